@@ -0,0 +1,14 @@
+#include "ofMain.h"
+#include "ofApp.h"
+#include "ofAppNoWindow.h"
+
+//========================================================================
+int main(int argc, char *argv[]){
+	// no window and no GL context, the benchmark runs on headless machines
+	auto window = std::make_shared<ofAppNoWindow>();
+	auto app = std::make_shared<ofApp>();
+	app->args = std::vector<std::string>(argv, argv + argc);
+
+	ofRunApp(window, app);
+	return ofRunMainLoop();
+}
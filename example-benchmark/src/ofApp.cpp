@@ -0,0 +1,1177 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofApp.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <random>
+#ifndef TARGET_WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+std::string formatName(ofPixelFormat pixelFormat) {
+    switch (pixelFormat) {
+        case OF_PIXELS_GRAY: return "GRAY";
+        case OF_PIXELS_GRAY_ALPHA: return "GRAY_ALPHA";
+        case OF_PIXELS_RGB: return "RGB";
+        case OF_PIXELS_BGR: return "BGR";
+        case OF_PIXELS_RGBA: return "RGBA";
+        case OF_PIXELS_BGRA: return "BGRA";
+        default: return "UNKNOWN";
+    }
+}
+
+// walls on a grid of cells with passages carved by a depth first walk, so
+// every cell is connected through long winding corridors
+void drawMaze(ofxHeadlessFbo &fbo, size_t cell, std::mt19937 &rng) {
+    const size_t w = fbo.getWidth();
+    const size_t h = fbo.getHeight();
+    fbo.disableAlphaBlending();
+    fbo.clear(ofColor(0));
+    fbo.setColor(ofColor(255));
+    for (size_t y = 0; y < h; y += cell) {
+        fbo.drawRectangle(0, y, w, 1);
+    }
+    for (size_t x = 0; x < w; x += cell) {
+        fbo.drawRectangle(x, 0, 1, h);
+    }
+
+    const int cellsX = w / cell;
+    const int cellsY = h / cell;
+    std::vector<char> seen(cellsX * cellsY, 0);
+    std::vector<int> stack = {0};
+    seen[0] = 1;
+    fbo.setColor(ofColor(0));
+    const int dx[] = {1, -1, 0, 0};
+    const int dy[] = {0, 0, 1, -1};
+    while (!stack.empty()) {
+        const int cx = stack.back() % cellsX;
+        const int cy = stack.back() / cellsX;
+        int options[4];
+        int count = 0;
+        for (int k = 0; k < 4; ++k) {
+            const int nx = cx + dx[k];
+            const int ny = cy + dy[k];
+            if (nx >= 0 && ny >= 0 && nx < cellsX && ny < cellsY && !seen[ny * cellsX + nx]) {
+                options[count++] = k;
+            }
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        const int k = options[rng() % count];
+        const int nx = cx + dx[k];
+        const int ny = cy + dy[k];
+        seen[ny * cellsX + nx] = 1;
+        stack.push_back(ny * cellsX + nx);
+        if (dx[k] != 0) {
+            fbo.drawRectangle(std::max(cx, nx) * cell, cy * cell + 1, 1, cell - 1);
+        } else {
+            fbo.drawRectangle(cx * cell + 1, std::max(cy, ny) * cell, cell - 1, 1);
+        }
+    }
+}
+
+double nowNs() {
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--quick") {
+            quick = true;
+        } else if (args[i] == "--out" && i + 1 < args.size()) {
+            outPath = args[++i];
+        } else if (args[i] == "--filter" && i + 1 < args.size()) {
+            filter = args[++i];
+        } else if (args[i] == "--scaling") {
+            scaling = true;
+        } else if (args[i] == "--pipeline") {
+            pipeline = true;
+        } else if (args[i] == "--floodfill") {
+            floodFill = true;
+        } else if (args[i] == "--delta") {
+            delta = true;
+        } else if (args[i] == "--framebuffer") {
+            framebuffer = true;
+        } else if (args[i] == "--dmx") {
+            dmx = true;
+        } else if (args[i] == "--startup") {
+            startup = true;
+        }
+    }
+
+    if (startup) {
+        // compared with the GL-less core test by tests/Makefile's measure target
+#ifndef TARGET_WIN32
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        std::printf("peak RSS %ld kB\n", usage.ru_maxrss);
+#endif
+        ofExit(0);
+        return;
+    }
+
+    if (dmx) {
+        ofExit(runDmx() ? 0 : 1);
+        return;
+    }
+
+    if (framebuffer) {
+        ofExit(runFramebuffer() ? 0 : 1);
+        return;
+    }
+
+    if (delta) {
+        ofExit(runDelta() ? 0 : 1);
+        return;
+    }
+
+    if (floodFill) {
+        runFloodFill();
+        ofExit(0);
+        return;
+    }
+
+    if (pipeline) {
+        ofExit(runPipeline() ? 0 : 1);
+        return;
+    }
+
+    if (scaling) {
+        runScaling();
+        ofExit(0);
+        return;
+    }
+
+    const std::vector<std::string> primitives = {"point", "line", "rectangle", "triangle",
+                                                 "circle", "ellipse", "rectRounded"};
+    std::vector<ofPixelFormat> formats = {OF_PIXELS_GRAY, OF_PIXELS_GRAY_ALPHA, OF_PIXELS_RGB,
+                                          OF_PIXELS_RGBA, OF_PIXELS_BGRA};
+    std::vector<glm::vec2> canvases = {{64, 64}, {512, 512}, {1920, 1080}};
+    std::vector<float> sizes = {4, 32, 256};
+    if (quick) {
+        formats = {OF_PIXELS_RGB, OF_PIXELS_RGBA};
+        canvases = {{512, 512}};
+        sizes = {4, 64};
+    }
+
+    results = ofJson::object();
+    results["quick"] = quick;
+    results["cases"] = ofJson::array();
+
+    for (const auto &primitive : primitives) {
+        if (!filter.empty() && primitive.find(filter) == std::string::npos) {
+            continue;
+        }
+        for (auto pixelFormat : formats) {
+            for (const auto &canvas : canvases) {
+                for (float size : sizes) {
+                    // points have no size, lines don't care about fill
+                    if (primitive == "point" && size != sizes.front()) {
+                        continue;
+                    }
+                    // integer coordinates only at the smallest size, where the float conversion weighs most
+                    const int numCoordinates = size == sizes.front() ? 2 : 1;
+                    for (int blending = 0; blending < 2; ++blending) {
+                        for (int fill = 1; fill >= 0; --fill) {
+                            for (int integer = 0; integer < numCoordinates; ++integer) {
+                                if ((primitive == "point" || primitive == "line") && !fill) {
+                                    continue;
+                                }
+
+                                Case c;
+                                c.primitive = primitive;
+                                c.pixelFormat = pixelFormat;
+                                c.blending = blending;
+                                c.fill = fill;
+                                c.canvasW = canvas.x;
+                                c.canvasH = canvas.y;
+                                c.size = size;
+                                c.integer = integer;
+
+                                const Result r = run(c);
+
+                                ofJson entry;
+                                entry["primitive"] = c.primitive;
+                                entry["format"] = formatName(c.pixelFormat);
+                                entry["blending"] = c.blending;
+                                entry["fill"] = c.fill;
+                                entry["canvas"] = {c.canvasW, c.canvasH};
+                                entry["size"] = c.size;
+                                entry["integer"] = c.integer;
+                                entry["primitivesPerBatch"] = r.primitivesPerBatch;
+                                entry["repetitions"] = r.repetitions;
+                                entry["nsPerPrimitive"] = {{"median", r.nsPerPrimitiveMedian},
+                                                           {"mean", r.nsPerPrimitiveMean},
+                                                           {"stddev", r.nsPerPrimitiveStdDev},
+                                                           {"min", r.nsPerPrimitiveMin}};
+                                entry["pixelsPerPrimitive"] = r.pixelsPerPrimitive;
+                                entry["pixelsPerSecond"] = r.pixelsPerSecond;
+                                results["cases"].push_back(entry);
+
+                                ofLogNotice("benchmark")
+                                    << c.primitive << " " << formatName(c.pixelFormat) << " " << c.canvasW << "x"
+                                    << c.canvasH << " size " << c.size << (c.integer ? " int" : "")
+                                    << (c.blending ? " blend" : "") << (c.fill ? " fill" : " outline") << ": " << r.nsPerPrimitiveMedian
+                                    << " ns/primitive, " << r.pixelsPerSecond / 1e6 << " Mpixels/s";
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved " << results["cases"].size() << " results to " << outPath;
+    ofExit(0);
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+
+}
+
+//--------------------------------------------------------------
+ofApp::Result ofApp::run(const Case &c){
+    ofxHeadlessFbo fbo;
+    fbo.allocate(c.canvasW, c.canvasH, c.pixelFormat);
+    fbo.clear(ofColor(0, 0, 0, 255));
+    if (c.fill)
+        fbo.setFill();
+    else
+        fbo.setNoFill();
+    if (c.blending)
+        fbo.enableAlphaBlending();
+    else
+        fbo.disableAlphaBlending();
+    fbo.setColor(ofColor(255, 127, 0, 127));
+
+    // fixed seed so every run draws the same primitives
+    std::mt19937 rng(1234);
+    const float maxX = std::max(1.0f, c.canvasW - c.size);
+    const float maxY = std::max(1.0f, c.canvasH - c.size);
+    std::uniform_real_distribution<float> randomX(0, maxX);
+    std::uniform_real_distribution<float> randomY(0, maxY);
+    std::uniform_real_distribution<float> randomAngle(0, TWO_PI);
+    std::vector<glm::vec4> params(4096);
+    for (auto &p : params) {
+        p = glm::vec4(randomX(rng), randomY(rng), randomAngle(rng), 0);
+    }
+
+    auto drawBatch = [&](size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            drawPrimitive(fbo, c, params[i % params.size()]);
+        }
+    };
+
+    // warm up and size the batch so a repetition takes about a millisecond
+    size_t batch = 16;
+    const double targetNs = quick ? 2e5 : 1e6;
+    while (batch < 65536) {
+        const double t1 = nowNs();
+        drawBatch(batch);
+        const double elapsed = nowNs() - t1;
+        if (elapsed >= targetNs) {
+            break;
+        }
+        batch *= 2;
+    }
+    drawBatch(batch);
+
+    const size_t repetitions = quick ? 5 : 25;
+    std::vector<double> samples;
+    samples.reserve(repetitions);
+    for (size_t r = 0; r < repetitions; ++r) {
+        const double t1 = nowNs();
+        drawBatch(batch);
+        const double t2 = nowNs();
+        samples.push_back((t2 - t1) / batch);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double variance = 0;
+    for (double s : samples) {
+        variance += (s - mean) * (s - mean);
+    }
+
+    Result result;
+    result.primitivesPerBatch = batch;
+    result.repetitions = repetitions;
+    result.nsPerPrimitiveMedian = samples[samples.size() / 2];
+    result.nsPerPrimitiveMean = mean;
+    result.nsPerPrimitiveStdDev = std::sqrt(variance / samples.size());
+    result.nsPerPrimitiveMin = samples.front();
+    result.pixelsPerPrimitive = estimatePixels(c);
+    result.pixelsPerSecond = result.pixelsPerPrimitive * 1e9 / result.nsPerPrimitiveMedian;
+    return result;
+}
+
+//--------------------------------------------------------------
+void ofApp::drawPrimitive(ofxHeadlessFbo &fbo, const Case &c, const glm::vec4 &p){
+    if (c.integer) {
+        drawPrimitiveInt(fbo, c, p);
+        return;
+    }
+    const float s = c.size;
+    if (c.primitive == "point") {
+        fbo.drawPoint(p.x, p.y);
+    } else if (c.primitive == "line") {
+        const float cx = p.x + s / 2;
+        const float cy = p.y + s / 2;
+        const float dx = std::cos(p.z) * s / 2;
+        const float dy = std::sin(p.z) * s / 2;
+        fbo.drawLine(cx - dx, cy - dy, cx + dx, cy + dy);
+    } else if (c.primitive == "rectangle") {
+        fbo.drawRectangle(p.x, p.y, s, s);
+    } else if (c.primitive == "triangle") {
+        fbo.drawTriangle(p.x, p.y + s, p.x + s / 2, p.y, p.x + s, p.y + s);
+    } else if (c.primitive == "circle") {
+        fbo.drawCircle(p.x + s / 2, p.y + s / 2, s / 2);
+    } else if (c.primitive == "ellipse") {
+        fbo.drawEllipse(p.x + s / 2, p.y + s / 2, s, s / 2);
+    } else if (c.primitive == "rectRounded") {
+        fbo.drawRectRounded(p.x, p.y, s, s / 2, s / 8);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::drawPrimitiveInt(ofxHeadlessFbo &fbo, const Case &c, const glm::vec4 &p){
+    // the same primitives as drawPrimitive() with every argument an int
+    const int x = static_cast<int>(p.x);
+    const int y = static_cast<int>(p.y);
+    const int s = static_cast<int>(c.size);
+    if (c.primitive == "point") {
+        fbo.drawPoint(x, y);
+    } else if (c.primitive == "line") {
+        const int dx = static_cast<int>(std::cos(p.z) * s / 2);
+        const int dy = static_cast<int>(std::sin(p.z) * s / 2);
+        fbo.drawLine(x + s / 2 - dx, y + s / 2 - dy, x + s / 2 + dx, y + s / 2 + dy);
+    } else if (c.primitive == "rectangle") {
+        fbo.drawRectangle(x, y, s, s);
+    } else if (c.primitive == "triangle") {
+        fbo.drawTriangle(x, y + s, x + s / 2, y, x + s, y + s);
+    } else if (c.primitive == "circle") {
+        fbo.drawCircle(x + s / 2, y + s / 2, s / 2);
+    } else if (c.primitive == "ellipse") {
+        fbo.drawEllipse(x + s / 2, y + s / 2, s, s / 2);
+    } else if (c.primitive == "rectRounded") {
+        fbo.drawRectRounded(x, y, s, s / 2, s / 8);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::runScaling(){
+    std::vector<size_t> counts = {1, 4, 16, 50, 100, 200, 400};
+    if (quick) {
+        counts = {1, 16, 100, 400};
+    }
+    const size_t repetitions = quick ? 5 : 25;
+
+    ofxHeadlessFboScheduler scheduler;
+    scheduler.setup();
+
+    results = ofJson::object();
+    results["quick"] = quick;
+    results["threads"] = scheduler.getNumThreads();
+    results["scaling"] = ofJson::array();
+
+    // every tenth panel is a lot busier, which the scheduler has to balance
+    auto drawPanel = [](ofxHeadlessFbo &fbo, size_t index) {
+        fbo.clear(ofColor(0));
+        fbo.setColor(ofColor(255, 127, index % 256));
+        const size_t circles = index % 10 == 0 ? 256 : 32;
+        for (size_t i = 0; i < circles; ++i) {
+            fbo.drawCircle((i * 7) % 64, (i * 13) % 64, 4 + i % 12);
+        }
+    };
+
+    auto median = [](std::vector<double> &samples) {
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    };
+
+    for (size_t count : counts) {
+        std::vector<ofxHeadlessFbo> canvases(count);
+        for (auto &canvas : canvases) {
+            canvas.allocate(64, 64, OF_PIXELS_RGB);
+        }
+
+        std::vector<double> serial;
+        for (size_t r = 0; r < repetitions + 1; ++r) {
+            const double t1 = nowNs();
+            for (size_t i = 0; i < count; ++i) {
+                drawPanel(canvases[i], i);
+            }
+            if (r > 0) {
+                serial.push_back(nowNs() - t1);
+            }
+        }
+
+        scheduler.clear();
+        for (size_t i = 0; i < count; ++i) {
+            scheduler.add(canvases[i], [i, &drawPanel](ofxHeadlessFbo &fbo, ofxHeadlessFboScheduler::Scratch &) {
+                drawPanel(fbo, i);
+            });
+        }
+        // the first frame has no costs to balance with yet
+        scheduler.render();
+        std::vector<double> parallel;
+        uint64_t steals = 0;
+        for (size_t r = 0; r < repetitions; ++r) {
+            const double t1 = nowNs();
+            scheduler.render();
+            parallel.push_back(nowNs() - t1);
+            steals += scheduler.getSteals();
+        }
+
+        const double serialMs = median(serial) / 1e6;
+        const double parallelMs = median(parallel) / 1e6;
+        ofJson entry;
+        entry["canvases"] = count;
+        entry["serialMs"] = serialMs;
+        entry["schedulerMs"] = parallelMs;
+        entry["speedup"] = serialMs / parallelMs;
+        entry["stealsPerFrame"] = static_cast<double>(steals) / repetitions;
+        results["scaling"].push_back(entry);
+
+        ofLogNotice("benchmark") << count << " canvases: serial " << serialMs << " ms, scheduler " << parallelMs
+                                 << " ms, speedup " << serialMs / parallelMs << " on "
+                                 << scheduler.getNumThreads() << " threads";
+    }
+    scheduler.clear();
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved " << results["scaling"].size() << " results to " << outPath;
+}
+
+//--------------------------------------------------------------
+bool ofApp::runPipeline(){
+#ifdef TARGET_WIN32
+    ofLogError("benchmark") << "--pipeline needs POSIX sockets";
+    return false;
+#else
+    const size_t frames = quick ? 200 : 1000;
+    const size_t packetSize = 512;
+
+    // local sink counting the packets of each phase, an empty datagram ends
+    // a phase and the sink stops after the second one
+    const int sink = socket(AF_INET, SOCK_DGRAM, 0);
+    const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    bind(sink, reinterpret_cast<sockaddr *>(&address), addressSize);
+    getsockname(sink, reinterpret_cast<sockaddr *>(&address), &addressSize);
+    int receiveBuffer = 8 << 20;
+    setsockopt(sink, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    timeval timeout = {2, 0};
+    setsockopt(sink, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    const size_t numPhases = 2;
+    size_t received[numPhases] = {};
+    std::atomic<size_t> phasesDone(0);
+    std::thread sinkThread([&]() {
+        unsigned char packet[packetSize];
+        size_t count = 0;
+        while (phasesDone < numPhases) {
+            const ssize_t size = recv(sink, packet, sizeof(packet), 0);
+            if (size < 0) {
+                break;
+            } else if (size == 0) {
+                received[phasesDone] = count;
+                count = 0;
+                phasesDone++;
+            } else {
+                count++;
+            }
+        }
+    });
+    auto endPhase = [&](size_t phase) {
+        sendto(sender, nullptr, 0, 0, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (phasesDone <= phase && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (phasesDone <= phase) {
+            ofLogWarning("benchmark") << "the sink didn't see the end of phase " << phase;
+        }
+    };
+
+    ofxHeadlessFbo fbo;
+    fbo.allocate(170, 100, OF_PIXELS_RGB);
+    auto drawFrame = [&](size_t n) {
+        fbo.clear(ofColor(0));
+        fbo.setColor(ofColor::fromHsb(n % 256, 255, 255));
+        for (size_t i = 0; i < 64; ++i) {
+            fbo.drawCircle((n + i * 11) % 170, (i * 7) % 100, 6 + i % 8);
+        }
+    };
+
+    unsigned char gamma[256];
+    for (int i = 0; i < 256; ++i) {
+        gamma[i] = static_cast<unsigned char>(std::pow(i / 255.0, 2.2) * 255 + 0.5);
+    }
+    auto correct = [&](ofPixels &pixels) {
+        unsigned char *p = pixels.getData();
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            p[i] = gamma[p[i]];
+        }
+    };
+    auto packetize = [&](const ofPixels &pixels, std::vector<unsigned char> &data) {
+        // a 2 byte universe number in front of every 510 bytes of channels
+        const size_t payload = packetSize - 2;
+        const size_t packets = (pixels.size() + payload - 1) / payload;
+        data.assign(packets * packetSize, 0);
+        for (size_t i = 0; i < packets; ++i) {
+            unsigned char *packet = data.data() + i * packetSize;
+            packet[0] = i & 0xff;
+            packet[1] = i >> 8;
+            const size_t bytes = std::min(payload, pixels.size() - i * payload);
+            std::memcpy(packet + 2, pixels.getData() + i * payload, bytes);
+        }
+    };
+    auto send = [&](const std::vector<unsigned char> &data) {
+        for (size_t offset = 0; offset < data.size(); offset += packetSize) {
+            sendto(sender, data.data() + offset, packetSize, 0, reinterpret_cast<sockaddr *>(&address),
+                   sizeof(address));
+        }
+    };
+
+    ofPixels pixels;
+    std::vector<unsigned char> data;
+    double t1 = nowNs();
+    for (size_t n = 0; n < frames; ++n) {
+        drawFrame(n);
+        fbo.readPixels(pixels);
+        correct(pixels);
+        packetize(pixels, data);
+        send(data);
+    }
+    const double serialMs = (nowNs() - t1) / 1e6 / frames;
+    const size_t packetsPerFrame = data.size() / packetSize;
+    endPhase(0);
+
+    ofxHeadlessFboPipeline pipeline;
+    pipeline.addStage("gamma", [&](ofxHeadlessFboFrame &frame) { correct(frame.pixels); });
+    pipeline.addStage("packetize", [&](ofxHeadlessFboFrame &frame) { packetize(frame.pixels, frame.data); });
+    pipeline.addStage("send", [&](ofxHeadlessFboFrame &frame) { send(frame.data); });
+    pipeline.setup(4);
+    t1 = nowNs();
+    for (size_t n = 0; n < frames; ++n) {
+        drawFrame(n);
+        pipeline.submit(fbo);
+    }
+    pipeline.flush();
+    const double pipelinedMs = (nowNs() - t1) / 1e6 / frames;
+    endPhase(1);
+    sinkThread.join();
+    ::close(sink);
+    ::close(sender);
+
+    results = ofJson::object();
+    results["quick"] = quick;
+    results["frames"] = frames;
+    results["serialMsPerFrame"] = serialMs;
+    results["pipelineMsPerFrame"] = pipelinedMs;
+    const size_t packetsSent = frames * packetsPerFrame;
+    const char *phaseNames[numPhases] = {"serial", "pipeline"};
+    bool complete = true;
+    for (size_t phase = 0; phase < numPhases; ++phase) {
+        results["packets"][phaseNames[phase]] = {{"sent", packetsSent}, {"received", received[phase]}};
+        if (received[phase] != packetsSent) {
+            complete = false;
+            ofLogError("benchmark") << phaseNames[phase] << ": " << received[phase] << " of " << packetsSent
+                                    << " packets received, UDP lost " << packetsSent - std::min(received[phase], packetsSent);
+        }
+    }
+    auto toJson = [](const ofxHeadlessFboLatencyHistogram &histogram) {
+        return ofJson{{"meanUs", histogram.getMeanNs() / 1e3},
+                      {"p50Us", histogram.getPercentileNs(50) / 1e3},
+                      {"p99Us", histogram.getPercentileNs(99) / 1e3},
+                      {"maxUs", histogram.maxNs / 1e3}};
+    };
+    results["latency"] = toJson(pipeline.getLatency());
+    for (const auto &stage : pipeline.getStageStats()) {
+        results["stages"][stage.name] = {{"wait", toJson(stage.wait)}, {"process", toJson(stage.process)}};
+        ofLogNotice("benchmark") << stage.name << ": process p50 " << stage.process.getPercentileNs(50) / 1e3
+                                 << " us, p99 " << stage.process.getPercentileNs(99) / 1e3 << " us, wait p50 "
+                                 << stage.wait.getPercentileNs(50) / 1e3 << " us";
+    }
+    pipeline.close();
+
+    ofLogNotice("benchmark") << "serial " << serialMs << " ms/frame, pipelined " << pipelinedMs
+                             << " ms/frame, latency p50 " << pipeline.getLatency().getPercentileNs(50) / 1e3
+                             << " us, " << received[0] << " and " << received[1] << " of " << packetsSent
+                             << " packets received";
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved pipeline results to " << outPath;
+    return complete;
+#endif
+}
+
+//--------------------------------------------------------------
+bool ofApp::runDelta(){
+#ifdef TARGET_WIN32
+    ofLogError("benchmark") << "--delta needs POSIX sockets";
+    return false;
+#else
+    const size_t frames = quick ? 200 : 1000;
+    // small enough for a keyframe to fit in one datagram
+    const size_t w = 160;
+    const size_t h = 120;
+
+    const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    bind(receiver, reinterpret_cast<sockaddr *>(&address), addressSize);
+    getsockname(receiver, reinterpret_cast<sockaddr *>(&address), &addressSize);
+    timeval timeout = {1, 0};
+    setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // a static backdrop with a few shapes moving over it
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    auto drawFrame = [&](size_t n) {
+        fbo.clear(ofColor(20));
+        fbo.setColor(ofColor(60, 60, 90));
+        for (size_t y = 0; y < h; y += 20) {
+            fbo.drawRectangle(0, y, w, 2);
+        }
+        fbo.setColor(ofColor::fromHsb(n % 256, 255, 255));
+        fbo.drawCircle((n * 2) % w, h / 2, 10);
+        fbo.drawRectangle(20, (n % (h - 16)), 16, 16);
+        fbo.drawLine(0, n % h, w - 1, h - 1 - n % h);
+    };
+
+    ofxHeadlessFboDeltaEncoder encoder;
+    ofxHeadlessFboDeltaDecoder decoder;
+    std::vector<unsigned char> packet;
+    std::vector<unsigned char> received(65536);
+    std::vector<double> encodeNs;
+    size_t totalBytes = 0;
+    size_t keyframes = 0;
+    size_t keyframeBytes = 0;
+    size_t lost = 0;
+    size_t rejected = 0;
+    size_t mismatches = 0;
+    for (size_t n = 0; n < frames; ++n) {
+        drawFrame(n);
+        const double t1 = nowNs();
+        const size_t bytes = encoder.encode(fbo, packet);
+        encodeNs.push_back(nowNs() - t1);
+        totalBytes += bytes;
+        if (encoder.isLastKeyframe()) {
+            keyframes++;
+            keyframeBytes += bytes;
+        }
+
+        sendto(sender, packet.data(), bytes, 0, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        const ssize_t size = recv(receiver, received.data(), received.size(), 0);
+        if (size < 0) {
+            lost++;
+            encoder.requestKeyframe();
+            continue;
+        }
+        if (!decoder.decode(received.data(), size)) {
+            rejected++;
+            encoder.requestKeyframe();
+            continue;
+        }
+        const ofPixels &decoded = decoder.getPixels();
+        const ofPixels &canvas = fbo.getPixels();
+        if (decoded.size() != canvas.size() || std::memcmp(decoded.getData(), canvas.getData(), canvas.size()) != 0) {
+            mismatches++;
+        }
+    }
+    ::close(receiver);
+    ::close(sender);
+
+    std::sort(encodeNs.begin(), encodeNs.end());
+    const double encodeMedian = encodeNs[encodeNs.size() / 2];
+    const double encodeMean = std::accumulate(encodeNs.begin(), encodeNs.end(), 0.0) / frames;
+    const size_t rawBytes = fbo.getPixels().size();
+    const double bytesPerFrame = static_cast<double>(totalBytes) / frames;
+    const double deltaBytes =
+        keyframes < frames ? static_cast<double>(totalBytes - keyframeBytes) / (frames - keyframes) : 0;
+
+    results = ofJson::object();
+    results["quick"] = quick;
+    results["frames"] = frames;
+    results["canvas"] = {w, h};
+    results["rawBytesPerFrame"] = rawBytes;
+    results["bytesPerFrame"] = bytesPerFrame;
+    results["bytesPerDeltaFrame"] = deltaBytes;
+    results["keyframes"] = keyframes;
+    results["encodeNs"] = {{"median", encodeMedian}, {"mean", encodeMean}};
+    results["lost"] = lost;
+    results["rejected"] = rejected;
+    results["mismatches"] = mismatches;
+
+    ofLogNotice("benchmark") << "delta " << w << "x" << h << " RGB: " << bytesPerFrame << " bytes/frame ("
+                             << deltaBytes << " per delta frame, " << rawBytes << " raw), " << keyframes
+                             << " keyframes, encode median " << encodeMedian << " ns, mean " << encodeMean << " ns";
+    if (lost > 0 || rejected > 0 || mismatches > 0) {
+        ofLogError("benchmark") << "delta round trip failed: " << lost << " frames lost, " << rejected
+                                << " rejected by the decoder, " << mismatches << " decoded frames differ from the canvas";
+    } else {
+        ofLogNotice("benchmark") << "all " << frames << " frames decoded identical to the canvas";
+    }
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved delta results to " << outPath;
+    return lost == 0 && rejected == 0 && mismatches == 0;
+#endif
+}
+
+//--------------------------------------------------------------
+bool ofApp::runFramebuffer(){
+#ifdef TARGET_WIN32
+    ofLogError("benchmark") << "--framebuffer needs POSIX file mapping";
+    return false;
+#else
+    // the canvas is presented off the origin of a larger target with padded rows
+    const size_t w = 64;
+    const size_t h = 48;
+    const size_t targetW = w + 8;
+    const size_t targetH = h + 4;
+    const size_t offsetX = 5;
+    const size_t offsetY = 3;
+    const unsigned char poison = 0xA5;
+    const std::string path = ofToDataPath("framebuffer.raw", true);
+    const std::vector<std::pair<ofxHeadlessFboOutputFormat, std::string>> formats = {
+        {OFX_HEADLESS_FBO_OUTPUT_RGB565, "RGB565"},
+        {OFX_HEADLESS_FBO_OUTPUT_XRGB8888, "XRGB8888"},
+        {OFX_HEADLESS_FBO_OUTPUT_BGRA8888, "BGRA8888"}};
+
+    auto readFile = [&]() {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+    // reference conversion of the whole canvas into the target layout
+    auto convert = [&](const ofxHeadlessFbo &fbo, ofxHeadlessFboOutputFormat format, size_t stride) {
+        const size_t bytes = format == OFX_HEADLESS_FBO_OUTPUT_RGB565 ? 2 : 4;
+        std::vector<unsigned char> target(stride * targetH, 0);
+        const unsigned char *src = fbo.getPixels().getData();
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x, src += 4) {
+                unsigned char *dst = target.data() + (offsetY + y) * stride + (offsetX + x) * bytes;
+                if (format == OFX_HEADLESS_FBO_OUTPUT_RGB565) {
+                    const unsigned int v = ((src[0] & 0xF8u) << 8) | ((src[1] & 0xFCu) << 3) | (src[2] >> 3);
+                    dst[0] = v & 0xff;
+                    dst[1] = v >> 8;
+                } else {
+                    dst[0] = src[2];
+                    dst[1] = src[1];
+                    dst[2] = src[0];
+                    dst[3] = format == OFX_HEADLESS_FBO_OUTPUT_XRGB8888 ? 255 : src[3];
+                }
+            }
+        }
+        return target;
+    };
+
+    results = ofJson::object();
+    results["framebuffer"] = ofJson::array();
+    size_t failures = 0;
+    for (const auto &format : formats) {
+        ofxHeadlessFbo fbo;
+        fbo.allocate(w, h, OF_PIXELS_RGBA);
+        fbo.disableAlphaBlending();
+        fbo.clear(ofColor(10, 20, 30));
+        for (size_t y = 0; y < h; ++y) {
+            fbo.setColor(ofColor(y * 5, 255 - y * 5, y * 3, 255 - y));
+            fbo.drawRectangle(0, y, w / 2, 1);
+        }
+        fbo.setColor(ofColor(200, 100, 50, 128));
+        fbo.drawCircle(44, 24, 14);
+
+        const size_t bytes = format.first == OFX_HEADLESS_FBO_OUTPUT_RGB565 ? 2 : 4;
+        const size_t stride = targetW * bytes + 12;
+        std::remove(path.c_str());
+        ofxHeadlessFboFramebuffer fb;
+        if (!fb.openFile(path, targetW, targetH, format.first, stride)) {
+            ofLogError("benchmark") << "couldn't open " << path;
+            failures++;
+            continue;
+        }
+
+        // the first frame converts the whole canvas
+        fb.present(fbo, offsetX, offsetY);
+        std::vector<unsigned char> expected = convert(fbo, format.first, stride);
+        std::vector<unsigned char> contents = readFile();
+        size_t frameMismatches = contents.size() == expected.size() ? 0 : expected.size();
+        for (size_t i = 0; i < std::min(contents.size(), expected.size()); ++i) {
+            frameMismatches += contents[i] != expected[i];
+        }
+
+        // the next one only the dirty rectangle, everything else keeps the marker
+        fbo.resetDirtyRegion();
+        fbo.setColor(ofColor(255, 255, 0, 200));
+        fbo.drawRectangle(20, 10, 6, 5);
+        const ofRectangle dirty = fbo.getDirtyRegion();
+        const size_t rowStart = offsetY + dirty.y;
+        const size_t rowEnd = rowStart + dirty.height;
+        const size_t byteStart = (offsetX + dirty.x) * bytes;
+        const size_t byteEnd = byteStart + dirty.width * bytes;
+        auto inside = [&](size_t i) {
+            const size_t row = i / stride;
+            const size_t column = i % stride;
+            return row >= rowStart && row < rowEnd && column >= byteStart && column < byteEnd;
+        };
+        unsigned char *mapped = fb.getData();
+        for (size_t i = 0; i < stride * targetH; ++i) {
+            if (!inside(i)) {
+                mapped[i] = poison;
+            }
+        }
+        fb.present(fbo, offsetX, offsetY);
+        expected = convert(fbo, format.first, stride);
+        contents = readFile();
+        size_t dirtyMismatches = contents.size() == expected.size() ? 0 : expected.size();
+        for (size_t i = 0; i < std::min(contents.size(), expected.size()); ++i) {
+            dirtyMismatches += contents[i] != (inside(i) ? expected[i] : poison);
+        }
+        fb.close();
+        std::remove(path.c_str());
+
+        ofJson entry;
+        entry["format"] = format.second;
+        entry["frameMismatches"] = frameMismatches;
+        entry["dirty"] = {dirty.x, dirty.y, dirty.width, dirty.height};
+        entry["dirtyMismatches"] = dirtyMismatches;
+        results["framebuffer"].push_back(entry);
+
+        if (frameMismatches > 0 || dirtyMismatches > 0) {
+            failures++;
+            ofLogError("benchmark") << "framebuffer " << format.second << ": " << frameMismatches
+                                    << " bytes differ after the first present, " << dirtyMismatches
+                                    << " bytes wrong after presenting the dirty rectangle " << dirty;
+        } else {
+            ofLogNotice("benchmark") << "framebuffer " << format.second << ": file matches the canvas, only the dirty rectangle "
+                                     << dirty << " was rewritten";
+        }
+    }
+    results["failures"] = failures;
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved framebuffer results to " << outPath;
+    return failures == 0;
+#endif
+}
+
+//--------------------------------------------------------------
+bool ofApp::runDmx(){
+#ifdef TARGET_WIN32
+    ofLogError("benchmark") << "--dmx needs POSIX sockets";
+    return false;
+#else
+    const size_t frames = quick ? 50 : 500;
+    const size_t w = 100;
+    const size_t h = 40;
+
+    // a strip of full universes, and a region hanging off the left and bottom
+    // edges with 5 pixels per universe, an odd 15 channels
+    struct Region {
+        int x;
+        int y;
+        size_t w;
+        size_t h;
+        uint16_t firstUniverse;
+        size_t pixelsPerUniverse;
+    };
+    const std::vector<Region> regions = {{0, 0, w, 8, 1, 0}, {-3, 35, 11, 7, 20, 5}};
+
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    auto drawFrame = [&](size_t n) {
+        fbo.clear(ofColor(0));
+        fbo.setColor(ofColor::fromHsb(n % 256, 255, 255));
+        for (size_t i = 0; i < 16; ++i) {
+            fbo.drawCircle((n + i * 13) % w, (i * 7) % h, 3 + i % 5);
+        }
+    };
+
+    // reference universes gathered pixel by pixel from the canvas
+    struct Expected {
+        uint16_t number;
+        std::vector<unsigned char> slots;
+    };
+    auto gather = [&]() {
+        std::vector<Expected> expected;
+        const unsigned char *pixels = fbo.getPixels().getData();
+        for (const auto &region : regions) {
+            const size_t perUniverse = region.pixelsPerUniverse > 0 ? std::min<size_t>(region.pixelsPerUniverse, 170) : 170;
+            for (size_t first = 0, n = 0; first < region.w * region.h; first += perUniverse, ++n) {
+                Expected universe;
+                universe.number = region.firstUniverse + n;
+                for (size_t i = first; i < std::min(first + perUniverse, region.w * region.h); ++i) {
+                    const int x = region.x + static_cast<int>(i % region.w);
+                    const int y = region.y + static_cast<int>(i / region.w);
+                    const bool inside = x >= 0 && y >= 0 && x < static_cast<int>(w) && y < static_cast<int>(h);
+                    for (size_t c = 0; c < 3; ++c) {
+                        universe.slots.push_back(inside ? pixels[(y * w + x) * 3 + c] : 0);
+                    }
+                }
+                expected.push_back(std::move(universe));
+            }
+        }
+        return expected;
+    };
+
+    results = ofJson::object();
+    results["quick"] = quick;
+    results["frames"] = frames;
+    results["dmx"] = ofJson::array();
+    const std::vector<std::pair<ofxHeadlessFboDmxProtocol, std::string>> protocols = {
+        {OFX_HEADLESS_FBO_DMX_ARTNET, "Art-Net"}, {OFX_HEADLESS_FBO_DMX_SACN, "sACN"}};
+    size_t failures = 0;
+    for (const auto &protocol : protocols) {
+        const bool artNet = protocol.first == OFX_HEADLESS_FBO_DMX_ARTNET;
+        const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressSize = sizeof(address);
+        bind(receiver, reinterpret_cast<sockaddr *>(&address), addressSize);
+        getsockname(receiver, reinterpret_cast<sockaddr *>(&address), &addressSize);
+        int receiveBuffer = 8 << 20;
+        setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        timeval timeout = {1, 0};
+        setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        ofxHeadlessFboDmxSender sender;
+        sender.setup(protocol.first, "127.0.0.1", ntohs(address.sin_port));
+        for (const auto &region : regions) {
+            sender.mapRegion(region.x, region.y, region.w, region.h, region.firstUniverse, region.pixelsPerUniverse);
+        }
+
+        size_t lost = 0;
+        size_t badHeaders = 0;
+        size_t badUniverses = 0;
+        size_t badLengths = 0;
+        size_t badSequences = 0;
+        size_t badPayloads = 0;
+        size_t packets = 0;
+        std::vector<double> sendNs;
+        unsigned char packet[1024];
+        uint8_t sequence = 0;
+        for (size_t n = 0; n < frames; ++n) {
+            drawFrame(n);
+            const double t1 = nowNs();
+            sender.send(fbo);
+            sendNs.push_back(nowNs() - t1);
+
+            // Art-Net skips sequence 0, it means sequencing is disabled
+            sequence++;
+            if (sequence == 0 && artNet) {
+                sequence = 1;
+            }
+            for (const auto &universe : gather()) {
+                const ssize_t size = recv(receiver, packet, sizeof(packet), 0);
+                if (size < 0) {
+                    lost++;
+                    continue;
+                }
+                packets++;
+                const size_t slots = universe.slots.size();
+                const unsigned char *payload;
+                if (artNet) {
+                    // ArtDmx lengths are even, odd universes get a zero pad
+                    const size_t length = slots + slots % 2;
+                    payload = packet + 18;
+                    badHeaders += std::memcmp(packet, "Art-Net\0", 8) != 0 || packet[8] != 0x00 || packet[9] != 0x50 ||
+                                  packet[10] != 0 || packet[11] != 14 || packet[13] != 0;
+                    badUniverses += (packet[14] | (packet[15] << 8)) != universe.number;
+                    badLengths += static_cast<size_t>(size) != 18 + length ||
+                                  static_cast<size_t>((packet[16] << 8) | packet[17]) != length ||
+                                  (length != slots && packet[18 + slots] != 0);
+                    badSequences += packet[12] != sequence;
+                } else {
+                    auto pduLength = [&](size_t offset) {
+                        return static_cast<size_t>((packet[offset] << 8) | packet[offset + 1]);
+                    };
+                    payload = packet + 126;
+                    badHeaders += pduLength(0) != 0x0010 || pduLength(2) != 0 ||
+                                  std::memcmp(packet + 4, "ASC-E1.17\0\0\0", 12) != 0 || packet[21] != 0x04 ||
+                                  packet[43] != 0x02 || std::strncmp(reinterpret_cast<const char *>(packet + 44),
+                                                                     "ofxHeadlessFbo", 64) != 0 ||
+                                  packet[108] != 100 || packet[117] != 0x02 || packet[118] != 0xa1 ||
+                                  pduLength(119) != 0 || pduLength(121) != 1 || packet[125] != 0;
+                    badUniverses += pduLength(113) != universe.number;
+                    badLengths += static_cast<size_t>(size) != 126 + slots || pduLength(16) != (0x7000 | (size - 16)) ||
+                                  pduLength(38) != (0x7000 | (size - 38)) || pduLength(115) != (0x7000 | (size - 115)) ||
+                                  pduLength(123) != slots + 1;
+                    badSequences += packet[111] != sequence;
+                }
+                if (static_cast<size_t>(size) >= slots + (artNet ? 18 : 126)) {
+                    badPayloads += std::memcmp(payload, universe.slots.data(), slots) != 0;
+                }
+            }
+        }
+        ::close(receiver);
+
+        std::sort(sendNs.begin(), sendNs.end());
+        const double sendMedian = sendNs[sendNs.size() / 2];
+        const double syscallsPerFrame = static_cast<double>(sender.getSyscalls()) / frames;
+        const size_t packetsSent = sender.getPacketsSent();
+
+        ofJson entry;
+        entry["protocol"] = protocol.second;
+        entry["universes"] = sender.getNumUniverses();
+        entry["packetsSent"] = packetsSent;
+        entry["packetsReceived"] = packets;
+        entry["lost"] = lost;
+        entry["badHeaders"] = badHeaders;
+        entry["badUniverses"] = badUniverses;
+        entry["badLengths"] = badLengths;
+        entry["badSequences"] = badSequences;
+        entry["badPayloads"] = badPayloads;
+        entry["syscallsPerFrame"] = syscallsPerFrame;
+        entry["sendNsMedian"] = sendMedian;
+        results["dmx"].push_back(entry);
+
+        ofLogNotice("benchmark") << protocol.second << ": " << sender.getNumUniverses() << " universes, " << packets
+                                 << " of " << packetsSent << " packets received, " << syscallsPerFrame
+                                 << " syscalls/frame, send median " << sendMedian << " ns";
+        if (lost > 0 || badHeaders > 0 || badUniverses > 0 || badLengths > 0 || badSequences > 0 ||
+            badPayloads > 0) {
+            failures++;
+            ofLogError("benchmark") << protocol.second << " check failed: " << lost << " lost, " << badHeaders
+                                    << " bad headers, " << badUniverses << " wrong universes, " << badLengths
+                                    << " wrong lengths or padding, " << badSequences << " wrong sequences, "
+                                    << badPayloads << " payloads differ from the canvas";
+        }
+    }
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved dmx results to " << outPath;
+    return failures == 0;
+#endif
+}
+
+//--------------------------------------------------------------
+void ofApp::runFloodFill(){
+    std::vector<ofPixelFormat> formats = {OF_PIXELS_GRAY, OF_PIXELS_RGB, OF_PIXELS_RGBA};
+    std::vector<glm::vec2> canvases = {{512, 512}, {1920, 1080}};
+    std::vector<size_t> cells = {4, 16, 64};
+    if (quick) {
+        formats = {OF_PIXELS_RGB};
+        canvases = {{1920, 1080}};
+        cells = {4, 64};
+    }
+    const size_t repetitions = quick ? 5 : 15;
+
+    results = ofJson::object();
+    results["quick"] = quick;
+    results["floodFill"] = ofJson::array();
+
+    for (auto pixelFormat : formats) {
+        for (const auto &canvas : canvases) {
+            for (size_t cell : cells) {
+                for (int blending = 0; blending < 2; ++blending) {
+                    ofxHeadlessFbo fbo;
+                    fbo.allocate(canvas.x, canvas.y, pixelFormat);
+                    std::mt19937 rng(1234);
+                    drawMaze(fbo, cell, rng);
+                    if (blending) {
+                        fbo.enableAlphaBlending();
+                    }
+
+                    // every fill repaints the whole corridor system
+                    std::vector<double> samples;
+                    for (size_t r = 0; r < repetitions + 1; ++r) {
+                        fbo.setColor(ofColor(r % 2 ? 0 : 200, 127, 0, blending ? 200 : 255));
+                        const double t1 = nowNs();
+                        fbo.floodFill(cell / 2, cell / 2);
+                        if (r > 0) {
+                            samples.push_back(nowNs() - t1);
+                        }
+                    }
+                    std::sort(samples.begin(), samples.end());
+                    const double ms = samples[samples.size() / 2] / 1e6;
+                    const double area = (canvas.x - canvas.x / cell) * (canvas.y - canvas.y / cell);
+
+                    ofJson entry;
+                    entry["format"] = formatName(pixelFormat);
+                    entry["canvas"] = {canvas.x, canvas.y};
+                    entry["cell"] = cell;
+                    entry["blending"] = blending;
+                    entry["ms"] = ms;
+                    entry["pixelsPerSecond"] = area / ms * 1e3;
+                    results["floodFill"].push_back(entry);
+
+                    ofLogNotice("benchmark") << "floodFill " << formatName(pixelFormat) << " " << canvas.x << "x"
+                                             << canvas.y << " cell " << cell << (blending ? " blend" : "") << ": "
+                                             << ms << " ms, " << area / ms / 1e3 << " Mpixels/s";
+                }
+            }
+        }
+    }
+
+    ofSavePrettyJson(outPath, results);
+    ofLogNotice("benchmark") << "saved flood fill results to " << outPath;
+}
+
+//--------------------------------------------------------------
+double ofApp::estimatePixels(const Case &c){
+    // analytic coverage of one primitive, clipped to the canvas area
+    const double s = c.size;
+    double pixels = 1;
+    if (c.primitive == "line") {
+        pixels = s;
+    } else if (c.primitive == "rectangle") {
+        pixels = c.fill ? s * s : 4 * s;
+    } else if (c.primitive == "triangle") {
+        pixels = c.fill ? s * s / 2 : s * (1 + std::sqrt(5.0));
+    } else if (c.primitive == "circle") {
+        pixels = c.fill ? PI * s * s / 4 : PI * s;
+    } else if (c.primitive == "ellipse") {
+        pixels = c.fill ? PI * s * s / 8 : PI * s * 0.75;
+    } else if (c.primitive == "rectRounded") {
+        const double r = s / 8;
+        pixels = c.fill ? s * s / 2 - (4 - PI) * r * r : 3 * s - 8 * r + TWO_PI * r;
+    }
+    return std::min(pixels, static_cast<double>(c.canvasW * c.canvasH));
+}
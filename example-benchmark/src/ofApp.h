@@ -0,0 +1,109 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxHeadlessFbo.h"
+#include "ofxHeadlessFboDelta.h"
+#include "ofxHeadlessFboDmx.h"
+#include "ofxHeadlessFboFramebuffer.h"
+#include "ofxHeadlessFboPipeline.h"
+#include "ofxHeadlessFboScheduler.h"
+#include <chrono>
+
+/// Headless benchmark of the ofxHeadlessFbo rasterizer.
+///
+/// Every primitive is timed across pixel formats, blending, fill, canvas
+/// sizes and primitive sizes. Results are printed and saved as JSON so runs
+/// can be compared over time. With --scaling the frame time of 1 to 400
+/// canvases rendered serially and through ofxHeadlessFboScheduler is
+/// measured instead, with --pipeline frames are drawn, gamma corrected,
+/// packetized and sent to a local UDP sink serially and through
+/// ofxHeadlessFboPipeline. --floodfill times flood fills of maze corridors.
+/// --delta sends delta encoded frames of a moving scene over loopback UDP
+/// and checks that the decoded frames match the canvas. --framebuffer
+/// presents into a regular file through ofxHeadlessFboFramebuffer and checks
+/// its contents and that only the dirty rectangle is rewritten. --dmx sends
+/// Art-Net and sACN universes to a loopback receiver and checks every packet
+/// against the canvas. --pipeline, --delta, --framebuffer and --dmx exit
+/// with 1 when their check fails. --startup only prints the peak RSS.
+///
+///     ./example-benchmark [--quick] [--out results.json] [--filter circle] [--scaling] [--pipeline] [--floodfill] [--delta] [--framebuffer] [--dmx] [--startup]
+class ofApp : public ofBaseApp{
+
+	public:
+		void setup();
+		void update();
+
+        struct Case {
+            std::string primitive;
+            ofPixelFormat pixelFormat;
+            bool blending;
+            bool fill;
+            size_t canvasW;
+            size_t canvasH;
+            float size;
+            // integer coordinates, calling the integer versions of the primitives
+            bool integer = false;
+        };
+
+        struct Result {
+            size_t primitivesPerBatch = 0;
+            size_t repetitions = 0;
+            double nsPerPrimitiveMedian = 0;
+            double nsPerPrimitiveMean = 0;
+            double nsPerPrimitiveStdDev = 0;
+            double nsPerPrimitiveMin = 0;
+            double pixelsPerPrimitive = 0;
+            double pixelsPerSecond = 0;
+        };
+
+        Result run(const Case &c);
+        void drawPrimitive(ofxHeadlessFbo &fbo, const Case &c, const glm::vec4 &p);
+        void drawPrimitiveInt(ofxHeadlessFbo &fbo, const Case &c, const glm::vec4 &p);
+        double estimatePixels(const Case &c);
+        void runScaling();
+        bool runPipeline();
+        void runFloodFill();
+        bool runDelta();
+        bool runFramebuffer();
+        bool runDmx();
+
+        std::vector<std::string> args;
+        bool quick = false;
+        bool scaling = false;
+        bool pipeline = false;
+        bool floodFill = false;
+        bool delta = false;
+        bool framebuffer = false;
+        bool dmx = false;
+        bool startup = false;
+        std::string outPath = "benchmark.json";
+        std::string filter;
+        ofJson results;
+};
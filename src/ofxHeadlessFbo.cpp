@@ -27,74 +27,99 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "ofxHeadlessFbo.h"
+#include "ofxHeadlessFboSwizzle.h"
+#ifndef OFX_HEADLESS_FBO_NO_GL
+#include "ofxHeadlessFboTexture.h"
+#endif
+#include "ofLog.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#ifdef OFX_HEADLESS_FBO_STATS
+#define OFX_HEADLESS_FBO_STATS_SCOPE(primitive) StatsScope statsScope(*this, ofxHeadlessFboStats::primitive)
+#else
+#define OFX_HEADLESS_FBO_STATS_SCOPE(primitive)
+#endif
 
 namespace {
-bool clipTest(float p, float q, float &u1, float &u2) {
-    if (p == 0.0f) {
-        return q >= 0.0f;
-    }
+const int fixedShift = 8;
+
+ofxHeadlessFboFixed fixedFromFloat(float v) {
+    // the same range ofxHeadlessFbo::toFixed() clamps integers to
+    const float limit = 536870912.0f;
+    const float scaled = std::min(std::max(v * 256.0f, -limit), limit);
+    // rounded with a truncating conversion, lrint() is a library call
+    return static_cast<ofxHeadlessFboFixed>(scaled + (scaled < 0 ? -0.5f : 0.5f));
+}
 
-    const float r = q / p;
-    if (p < 0.0f) {
-        if (r > u2) {
-            return false;
-        }
-        if (r > u1) {
-            u1 = r;
-        }
-    } else {
-        if (r < u1) {
-            return false;
-        }
-        if (r < u2) {
-            u2 = r;
-        }
-    }
+float fixedToFloat(ofxHeadlessFboFixed v) {
+    return static_cast<float>(v) * (1.0f / 256.0f);
+}
 
-    return true;
+// pixel containing a coordinate
+inline int fixedToPixel(ofxHeadlessFboFixed v) {
+    return v >> fixedShift;
 }
 
-bool clipLineToBounds(float &x0, float &y0, float &x1, float &y1, float maxX, float maxY) {
-    const float dx = x1 - x0;
-    const float dy = y1 - y0;
-    float u1 = 0.0f;
-    float u2 = 1.0f;
+// first pixel whose center lies at or after a coordinate, edges of filled shapes
+inline int fixedToEdge(ofxHeadlessFboFixed v) {
+    return (v + 127) >> fixedShift;
+}
 
-    if (!clipTest(-dx, x0, u1, u2)) {
-        return false;
-    }
-    if (!clipTest(dx, maxX - x0, u1, u2)) {
-        return false;
-    }
-    if (!clipTest(-dy, y0, u1, u2)) {
-        return false;
-    }
-    if (!clipTest(dy, maxY - y0, u1, u2)) {
-        return false;
-    }
+inline int64_t floorDiv(int64_t a, int64_t b) {
+    const int64_t q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
 
-    if (u2 < 1.0f) {
-        x1 = x0 + u2 * dx;
-        y1 = y0 + u2 * dy;
-    }
-    if (u1 > 0.0f) {
-        x0 = x0 + u1 * dx;
-        y0 = y0 + u1 * dy;
+// x where an edge from a to b (ay < by) crosses the pixel centers of
+// consecutive rows, floored to 1/256 and stepped without divisions
+struct EdgeWalker {
+    EdgeWalker(ofxHeadlessFboFixed ax, ofxHeadlessFboFixed ay, ofxHeadlessFboFixed bx, ofxHeadlessFboFixed by,
+               int row) {
+        den = static_cast<int64_t>(by) - ay;
+        const int64_t dx = static_cast<int64_t>(bx) - ax;
+        const int64_t num = (static_cast<int64_t>(row) * 256 + 128 - ay) * dx;
+        const int64_t q = floorDiv(num, den);
+        x = ax + q;
+        rem = num - q * den;
+        stepX = floorDiv(dx * 256, den);
+        stepRem = dx * 256 - stepX * den;
     }
 
-    return true;
-}
+    void next() {
+        x += stepX;
+        rem += stepRem;
+        if (rem >= den) {
+            rem -= den;
+            ++x;
+        }
+    }
 
-int clampToRange(int value, int minValue, int maxValue) {
-    if (value < minValue) {
-        return minValue;
+    int64_t x;
+    int64_t rem;
+    int64_t stepX;
+    int64_t stepRem;
+    int64_t den;
+};
+
+// first corner of the longest edge of a triangle without area, the edge
+// runs to the next corner
+int longestEdge(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys) {
+    int64_t lengths[3];
+    for (int i = 0; i < 3; ++i) {
+        const int64_t dx = static_cast<int64_t>(xs[(i + 1) % 3]) - xs[i];
+        const int64_t dy = static_cast<int64_t>(ys[(i + 1) % 3]) - ys[i];
+        lengths[i] = dx * dx + dy * dy;
     }
-    if (value > maxValue) {
-        return maxValue;
+    if (lengths[0] >= lengths[1] && lengths[0] >= lengths[2]) {
+        return 0;
     }
-    return value;
+    return lengths[1] >= lengths[2] ? 1 : 2;
 }
 
 inline unsigned char blendOverOpaqueChannel(unsigned char src, unsigned char dst, unsigned char srcAlpha) {
@@ -130,104 +155,1173 @@ inline unsigned char monoFromRgb(unsigned char r, unsigned char g, unsigned char
     }
     return maxValue;
 }
+
+// Writes RGBA pixels over a row of 8 bit pixels with the same blending as
+// ofxHeadlessFbo::writeSpanPixels(), one color per pixel.
+void blendRowRGBA(unsigned char *dst, const unsigned char *rgba, size_t span, size_t numChannels, bool swapped,
+                  bool alphaBlending) {
+    if (numChannels == 4 && !swapped && !alphaBlending) {
+        std::memcpy(dst, rgba, span * 4);
+        return;
+    }
+    const size_t r = swapped ? 2 : 0;
+    const size_t b = swapped ? 0 : 2;
+    for (size_t i = 0; i < span; ++i, dst += numChannels, rgba += 4) {
+        const unsigned char srcA = rgba[3];
+        if (alphaBlending && srcA == 0) {
+            continue;
+        }
+        const bool replace = !alphaBlending || srcA == 255;
+        const unsigned char outA = replace ? (alphaBlending ? 255 : srcA) : 0;
+        if (numChannels >= 3) {
+            if (replace) {
+                dst[r] = rgba[0];
+                dst[1] = rgba[1];
+                dst[b] = rgba[2];
+                if (numChannels == 4) {
+                    dst[3] = outA;
+                }
+            } else if (numChannels == 4) {
+                const unsigned int invSrcAlpha = 255u - srcA;
+                const unsigned char dstA = dst[3];
+                const unsigned char blendA = static_cast<unsigned char>(
+                    srcA + (static_cast<unsigned int>(dstA) * invSrcAlpha + 127u) / 255u);
+                dst[r] = blendOverChannel(rgba[0], dst[r], srcA, dstA, blendA, invSrcAlpha);
+                dst[1] = blendOverChannel(rgba[1], dst[1], srcA, dstA, blendA, invSrcAlpha);
+                dst[b] = blendOverChannel(rgba[2], dst[b], srcA, dstA, blendA, invSrcAlpha);
+                dst[3] = blendA;
+            } else {
+                dst[r] = blendOverOpaqueChannel(rgba[0], dst[r], srcA);
+                dst[1] = blendOverOpaqueChannel(rgba[1], dst[1], srcA);
+                dst[b] = blendOverOpaqueChannel(rgba[2], dst[b], srcA);
+            }
+        } else {
+            const unsigned char mono = monoFromRgb(rgba[0], rgba[1], rgba[2]);
+            if (replace) {
+                dst[0] = mono;
+                if (numChannels == 2) {
+                    dst[1] = outA;
+                }
+            } else if (numChannels == 2) {
+                const unsigned int invSrcAlpha = 255u - srcA;
+                const unsigned char dstA = dst[1];
+                const unsigned char blendA = static_cast<unsigned char>(
+                    srcA + (static_cast<unsigned int>(dstA) * invSrcAlpha + 127u) / 255u);
+                dst[0] = blendOverChannel(mono, dst[0], srcA, dstA, blendA, invSrcAlpha);
+                dst[1] = blendA;
+            } else {
+                dst[0] = blendOverOpaqueChannel(mono, dst[0], srcA);
+            }
+        }
+    }
+}
+
+bool isByteFormat(ofPixelFormat pixelFormat) {
+    switch (pixelFormat) {
+        case OF_PIXELS_RGBA:
+        case OF_PIXELS_BGRA:
+        case OF_PIXELS_RGB:
+        case OF_PIXELS_BGR:
+        case OF_PIXELS_GRAY:
+        case OF_PIXELS_GRAY_ALPHA:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const size_t tileSize = 64;
+
+// clips a region to the buffer, an empty region is the whole buffer
+bool clipRegion(const ofRectangle &region, size_t w, size_t h, size_t &x0, size_t &y0, size_t &x1, size_t &y1) {
+    if (region.width <= 0 || region.height <= 0) {
+        x0 = y0 = 0;
+        x1 = w;
+        y1 = h;
+        return w > 0 && h > 0;
+    }
+    x0 = static_cast<size_t>(std::max(std::floor(region.x), 0.0f));
+    y0 = static_cast<size_t>(std::max(std::floor(region.y), 0.0f));
+    x1 = static_cast<size_t>(std::min(std::max(std::ceil(region.x + region.width), 0.0f), static_cast<float>(w)));
+    y1 = static_cast<size_t>(std::min(std::max(std::ceil(region.y + region.height), 0.0f), static_cast<float>(h)));
+    return x0 < x1 && y0 < y1;
+}
+
+size_t channelsFromPixelFormat(ofPixelFormat pixelFormat) {
+    switch (pixelFormat) {
+        case OF_PIXELS_RGBA:
+        case OF_PIXELS_BGRA:
+            return 4;
+        case OF_PIXELS_RGB:
+        case OF_PIXELS_BGR:
+            return 3;
+        case OF_PIXELS_GRAY_ALPHA:
+            return 2;
+        case OF_PIXELS_GRAY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// writes color the way ofPixels::setColor stores it
+void packColor(const ofColor &color, ofPixelFormat pixelFormat, unsigned char *pixel) {
+    switch (pixelFormat) {
+        case OF_PIXELS_RGBA:
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = color.a;
+            break;
+        case OF_PIXELS_BGRA:
+            pixel[0] = color.b;
+            pixel[1] = color.g;
+            pixel[2] = color.r;
+            pixel[3] = color.a;
+            break;
+        case OF_PIXELS_RGB:
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            break;
+        case OF_PIXELS_BGR:
+            pixel[0] = color.b;
+            pixel[1] = color.g;
+            pixel[2] = color.r;
+            break;
+        case OF_PIXELS_GRAY:
+            pixel[0] = monoFromRgb(color.r, color.g, color.b);
+            break;
+        case OF_PIXELS_GRAY_ALPHA:
+            pixel[0] = monoFromRgb(color.r, color.g, color.b);
+            pixel[1] = color.a;
+            break;
+        default:
+            break;
+    }
+}
+
+size_t packedRowBytes(size_t w, ofxHeadlessFboPackedFormat packedFormat) {
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            return w * 2;
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            return (w + 7) / 8;
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            return w;
+        default:
+            return 0;
+    }
+}
+
+// format of the pixels handed out by getPixels() and readPixels()
+ofPixelFormat expandedFormat(ofxHeadlessFboPackedFormat packedFormat) {
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            return OF_PIXELS_RGB565;
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            return OF_PIXELS_GRAY;
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            return OF_PIXELS_RGB;
+        default:
+            return OF_PIXELS_UNKNOWN;
+    }
+}
+
+size_t expandedChannels(ofxHeadlessFboPackedFormat packedFormat) {
+    return packedFormat == OFX_HEADLESS_FBO_PACKED_RGB565 ? 2 : channelsFromPixelFormat(expandedFormat(packedFormat));
+}
+
+inline uint16_t packRgb565(unsigned char r, unsigned char g, unsigned char b) {
+    return static_cast<uint16_t>(((r & 0xF8u) << 8) | ((g & 0xFCu) << 3) | (b >> 3));
+}
+
+// blends with the green bits moved to the upper half, so all three channels
+// are scaled by one multiplication each, alpha is 0 - 32
+inline uint16_t blendRgb565(uint16_t src, uint16_t dst, unsigned int alpha) {
+    const uint32_t s = (src | (static_cast<uint32_t>(src) << 16)) & 0x07E0F81Fu;
+    const uint32_t d = (dst | (static_cast<uint32_t>(dst) << 16)) & 0x07E0F81Fu;
+    const uint32_t out = ((s * alpha + d * (32u - alpha)) >> 5) & 0x07E0F81Fu;
+    return static_cast<uint16_t>(out | (out >> 16));
+}
+
+// sets or clears the bits of a span, whole bytes are filled at once
+void fillBits(unsigned char *row, size_t x, size_t span, bool on) {
+    const size_t first = x >> 3;
+    const size_t last = (x + span - 1) >> 3;
+    const unsigned char headMask = static_cast<unsigned char>(0xFFu >> (x & 7));
+    const unsigned char tailMask = static_cast<unsigned char>(0xFFu << (7 - ((x + span - 1) & 7)));
+    if (first == last) {
+        const unsigned char mask = headMask & tailMask;
+        row[first] = on ? row[first] | mask : row[first] & ~mask;
+        return;
+    }
+    row[first] = on ? row[first] | headMask : row[first] & ~headMask;
+    if (last > first + 1) {
+        std::memset(row + first + 1, on ? 0xFF : 0x00, last - first - 1);
+    }
+    row[last] = on ? row[last] | tailMask : row[last] & ~tailMask;
+}
+
+// sets or clears the bits left to right of a bitmap row, inclusive
+void setBitRange(uint64_t *row, size_t left, size_t right, bool on) {
+    const size_t first = left >> 6;
+    const size_t last = right >> 6;
+    const uint64_t headMask = ~uint64_t(0) << (left & 63);
+    const uint64_t tailMask = ~uint64_t(0) >> (63 - (right & 63));
+    for (size_t i = first; i <= last; ++i) {
+        const uint64_t mask = (i == first ? headMask : ~uint64_t(0)) & (i == last ? tailMask : ~uint64_t(0));
+        row[i] = on ? row[i] | mask : row[i] & ~mask;
+    }
+}
+
+const std::vector<ofColor> &defaultPalette() {
+    static const std::vector<ofColor> colors = [] {
+        std::vector<ofColor> rgb332(256);
+        for (size_t i = 0; i < 256; ++i) {
+            rgb332[i].set((i >> 5) * 255 / 7, ((i >> 2) & 7) * 255 / 7, (i & 3) * 255 / 3);
+        }
+        return rgb332;
+    }();
+    return colors;
+}
+
+inline ofColor toByteColor(const ofFloatColor &color) {
+    auto toByte = [](float v) { return std::round(std::min(std::max(v, 0.0f), 1.0f) * 255.0f); };
+    return ofColor(toByte(color.r), toByte(color.g), toByte(color.b), toByte(color.a));
+}
+
+inline float toUnit(unsigned short value) {
+    return value * (1.0f / 65535.0f);
+}
+
+inline float toUnit(float value) {
+    return value;
+}
+
+template <typename T>
+T fromUnit(float value);
+
+template <>
+unsigned short fromUnit<unsigned short>(float value) {
+    return static_cast<unsigned short>(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+template <>
+float fromUnit<float>(float value) {
+    return value;
+}
+
+inline unsigned short blendOverOpaqueWide(unsigned short src, unsigned short dst, float srcAlpha) {
+    const unsigned int alpha = static_cast<unsigned int>(srcAlpha * 65535.0f + 0.5f);
+    return static_cast<unsigned short>((src * alpha + dst * (65535u - alpha) + 32767u) / 65535u);
+}
+
+inline float blendOverOpaqueWide(float src, float dst, float srcAlpha) {
+    return dst + (src - dst) * srcAlpha;
+}
+
+// same channel order as packColor, at the precision of the buffer
+template <typename T>
+void packWideColor(const ofFloatColor &color, ofPixelFormat pixelFormat, T *pixel) {
+    const T r = fromUnit<T>(color.r);
+    const T g = fromUnit<T>(color.g);
+    const T b = fromUnit<T>(color.b);
+    const T a = fromUnit<T>(color.a);
+    switch (pixelFormat) {
+        case OF_PIXELS_RGBA:
+            pixel[0] = r, pixel[1] = g, pixel[2] = b, pixel[3] = a;
+            break;
+        case OF_PIXELS_BGRA:
+            pixel[0] = b, pixel[1] = g, pixel[2] = r, pixel[3] = a;
+            break;
+        case OF_PIXELS_RGB:
+            pixel[0] = r, pixel[1] = g, pixel[2] = b;
+            break;
+        case OF_PIXELS_BGR:
+            pixel[0] = b, pixel[1] = g, pixel[2] = r;
+            break;
+        case OF_PIXELS_GRAY:
+            pixel[0] = std::max(r, std::max(g, b));
+            break;
+        case OF_PIXELS_GRAY_ALPHA:
+            pixel[0] = std::max(r, std::max(g, b));
+            pixel[1] = a;
+            break;
+        default:
+            break;
+    }
+}
+
+// blends a pixel at the precision of the buffer, srcA is above 0 and below 1
+template <typename T>
+void blendWidePixel(T *dst, const T *pixel, size_t numChannels, bool hasAlpha, float srcA) {
+    if (!hasAlpha) {
+        for (size_t c = 0; c < numChannels; ++c) {
+            dst[c] = blendOverOpaqueWide(pixel[c], dst[c], srcA);
+        }
+        return;
+    }
+    const size_t alphaChannel = numChannels - 1;
+    const float dstA = toUnit(dst[alphaChannel]);
+    const float dstWeight = dstA * (1.0f - srcA);
+    const float outA = srcA + dstWeight;
+    for (size_t c = 0; c < alphaChannel; ++c) {
+        dst[c] = outA <= 0.0f ? T(0) : fromUnit<T>((toUnit(pixel[c]) * srcA + toUnit(dst[c]) * dstWeight) / outA);
+    }
+    dst[alphaChannel] = fromUnit<T>(outA);
+}
+
+const unsigned char bayer8x8[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+// threshold is 0 - 63, the value is rounded up when its fraction is above (threshold + 0.5) / 64
+inline unsigned char quantize(unsigned short value, unsigned int threshold) {
+    return static_cast<unsigned char>((value * 255u + ((2u * threshold + 1u) * 65535u) / 128u) / 65535u);
+}
+
+inline unsigned char quantize(float value, unsigned int threshold) {
+    const float scaled = std::min(std::max(value, 0.0f), 1.0f) * 255.0f + (2.0f * threshold + 1.0f) / 128.0f;
+    return static_cast<unsigned char>(std::min(scaled, 255.0f));
+}
+
+template <typename T>
+void quantizeRow(const T *src, unsigned char *dst, size_t w, size_t channels, size_t y, ofxHeadlessFboDither dither,
+                 unsigned int frameOffset) {
+    if (dither == OFX_HEADLESS_FBO_DITHER_NONE) {
+        for (size_t i = 0; i < w * channels; ++i) {
+            dst[i] = quantize(src[i], 31u);
+        }
+        return;
+    }
+    const unsigned char *pattern = bayer8x8[y & 7];
+    for (size_t x = 0; x < w; ++x) {
+        const unsigned int threshold = (pattern[x & 7] + frameOffset) & 63u;
+        for (size_t c = 0; c < channels; ++c) {
+            dst[c] = quantize(src[c], threshold);
+        }
+        src += channels;
+        dst += channels;
+    }
+}
+
+unsigned char nearestIndex(const std::vector<ofColor> &palette, unsigned char r, unsigned char g, unsigned char b) {
+    size_t best = 0;
+    int bestDistance = INT32_MAX;
+    for (size_t i = 0; i < palette.size(); ++i) {
+        const int dr = palette[i].r - r;
+        const int dg = palette[i].g - g;
+        const int db = palette[i].b - b;
+        const int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = i;
+        }
+    }
+    return static_cast<unsigned char>(best);
+}
 } // namespace
 
-void ofxHeadlessFbo::allocate(size_t w, size_t h, ofPixelFormat pixelFormat) {
-    if (w <= 0 || h <= 0 || pixelFormat == OF_PIXELS_UNKNOWN) {
-        return;
-    }
+ofxHeadlessFbo::AlignedBuffer::AlignedBuffer(const AlignedBuffer &other) {
+    *this = other;
+}
+
+ofxHeadlessFbo::AlignedBuffer &ofxHeadlessFbo::AlignedBuffer::operator=(const AlignedBuffer &other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (other.data == nullptr) {
+        clear();
+        return *this;
+    }
+    allocate(other.size, other.alignment);
+    std::memcpy(data, other.data, size);
+    return *this;
+}
+
+void ofxHeadlessFbo::AlignedBuffer::allocate(size_t size, size_t alignment) {
+    if (data != nullptr && this->size == size && this->alignment == alignment) {
+        return;
+    }
+    storage.reset(new unsigned char[size + alignment - 1]);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+    data = storage.get() + ((alignment - address % alignment) % alignment);
+    this->size = size;
+    this->alignment = alignment;
+}
+
+void ofxHeadlessFbo::AlignedBuffer::clear() {
+    storage.reset();
+    data = nullptr;
+    size = 0;
+    alignment = 0;
+}
+
+void ofxHeadlessFbo::allocate(size_t w, size_t h, ofPixelFormat pixelFormat) {
+    if (w <= 0 || h <= 0 || pixelFormat == OF_PIXELS_UNKNOWN) {
+        return;
+    }
+    if (pixelFormat == OF_PIXELS_RGB565) {
+        allocate(w, h, OFX_HEADLESS_FBO_PACKED_RGB565);
+        return;
+    }
+
+    external = nullptr;
+    aligned.clear();
+    clearWideStorage();
+    pixels.allocate(w, h, pixelFormat);
+    setLayout(w, h, pixelFormat, pixels.getNumChannels(), pixels.getBytesStride());
+}
+
+void ofxHeadlessFbo::allocate(size_t w, size_t h, ofPixelFormat pixelFormat, size_t rowAlignment) {
+    if (rowAlignment <= 1) {
+        allocate(w, h, pixelFormat);
+        return;
+    }
+    if (w <= 0 || h <= 0 || !isByteFormat(pixelFormat) || (rowAlignment & (rowAlignment - 1)) != 0) {
+        ofLogWarning("ofxHeadlessFbo") << "allocate(): unsupported format or row alignment " << rowAlignment;
+        return;
+    }
+
+    const size_t channels = channelsFromPixelFormat(pixelFormat);
+    const size_t stride = (w * channels + rowAlignment - 1) & ~(rowAlignment - 1);
+    external = nullptr;
+    pixels.clear();
+    clearWideStorage();
+    aligned.allocate(stride * h, rowAlignment);
+    setLayout(w, h, pixelFormat, channels, stride);
+}
+
+void ofxHeadlessFbo::allocate(size_t w, size_t h, ofxHeadlessFboPackedFormat packedFormat) {
+    if (w <= 0 || h <= 0 || packedFormat == OFX_HEADLESS_FBO_PACKED_NONE) {
+        return;
+    }
+
+    const size_t stride = packedRowBytes(w, packedFormat);
+    external = nullptr;
+    pixels.clear();
+    clearWideStorage();
+    aligned.allocate(stride * h, 16);
+    setLayout(w, h, expandedFormat(packedFormat), expandedChannels(packedFormat), stride, packedFormat);
+}
+
+void ofxHeadlessFbo::allocate(size_t w, size_t h, ofPixelFormat pixelFormat, ofxHeadlessFboPrecision precision) {
+    if (precision == OFX_HEADLESS_FBO_PRECISION_8) {
+        allocate(w, h, pixelFormat);
+        return;
+    }
+    if (w <= 0 || h <= 0 || !isByteFormat(pixelFormat)) {
+        ofLogWarning("ofxHeadlessFbo") << "allocate(): unsupported format for 16 bit and float buffers";
+        return;
+    }
+
+    external = nullptr;
+    aligned.clear();
+    pixels.clear();
+    if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+        floatPixels.clear();
+        shortPixels.allocate(w, h, pixelFormat);
+        setLayout(w, h, pixelFormat, shortPixels.getNumChannels(), shortPixels.getBytesStride());
+    } else {
+        shortPixels.clear();
+        floatPixels.allocate(w, h, pixelFormat);
+        setLayout(w, h, pixelFormat, floatPixels.getNumChannels(), floatPixels.getBytesStride());
+    }
+}
+
+void ofxHeadlessFbo::clearWideStorage() {
+    shortPixels.clear();
+    floatPixels.clear();
+}
+
+void ofxHeadlessFbo::allocateFromExternal(unsigned char *data, size_t w, size_t h, size_t stride,
+                                          ofxHeadlessFboPackedFormat packedFormat) {
+    const size_t rowBytes = packedRowBytes(w, packedFormat);
+    if (stride == 0) {
+        stride = rowBytes;
+    }
+    const bool misaligned = packedFormat == OFX_HEADLESS_FBO_PACKED_RGB565 &&
+                            (reinterpret_cast<uintptr_t>(data) % 2 != 0 || stride % 2 != 0);
+    if (data == nullptr || w <= 0 || h <= 0 || packedFormat == OFX_HEADLESS_FBO_PACKED_NONE || stride < rowBytes ||
+        misaligned) {
+        ofLogWarning("ofxHeadlessFbo") << "allocateFromExternal(): unsupported format or stride " << stride;
+        return;
+    }
+
+    pixels.clear();
+    aligned.clear();
+    clearWideStorage();
+    external = data;
+    setLayout(w, h, expandedFormat(packedFormat), expandedChannels(packedFormat), stride, packedFormat);
+}
+
+void ofxHeadlessFbo::allocateFromExternal(unsigned char *data, size_t w, size_t h, size_t stride,
+                                          ofPixelFormat pixelFormat) {
+    if (pixelFormat == OF_PIXELS_RGB565) {
+        allocateFromExternal(data, w, h, stride, OFX_HEADLESS_FBO_PACKED_RGB565);
+        return;
+    }
+    const size_t channels = channelsFromPixelFormat(pixelFormat);
+    if (stride == 0) {
+        stride = w * channels;
+    }
+    if (data == nullptr || w <= 0 || h <= 0 || !isByteFormat(pixelFormat) || stride < w * channels) {
+        ofLogWarning("ofxHeadlessFbo") << "allocateFromExternal(): unsupported format or stride " << stride;
+        return;
+    }
+
+    pixels.clear();
+    aligned.clear();
+    clearWideStorage();
+    external = data;
+    setLayout(w, h, pixelFormat, channels, stride);
+}
+
+void ofxHeadlessFbo::setLayout(size_t w, size_t h, ofPixelFormat pixelFormat, size_t numChannels, size_t stride,
+                               ofxHeadlessFboPackedFormat packedFormat) {
+    this->w = w;
+    this->h = h;
+    this->pixelFormat = pixelFormat;
+    this->numChannels = numChannels;
+    this->stride = stride;
+    this->packedFormat = packedFormat;
+    this->precision = shortPixels.isAllocated()   ? OFX_HEADLESS_FBO_PRECISION_16
+                      : floatPixels.isAllocated() ? OFX_HEADLESS_FBO_PRECISION_FLOAT
+                                                  : OFX_HEADLESS_FBO_PRECISION_8;
+    packedColor = getPackedValue(color);
+    maskRunsValid = false;
+    resetTiles();
+    markDirty();
+}
+
+bool ofxHeadlessFbo::isAllocated() const {
+    return getBase() != nullptr;
+}
+
+unsigned char *ofxHeadlessFbo::getBase() {
+    if (external != nullptr) {
+        return external;
+    }
+    if (aligned.data != nullptr) {
+        return aligned.data;
+    }
+    if (shortPixels.isAllocated()) {
+        return reinterpret_cast<unsigned char *>(shortPixels.getData());
+    }
+    if (floatPixels.isAllocated()) {
+        return reinterpret_cast<unsigned char *>(floatPixels.getData());
+    }
+    return pixels.getData();
+}
+
+const unsigned char *ofxHeadlessFbo::getBase() const {
+    return const_cast<ofxHeadlessFbo *>(this)->getBase();
+}
+
+void ofxHeadlessFbo::setColor(const ofColor &color) {
+    this->color = color;
+    this->wideColor = ofFloatColor(color);
+    if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+        packedColor = getPackedValue(color);
+    }
+}
+
+void ofxHeadlessFbo::setColor(const ofFloatColor &color) {
+    setColor(toByteColor(color));
+    this->wideColor = color;
+}
+
+uint16_t ofxHeadlessFbo::getPackedValue(const ofColor &color) const {
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            return packRgb565(color.r, color.g, color.b);
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            return monoFromRgb(color.r, color.g, color.b) >= 128 ? 1 : 0;
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            return nearestIndex(getPalette(), color.r, color.g, color.b);
+        default:
+            return 0;
+    }
+}
+
+void ofxHeadlessFbo::setPalette(const std::vector<ofColor> &palette) {
+    if (palette.size() > 256) {
+        ofLogWarning("ofxHeadlessFbo") << "setPalette(): only the first 256 of " << palette.size() << " colors are used";
+        this->palette.assign(palette.begin(), palette.begin() + 256);
+    } else {
+        this->palette = palette;
+    }
+    if (packedFormat == OFX_HEADLESS_FBO_PACKED_INDEXED8) {
+        packedColor = getPackedValue(color);
+        markDirty();
+    }
+}
+
+const std::vector<ofColor> &ofxHeadlessFbo::getPalette() const {
+    return palette.empty() ? defaultPalette() : palette;
+}
+
+void ofxHeadlessFbo::clear(const ofColor &color) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("clear");
+    OFX_HEADLESS_FBO_STATS_SCOPE(CLEAR);
+    unsigned char *data = getBase();
+    if (data == nullptr) {
+        return;
+    }
+#ifdef OFX_HEADLESS_FBO_STATS
+    stats.spans += h;
+    stats.pixelsOverwritten += w * h;
+    stats.primitives[ofxHeadlessFboStats::CLEAR].spans += h;
+    stats.primitives[ofxHeadlessFboStats::CLEAR].pixels += w * h;
+#endif
+
+    if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+        clearWide(reinterpret_cast<unsigned short *>(data), ofFloatColor(color));
+        markDirty();
+        return;
+    }
+    if (precision == OFX_HEADLESS_FBO_PRECISION_FLOAT) {
+        clearWide(reinterpret_cast<float *>(data), ofFloatColor(color));
+        markDirty();
+        return;
+    }
+    if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+        clearPacked(data, color);
+        markDirty();
+        return;
+    }
+    if (!isByteFormat(pixelFormat)) {
+        pixels.setColor(color);
+        markDirty();
+        return;
+    }
+
+    unsigned char pixel[4];
+    packColor(color, pixelFormat, pixel);
+    if (lazyClear) {
+        std::memcpy(solidPixel, pixel, sizeof(pixel));
+        tilesX = (w + tileSize - 1) / tileSize;
+        solidTiles.assign(tilesX * ((h + tileSize - 1) / tileSize), 1);
+        numSolidTiles = solidTiles.size();
+        markDirty();
+        return;
+    }
+
+    // fill the first row and replicate it
+    resetTiles();
+    const size_t rowBytes = w * numChannels;
+    if (numChannels == 1) {
+        std::memset(data, pixel[0], rowBytes);
+    } else {
+        for (size_t i = 0; i < rowBytes; i += numChannels) {
+            std::memcpy(data + i, pixel, numChannels);
+        }
+    }
+    for (size_t y = 1; y < h; ++y) {
+        std::memcpy(data + y * stride, data, rowBytes);
+    }
+    markDirty();
+}
+
+void ofxHeadlessFbo::setLazyClear(bool lazyClear) {
+    if (!lazyClear) {
+        materializeTiles();
+    }
+    this->lazyClear = lazyClear;
+}
+
+bool ofxHeadlessFbo::isLazyClear() const {
+    return lazyClear;
+}
+
+size_t ofxHeadlessFbo::getTileSize() const {
+    return tileSize;
+}
+
+const unsigned char *ofxHeadlessFbo::getSolidTile(size_t tileX, size_t tileY) const {
+    if (numSolidTiles == 0 || tileX >= tilesX || tileY * tilesX + tileX >= solidTiles.size() ||
+        !solidTiles[tileY * tilesX + tileX]) {
+        return nullptr;
+    }
+    return solidPixel;
+}
+
+void ofxHeadlessFbo::materializeTiles() const {
+    if (numSolidTiles == 0) {
+        return;
+    }
+    OFX_HEADLESS_FBO_TRACE_SCOPE("materializeTiles");
+    for (size_t i = 0; i < solidTiles.size(); ++i) {
+        if (solidTiles[i]) {
+            fillTile(i % tilesX, i / tilesX);
+        }
+    }
+}
+
+void ofxHeadlessFbo::fillTile(size_t tileX, size_t tileY) const {
+    // writing the pixels the buffer already shows doesn't change it
+    unsigned char *data = const_cast<ofxHeadlessFbo *>(this)->getBase();
+    const size_t x0 = tileX * tileSize;
+    const size_t y0 = tileY * tileSize;
+    const size_t rowBytes = std::min(tileSize, w - x0) * numChannels;
+    const size_t rows = std::min(tileSize, h - y0);
+    unsigned char *first = data + y0 * stride + x0 * numChannels;
+    for (size_t i = 0; i < rowBytes; i += numChannels) {
+        std::memcpy(first + i, solidPixel, numChannels);
+    }
+    for (size_t y = 1; y < rows; ++y) {
+        std::memcpy(first + y * stride, first, rowBytes);
+    }
+    solidTiles[tileY * tilesX + tileX] = 0;
+    numSolidTiles--;
+}
+
+void ofxHeadlessFbo::readRow(size_t y, unsigned char *dst) const {
+    const unsigned char *row = getBase() + y * stride;
+    const unsigned char *solid = solidTiles.data() + (y / tileSize) * tilesX;
+    for (size_t tx = 0; tx < tilesX; ++tx) {
+        const size_t x0 = tx * tileSize;
+        const size_t bytes = std::min(tileSize, w - x0) * numChannels;
+        if (!solid[tx]) {
+            std::memcpy(dst + x0 * numChannels, row + x0 * numChannels, bytes);
+            continue;
+        }
+        for (size_t i = 0; i < bytes; i += numChannels) {
+            std::memcpy(dst + x0 * numChannels + i, solidPixel, numChannels);
+        }
+    }
+}
+
+void ofxHeadlessFbo::resetTiles() {
+    solidTiles.clear();
+    numSolidTiles = 0;
+}
+
+void ofxHeadlessFbo::readPixels(ofPixels &pixels) const {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("readPixels");
+    if (this->pixels.isAllocated() && numSolidTiles == 0) {
+        pixels = this->pixels;
+        return;
+    }
+    if (!isAllocated()) {
+        pixels.clear();
+        return;
+    }
+    pixels.allocate(w, h, pixelFormat);
+    if (precision != OFX_HEADLESS_FBO_PRECISION_8) {
+        quantizeRows(pixels.getData());
+    } else if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+        unpackRows(pixels.getData());
+    } else if (numSolidTiles > 0) {
+        for (size_t y = 0; y < h; ++y) {
+            readRow(y, pixels.getData() + y * w * numChannels);
+        }
+    } else {
+        copyRows(getBase(), stride, pixels.getData(), w * numChannels);
+    }
+}
+
+void ofxHeadlessFbo::readPixelsAs(ofPixels &pixels, ofPixelFormat pixelFormat, const ofRectangle &region) const {
+    size_t x0, y0, x1, y1;
+    if (!isAllocated() || !ofxHeadlessFboSwizzle::isSupported(pixelFormat) ||
+        !clipRegion(region, w, h, x0, y0, x1, y1)) {
+        pixels.clear();
+        return;
+    }
+    if (pixels.getWidth() != x1 - x0 || pixels.getHeight() != y1 - y0 || pixels.getPixelFormat() != pixelFormat) {
+        pixels.allocate(x1 - x0, y1 - y0, pixelFormat);
+    }
+    readPixelsAs(pixels.getData(), pixels.getBytesStride(), pixelFormat, region);
+}
+
+bool ofxHeadlessFbo::readPixelsAs(unsigned char *data, size_t stride, ofPixelFormat pixelFormat,
+                                  const ofRectangle &region) const {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("readPixelsAs");
+    if (data == nullptr || !isAllocated()) {
+        return false;
+    }
+    ofxHeadlessFboSwizzle swizzle(this->pixelFormat, pixelFormat);
+    if (!swizzle.isValid()) {
+        ofLogWarning("ofxHeadlessFbo") << "readPixelsAs(): unsupported pixel format";
+        return false;
+    }
+    size_t x0, y0, x1, y1;
+    if (!clipRegion(region, w, h, x0, y0, x1, y1)) {
+        return true;
+    }
+    const size_t srcBytes = this->pixelFormat == OF_PIXELS_RGB565 ? 2 : numChannels;
+    const size_t dstBytes = pixelFormat == OF_PIXELS_RGB565 ? 2 : channelsFromPixelFormat(pixelFormat);
+    if (stride == 0) {
+        stride = (x1 - x0) * dstBytes;
+    }
+
+    // 8 bit rows are read in place, the others are expanded into one row first
+    const bool expand = precision != OFX_HEADLESS_FBO_PRECISION_8 || packedFormat == OFX_HEADLESS_FBO_PACKED_MONO1 ||
+                        packedFormat == OFX_HEADLESS_FBO_PACKED_INDEXED8 || numSolidTiles > 0;
+    const unsigned int frameOffset = precision != OFX_HEADLESS_FBO_PRECISION_8 ? nextDitherOffset() : 0u;
+    std::vector<unsigned char> row(expand ? w * numChannels : 0);
+    const unsigned char *base = getBase();
+    for (size_t y = y0; y < y1; ++y) {
+        const unsigned char *src = base + y * this->stride;
+        if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+            quantizeRow(reinterpret_cast<const unsigned short *>(src), row.data(), w, numChannels, y, dither,
+                        frameOffset);
+            src = row.data();
+        } else if (precision == OFX_HEADLESS_FBO_PRECISION_FLOAT) {
+            quantizeRow(reinterpret_cast<const float *>(src), row.data(), w, numChannels, y, dither, frameOffset);
+            src = row.data();
+        } else if (numSolidTiles > 0) {
+            readRow(y, row.data());
+            src = row.data();
+        } else if (expand) {
+            unpackRow(y, row.data());
+            src = row.data();
+        }
+        swizzle.convert(src + x0 * srcBytes, data + (y - y0) * stride, x1 - x0);
+    }
+    return true;
+}
+
+void ofxHeadlessFbo::setFromPixels(ofPixels newPixels, size_t w, size_t h, ofPixelFormat pixelFormat) {
+    if (!newPixels.isAllocated()) {
+        return;
+    }
+    setFromPixels(newPixels.getData(), newPixels.getWidth(), newPixels.getHeight(), newPixels.getPixelFormat());
+}
+
+void ofxHeadlessFbo::setFromPixels(const unsigned char *data, size_t w, size_t h, ofPixelFormat pixelFormat) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("setFromPixels");
+    if (data == nullptr || w <= 0 || h <= 0 || pixelFormat == OF_PIXELS_UNKNOWN) {
+        return;
+    }
+
+    // external, aligned and packed buffers keep their memory when the layout matches
+    if ((external != nullptr || aligned.data != nullptr) && w == this->w && h == this->h &&
+        pixelFormat == this->pixelFormat) {
+        if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+            packRows(data);
+        } else {
+            for (size_t y = 0; y < h; ++y) {
+                std::memcpy(getBase() + y * stride, data + y * w * numChannels, w * numChannels);
+            }
+        }
+        resetTiles();
+        markDirty();
+        return;
+    }
+    if (pixelFormat == OF_PIXELS_RGB565) {
+        allocate(w, h, OFX_HEADLESS_FBO_PACKED_RGB565);
+        packRows(data);
+        markDirty();
+        return;
+    }
+
+    external = nullptr;
+    aligned.clear();
+    clearWideStorage();
+    pixels.setFromPixels(data, w, h, pixelFormat);
+    setLayout(w, h, pixelFormat, pixels.getNumChannels(), pixels.getBytesStride());
+}
+
+void ofxHeadlessFbo::setFromPixels(const ofShortPixels &newPixels) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("setFromPixels");
+    if (!newPixels.isAllocated() || !isByteFormat(newPixels.getPixelFormat())) {
+        return;
+    }
+    external = nullptr;
+    aligned.clear();
+    pixels.clear();
+    floatPixels.clear();
+    shortPixels = newPixels;
+    setLayout(shortPixels.getWidth(), shortPixels.getHeight(), shortPixels.getPixelFormat(),
+              shortPixels.getNumChannels(), shortPixels.getBytesStride());
+}
+
+void ofxHeadlessFbo::setFromPixels(const ofFloatPixels &newPixels) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("setFromPixels");
+    if (!newPixels.isAllocated() || !isByteFormat(newPixels.getPixelFormat())) {
+        return;
+    }
+    external = nullptr;
+    aligned.clear();
+    pixels.clear();
+    shortPixels.clear();
+    floatPixels = newPixels;
+    setLayout(floatPixels.getWidth(), floatPixels.getHeight(), floatPixels.getPixelFormat(),
+              floatPixels.getNumChannels(), floatPixels.getBytesStride());
+}
+
+void ofxHeadlessFbo::copyRows(const unsigned char *src, size_t srcStride, unsigned char *dst, size_t dstStride) const {
+    const size_t rowBytes = w * numChannels;
+    if (srcStride == rowBytes && dstStride == rowBytes) {
+        std::memcpy(dst, src, rowBytes * h);
+        return;
+    }
+    for (size_t y = 0; y < h; ++y) {
+        std::memcpy(dst + y * dstStride, src + y * srcStride, rowBytes);
+    }
+}
+
+void ofxHeadlessFbo::setFill() {
+    fill = true;
+}
+
+void ofxHeadlessFbo::setNoFill() {
+    fill = false;
+}
+
+void ofxHeadlessFbo::setLineWidth(float lineWidth) {
+    this->lineWidth = lineWidth;
+}
+
+float ofxHeadlessFbo::getLineWidth() const {
+    return lineWidth;
+}
+
+void ofxHeadlessFbo::setLineJoin(ofxHeadlessFboLineJoin lineJoin) {
+    this->lineJoin = lineJoin;
+}
+
+ofxHeadlessFboLineJoin ofxHeadlessFbo::getLineJoin() const {
+    return lineJoin;
+}
+
+void ofxHeadlessFbo::setTranslation(float x, float y) {
+    translateX = fixedFromFloat(x);
+    translateY = fixedFromFloat(y);
+}
+
+float ofxHeadlessFbo::getTranslationX() const {
+    return fixedToFloat(translateX);
+}
+
+float ofxHeadlessFbo::getTranslationY() const {
+    return fixedToFloat(translateY);
+}
+
+void ofxHeadlessFbo::setMask(const ofxHeadlessFbo *mask) {
+    if (mask != nullptr && (mask == this || (mask->getPackedFormat() != OFX_HEADLESS_FBO_PACKED_MONO1 &&
+                                             (mask->getPixelFormat() != OF_PIXELS_GRAY ||
+                                              mask->getPrecision() != OFX_HEADLESS_FBO_PRECISION_8)))) {
+        ofLogWarning("ofxHeadlessFbo") << "setMask(): the mask has to be an 8 bit GRAY or a MONO1 buffer";
+        return;
+    }
+    this->mask = mask;
+    maskRunsValid = false;
+}
+
+const ofxHeadlessFbo *ofxHeadlessFbo::getMask() const {
+    return mask;
+}
+
+void ofxHeadlessFbo::enableAlphaBlending() {
+    alphaBlending = true;
+}
+
+void ofxHeadlessFbo::disableAlphaBlending() {
+    alphaBlending = false;
+}
+
+#ifndef OFX_HEADLESS_FBO_NO_GL
+void ofxHeadlessFbo::draw(float x, float y) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("draw");
+    if (!isAllocated()) {
+        return;
+    }
+    if (!texture) {
+        texture = std::make_shared<ofxHeadlessFboTexture>();
+    }
+    texture->draw(*this, x, y);
+}
+#endif
+
+size_t ofxHeadlessFbo::getWidth() const {
+    return w;
+}
+
+size_t ofxHeadlessFbo::getHeight() const {
+    return h;
+}
+
+ofPixelFormat ofxHeadlessFbo::getPixelFormat() const {
+    return pixelFormat;
+}
+
+ofxHeadlessFboPackedFormat ofxHeadlessFbo::getPackedFormat() const {
+    return packedFormat;
+}
+
+ofxHeadlessFboPrecision ofxHeadlessFbo::getPrecision() const {
+    return precision;
+}
 
-    pixels.allocate(w, h, pixelFormat);
-    this->w = w;
-    this->h = h;
-    this->pixelFormat = pixelFormat;
-    this->numChannels = pixels.getNumChannels();
-    markTextureDirty();
+const ofShortPixels &ofxHeadlessFbo::getShortPixels() const {
+    return shortPixels;
 }
 
-bool ofxHeadlessFbo::isAllocated() {
-    return pixels.isAllocated();
+const ofFloatPixels &ofxHeadlessFbo::getFloatPixels() const {
+    return floatPixels;
 }
 
-void ofxHeadlessFbo::setColor(const ofColor &color) {
-    this->color = color;
+void ofxHeadlessFbo::setDither(ofxHeadlessFboDither dither) {
+    this->dither = dither;
+    viewVersion = version - 1;
 }
 
-void ofxHeadlessFbo::clear(const ofColor &color) {
-    pixels.setColor(color);
-    markTextureDirty();
+ofxHeadlessFboDither ofxHeadlessFbo::getDither() const {
+    return dither;
 }
 
-void ofxHeadlessFbo::readPixels(ofPixels &pixels) const {
-    pixels = this->pixels;
+size_t ofxHeadlessFbo::getNumChannels() const {
+    return numChannels;
 }
 
-void ofxHeadlessFbo::setFromPixels(ofPixels newPixels, size_t w, size_t h, ofPixelFormat pixelFormat) {
-    if (w <= 0 || h <= 0 || pixelFormat == OF_PIXELS_UNKNOWN) {
-        return;
+const ofPixels &ofxHeadlessFbo::getPixels() const {
+    materializeTiles();
+    if (pixels.isAllocated() || !isAllocated()) {
+        return pixels;
+    }
+    const bool expanded = packedFormat == OFX_HEADLESS_FBO_PACKED_MONO1 ||
+                          packedFormat == OFX_HEADLESS_FBO_PACKED_INDEXED8 || precision != OFX_HEADLESS_FBO_PRECISION_8;
+    if (!expanded && stride == w * numChannels) {
+        view.setFromExternalPixels(const_cast<unsigned char *>(getBase()), w, h, pixelFormat);
+        viewOwned = false;
+        return view;
     }
 
-    pixels.allocate(w, h, pixelFormat);
-    pixels = newPixels;
-    this->w = w;
-    this->h = h;
-    this->pixelFormat = pixelFormat;
-    this->numChannels = pixels.getNumChannels();
-    markTextureDirty();
+    // padded rows, packed and wide formats are copied, refreshed only after
+    // changes or for every frame of temporal dithering
+    const bool temporal = precision != OFX_HEADLESS_FBO_PRECISION_8 && dither == OFX_HEADLESS_FBO_DITHER_TEMPORAL;
+    if (!viewOwned || viewVersion != version || temporal || view.getWidth() != w || view.getHeight() != h ||
+        view.getPixelFormat() != pixelFormat) {
+        if (!viewOwned) {
+            view.clear();
+        }
+        view.allocate(w, h, pixelFormat);
+        if (precision != OFX_HEADLESS_FBO_PRECISION_8) {
+            quantizeRows(view.getData());
+        } else if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+            unpackRows(view.getData());
+        } else {
+            copyRows(getBase(), stride, view.getData(), w * numChannels);
+        }
+        viewVersion = version;
+        viewOwned = true;
+    }
+    return view;
 }
 
-void ofxHeadlessFbo::setFill() {
-    fill = true;
+const unsigned char *ofxHeadlessFbo::getData() const {
+    materializeTiles();
+    return getBase();
 }
 
-void ofxHeadlessFbo::setNoFill() {
-    fill = false;
+size_t ofxHeadlessFbo::getStride() const {
+    return stride;
 }
 
-void ofxHeadlessFbo::enableAlphaBlending() {
-    alphaBlending = true;
+const ofxHeadlessFboStats &ofxHeadlessFbo::getStats() const {
+#ifdef OFX_HEADLESS_FBO_STATS
+    return stats;
+#else
+    static const ofxHeadlessFboStats empty;
+    return empty;
+#endif
 }
 
-void ofxHeadlessFbo::disableAlphaBlending() {
-    alphaBlending = false;
+void ofxHeadlessFbo::resetStats() {
+#ifdef OFX_HEADLESS_FBO_STATS
+    stats = ofxHeadlessFboStats();
+#endif
+    shapeCache.resetStats();
 }
 
-void ofxHeadlessFbo::draw(float x, float y) {
-    if (!isAllocated()) {
-        return;
-    }
+void ofxHeadlessFbo::setShapeCacheSize(size_t bytes) {
+    shapeCache.setMaxBytes(bytes);
+}
 
-    const size_t currentW = pixels.getWidth();
-    const size_t currentH = pixels.getHeight();
-    const ofPixelFormat currentPixelFormat = pixels.getPixelFormat();
+size_t ofxHeadlessFbo::getShapeCacheSize() const {
+    return shapeCache.getMaxBytes();
+}
 
-    if (!textureCache.isAllocated() || currentW != textureW || currentH != textureH ||
-        currentPixelFormat != texturePixelFormat) {
-        textureCache.allocate(pixels);
-        textureW = currentW;
-        textureH = currentH;
-        texturePixelFormat = currentPixelFormat;
-        textureDirty = true;
-    }
+const ofxHeadlessFboShapeCache::Stats &ofxHeadlessFbo::getShapeCacheStats() const {
+    return shapeCache.getStats();
+}
 
-    if (textureDirty) {
-        textureCache.loadData(pixels);
-        textureDirty = false;
-    }
+void ofxHeadlessFbo::clearShapeCache() {
+    shapeCache.clear();
+}
 
-    textureCache.draw(x, y);
+#ifdef OFX_HEADLESS_FBO_STATS
+ofxHeadlessFbo::StatsScope::StatsScope(ofxHeadlessFbo &fbo, ofxHeadlessFboStats::Primitive primitive)
+    : fbo(fbo), primitive(primitive), outermost(fbo.statsDepth++ == 0), spansBefore(fbo.stats.spans) {
+    // primitives built from other primitives are only counted once
+    if (outermost) {
+        fbo.stats.primitives[primitive].calls++;
+        fbo.statsPrimitive = primitive;
+#ifdef OFX_HEADLESS_FBO_STATS_TIMING
+        start = std::chrono::steady_clock::now();
+#endif
+    }
 }
 
-size_t ofxHeadlessFbo::getWidth() {
-    return pixels.getWidth();
+ofxHeadlessFbo::StatsScope::~StatsScope() {
+    fbo.statsDepth--;
+    if (!outermost) {
+        return;
+    }
+    ofxHeadlessFboStats::PrimitiveStats &primitiveStats = fbo.stats.primitives[primitive];
+    if (fbo.stats.spans == spansBefore) {
+        primitiveStats.rejected++;
+    }
+#ifdef OFX_HEADLESS_FBO_STATS_TIMING
+    primitiveStats.nanoseconds += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+#endif
 }
 
-size_t ofxHeadlessFbo::getHeight() {
-    return pixels.getHeight();
+void ofxHeadlessFbo::countSpan(size_t span) {
+    stats.spans++;
+    stats.primitives[statsPrimitive].spans++;
+    stats.primitives[statsPrimitive].pixels += span;
+
+    if (!isByteFormat(pixelFormat) && packedFormat == OFX_HEADLESS_FBO_PACKED_NONE) {
+        stats.pixelsSlowPath += span;
+    } else if (!alphaBlending || color.a == 255) {
+        stats.pixelsOverwritten += span;
+    } else if (color.a == 0) {
+        stats.pixelsSkipped += span;
+    } else {
+        stats.pixelsBlended += span;
+    }
 }
+#endif
 
 void ofxHeadlessFbo::drawPoint(float x, float y) {
-    writePoint(x, y);
+    drawPointFixed(fixedFromFloat(x) + translateX, fixedFromFloat(y) + translateY);
+}
+
+void ofxHeadlessFbo::drawPointFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y) {
+    const int px = fixedToPixel(x);
+    const int py = fixedToPixel(y);
+    if (recording) {
+        recordedRows.addSpan(px, py, 1);
+        return;
+    }
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawPoint");
+    OFX_HEADLESS_FBO_STATS_SCOPE(POINT);
+    if (px < 0 || py < 0) {
+        return;
+    }
+    writePoint(px, py);
 }
 
 void ofxHeadlessFbo::writePoint(size_t x, size_t y) {
@@ -238,17 +1332,206 @@ void ofxHeadlessFbo::writePoint(size_t x, size_t y) {
 }
 
 void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
+    if (mask != nullptr) {
+        writeSpanMasked(x, y, span);
+        return;
+    }
+    writeSpan(x, y, span);
+}
+
+void ofxHeadlessFbo::writeSpanMasked(size_t x, size_t y, size_t span) {
+    if (!maskRunsValid || mask->getVersion() != maskVersion) {
+        updateMaskRuns();
+    }
+    if (y + 1 >= maskRows.size()) {
+        return;
+    }
+
+    // first run ending after x, rows rarely have more than a few runs
+    const size_t end = x + span;
+    const auto rowEnd = maskRuns.begin() + maskRows[y + 1];
+    auto run = std::upper_bound(maskRuns.begin() + maskRows[y], rowEnd, x,
+                                [](size_t value, const MaskRun &r) { return value < r.end; });
+    for (; run != rowEnd && run->start < end; ++run) {
+        const size_t left = std::max<size_t>(x, run->start);
+        const size_t right = std::min<size_t>(end, run->end);
+        if (!run->partial) {
+            writeSpan(left, y, right - left);
+            continue;
+        }
+
+        // partly covered pixels are blended in groups of equal coverage
+        const unsigned char *coverage = mask->getData() + (y + maskY) * mask->getStride() + maskX;
+        const ofColor savedColor = color;
+        const float savedAlpha = wideColor.a;
+        const bool savedBlending = alphaBlending;
+        const unsigned int srcA = alphaBlending ? color.a : 255u;
+        alphaBlending = true;
+        for (size_t i = left; i < right;) {
+            size_t next = i + 1;
+            while (next < right && coverage[next] == coverage[i]) {
+                ++next;
+            }
+            color.a = static_cast<unsigned char>((srcA * coverage[i] + 127u) / 255u);
+            wideColor.a = (savedBlending ? savedAlpha : 1.0f) * coverage[i] / 255.0f;
+            writeSpan(i, y, next - i);
+            i = next;
+        }
+        color = savedColor;
+        wideColor.a = savedAlpha;
+        alphaBlending = savedBlending;
+    }
+}
+
+void ofxHeadlessFbo::updateMaskRuns() {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("updateMaskRuns");
+    maskRuns.clear();
+    maskRows.assign(1, 0);
+    maskVersion = mask->getVersion();
+    maskRunsValid = true;
+    const unsigned char *data = mask->getData();
+    const size_t rows = maskY < mask->getHeight() ? std::min(h, mask->getHeight() - maskY) : 0;
+    const size_t cols = maskX < mask->getWidth() ? std::min(w, mask->getWidth() - maskX) : 0;
+    const bool bits = mask->getPackedFormat() == OFX_HEADLESS_FBO_PACKED_MONO1;
+    // x runs over the columns of the mask, runs are stored in pixels of this buffer
+    const size_t first = maskX;
+    const size_t last = maskX + cols;
+    auto addRun = [&](size_t start, size_t end, bool partial) {
+        maskRuns.push_back({static_cast<uint32_t>(start - first), static_cast<uint32_t>(end - first), partial});
+    };
+    for (size_t y = 0; y < rows && data != nullptr; ++y) {
+        const unsigned char *row = data + (y + maskY) * mask->getStride();
+        size_t x = first;
+        while (x < last) {
+            if (bits) {
+                // whole bytes of the row are skipped or taken at once
+                if ((x & 7) == 0 && x + 8 <= last && (row[x >> 3] == 0x00 || row[x >> 3] == 0xFF)) {
+                    const unsigned char byte = row[x >> 3];
+                    size_t next = x + 8;
+                    while (next + 8 <= last && row[next >> 3] == byte) {
+                        next += 8;
+                    }
+                    if (byte != 0) {
+                        addRun(x, next, false);
+                    }
+                    x = next;
+                    continue;
+                }
+                if ((row[x >> 3] & (0x80u >> (x & 7))) != 0) {
+                    addRun(x, x + 1, false);
+                }
+                ++x;
+                continue;
+            }
+            const unsigned char value = row[x];
+            size_t next = x + 1;
+            if (value == 0) {
+                while (next < last && row[next] == 0) {
+                    ++next;
+                }
+            } else if (value == 255) {
+                while (next < last && row[next] == 255) {
+                    ++next;
+                }
+                addRun(x, next, false);
+            } else {
+                while (next < last && row[next] != 0 && row[next] != 255) {
+                    ++next;
+                }
+                addRun(x, next, true);
+            }
+            x = next;
+        }
+        maskRows.push_back(maskRuns.size());
+    }
+    // pixels below the mask are masked out
+    maskRows.resize(h + 1, maskRuns.size());
+
+    // neighbouring runs of single bits are merged
+    if (bits) {
+        size_t out = 0;
+        for (size_t y = 0; y < h; ++y) {
+            const size_t first = maskRows[y];
+            const size_t last = maskRows[y + 1];
+            maskRows[y] = out;
+            for (size_t i = first; i < last; ++i) {
+                if (out > maskRows[y] && maskRuns[out - 1].end == maskRuns[i].start) {
+                    maskRuns[out - 1].end = maskRuns[i].end;
+                } else {
+                    maskRuns[out++] = maskRuns[i];
+                }
+            }
+        }
+        maskRows[h] = out;
+        maskRuns.resize(out);
+    }
+}
+
+void ofxHeadlessFbo::writeSpan(size_t x, size_t y, size_t span) {
+    if (numSolidTiles == 0 || span == 0 || (alphaBlending && color.a == 0)) {
+        writeSpanPixels(x, y, span);
+        return;
+    }
+
+    // solid tiles are filled before their first write, a blended span over
+    // a solid tile blends its first pixel and copies it
+    const bool blended = alphaBlending && color.a != 255;
+    const size_t tileY = y / tileSize;
+    const size_t end = x + span;
+    size_t pending = x;
+    while (x < end) {
+        const size_t tileX = x / tileSize;
+        const size_t partEnd = std::min(end, (tileX + 1) * tileSize);
+        if (solidTiles[tileY * tilesX + tileX]) {
+            fillTile(tileX, tileY);
+            if (blended && partEnd - x > 1) {
+                writeSpanPixels(pending, y, x + 1 - pending);
+                unsigned char *row = getBase() + y * stride;
+                for (size_t i = x + 1; i < partEnd; ++i) {
+                    std::memcpy(row + i * numChannels, row + x * numChannels, numChannels);
+                }
+                dirtyX2 = std::max(dirtyX2, partEnd);
+                pending = partEnd;
+            }
+        }
+        x = partEnd;
+    }
+    if (pending < end) {
+        writeSpanPixels(pending, y, end - pending);
+    }
+}
+
+void ofxHeadlessFbo::writeSpanPixels(size_t x, size_t y, size_t span) {
     if (span == 0 || numChannels == 0) {
         return;
     }
 
-    unsigned char *data = pixels.getData();
+    unsigned char *data = getBase();
     if (data == nullptr) {
         return;
     }
+#ifdef OFX_HEADLESS_FBO_STATS
+    countSpan(span);
+#endif
+    dirtyX1 = std::min(dirtyX1, x);
+    dirtyX2 = std::max(dirtyX2, x + span);
+    dirtyY1 = std::min(dirtyY1, y);
+    dirtyY2 = std::max(dirtyY2, y + 1);
+
+    if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+        writeSpanPacked(data, x, y, span);
+        return;
+    }
+    if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+        writeSpanWide(reinterpret_cast<unsigned short *>(data + y * stride) + x * numChannels, span);
+        return;
+    }
+    if (precision == OFX_HEADLESS_FBO_PRECISION_FLOAT) {
+        writeSpanWide(reinterpret_cast<float *>(data + y * stride) + x * numChannels, span);
+        return;
+    }
 
-    const size_t index = (y * w + x) * numChannels;
-    unsigned char *dst = data + index;
+    unsigned char *dst = data + y * stride + x * numChannels;
 
     const unsigned char srcR = color.r;
     const unsigned char srcG = color.g;
@@ -266,7 +1549,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[3] = srcA;
                         dst += 4;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -281,7 +1564,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[3] = 255;
                         dst += 4;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -296,7 +1579,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                     dst[3] = outA;
                     dst += 4;
                 }
-                textureDirty = true;
+                ++version;
                 return;
             }
         case OF_PIXELS_BGRA:
@@ -309,7 +1592,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[3] = srcA;
                         dst += 4;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -324,7 +1607,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[3] = 255;
                         dst += 4;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -339,7 +1622,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                     dst[3] = outA;
                     dst += 4;
                 }
-                textureDirty = true;
+                ++version;
                 return;
             }
         case OF_PIXELS_RGB:
@@ -351,7 +1634,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[2] = srcB;
                         dst += 3;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -365,7 +1648,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[2] = srcB;
                         dst += 3;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -375,7 +1658,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                     dst[2] = blendOverOpaqueChannel(srcB, dst[2], srcA);
                     dst += 3;
                 }
-                textureDirty = true;
+                ++version;
                 return;
             }
         case OF_PIXELS_BGR:
@@ -387,7 +1670,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[2] = srcR;
                         dst += 3;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -401,7 +1684,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[2] = srcR;
                         dst += 3;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -411,7 +1694,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                     dst[2] = blendOverOpaqueChannel(srcR, dst[2], srcA);
                     dst += 3;
                 }
-                textureDirty = true;
+                ++version;
                 return;
             }
         case OF_PIXELS_GRAY:
@@ -419,7 +1702,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                 const unsigned char srcMono = monoFromRgb(srcR, srcG, srcB);
                 if (!alphaBlending) {
                     std::fill_n(dst, span, srcMono);
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -428,14 +1711,14 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                 }
                 if (srcA == 255) {
                     std::fill_n(dst, span, srcMono);
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
                 for (size_t i = 0; i < span; ++i) {
                     dst[i] = blendOverOpaqueChannel(srcMono, dst[i], srcA);
                 }
-                textureDirty = true;
+                ++version;
                 return;
             }
         case OF_PIXELS_GRAY_ALPHA:
@@ -447,7 +1730,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[1] = srcA;
                         dst += 2;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -460,7 +1743,7 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                         dst[1] = 255;
                         dst += 2;
                     }
-                    textureDirty = true;
+                    ++version;
                     return;
                 }
 
@@ -473,40 +1756,522 @@ void ofxHeadlessFbo::writeSpanHFast(size_t x, size_t y, size_t span) {
                     dst[1] = outA;
                     dst += 2;
                 }
-                textureDirty = true;
+                ++version;
+                return;
+            }
+        default:
+            break;
+    }
+
+    for (size_t i = 0; i < span; ++i) {
+        pixels.setColor(x + i, y, this->color);
+    }
+    ++version;
+}
+
+void ofxHeadlessFbo::writeSpanRGBA(size_t x, size_t y, size_t span, const unsigned char *rgba) {
+    if (span == 0 || numChannels == 0) {
+        return;
+    }
+    if (mask == nullptr) {
+        writeRowRGBA(x, y, span, rgba, nullptr);
+        return;
+    }
+
+    // the runs of the mask, as in writeSpanMasked()
+    if (!maskRunsValid || mask->getVersion() != maskVersion) {
+        updateMaskRuns();
+    }
+    if (y + 1 >= maskRows.size()) {
+        return;
+    }
+    const size_t end = x + span;
+    const auto rowEnd = maskRuns.begin() + maskRows[y + 1];
+    auto run = std::upper_bound(maskRuns.begin() + maskRows[y], rowEnd, x,
+                                [](size_t value, const MaskRun &r) { return value < r.end; });
+    const unsigned char *coverage = mask->getData() + (y + maskY) * mask->getStride() + maskX;
+    for (; run != rowEnd && run->start < end; ++run) {
+        const size_t left = std::max<size_t>(x, run->start);
+        const size_t right = std::min<size_t>(end, run->end);
+        writeRowRGBA(left, y, right - left, rgba + (left - x) * 4, run->partial ? coverage + left : nullptr);
+    }
+}
+
+void ofxHeadlessFbo::writeRowRGBA(size_t x, size_t y, size_t span, const unsigned char *rgba,
+                                  const unsigned char *coverage) {
+    unsigned char *data = getBase();
+    if (data == nullptr) {
+        return;
+    }
+    if (numSolidTiles != 0) {
+        const size_t tileY = y / tileSize;
+        for (size_t tileX = x / tileSize; tileX <= (x + span - 1) / tileSize; ++tileX) {
+            if (solidTiles[tileY * tilesX + tileX]) {
+                fillTile(tileX, tileY);
+            }
+        }
+    }
+#ifdef OFX_HEADLESS_FBO_STATS
+    countSpan(span);
+#endif
+    dirtyX1 = std::min(dirtyX1, x);
+    dirtyX2 = std::max(dirtyX2, x + span);
+    dirtyY1 = std::min(dirtyY1, y);
+    dirtyY2 = std::max(dirtyY2, y + 1);
+
+    if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+        writeRowWide(reinterpret_cast<unsigned short *>(data + y * stride) + x * numChannels, span, rgba, coverage);
+    } else if (precision == OFX_HEADLESS_FBO_PRECISION_FLOAT) {
+        writeRowWide(reinterpret_cast<float *>(data + y * stride) + x * numChannels, span, rgba, coverage);
+    } else {
+        // partly covered pixels blend with their alpha scaled by the coverage
+        if (coverage != nullptr) {
+            coveredRow.resize(span * 4);
+            for (size_t i = 0; i < span; ++i) {
+                const unsigned int srcA = alphaBlending ? rgba[i * 4 + 3] : 255u;
+                std::memcpy(&coveredRow[i * 4], rgba + i * 4, 3);
+                coveredRow[i * 4 + 3] = static_cast<unsigned char>((srcA * coverage[i] + 127u) / 255u);
+            }
+            rgba = coveredRow.data();
+        }
+        const bool blending = alphaBlending || coverage != nullptr;
+        if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+            writeRowPacked(data + y * stride, x, span, rgba, blending);
+        } else {
+            const bool swapped = pixelFormat == OF_PIXELS_BGR || pixelFormat == OF_PIXELS_BGRA;
+            blendRowRGBA(data + y * stride + x * numChannels, rgba, span, numChannels, swapped, blending);
+        }
+    }
+    ++version;
+}
+
+void ofxHeadlessFbo::writeRowPacked(unsigned char *row, size_t x, size_t span, const unsigned char *rgba,
+                                    bool blending) {
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            {
+                uint16_t *dst = reinterpret_cast<uint16_t *>(row) + x;
+                for (size_t i = 0; i < span; ++i, rgba += 4) {
+                    const unsigned char srcA = rgba[3];
+                    if (blending && srcA == 0) {
+                        continue;
+                    }
+                    const uint16_t value = packRgb565(rgba[0], rgba[1], rgba[2]);
+                    dst[i] = !blending || srcA == 255 ? value : blendRgb565(value, dst[i], (srcA * 32u + 127u) / 255u);
+                }
+                break;
+            }
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            {
+                // -1 leaves a pixel alone, runs of equal bits are filled at once
+                auto bitOf = [&](size_t i) {
+                    const unsigned char *p = rgba + i * 4;
+                    if (blending && p[3] < 128) {
+                        return -1;
+                    }
+                    return monoFromRgb(p[0], p[1], p[2]) >= 128 ? 1 : 0;
+                };
+                for (size_t i = 0; i < span;) {
+                    const int bit = bitOf(i);
+                    size_t end = i + 1;
+                    while (end < span && bitOf(end) == bit) {
+                        ++end;
+                    }
+                    if (bit >= 0) {
+                        fillBits(row, x + i, end - i, bit != 0);
+                    }
+                    i = end;
+                }
+                break;
+            }
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            {
+                // palette matches of recent colors are kept in a small table,
+                // blended pixels depend on the index under them as well
+                const std::vector<ofColor> &colors = getPalette();
+                uint32_t keys[64];
+                unsigned char indices[64];
+                std::fill_n(keys, 64, 0xFFFFFFFFu);
+                unsigned char *dst = row + x;
+                for (size_t i = 0; i < span; ++i, rgba += 4) {
+                    const unsigned char srcA = rgba[3];
+                    if (blending && srcA == 0) {
+                        continue;
+                    }
+                    const bool opaque = !blending || srcA == 255;
+                    unsigned char r = rgba[0];
+                    unsigned char g = rgba[1];
+                    unsigned char b = rgba[2];
+                    if (!opaque) {
+                        const ofColor under = dst[i] < colors.size() ? colors[dst[i]] : ofColor(0);
+                        r = blendOverOpaqueChannel(r, under.r, srcA);
+                        g = blendOverOpaqueChannel(g, under.g, srcA);
+                        b = blendOverOpaqueChannel(b, under.b, srcA);
+                    }
+                    const uint32_t key = (static_cast<uint32_t>(r) << 16) | (g << 8) | b;
+                    const size_t slot = (key * 2654435761u) >> 26;
+                    if (keys[slot] != key) {
+                        keys[slot] = key;
+                        indices[slot] = nearestIndex(colors, r, g, b);
+                    }
+                    dst[i] = indices[slot];
+                }
+                break;
+            }
+        default:
+            break;
+    }
+}
+
+void ofxHeadlessFbo::writeSpanPacked(unsigned char *data, size_t x, size_t y, size_t span) {
+    unsigned char *row = data + y * stride;
+    const unsigned char srcA = color.a;
+    if (alphaBlending && srcA == 0) {
+        return;
+    }
+    const bool opaque = !alphaBlending || srcA == 255;
+
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            {
+                uint16_t *dst = reinterpret_cast<uint16_t *>(row) + x;
+                if (opaque) {
+                    std::fill_n(dst, span, packedColor);
+                    break;
+                }
+                const unsigned int alpha = (srcA * 32u + 127u) / 255u;
+                for (size_t i = 0; i < span; ++i) {
+                    dst[i] = blendRgb565(packedColor, dst[i], alpha);
+                }
+                break;
+            }
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            if (!opaque && srcA < 128) {
                 return;
             }
+            fillBits(row, x, span, packedColor != 0);
+            break;
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            {
+                unsigned char *dst = row + x;
+                if (opaque) {
+                    std::memset(dst, packedColor, span);
+                    break;
+                }
+                // neighbouring pixels mostly share an index, reuse the last match
+                const std::vector<ofColor> &colors = getPalette();
+                int lastIndex = -1;
+                unsigned char lastResult = 0;
+                for (size_t i = 0; i < span; ++i) {
+                    if (dst[i] != lastIndex) {
+                        lastIndex = dst[i];
+                        const ofColor under = dst[i] < colors.size() ? colors[dst[i]] : ofColor(0);
+                        lastResult = nearestIndex(colors, blendOverOpaqueChannel(color.r, under.r, srcA),
+                                                  blendOverOpaqueChannel(color.g, under.g, srcA),
+                                                  blendOverOpaqueChannel(color.b, under.b, srcA));
+                    }
+                    dst[i] = lastResult;
+                }
+                break;
+            }
+        default:
+            return;
+    }
+    ++version;
+}
+
+template <typename T>
+void ofxHeadlessFbo::writeSpanWide(T *dst, size_t span) {
+    const float srcA = std::min(std::max(wideColor.a, 0.0f), 1.0f);
+    if (alphaBlending && srcA <= 0.0f) {
+        return;
+    }
+    T pixel[4];
+    packWideColor(wideColor, pixelFormat, pixel);
+
+    if (!alphaBlending || srcA >= 1.0f) {
+        for (size_t i = 0; i < span; ++i) {
+            std::copy_n(pixel, numChannels, dst);
+            dst += numChannels;
+        }
+        ++version;
+        return;
+    }
+
+    const bool hasAlpha =
+        pixelFormat == OF_PIXELS_RGBA || pixelFormat == OF_PIXELS_BGRA || pixelFormat == OF_PIXELS_GRAY_ALPHA;
+    for (size_t i = 0; i < span; ++i) {
+        blendWidePixel(dst, pixel, numChannels, hasAlpha, srcA);
+        dst += numChannels;
+    }
+    ++version;
+}
+
+template <typename T>
+void ofxHeadlessFbo::writeRowWide(T *dst, size_t span, const unsigned char *rgba, const unsigned char *coverage) {
+    const bool hasAlpha =
+        pixelFormat == OF_PIXELS_RGBA || pixelFormat == OF_PIXELS_BGRA || pixelFormat == OF_PIXELS_GRAY_ALPHA;
+    const bool blending = alphaBlending || coverage != nullptr;
+    T pixel[4];
+    // runs of equal colors are converted once
+    for (size_t i = 0; i < span;) {
+        size_t end = i + 1;
+        while (end < span && std::memcmp(rgba + i * 4, rgba + end * 4, 4) == 0) {
+            ++end;
+        }
+        const ofFloatColor color(ofColor(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3]));
+        packWideColor(color, pixelFormat, pixel);
+        const float alpha = std::min(std::max(color.a, 0.0f), 1.0f);
+        for (; i < end; ++i, dst += numChannels) {
+            const float srcA = coverage != nullptr ? (alphaBlending ? alpha : 1.0f) * coverage[i] / 255.0f : alpha;
+            if (!blending || srcA >= 1.0f) {
+                std::copy_n(pixel, numChannels, dst);
+            } else if (srcA > 0.0f) {
+                blendWidePixel(dst, pixel, numChannels, hasAlpha, srcA);
+            }
+        }
+    }
+}
+
+template <typename T>
+void ofxHeadlessFbo::clearWide(T *data, const ofFloatColor &color) {
+    T pixel[4];
+    packWideColor(color, pixelFormat, pixel);
+    for (size_t x = 0; x < w; ++x) {
+        std::copy_n(pixel, numChannels, data + x * numChannels);
+    }
+    unsigned char *rows = reinterpret_cast<unsigned char *>(data);
+    for (size_t y = 1; y < h; ++y) {
+        std::memcpy(rows + y * stride, rows, w * numChannels * sizeof(T));
+    }
+}
+
+void ofxHeadlessFbo::quantizeRows(unsigned char *dst) const {
+    const unsigned int frameOffset = nextDitherOffset();
+    const unsigned char *data = getBase();
+    for (size_t y = 0; y < h; ++y) {
+        unsigned char *out = dst + y * w * numChannels;
+        if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+            quantizeRow(reinterpret_cast<const unsigned short *>(data + y * stride), out, w, numChannels, y, dither,
+                        frameOffset);
+        } else {
+            quantizeRow(reinterpret_cast<const float *>(data + y * stride), out, w, numChannels, y, dither,
+                        frameOffset);
+        }
+    }
+}
+
+unsigned int ofxHeadlessFbo::nextDitherOffset() const {
+    // temporal dithering moves every threshold by an odd step, each pixel
+    // cycles through all 64 of them
+    return dither == OFX_HEADLESS_FBO_DITHER_TEMPORAL ? static_cast<unsigned int>(ditherFrame++ * 37u) & 63u : 0u;
+}
+
+void ofxHeadlessFbo::clearPacked(unsigned char *data, const ofColor &color) {
+    const uint16_t value = getPackedValue(color);
+    const size_t rowBytes = getRowBytes();
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            std::fill_n(reinterpret_cast<uint16_t *>(data), w, value);
+            break;
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            std::memset(data, value != 0 ? 0xFF : 0x00, rowBytes);
+            break;
+        default:
+            std::memset(data, value, rowBytes);
+            break;
+    }
+    for (size_t y = 1; y < h; ++y) {
+        std::memcpy(data + y * stride, data, rowBytes);
+    }
+}
+
+void ofxHeadlessFbo::packRows(const unsigned char *src) {
+    unsigned char *data = getBase();
+    const std::vector<ofColor> &colors = getPalette();
+    for (size_t y = 0; y < h; ++y) {
+        unsigned char *row = data + y * stride;
+        const unsigned char *in = src + y * w * numChannels;
+        switch (packedFormat) {
+            case OFX_HEADLESS_FBO_PACKED_RGB565:
+                std::memcpy(row, in, w * 2);
+                break;
+            case OFX_HEADLESS_FBO_PACKED_MONO1:
+                std::memset(row, 0, getRowBytes());
+                for (size_t x = 0; x < w; ++x) {
+                    if (in[x] >= 128) {
+                        row[x >> 3] |= static_cast<unsigned char>(0x80u >> (x & 7));
+                    }
+                }
+                break;
+            case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+                for (size_t x = 0; x < w; ++x, in += 3) {
+                    row[x] = nearestIndex(colors, in[0], in[1], in[2]);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void ofxHeadlessFbo::unpackRows(unsigned char *dst) const {
+    for (size_t y = 0; y < h; ++y) {
+        unpackRow(y, dst + y * w * numChannels);
+    }
+}
+
+void ofxHeadlessFbo::unpackRow(size_t y, unsigned char *out) const {
+    const unsigned char *row = getBase() + y * stride;
+    switch (packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            std::memcpy(out, row, w * 2);
+            break;
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            for (size_t x = 0; x < w; ++x) {
+                out[x] = (row[x >> 3] & (0x80u >> (x & 7))) != 0 ? 255 : 0;
+            }
+            break;
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            {
+                const std::vector<ofColor> &colors = getPalette();
+                for (size_t x = 0; x < w; ++x, out += 3) {
+                    const ofColor c = row[x] < colors.size() ? colors[row[x]] : ofColor(0);
+                    out[0] = c.r;
+                    out[1] = c.g;
+                    out[2] = c.b;
+                }
+                break;
+            }
         default:
             break;
     }
-
-    for (size_t i = 0; i < span; ++i) {
-        pixels.setColor(x + i, y, this->color);
+}
+
+size_t ofxHeadlessFbo::getRowBytes() const {
+    return packedFormat != OFX_HEADLESS_FBO_PACKED_NONE ? packedRowBytes(w, packedFormat) : w * numChannels;
+}
+
+size_t ofxHeadlessFbo::getRowBytes(size_t w, ofPixelFormat pixelFormat) {
+    if (pixelFormat == OF_PIXELS_RGB565) {
+        return packedRowBytes(w, OFX_HEADLESS_FBO_PACKED_RGB565);
+    }
+    return isByteFormat(pixelFormat) ? ofPixels::bytesFromPixelFormat(w, 1, pixelFormat) : 0;
+}
+
+size_t ofxHeadlessFbo::getRowBytes(size_t w, ofxHeadlessFboPackedFormat packedFormat) {
+    return packedRowBytes(w, packedFormat);
+}
+
+void ofxHeadlessFbo::markDirty() {
+    dirtyX1 = 0;
+    dirtyY1 = 0;
+    dirtyX2 = w;
+    dirtyY2 = h;
+    ++version;
+}
+
+uint64_t ofxHeadlessFbo::getVersion() const {
+    return version;
+}
+
+ofRectangle ofxHeadlessFbo::getDirtyRegion() const {
+    const size_t x1 = std::min(dirtyX1, userDirty.x1);
+    const size_t y1 = std::min(dirtyY1, userDirty.y1);
+    const size_t x2 = std::max(dirtyX2, userDirty.x2);
+    const size_t y2 = std::max(dirtyY2, userDirty.y2);
+    if (x2 <= x1 || y2 <= y1) {
+        return ofRectangle(0, 0, 0, 0);
+    }
+    return ofRectangle(x1, y1, x2 - x1, y2 - y1);
+}
+
+void ofxHeadlessFbo::resetDirtyRegion() {
+    closeDirtyEpoch();
+    userDirty = {0, SIZE_MAX, SIZE_MAX, 0, 0};
+}
+
+ofRectangle ofxHeadlessFbo::getDirtyRegionSince(uint64_t version) {
+    closeDirtyEpoch();
+    if (version < dirtyForgottenVersion) {
+        return ofRectangle(0, 0, w, h);
+    }
+    size_t x1 = SIZE_MAX;
+    size_t y1 = SIZE_MAX;
+    size_t x2 = 0;
+    size_t y2 = 0;
+    for (const auto &epoch : dirtyEpochs) {
+        if (epoch.version > version) {
+            x1 = std::min(x1, epoch.x1);
+            y1 = std::min(y1, epoch.y1);
+            x2 = std::max(x2, epoch.x2);
+            y2 = std::max(y2, epoch.y2);
+        }
+    }
+    // epochs from before a resize may reach outside of the buffer
+    x2 = std::min(x2, w);
+    y2 = std::min(y2, h);
+    if (x2 <= x1 || y2 <= y1) {
+        return ofRectangle(0, 0, 0, 0);
     }
-    textureDirty = true;
+    return ofRectangle(x1, y1, x2 - x1, y2 - y1);
 }
 
-void ofxHeadlessFbo::markTextureDirty() {
-    textureDirty = true;
+void ofxHeadlessFbo::closeDirtyEpoch() {
+    if (dirtyX2 <= dirtyX1 || dirtyY2 <= dirtyY1) {
+        return;
+    }
+    // the epoch has to be newer than the version the last caller kept
+    if (version == dirtyClosedVersion) {
+        ++version;
+    }
+    dirtyClosedVersion = version;
+
+    const size_t maxEpochs = 8;
+    if (dirtyEpochs.size() == maxEpochs) {
+        dirtyForgottenVersion = dirtyEpochs.front().version;
+        dirtyEpochs.erase(dirtyEpochs.begin());
+    }
+    dirtyEpochs.push_back({version, dirtyX1, dirtyY1, dirtyX2, dirtyY2});
+    userDirty.x1 = std::min(userDirty.x1, dirtyX1);
+    userDirty.y1 = std::min(userDirty.y1, dirtyY1);
+    userDirty.x2 = std::max(userDirty.x2, dirtyX2);
+    userDirty.y2 = std::max(userDirty.y2, dirtyY2);
+    dirtyX1 = SIZE_MAX;
+    dirtyY1 = SIZE_MAX;
+    dirtyX2 = 0;
+    dirtyY2 = 0;
 }
 
 void ofxHeadlessFbo::drawLine(float x1, float y1, float x2, float y2) {
+    drawLineFixed(fixedFromFloat(x1) + translateX, fixedFromFloat(y1) + translateY, fixedFromFloat(x2) + translateX,
+                  fixedFromFloat(y2) + translateY);
+}
+
+void ofxHeadlessFbo::drawLineFixed(ofxHeadlessFboFixed x1, ofxHeadlessFboFixed y1, ofxHeadlessFboFixed x2,
+                                   ofxHeadlessFboFixed y2) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawLine");
+    OFX_HEADLESS_FBO_STATS_SCOPE(LINE);
     if (!isAllocated() || w == 0 || h == 0) {
         return;
     }
-
-    const float maxX = static_cast<float>(w - 1);
-    const float maxY = static_cast<float>(h - 1);
-    if (!clipLineToBounds(x1, y1, x2, y2, maxX, maxY)) {
+    if (lineWidth > 1) {
+        const float xs[2] = {fixedToFloat(x1) + 0.5f, fixedToFloat(x2) + 0.5f};
+        const float ys[2] = {fixedToFloat(y1) + 0.5f, fixedToFloat(y2) + 0.5f};
+        strokePolyline(xs, ys, 2, false);
         return;
     }
 
-    const int xMax = static_cast<int>(w - 1);
-    const int yMax = static_cast<int>(h - 1);
-    int ix1 = clampToRange(static_cast<int>(std::lround(x1)), 0, xMax);
-    int iy1 = clampToRange(static_cast<int>(std::lround(y1)), 0, yMax);
-    int ix2 = clampToRange(static_cast<int>(std::lround(x2)), 0, xMax);
-    int iy2 = clampToRange(static_cast<int>(std::lround(y2)), 0, yMax);
+    // lines are clipped while they are stepped, so they keep the same
+    // pixels however much of them lies outside the buffer
+    int ix1 = fixedToPixel(x1);
+    int iy1 = fixedToPixel(y1);
+    int ix2 = fixedToPixel(x2);
+    int iy2 = fixedToPixel(y2);
+    if (std::max(ix1, ix2) < 0 || std::max(iy1, iy2) < 0 || std::min(ix1, ix2) >= static_cast<int>(w) ||
+        std::min(iy1, iy2) >= static_cast<int>(h)) {
+        return;
+    }
 
     if (ix1 == ix2) { // vertical line
         if (iy1 > iy2) {
@@ -523,7 +2288,8 @@ void ofxHeadlessFbo::drawLine(float x1, float y1, float x2, float y2) {
     }
 }
 
-void ofxHeadlessFbo::writeLine(int x1, int y1, int x2, int y2) {
+template <typename PointFunction>
+void ofxHeadlessFbo::stepLine(int x1, int y1, int x2, int y2, PointFunction point) {
     const bool steep = std::abs(y2 - y1) > std::abs(x2 - x1);
     if (steep) {
         std::swap(x1, y1);
@@ -537,15 +2303,24 @@ void ofxHeadlessFbo::writeLine(int x1, int y1, int x2, int y2) {
 
     const int dx = x2 - x1;
     const int dy = std::abs(y2 - y1);
-    int err = dx / 2;
     const int ystep = (y1 < y2) ? 1 : -1;
 
-    int y = y1;
-    for (int x = x1; x <= x2; ++x) {
+    // step only the columns inside the buffer, the error term is advanced
+    // to the first of them as if the line had been stepped from its start
+    const int first = std::max(x1, 0);
+    const int last = std::min(x2, static_cast<int>(steep ? h : w) - 1);
+    if (first > last) {
+        return;
+    }
+    const int64_t skipped = first - x1;
+    const int64_t ySteps = -floorDiv(dx / 2 - skipped * dy, dx);
+    int err = static_cast<int>(dx / 2 - skipped * dy + ySteps * dx);
+    int y = y1 + static_cast<int>(ySteps) * ystep;
+    for (int x = first; x <= last; ++x) {
         if (steep) {
-            writePoint(static_cast<size_t>(y), static_cast<size_t>(x));
+            point(y, x);
         } else {
-            writePoint(static_cast<size_t>(x), static_cast<size_t>(y));
+            point(x, y);
         }
 
         err -= dy;
@@ -556,7 +2331,38 @@ void ofxHeadlessFbo::writeLine(int x1, int y1, int x2, int y2) {
     }
 }
 
+void ofxHeadlessFbo::writeLine(int x1, int y1, int x2, int y2) {
+    stepLine(x1, y1, x2, y2, [this](int x, int y) { writePoint(static_cast<size_t>(x), static_cast<size_t>(y)); });
+}
+
+void ofxHeadlessFbo::writeLineRGBA(int x1, int y1, int x2, int y2, const unsigned char *rgba1,
+                                   const unsigned char *rgba2) {
+    // the colors are blended along the major axis, the same pixels as writeLine()
+    const bool steep = std::abs(y2 - y1) > std::abs(x2 - x1);
+    const int length = steep ? y2 - y1 : x2 - x1;
+    unsigned char rgba[4];
+    auto point = [&](int x, int y) {
+        if (x < 0 || y < 0 || x >= static_cast<int>(w) || y >= static_cast<int>(h)) {
+            return;
+        }
+        const double t = length == 0 ? 0.0 : static_cast<double>(steep ? y - y1 : x - x1) / length;
+        for (int c = 0; c < 4; ++c) {
+            rgba[c] = static_cast<unsigned char>(std::lround(rgba1[c] + (rgba2[c] - rgba1[c]) * t));
+        }
+        writeSpanRGBA(static_cast<size_t>(x), static_cast<size_t>(y), 1, rgba);
+    };
+    if (x1 == x2 && y1 == y2) {
+        point(x1, y1);
+        return;
+    }
+    stepLine(x1, y1, x2, y2, point);
+}
+
 void ofxHeadlessFbo::writeLineH(int x, int y, int span) {
+    if (recording) {
+        recordedRows.addSpan(x, y, span);
+        return;
+    }
     if (!isAllocated() || span <= 0) {
         return;
     }
@@ -583,6 +2389,10 @@ void ofxHeadlessFbo::writeLineH(int x, int y, int span) {
 }
 
 void ofxHeadlessFbo::writeLineV(int x, int y, int span) {
+    if (recording) {
+        recordedRows.addColumn(x, y, span);
+        return;
+    }
     if (!isAllocated() || span <= 0) {
         return;
     }
@@ -611,6 +2421,14 @@ void ofxHeadlessFbo::writeLineV(int x, int y, int span) {
 }
 
 void ofxHeadlessFbo::drawRectangle(float x, float y, float w, float h) {
+    drawRectangleFixed(fixedFromFloat(x) + translateX, fixedFromFloat(y) + translateY, fixedFromFloat(w),
+                       fixedFromFloat(h));
+}
+
+void ofxHeadlessFbo::drawRectangleFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed w,
+                                        ofxHeadlessFboFixed h) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawRectangle");
+    OFX_HEADLESS_FBO_STATS_SCOPE(RECTANGLE);
     if (w < 0) {
         x += w;
         w = -w;
@@ -620,10 +2438,10 @@ void ofxHeadlessFbo::drawRectangle(float x, float y, float w, float h) {
         h = -h;
     }
 
-    const int x0 = static_cast<int>(std::floor(x));
-    const int y0 = static_cast<int>(std::floor(y));
-    const int x1 = static_cast<int>(std::ceil(x + w));
-    const int y1 = static_cast<int>(std::ceil(y + h));
+    const int x0 = fixedToEdge(x);
+    const int y0 = fixedToEdge(y);
+    const int x1 = fixedToEdge(x + w);
+    const int y1 = fixedToEdge(y + h);
     const int spanW = x1 - x0;
     const int spanH = y1 - y0;
     if (spanW <= 0 || spanH <= 0) {
@@ -634,6 +2452,11 @@ void ofxHeadlessFbo::drawRectangle(float x, float y, float w, float h) {
         for (int row = y0; row < y1; ++row) {
             writeLineH(x0, row, spanW);
         }
+    } else if (lineWidth > 1) {
+        // the outline runs through the centers of the border pixels
+        const float xs[4] = {x0 + 0.5f, x1 - 0.5f, x1 - 0.5f, x0 + 0.5f};
+        const float ys[4] = {y0 + 0.5f, y0 + 0.5f, y1 - 0.5f, y1 - 0.5f};
+        strokePolyline(xs, ys, 4, true);
     } else {
         writeLineH(x0, y0, spanW);
         writeLineH(x0, y1 - 1, spanW);
@@ -643,121 +2466,413 @@ void ofxHeadlessFbo::drawRectangle(float x, float y, float w, float h) {
 }
 
 void ofxHeadlessFbo::drawSquare(float x, float y, float d) {
-    drawRectangle(x, y, d, d);
+    const ofxHeadlessFboFixed size = fixedFromFloat(d);
+    drawRectangleFixed(fixedFromFloat(x) + translateX, fixedFromFloat(y) + translateY, size, size);
 }
 
 void ofxHeadlessFbo::drawSquareCentered(float x, float y, float d) {
-    drawRectangle(x - d / 2, y - d / 2, d, d);
+    const ofxHeadlessFboFixed size = fixedFromFloat(d);
+    drawRectangleFixed(fixedFromFloat(x) - size / 2 + translateX, fixedFromFloat(y) - size / 2 + translateY, size,
+                       size);
 }
 
 void ofxHeadlessFbo::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+    drawTriangleFixed(fixedFromFloat(x1) + translateX, fixedFromFloat(y1) + translateY, fixedFromFloat(x2) + translateX,
+                      fixedFromFloat(y2) + translateY, fixedFromFloat(x3) + translateX, fixedFromFloat(y3) + translateY);
+}
+
+void ofxHeadlessFbo::drawTriangleFixed(ofxHeadlessFboFixed x1, ofxHeadlessFboFixed y1, ofxHeadlessFboFixed x2,
+                                       ofxHeadlessFboFixed y2, ofxHeadlessFboFixed x3, ofxHeadlessFboFixed y3) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawTriangle");
+    OFX_HEADLESS_FBO_STATS_SCOPE(TRIANGLE);
     if (fill) {
         if (!isAllocated() || w == 0 || h == 0) {
             return;
         }
 
-        const float area2 = (x2 - x1) * (y3 - y1) - (y2 - y1) * (x3 - x1);
-        if (std::abs(area2) <= 1e-6f) {
-            auto dist2 = [](float ax, float ay, float bx, float by) {
-                const float dx = bx - ax;
-                const float dy = by - ay;
-                return dx * dx + dy * dy;
-            };
-
-            const float d12 = dist2(x1, y1, x2, y2);
-            const float d23 = dist2(x2, y2, x3, y3);
-            const float d31 = dist2(x3, y3, x1, y1);
-            if (d12 >= d23 && d12 >= d31) {
-                drawLine(x1, y1, x2, y2);
-            } else if (d23 >= d31) {
-                drawLine(x2, y2, x3, y3);
-            } else {
-                drawLine(x3, y3, x1, y1);
-            }
+        const int64_t area2 = (static_cast<int64_t>(x2) - x1) * (static_cast<int64_t>(y3) - y1) -
+                              (static_cast<int64_t>(y2) - y1) * (static_cast<int64_t>(x3) - x1);
+        const ofxHeadlessFboFixed xs[3] = {x1, x2, x3};
+        const ofxHeadlessFboFixed ys[3] = {y1, y2, y3};
+        if (area2 == 0) {
+            const int a = longestEdge(xs, ys);
+            const int b = (a + 1) % 3;
+            drawLineFixed(xs[a], ys[a], xs[b], ys[b]);
             return;
         }
+        fillTriangle(xs, ys, nullptr, 0, static_cast<int>(h));
+    } else if (lineWidth > 1) {
+        const float xs[3] = {fixedToFloat(x1) + 0.5f, fixedToFloat(x2) + 0.5f, fixedToFloat(x3) + 0.5f};
+        const float ys[3] = {fixedToFloat(y1) + 0.5f, fixedToFloat(y2) + 0.5f, fixedToFloat(y3) + 0.5f};
+        strokePolyline(xs, ys, 3, true);
+    } else {
+        drawLineFixed(x1, y1, x2, y2);
+        drawLineFixed(x2, y2, x3, y3);
+        drawLineFixed(x3, y3, x1, y1);
+    }
+}
+
+template <typename SpanFunction>
+void ofxHeadlessFbo::rasterizeTriangle(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys, int rowStart,
+                                       int rowEnd, SpanFunction span) {
+    // corners from top to bottom, the long edge spans all rows
+    int top = 0;
+    int mid = 1;
+    int bottom = 2;
+    if (ys[top] > ys[mid]) {
+        std::swap(top, mid);
+    }
+    if (ys[mid] > ys[bottom]) {
+        std::swap(mid, bottom);
+    }
+    if (ys[top] > ys[mid]) {
+        std::swap(top, mid);
+    }
 
-        const float minY = std::min({y1, y2, y3});
-        const float maxY = std::max({y1, y2, y3});
-        int yStart = static_cast<int>(std::floor(minY));
-        int yEnd = static_cast<int>(std::ceil(maxY));
+    // rows and columns whose pixel centers lie inside, edges include their
+    // top end and leave out their bottom end
+    int row = std::max(fixedToEdge(ys[top]), rowStart);
+    const int midRow = std::min(fixedToEdge(ys[mid]), rowEnd);
+    const int endRow = std::min(fixedToEdge(ys[bottom]), rowEnd);
+    if (row >= endRow) {
+        return;
+    }
 
-        if (yEnd <= 0 || yStart >= static_cast<int>(h)) {
-            return;
+    auto emit = [&](int64_t a, int64_t b) {
+        const int left = fixedToEdge(static_cast<ofxHeadlessFboFixed>(std::min(a, b)));
+        const int right = fixedToEdge(static_cast<ofxHeadlessFboFixed>(std::max(a, b)));
+        if (right > left) {
+            span(row, left, right);
         }
-        yStart = std::max(yStart, 0);
-        yEnd = std::min(yEnd, static_cast<int>(h));
-        if (yStart >= yEnd) {
-            return;
+    };
+
+    EdgeWalker longEdge(xs[top], ys[top], xs[bottom], ys[bottom], row);
+    if (row < midRow) {
+        EdgeWalker edge(xs[top], ys[top], xs[mid], ys[mid], row);
+        for (; row < midRow; ++row) {
+            emit(longEdge.x, edge.x);
+            longEdge.next();
+            edge.next();
+        }
+    }
+    if (row < endRow) {
+        EdgeWalker edge(xs[mid], ys[mid], xs[bottom], ys[bottom], row);
+        for (; row < endRow; ++row) {
+            emit(longEdge.x, edge.x);
+            longEdge.next();
+            edge.next();
         }
+    }
+}
 
-        auto addIntersection = [](float ax, float ay, float bx, float by, float scanY, float *hits,
-                                  int &hitCount) {
-            if (ay == by) {
-                return;
-            }
-            const float edgeMinY = std::min(ay, by);
-            const float edgeMaxY = std::max(ay, by);
-            if (scanY < edgeMinY || scanY >= edgeMaxY) {
-                return;
-            }
+void ofxHeadlessFbo::fillTriangle(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys,
+                                  const unsigned char *const *colors, int rowStart, int rowEnd) {
+    if (colors == nullptr) {
+        rasterizeTriangle(xs, ys, rowStart, rowEnd, [&](int row, int left, int right) {
+            writeLineH(left, row, right - left);
+        });
+        return;
+    }
 
-            const float t = (scanY - ay) / (by - ay);
-            hits[hitCount++] = ax + t * (bx - ax);
-        };
+    const double dx1 = static_cast<double>(xs[1]) - xs[0];
+    const double dy1 = static_cast<double>(ys[1]) - ys[0];
+    const double dx2 = static_cast<double>(xs[2]) - xs[0];
+    const double dy2 = static_cast<double>(ys[2]) - ys[0];
+    const double area2 = dx1 * dy2 - dy1 * dx2;
+    if (area2 == 0) {
+        return;
+    }
 
-        for (int row = yStart; row < yEnd; ++row) {
-            const float scanY = static_cast<float>(row) + 0.5f;
-            float hits[3];
-            int hitCount = 0;
+    // every channel is a plane over the triangle, kept in 16.16 fixed point
+    // per pixel, with its value at the center of the pixel holding the first
+    // corner, so moving the triangle by whole pixels gives the same colors
+    const int baseX = fixedToPixel(xs[0]);
+    const int baseY = fixedToPixel(ys[0]);
+    const double centerX = (static_cast<double>(baseX) * 256.0 + 128.0 - xs[0]) / 256.0;
+    const double centerY = (static_cast<double>(baseY) * 256.0 + 128.0 - ys[0]) / 256.0;
+    int64_t stepX[4];
+    int64_t stepY[4];
+    int64_t origin[4];
+    for (int c = 0; c < 4; ++c) {
+        const double c0 = colors[0][c];
+        const double dc1 = colors[1][c] - c0;
+        const double dc2 = colors[2][c] - c0;
+        const double gradientX = (dc1 * dy2 - dc2 * dy1) / area2 * 256.0;
+        const double gradientY = (dc2 * dx1 - dc1 * dx2) / area2 * 256.0;
+        stepX[c] = std::llround(gradientX * 65536.0);
+        stepY[c] = std::llround(gradientY * 65536.0);
+        origin[c] = std::llround((c0 + gradientX * centerX + gradientY * centerY) * 65536.0);
+    }
 
-            addIntersection(x1, y1, x2, y2, scanY, hits, hitCount);
-            addIntersection(x2, y2, x3, y3, scanY, hits, hitCount);
-            addIntersection(x3, y3, x1, y1, scanY, hits, hitCount);
+    int64_t rowValue[4];
+    int lastRow = 0;
+    bool first = true;
+    const int maxX = static_cast<int>(w);
+    rasterizeTriangle(xs, ys, rowStart, rowEnd, [&](int row, int left, int right) {
+        for (int c = 0; c < 4; ++c) {
+            rowValue[c] = first ? origin[c] + stepY[c] * (row - baseY) : rowValue[c] + stepY[c] * (row - lastRow);
+        }
+        first = false;
+        lastRow = row;
 
-            if (hitCount < 2) {
-                continue;
+        left = std::max(left, 0);
+        right = std::min(right, maxX);
+        if (left >= right || row < 0 || row >= static_cast<int>(h)) {
+            return;
+        }
+        const size_t span = right - left;
+        meshScratch.span.resize(span * 4);
+        unsigned char *out = meshScratch.span.data();
+        for (int c = 0; c < 4; ++c) {
+            int64_t value = rowValue[c] + stepX[c] * (left - baseX);
+            for (size_t i = 0; i < span; ++i) {
+                const int64_t clamped = std::min<int64_t>(std::max<int64_t>(value, 0), 255 << 16);
+                out[i * 4 + c] = static_cast<unsigned char>((clamped + 0x8000) >> 16);
+                value += stepX[c];
             }
+        }
+        writeSpanRGBA(left, row, span, out);
+    });
+}
+
+void ofxHeadlessFbo::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3, const ofColor &c1,
+                                  const ofColor &c2, const ofColor &c3) {
+    const ofxHeadlessFboFixed xs[3] = {fixedFromFloat(x1) + translateX, fixedFromFloat(x2) + translateX,
+                                       fixedFromFloat(x3) + translateX};
+    const ofxHeadlessFboFixed ys[3] = {fixedFromFloat(y1) + translateY, fixedFromFloat(y2) + translateY,
+                                       fixedFromFloat(y3) + translateY};
+    drawTriangleFixed(xs, ys, c1, c2, c3);
+}
+
+void ofxHeadlessFbo::drawTriangleFixed(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys, const ofColor &c1,
+                                       const ofColor &c2, const ofColor &c3) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawTriangle");
+    OFX_HEADLESS_FBO_STATS_SCOPE(TRIANGLE);
+    if (!isAllocated() || w == 0 || h == 0) {
+        return;
+    }
+    const unsigned char rgba[3][4] = {{c1.r, c1.g, c1.b, c1.a}, {c2.r, c2.g, c2.b, c2.a}, {c3.r, c3.g, c3.b, c3.a}};
+    const int64_t area2 = (static_cast<int64_t>(xs[1]) - xs[0]) * (static_cast<int64_t>(ys[2]) - ys[0]) -
+                          (static_cast<int64_t>(ys[1]) - ys[0]) * (static_cast<int64_t>(xs[2]) - xs[0]);
+    if (area2 == 0) {
+        // the same edge as the flat triangle, one pixel wide
+        const int a = longestEdge(xs, ys);
+        const int b = (a + 1) % 3;
+        writeLineRGBA(fixedToPixel(xs[a]), fixedToPixel(ys[a]), fixedToPixel(xs[b]), fixedToPixel(ys[b]), rgba[a],
+                      rgba[b]);
+        return;
+    }
+    const unsigned char *colors[3] = {rgba[0], rgba[1], rgba[2]};
+    fillTriangle(xs, ys, colors, 0, static_cast<int>(h));
+}
+
+void ofxHeadlessFbo::drawTriangles(const float *positions, size_t positionStride, const float *colors,
+                                   size_t colorStride, size_t numVertices, size_t binRows) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawMesh");
+    OFX_HEADLESS_FBO_STATS_SCOPE(MESH);
+    if (!isAllocated() || w == 0 || h == 0) {
+        return;
+    }
+
+    // every vertex is converted once, however many triangles share it
+    const bool colored = colors != nullptr;
+    meshScratch.xs.resize(numVertices);
+    meshScratch.ys.resize(numVertices);
+    for (size_t i = 0; i < numVertices; ++i) {
+        meshScratch.xs[i] = fixedFromFloat(positions[i * positionStride]) + translateX;
+        meshScratch.ys[i] = fixedFromFloat(positions[i * positionStride + 1]) + translateY;
+    }
+    if (colored) {
+        meshScratch.colors.resize(numVertices * 4);
+        for (size_t i = 0; i < numVertices; ++i) {
+            const float *c = colors + i * colorStride;
+            const ofColor color = toByteColor(ofFloatColor(c[0], c[1], c[2], c[3]));
+            meshScratch.colors[i * 4] = color.r;
+            meshScratch.colors[i * 4 + 1] = color.g;
+            meshScratch.colors[i * 4 + 2] = color.b;
+            meshScratch.colors[i * 4 + 3] = color.a;
+        }
+    }
+
+    const auto &triangles = meshScratch.triangles;
+    const size_t numTriangles = triangles.size() / 3;
+    auto draw = [&](size_t t, int rowStart, int rowEnd) {
+        const uint32_t *corners = &triangles[t * 3];
+        const ofxHeadlessFboFixed xs[3] = {meshScratch.xs[corners[0]], meshScratch.xs[corners[1]],
+                                           meshScratch.xs[corners[2]]};
+        const ofxHeadlessFboFixed ys[3] = {meshScratch.ys[corners[0]], meshScratch.ys[corners[1]],
+                                           meshScratch.ys[corners[2]]};
+        if (colored) {
+            const unsigned char *colors[3] = {&meshScratch.colors[corners[0] * 4], &meshScratch.colors[corners[1] * 4],
+                                              &meshScratch.colors[corners[2] * 4]};
+            fillTriangle(xs, ys, colors, rowStart, rowEnd);
+        } else {
+            fillTriangle(xs, ys, nullptr, rowStart, rowEnd);
+        }
+    };
 
-            float left = hits[0];
-            float right = hits[0];
-            for (int i = 1; i < hitCount; ++i) {
-                left = std::min(left, hits[i]);
-                right = std::max(right, hits[i]);
+    if (binRows == 0) {
+        for (size_t t = 0; t < numTriangles; ++t) {
+            draw(t, 0, static_cast<int>(h));
+        }
+        return;
+    }
+
+    // counting sort of the triangles into the bands they touch, in mesh order
+    const size_t numBins = (h + binRows - 1) / binRows;
+    auto bandsOf = [&](size_t t, size_t &first, size_t &last) {
+        const uint32_t *corners = &triangles[t * 3];
+        const ofxHeadlessFboFixed *ys = meshScratch.ys.data();
+        const int top = fixedToEdge(std::min({ys[corners[0]], ys[corners[1]], ys[corners[2]]}));
+        const int bottom = fixedToEdge(std::max({ys[corners[0]], ys[corners[1]], ys[corners[2]]}));
+        if (bottom <= 0 || top >= static_cast<int>(h) || top >= bottom) {
+            return false;
+        }
+        first = static_cast<size_t>(std::max(top, 0)) / binRows;
+        last = (static_cast<size_t>(std::min(bottom, static_cast<int>(h))) - 1) / binRows;
+        return true;
+    };
+    auto &binStarts = meshScratch.binStarts;
+    auto &binTriangles = meshScratch.binTriangles;
+    binStarts.assign(numBins + 1, 0);
+    size_t first = 0;
+    size_t last = 0;
+    for (size_t t = 0; t < numTriangles; ++t) {
+        if (bandsOf(t, first, last)) {
+            for (size_t bin = first; bin <= last; ++bin) {
+                binStarts[bin + 1]++;
+            }
+        }
+    }
+    for (size_t bin = 0; bin < numBins; ++bin) {
+        binStarts[bin + 1] += binStarts[bin];
+    }
+    binTriangles.resize(binStarts[numBins]);
+    // placing moves every start to the end of its bin, bin b ends up
+    // running from binStarts[b - 1] to binStarts[b]
+    for (size_t t = 0; t < numTriangles; ++t) {
+        if (bandsOf(t, first, last)) {
+            for (size_t bin = first; bin <= last; ++bin) {
+                binTriangles[binStarts[bin]++] = static_cast<uint32_t>(t);
             }
+        }
+    }
+    for (size_t bin = 0; bin < numBins; ++bin) {
+        const int rowStart = static_cast<int>(bin * binRows);
+        const int rowEnd = static_cast<int>(std::min((bin + 1) * binRows, h));
+        for (size_t i = bin == 0 ? 0 : binStarts[bin - 1]; i < binStarts[bin]; ++i) {
+            draw(binTriangles[i], rowStart, rowEnd);
+        }
+    }
+}
+
+void ofxHeadlessFbo::RowExtents::begin(int top, int rows) {
+    this->top = top;
+    left.assign(rows, std::numeric_limits<int32_t>::max());
+    right.assign(rows, std::numeric_limits<int32_t>::min());
+}
+
+void ofxHeadlessFbo::RowExtents::addSpan(int x, int y, int span) {
+    const int row = y - top;
+    if (span <= 0 || row < 0 || row >= static_cast<int>(left.size())) {
+        return;
+    }
+    left[row] = std::min(left[row], x);
+    right[row] = std::max(right[row], x + span - 1);
+}
+
+void ofxHeadlessFbo::RowExtents::addColumn(int x, int y, int span) {
+    // only the rows being collected, a column of a huge shape stays cheap
+    const int first = std::max(y - top, 0);
+    const int last = std::min(y - top + span, static_cast<int>(left.size()));
+    for (int row = first; row < last; ++row) {
+        left[row] = std::min(left[row], x);
+        right[row] = std::max(right[row], x);
+    }
+}
 
-            int xStart = static_cast<int>(std::floor(left));
-            int xEnd = static_cast<int>(std::floor(right));
-            if (xEnd < xStart) {
-                std::swap(xStart, xEnd);
+template <typename Rasterize>
+void ofxHeadlessFbo::drawFilled(const ofxHeadlessFboShapeCache::Key &key, int left, int top, int width, int height,
+                                Rasterize rasterize) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    const bool cached = shapeCache.isEnabled() && static_cast<size_t>(width) <= w &&
+                        static_cast<size_t>(height) <= h &&
+                        ofxHeadlessFboShapeCache::getEntryBytes(height) <= shapeCache.getMaxBytes();
+    if (!cached) {
+        // only the rows on the canvas
+        const int first = std::max(top, 0);
+        const int last = static_cast<int>(std::min<long long>(static_cast<long long>(top) + height, h));
+        if (first >= last) {
+            return;
+        }
+        recordedRows.begin(first, last - first);
+        recording = true;
+        rasterize();
+        recording = false;
+        for (int row = first; row < last; ++row) {
+            const int32_t x1 = recordedRows.left[row - first];
+            const int32_t x2 = recordedRows.right[row - first];
+            if (x1 <= x2) {
+                writeLineH(x1, row, x2 - x1 + 1);
             }
+        }
+        return;
+    }
 
-            writeLineH(xStart, row, xEnd - xStart + 1);
+    const std::vector<ofxHeadlessFboShapeCache::Span> *spans = shapeCache.find(key);
+    if (spans == nullptr) {
+        // the whole shape, with its spans relative to the top left corner
+        recordedRows.begin(top, height);
+        recording = true;
+        rasterize();
+        recording = false;
+        recordedSpans.clear();
+        for (int row = 0; row < height; ++row) {
+            if (recordedRows.left[row] <= recordedRows.right[row]) {
+                recordedSpans.push_back({row, recordedRows.left[row] - left, recordedRows.right[row] - left});
+            }
         }
-    } else {
-        drawLine(x1, y1, x2, y2);
-        drawLine(x2, y2, x3, y3);
-        drawLine(x3, y3, x1, y1);
+        shapeCache.insert(key, recordedSpans);
+        spans = &recordedSpans;
+    }
+    for (const auto &span : *spans) {
+        writeLineH(left + span.left, top + span.row, span.right - span.left + 1);
     }
 }
 
 void ofxHeadlessFbo::drawCircle(float x, float y, float r) {
-    if (r <= 0)
-        r = 0;
+    drawCircleFixed(fixedFromFloat(x) + translateX, fixedFromFloat(y) + translateY, fixedFromFloat(r));
+}
+
+void ofxHeadlessFbo::drawCircleFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed r) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawCircle");
+    OFX_HEADLESS_FBO_STATS_SCOPE(CIRCLE);
+    const int ix = fixedToPixel(x);
+    const int iy = fixedToPixel(y);
+    const int ir = std::max(fixedToPixel(r), 0);
     if (fill) {
-        writeLineV(x, y - r, 2 * r + 1);
-        fillCircleHelper(x, y, r, 3, 0);
+        drawFilled({ofxHeadlessFboShapeCache::CIRCLE, {ir}}, ix - ir, iy - ir, 2 * ir + 1, 2 * ir + 1, [&]() {
+            writeLineV(ix, iy - ir, 2 * ir + 1);
+            fillCircleHelper(ix, iy, ir, 3, 0);
+        });
+    } else if (lineWidth > 1) {
+        const float radius = static_cast<float>(ir);
+        strokeSpans.begin(h);
+        strokeSpans.addEllipseRing(ix + 0.5f, iy + 0.5f, radius, radius, lineWidth / 2);
+        strokeSpans.flush(*this);
     } else {
-        int f = 1 - r;
+        int f = 1 - ir;
         int ddF_x = 1;
-        int ddF_y = -2 * r;
+        int ddF_y = -2 * ir;
         int _x = 0;
-        int _y = r;
+        int _y = ir;
 
-        writePoint(x, y + r);
-        writePoint(x, y - r);
-        writePoint(x + r, y);
-        writePoint(x - r, y);
+        writePoint(ix, iy + ir);
+        writePoint(ix, iy - ir);
+        writePoint(ix + ir, iy);
+        writePoint(ix - ir, iy);
 
         while (_x < _y) {
             if (f >= 0) {
@@ -769,14 +2884,14 @@ void ofxHeadlessFbo::drawCircle(float x, float y, float r) {
             ddF_x += 2;
             f += ddF_x;
 
-            writePoint(x + _x, y + _y);
-            writePoint(x - _x, y + _y);
-            writePoint(x + _x, y - _y);
-            writePoint(x - _x, y - _y);
-            writePoint(x + _y, y + _x);
-            writePoint(x - _y, y + _x);
-            writePoint(x + _y, y - _x);
-            writePoint(x - _y, y - _x);
+            writePoint(ix + _x, iy + _y);
+            writePoint(ix - _x, iy + _y);
+            writePoint(ix + _x, iy - _y);
+            writePoint(ix - _x, iy - _y);
+            writePoint(ix + _y, iy + _x);
+            writePoint(ix - _y, iy + _x);
+            writePoint(ix + _y, iy - _x);
+            writePoint(ix - _y, iy - _x);
         }
     }
 }
@@ -855,41 +2970,82 @@ void ofxHeadlessFbo::fillCircleHelper(int x0, int y0, int r, int corners, int de
 }
 
 void ofxHeadlessFbo::drawRectRounded(float x, float y, float w, float h, float r) {
-    if (w < 0)
-        w = 0;
-    if (h < 0)
-        h = 0;
-    if (r < 0)
-        r = 0;
+    drawRectRoundedFixed(fixedFromFloat(x) + translateX, fixedFromFloat(y) + translateY, fixedFromFloat(w),
+                         fixedFromFloat(h), fixedFromFloat(r));
+}
 
-    int max_radius = ((w < h) ? w : h) / 2; // 1/2 minor axis
-    if (r > max_radius)
-        r = max_radius;
+void ofxHeadlessFbo::drawRectRoundedFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed w,
+                                          ofxHeadlessFboFixed h, ofxHeadlessFboFixed r) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawRectRounded");
+    OFX_HEADLESS_FBO_STATS_SCOPE(RECT_ROUNDED);
+    // the same pixels drawRectangle() covers
+    const int x0 = fixedToEdge(x);
+    const int y0 = fixedToEdge(y);
+    const int iw = std::max(fixedToEdge(x + std::max(w, 0)) - x0, 0);
+    const int ih = std::max(fixedToEdge(y + std::max(h, 0)) - y0, 0);
+    const int ir = std::min(std::max(fixedToPixel(r), 0), std::min(iw, ih) / 2); // up to 1/2 minor axis
+
+    auto rasterizeFill = [&]() {
+        for (int row = y0; row < y0 + ih; ++row) {
+            writeLineH(x0 + ir, row, iw - 2 * ir);
+        }
+        // draw four corners
+        fillCircleHelper(x0 + iw - ir - 1, y0 + ir, ir, 1, ih - 2 * ir - 1);
+        fillCircleHelper(x0 + ir, y0 + ir, ir, 2, ih - 2 * ir - 1);
+    };
 
     if (fill) {
-        drawRectangle(x + r, y, w - 2 * r, h);
-        // draw four corners
-        fillCircleHelper(x + w - r - 1, y + r, r, 1, h - 2 * r - 1);
-        fillCircleHelper(x + r, y + r, r, 2, h - 2 * r - 1);
+        drawFilled({ofxHeadlessFboShapeCache::RECT_ROUNDED, {iw, ih, ir}}, x0, y0, iw, ih, rasterizeFill);
+    } else if (lineWidth > 1) {
+        strokeSpans.begin(this->h);
+        strokeSpans.addRoundedRectRing(x0 + 0.5f, y0 + 0.5f, x0 + iw - 0.5f, y0 + ih - 0.5f, static_cast<float>(ir),
+                                       lineWidth / 2);
+        strokeSpans.flush(*this);
     } else {
-        writeLineH(x + r, y, w - 2 * r);         // Top
-        writeLineH(x + r, y + h - 1, w - 2 * r); // Bottom
-        writeLineV(x, y + r, h - 2 * r);         // Left
-        writeLineV(x + w - 1, y + r, h - 2 * r); // Right
+        writeLineH(x0 + ir, y0, iw - 2 * ir);          // Top
+        writeLineH(x0 + ir, y0 + ih - 1, iw - 2 * ir); // Bottom
+        writeLineV(x0, y0 + ir, ih - 2 * ir);          // Left
+        writeLineV(x0 + iw - 1, y0 + ir, ih - 2 * ir); // Right
         // draw four corners
-        circleHelper(x + r, y + r, r, 1);
-        circleHelper(x + w - r - 1, y + r, r, 2);
-        circleHelper(x + w - r - 1, y + h - r - 1, r, 4);
-        circleHelper(x + r, y + h - r - 1, r, 8);
+        circleHelper(x0 + ir, y0 + ir, ir, 1);
+        circleHelper(x0 + iw - ir - 1, y0 + ir, ir, 2);
+        circleHelper(x0 + iw - ir - 1, y0 + ih - ir - 1, ir, 4);
+        circleHelper(x0 + ir, y0 + ih - ir - 1, ir, 8);
     }
 }
 
 void ofxHeadlessFbo::drawEllipse(float x, float y, float w, float h) {
+    drawEllipseFixed(fixedFromFloat(x) + translateX, fixedFromFloat(y) + translateY, fixedFromFloat(w),
+                     fixedFromFloat(h));
+}
+
+void ofxHeadlessFbo::drawEllipseFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed w,
+                                      ofxHeadlessFboFixed h) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("drawEllipse");
+    OFX_HEADLESS_FBO_STATS_SCOPE(ELLIPSE);
     if (w < 0)
         w = 0;
     if (h < 0)
         h = 0;
-    int x0 = x - w / 2.0, y0 = y + h / 2.0, x1 = x + w / 2.0, y1 = y - h / 2.0;
+    // pixels containing the corners of the bounding box
+    int x0 = fixedToPixel(x - w / 2), y0 = fixedToPixel(y + h / 2), x1 = fixedToPixel(x + w / 2),
+        y1 = fixedToPixel(y - h / 2);
+    if (!fill && lineWidth > 1) {
+        strokeSpans.begin(this->h);
+        strokeSpans.addEllipseRing((x0 + x1) / 2.0f + 0.5f, (y0 + y1) / 2.0f + 0.5f, std::abs(x1 - x0) / 2.0f,
+                                   std::abs(y0 - y1) / 2.0f, lineWidth / 2);
+        strokeSpans.flush(*this);
+        return;
+    }
+    if (fill) {
+        drawFilled({ofxHeadlessFboShapeCache::ELLIPSE, {x1 - x0, y0 - y1}}, x0, y1, x1 - x0 + 1, y0 - y1 + 1,
+                   [&]() { rasterizeEllipse(x0, y0, x1, y1); });
+        return;
+    }
+    rasterizeEllipse(x0, y0, x1, y1);
+}
+
+void ofxHeadlessFbo::rasterizeEllipse(int x0, int y0, int x1, int y1) {
     long a = abs(x1 - x0), b = abs(y1 - y0), b1 = b & 1;      /* values of diameter */
     long dx = 4 * (1 - a) * b * b, dy = 4 * (b1 + 1) * a * a; /* error increment */
     long err = dx + dy + b1 * a * a, e2;                      /* error of 1.step */
@@ -911,10 +3067,10 @@ void ofxHeadlessFbo::drawEllipse(float x, float y, float w, float h) {
             if (x0 != x1)
                 writeLineV(x0, y1, y0 - y1);
         } else {
-            drawPoint(x1, y0); /*   I. Quadrant */ // bottom right
-            drawPoint(x0, y0); /*  II. Quadrant */ // bottom left
-            drawPoint(x0, y1); /* III. Quadrant */ // top left
-            drawPoint(x1, y1); /*  IV. Quadrant */ // top right
+            drawPointFixed(toFixed(x1), toFixed(y0)); /*   I. Quadrant */ // bottom right
+            drawPointFixed(toFixed(x0), toFixed(y0)); /*  II. Quadrant */ // bottom left
+            drawPointFixed(toFixed(x0), toFixed(y1)); /* III. Quadrant */ // top left
+            drawPointFixed(toFixed(x1), toFixed(y1)); /*  IV. Quadrant */ // top right
         }
         e2 = 2 * err;
         if (e2 >= dx) {
@@ -930,7 +3086,477 @@ void ofxHeadlessFbo::drawEllipse(float x, float y, float w, float h) {
     } while (x0 <= x1);
 
     while (y0 - y1 < b) {        /* too early stop of flat ellipses a=1 */
-        drawPoint(x0 - 1, ++y0); /* -> complete tip of ellipse */
-        drawPoint(x0 - 1, --y1);
+        drawPointFixed(toFixed(x0 - 1), toFixed(++y0)); /* -> complete tip of ellipse */
+        drawPointFixed(toFixed(x0 - 1), toFixed(--y1));
+    }
+}
+
+void ofxHeadlessFbo::floodFill(float x, float y, float tolerance) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("floodFill");
+    OFX_HEADLESS_FBO_STATS_SCOPE(FLOOD_FILL);
+    x += fixedToFloat(translateX);
+    y += fixedToFloat(translateY);
+    if (!isAllocated() || numChannels == 0 || x < 0 || y < 0 || x >= w || y >= h) {
+        return;
+    }
+    const size_t seedX = static_cast<size_t>(x);
+    const size_t seedY = static_cast<size_t>(y);
+    const int limit = static_cast<int>(std::max(tolerance, 0.0f));
+    const size_t channels = pixelFormat == OF_PIXELS_RGB565 ? 3 : numChannels;
+    const bool readDirect = precision == OFX_HEADLESS_FBO_PRECISION_8 && packedFormat == OFX_HEADLESS_FBO_PACKED_NONE &&
+                            isByteFormat(pixelFormat) && numSolidTiles == 0;
+    const size_t words = (w + 63) / 64;
+    if (flood.visited.size() != words * h) {
+        flood.visited.assign(words * h, 0);
+    }
+    if (!readDirect) {
+        flood.rows.resize(w * h * channels);
+        flood.rowReady.assign(h, 0);
+    }
+    const unsigned char *base = getBase();
+    auto row = [&](size_t ry) { return readDirect ? base + ry * stride : getFloodRow(ry); };
+
+    unsigned char seed[4];
+    std::memcpy(seed, row(seedY) + seedX * channels, channels);
+    auto matches = [&](const unsigned char *pixel) {
+        for (size_t c = 0; c < channels; ++c) {
+            if (std::abs(static_cast<int>(pixel[c]) - static_cast<int>(seed[c])) > limit) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto visited = [&](size_t px, size_t py) {
+        return (flood.visited[py * words + (px >> 6)] >> (px & 63)) & 1u;
+    };
+
+    // find the area first, spans are marked visited so they never overlap
+    flood.spans.clear();
+    flood.stack.clear();
+    flood.stack.push_back({static_cast<uint32_t>(seedX), static_cast<uint32_t>(seedY)});
+    while (!flood.stack.empty()) {
+        const size_t px = flood.stack.back().first;
+        const size_t py = flood.stack.back().second;
+        flood.stack.pop_back();
+        const unsigned char *pixels = row(py);
+        if (visited(px, py) || !matches(pixels + px * channels)) {
+            continue;
+        }
+        size_t left = px;
+        while (left > 0 && !visited(left - 1, py) && matches(pixels + (left - 1) * channels)) {
+            --left;
+        }
+        size_t right = px;
+        while (right + 1 < w && !visited(right + 1, py) && matches(pixels + (right + 1) * channels)) {
+            ++right;
+        }
+        setBitRange(flood.visited.data() + py * words, left, right, true);
+        flood.spans.push_back({static_cast<int32_t>(py), static_cast<int32_t>(left), static_cast<int32_t>(right)});
+
+        // one seed per matching run above and below
+        for (int dy = -1; dy <= 1; dy += 2) {
+            if ((dy < 0 && py == 0) || (dy > 0 && py + 1 >= h)) {
+                continue;
+            }
+            const size_t ny = py + dy;
+            const unsigned char *next = row(ny);
+            bool inRun = false;
+            for (size_t i = left; i <= right; ++i) {
+                const bool open = !visited(i, ny) && matches(next + i * channels);
+                if (open && !inRun) {
+                    flood.stack.push_back({static_cast<uint32_t>(i), static_cast<uint32_t>(ny)});
+                }
+                inRun = open;
+            }
+        }
+    }
+
+    for (const auto &span : flood.spans) {
+        setBitRange(flood.visited.data() + span.row * words, span.left, span.right, false);
+        writeSpanHFast(span.left, span.row, span.right - span.left + 1);
+    }
+}
+
+void ofxHeadlessFbo::fillWith(const ofxHeadlessFboGenerator::RowFunction &row, const ofRectangle &region,
+                              size_t numThreads) {
+    fillWith(ofxHeadlessFboGenerator(row), region, numThreads);
+}
+
+void ofxHeadlessFbo::fillWith(const ofxHeadlessFboGenerator &generator, const ofRectangle &region,
+                              size_t numThreads) {
+    OFX_HEADLESS_FBO_TRACE_DRAW("fillWith");
+    OFX_HEADLESS_FBO_STATS_SCOPE(FILL_WITH);
+    if (!isAllocated() || numChannels == 0 || generator.isEmpty()) {
+        return;
+    }
+    ofxHeadlessFboFixed x = fixedFromFloat(region.x) + translateX;
+    ofxHeadlessFboFixed y = fixedFromFloat(region.y) + translateY;
+    ofxHeadlessFboFixed regionW = fixedFromFloat(region.width);
+    ofxHeadlessFboFixed regionH = fixedFromFloat(region.height);
+    if (regionW < 0) {
+        x += regionW;
+        regionW = -regionW;
+    }
+    if (regionH < 0) {
+        y += regionH;
+        regionH = -regionH;
+    }
+    const int x0 = std::max(fixedToEdge(x), 0);
+    const int y0 = std::max(fixedToEdge(y), 0);
+    const int x1 = std::min<int64_t>(fixedToEdge(x + regionW), w);
+    const int y1 = std::min<int64_t>(fixedToEdge(y + regionH), h);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    // the generator gets drawing coordinates, the translation rounded to whole pixels
+    const int originX = fixedToPixel(translateX + 128);
+    const int originY = fixedToPixel(translateY + 128);
+    const size_t span = x1 - x0;
+    const size_t rows = y1 - y0;
+
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, rows);
+    const bool direct = mask == nullptr && precision == OFX_HEADLESS_FBO_PRECISION_8 &&
+                        packedFormat == OFX_HEADLESS_FBO_PACKED_NONE && isByteFormat(pixelFormat);
+    if (!direct || numThreads == 1) {
+        meshScratch.span.resize(span * 4);
+        for (int row = y0; row < y1; ++row) {
+            generator.generate(x0 - originX, row - originY, span, meshScratch.span.data());
+            writeSpanRGBA(x0, row, span, meshScratch.span.data());
+        }
+        return;
+    }
+
+    // tiles, counters and the dirty region are updated up front, so the
+    // threads share nothing but the generator and write only their own rows
+    if (numSolidTiles != 0) {
+        for (size_t tileY = y0 / tileSize; tileY <= (y1 - 1) / tileSize; ++tileY) {
+            for (size_t tileX = x0 / tileSize; tileX <= (x1 - 1) / tileSize; ++tileX) {
+                if (solidTiles[tileY * tilesX + tileX]) {
+                    fillTile(tileX, tileY);
+                }
+            }
+        }
+    }
+#ifdef OFX_HEADLESS_FBO_STATS
+    for (size_t i = 0; i < rows; ++i) {
+        countSpan(span);
+    }
+#endif
+    dirtyX1 = std::min<size_t>(dirtyX1, x0);
+    dirtyX2 = std::max<size_t>(dirtyX2, x1);
+    dirtyY1 = std::min<size_t>(dirtyY1, y0);
+    dirtyY2 = std::max<size_t>(dirtyY2, y1);
+
+    unsigned char *base = getBase();
+    const bool swapped = pixelFormat == OF_PIXELS_BGR || pixelFormat == OF_PIXELS_BGRA;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto fillRows = [&](size_t band) {
+        try {
+            const int rowBegin = y0 + static_cast<int>(rows * band / numThreads);
+            const int rowEnd = y0 + static_cast<int>(rows * (band + 1) / numThreads);
+            std::vector<unsigned char> rgba(span * 4);
+            for (int row = rowBegin; row < rowEnd; ++row) {
+                generator.generate(x0 - originX, row - originY, span, rgba.data());
+                blendRowRGBA(base + row * stride + x0 * numChannels, rgba.data(), span, numChannels, swapped,
+                             alphaBlending);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (size_t band = 1; band < numThreads; ++band) {
+        threads.emplace_back(fillRows, band);
+    }
+    fillRows(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ++version;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+const unsigned char *ofxHeadlessFbo::getFloodRow(size_t y) {
+    const size_t channels = pixelFormat == OF_PIXELS_RGB565 ? 3 : numChannels;
+    unsigned char *out = flood.rows.data() + y * w * channels;
+    if (flood.rowReady[y]) {
+        return out;
+    }
+    const unsigned char *src = getBase() + y * stride;
+    if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+        quantizeRow(reinterpret_cast<const unsigned short *>(src), out, w, numChannels, y, OFX_HEADLESS_FBO_DITHER_NONE,
+                    0);
+    } else if (precision == OFX_HEADLESS_FBO_PRECISION_FLOAT) {
+        quantizeRow(reinterpret_cast<const float *>(src), out, w, numChannels, y, OFX_HEADLESS_FBO_DITHER_NONE, 0);
+    } else if (packedFormat == OFX_HEADLESS_FBO_PACKED_RGB565) {
+        ofxHeadlessFboSwizzle(OF_PIXELS_RGB565, OF_PIXELS_RGB).convert(src, out, w);
+    } else if (packedFormat != OFX_HEADLESS_FBO_PACKED_NONE) {
+        unpackRow(y, out);
+    } else if (numSolidTiles > 0) {
+        readRow(y, out);
+    } else {
+        std::memcpy(out, src, w * numChannels);
+    }
+    flood.rowReady[y] = 1;
+    return out;
+}
+
+void ofxHeadlessFbo::strokePolyline(const float *xs, const float *ys, size_t n, bool closed) {
+    const float halfWidth = lineWidth / 2;
+    const size_t maxPoints = 8;
+    n = std::min(n, maxPoints);
+    strokeSpans.begin(h);
+
+    // every segment is a quad, zero length segments don't have a direction
+    float dirX[maxPoints];
+    float dirY[maxPoints];
+    size_t start[maxPoints];
+    size_t segments = 0;
+    const size_t edges = closed ? n : n - 1;
+    for (size_t i = 0; i < edges; ++i) {
+        const size_t j = (i + 1) % n;
+        const float dx = xs[j] - xs[i];
+        const float dy = ys[j] - ys[i];
+        const float length = std::sqrt(dx * dx + dy * dy);
+        if (length < 1e-6f) {
+            continue;
+        }
+        dirX[segments] = dx / length;
+        dirY[segments] = dy / length;
+        start[segments] = i;
+        ++segments;
+
+        const float nx = -dy / length * halfWidth;
+        const float ny = dx / length * halfWidth;
+        const float qx[4] = {xs[i] + nx, xs[j] + nx, xs[j] - nx, xs[i] - nx};
+        const float qy[4] = {ys[i] + ny, ys[j] + ny, ys[j] - ny, ys[i] - ny};
+        strokeSpans.addPolygon(qx, qy, 4);
+    }
+
+    if (segments == 0) {
+        if (lineJoin == OFX_HEADLESS_FBO_JOIN_ROUND) {
+            strokeSpans.addDisc(xs[0], ys[0], halfWidth);
+        } else {
+            const float qx[4] = {xs[0] - halfWidth, xs[0] + halfWidth, xs[0] + halfWidth, xs[0] - halfWidth};
+            const float qy[4] = {ys[0] - halfWidth, ys[0] - halfWidth, ys[0] + halfWidth, ys[0] + halfWidth};
+            strokeSpans.addPolygon(qx, qy, 4);
+        }
+        strokeSpans.flush(*this);
+        return;
+    }
+
+    for (size_t k = closed ? 0 : 1; k < segments; ++k) {
+        const size_t previous = k == 0 ? segments - 1 : k - 1;
+        addStrokeJoin(xs[start[k]], ys[start[k]], dirX[previous], dirY[previous], dirX[k], dirY[k]);
+    }
+    if (!closed && lineJoin == OFX_HEADLESS_FBO_JOIN_ROUND) {
+        strokeSpans.addDisc(xs[0], ys[0], halfWidth);
+        strokeSpans.addDisc(xs[n - 1], ys[n - 1], halfWidth);
+    }
+    strokeSpans.flush(*this);
+}
+
+void ofxHeadlessFbo::addStrokeJoin(float px, float py, float d1x, float d1y, float d2x, float d2y) {
+    const float halfWidth = lineWidth / 2;
+    if (d1x * d2y - d1y * d2x == 0.0f && d1x * d2x + d1y * d2y > 0.0f) {
+        return;
+    }
+    if (lineJoin == OFX_HEADLESS_FBO_JOIN_ROUND) {
+        strokeSpans.addDisc(px, py, halfWidth);
+        return;
+    }
+
+    // only the outer side of the corner is open, the inner side is covered by the quads
+    const float side = (d2x * -d1y + d2y * d1x) > 0.0f ? -1.0f : 1.0f;
+    const float n1x = -d1y * side;
+    const float n1y = d1x * side;
+    const float n2x = -d2y * side;
+    const float n2y = d2x * side;
+    const float o1x = px + n1x * halfWidth;
+    const float o1y = py + n1y * halfWidth;
+    const float o2x = px + n2x * halfWidth;
+    const float o2y = py + n2y * halfWidth;
+
+    if (lineJoin == OFX_HEADLESS_FBO_JOIN_MITER) {
+        const float mx = n1x + n2x;
+        const float my = n1y + n2y;
+        const float length = std::sqrt(mx * mx + my * my);
+        const float miterLimit = 4;
+        // cosine of half the angle between the segments
+        const float cosHalf = length / 2;
+        if (cosHalf > 1.0f / miterLimit) {
+            const float scale = halfWidth / (cosHalf * length);
+            const float qx[4] = {px, o1x, px + mx * scale, o2x};
+            const float qy[4] = {py, o1y, py + my * scale, o2y};
+            strokeSpans.addPolygon(qx, qy, 4);
+            return;
+        }
+    }
+
+    const float qx[3] = {px, o1x, o2x};
+    const float qy[3] = {py, o1y, o2y};
+    strokeSpans.addPolygon(qx, qy, 3);
+}
+
+void ofxHeadlessFbo::SpanAccumulator::begin(size_t count) {
+    if (rows.size() != count) {
+        rows.resize(count);
+    }
+    minRow = static_cast<int>(count);
+    maxRow = -1;
+}
+
+void ofxHeadlessFbo::SpanAccumulator::add(int row, float left, float right) {
+    if (row < 0 || row >= static_cast<int>(rows.size())) {
+        return;
+    }
+    // limits keep far off screen coordinates from overflowing, writeLineH clips them
+    const float limit = 1 << 28;
+    const float start = std::max(std::ceil(left - 0.5f), -limit);
+    const float end = std::min(std::floor(right - 0.5f), limit);
+    if (end < start) {
+        return;
+    }
+    rows[row].emplace_back(static_cast<int>(start), static_cast<int>(end));
+    minRow = std::min(minRow, row);
+    maxRow = std::max(maxRow, row);
+}
+
+void ofxHeadlessFbo::SpanAccumulator::addPolygon(const float *xs, const float *ys, size_t n) {
+    const float minY = *std::min_element(ys, ys + n);
+    const float maxY = *std::max_element(ys, ys + n);
+    const int firstRow = std::max(static_cast<int>(std::floor(minY)), 0);
+    const int lastRow = std::min(static_cast<int>(std::ceil(maxY)), static_cast<int>(rows.size()) - 1);
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const float scanY = row + 0.5f;
+        float left = 0;
+        float right = 0;
+        bool hit = false;
+        for (size_t i = 0; i < n; ++i) {
+            const size_t j = (i + 1) % n;
+            const float ay = ys[i];
+            const float by = ys[j];
+            if (ay == by || scanY < std::min(ay, by) || scanY > std::max(ay, by)) {
+                continue;
+            }
+            const float x = xs[i] + (scanY - ay) / (by - ay) * (xs[j] - xs[i]);
+            left = hit ? std::min(left, x) : x;
+            right = hit ? std::max(right, x) : x;
+            hit = true;
+        }
+        if (hit) {
+            add(row, left, right);
+        }
+    }
+}
+
+void ofxHeadlessFbo::SpanAccumulator::addDisc(float cx, float cy, float r) {
+    const int firstRow = std::max(static_cast<int>(std::floor(cy - r)), 0);
+    const int lastRow = std::min(static_cast<int>(std::ceil(cy + r)), static_cast<int>(rows.size()) - 1);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const float dy = row + 0.5f - cy;
+        if (std::abs(dy) > r) {
+            continue;
+        }
+        const float halfSpan = std::sqrt(r * r - dy * dy);
+        add(row, cx - halfSpan, cx + halfSpan);
+    }
+}
+
+void ofxHeadlessFbo::SpanAccumulator::addEllipseRing(float cx, float cy, float rx, float ry, float halfWidth) {
+    const float outerX = rx + halfWidth;
+    const float outerY = ry + halfWidth;
+    const float innerX = rx - halfWidth;
+    const float innerY = ry - halfWidth;
+    const int firstRow = std::max(static_cast<int>(std::floor(cy - outerY)), 0);
+    const int lastRow = std::min(static_cast<int>(std::ceil(cy + outerY)), static_cast<int>(rows.size()) - 1);
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const float dy = row + 0.5f - cy;
+        if (std::abs(dy) > outerY) {
+            continue;
+        }
+        const float outer = outerX * std::sqrt(1.0f - (dy / outerY) * (dy / outerY));
+        if (innerX <= 0.0f || innerY <= 0.0f || std::abs(dy) >= innerY) {
+            add(row, cx - outer, cx + outer);
+            continue;
+        }
+        const float inner = innerX * std::sqrt(1.0f - (dy / innerY) * (dy / innerY));
+        add(row, cx - outer, cx - inner);
+        add(row, cx + inner, cx + outer);
+    }
+}
+
+void ofxHeadlessFbo::SpanAccumulator::addRoundedRectRing(float x0, float y0, float x1, float y1, float r,
+                                                         float halfWidth) {
+    // horizontal extent of a rounded rectangle on a row
+    auto extent = [](float ax0, float ay0, float ax1, float ay1, float radius, float scanY, float &left,
+                     float &right) {
+        if (scanY < ay0 || scanY > ay1 || ax1 < ax0) {
+            return false;
+        }
+        float d = 0;
+        if (scanY < ay0 + radius) {
+            d = ay0 + radius - scanY;
+        } else if (scanY > ay1 - radius) {
+            d = scanY - (ay1 - radius);
+        }
+        const float inset = radius - std::sqrt(std::max(radius * radius - d * d, 0.0f));
+        left = ax0 + inset;
+        right = ax1 - inset;
+        return true;
+    };
+
+    const float innerRadius = std::max(r - halfWidth, 0.0f);
+    const int firstRow = std::max(static_cast<int>(std::floor(y0 - halfWidth)), 0);
+    const int lastRow = std::min(static_cast<int>(std::ceil(y1 + halfWidth)), static_cast<int>(rows.size()) - 1);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const float scanY = row + 0.5f;
+        float outerLeft, outerRight, innerLeft, innerRight;
+        if (!extent(x0 - halfWidth, y0 - halfWidth, x1 + halfWidth, y1 + halfWidth, r + halfWidth, scanY, outerLeft,
+                    outerRight)) {
+            continue;
+        }
+        if (!extent(x0 + halfWidth, y0 + halfWidth, x1 - halfWidth, y1 - halfWidth, innerRadius, scanY, innerLeft,
+                    innerRight)) {
+            add(row, outerLeft, outerRight);
+            continue;
+        }
+        add(row, outerLeft, innerLeft);
+        add(row, innerRight, outerRight);
+    }
+}
+
+void ofxHeadlessFbo::SpanAccumulator::flush(ofxHeadlessFbo &fbo) {
+    for (int row = minRow; row <= maxRow; ++row) {
+        std::vector<std::pair<int, int>> &spans = rows[row];
+        if (spans.empty()) {
+            continue;
+        }
+        std::sort(spans.begin(), spans.end());
+        std::pair<int, int> current = spans[0];
+        for (size_t i = 1; i < spans.size(); ++i) {
+            if (spans[i].first <= current.second + 1) {
+                current.second = std::max(current.second, spans[i].second);
+                continue;
+            }
+            fbo.writeLineH(current.first, row, current.second - current.first + 1);
+            current = spans[i];
+        }
+        fbo.writeLineH(current.first, row, current.second - current.first + 1);
+        spans.clear();
     }
+    minRow = static_cast<int>(rows.size());
+    maxRow = -1;
 }
@@ -29,8 +29,21 @@ POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include "ofColor.h"
-#include "ofMain.h"
 #include "ofPixels.h"
+#include "ofRectangle.h"
+#include "ofxHeadlessFboGenerator.h"
+#include "ofxHeadlessFboShapeCache.h"
+#include "ofxHeadlessFboStats.h"
+#include "ofxHeadlessFboTrace.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#ifndef OFX_HEADLESS_FBO_NO_GL
+class ofxHeadlessFboTexture;
+#endif
 
 /// @file
 /// ofPixels is an object for working with blocks of pixels, those pixels can
@@ -46,6 +59,56 @@ POSSIBILITY OF SUCH DAMAGE.
 ///
 /// ofPixels represents pixels data on the CPU as opposed to an ofTexture
 /// which represents pixel data on the GPU.
+///
+/// The rasterizer only depends on ofPixels and ofColor. Drawing the buffer
+/// on screen goes through ofxHeadlessFboTexture, define OFX_HEADLESS_FBO_NO_GL
+/// to leave it out and build without any GL dependency.
+
+/// Storage formats with less than 8 bits per channel, drawn natively for
+/// displays that take them directly.
+enum ofxHeadlessFboPackedFormat {
+    OFX_HEADLESS_FBO_PACKED_NONE = 0,
+    /// 16 bit native endian words, 5 bits red, 6 bits green, 5 bits blue.
+    OFX_HEADLESS_FBO_PACKED_RGB565,
+    /// 1 bit per pixel, most significant bit first, rows padded to whole bytes.
+    OFX_HEADLESS_FBO_PACKED_MONO1,
+    /// 1 byte per pixel indexing the palette, see setPalette().
+    OFX_HEADLESS_FBO_PACKED_INDEXED8,
+};
+
+/// Precision of the stored channels.
+enum ofxHeadlessFboPrecision {
+    /// ofPixels, 8 bits per channel.
+    OFX_HEADLESS_FBO_PRECISION_8 = 0,
+    /// ofShortPixels, 16 bits per channel.
+    OFX_HEADLESS_FBO_PRECISION_16,
+    /// ofFloatPixels, 0 - 1 floats per channel.
+    OFX_HEADLESS_FBO_PRECISION_FLOAT,
+};
+
+/// Shape of the corners where two segments of a thick outline meet.
+enum ofxHeadlessFboLineJoin {
+    /// Sharp corners, beveled when the miter is longer than 4 times the line width.
+    OFX_HEADLESS_FBO_JOIN_MITER = 0,
+    /// Round corners, lines also get round caps.
+    OFX_HEADLESS_FBO_JOIN_ROUND,
+    /// Corners cut off straight.
+    OFX_HEADLESS_FBO_JOIN_BEVEL,
+};
+
+/// How 16 bit and float buffers are quantized to 8 bits.
+enum ofxHeadlessFboDither {
+    /// Rounded to the closest value, smooth gradients band.
+    OFX_HEADLESS_FBO_DITHER_NONE = 0,
+    /// 8x8 Bayer matrix, a fixed pattern.
+    OFX_HEADLESS_FBO_DITHER_ORDERED,
+    /// Bayer matrix shifted every frame, averages to the exact value over time.
+    OFX_HEADLESS_FBO_DITHER_TEMPORAL,
+};
+
+/// Coordinate in 24.8 fixed point, 1/256 of a pixel. All primitives are
+/// rasterized from these, float coordinates are rounded to them once.
+typedef int32_t ofxHeadlessFboFixed;
 
 class ofxHeadlessFbo {
     public:
@@ -63,11 +126,88 @@ class ofxHeadlessFbo {
     /// @param pixelFormat ofPixelFormat defining number of channels per pixel
     void allocate(size_t w, size_t h, ofPixelFormat pixelFormat);
 
+    /// @brief Allocates space for pixel data with aligned rows
+    ///
+    /// Every row starts on a multiple of rowAlignment bytes, rows are padded
+    /// when needed. With 64 byte rows vectorized code working on the buffer
+    /// never has to deal with unaligned row starts.
+    ///
+    /// @param w Width of pixel array
+    /// @param h Height of pixel array
+    /// @param pixelFormat ofPixelFormat defining number of channels per pixel
+    /// @param rowAlignment Alignment of the rows in bytes, a power of two
+    void allocate(size_t w, size_t h, ofPixelFormat pixelFormat, size_t rowAlignment);
+
+    /// @brief Allocates space for pixel data in a packed format
+    ///
+    /// Spans are filled straight in the packed format, 16 bits per pixel
+    /// for RGB565, 1 bit per pixel for MONO1 and 8 bits for INDEXED8.
+    /// getPixels() and readPixels() expand the pixels to 8 bits per channel,
+    /// getData() and getStride() give access to the packed rows.
+    ///
+    /// With alpha blending MONO1 only draws colors with an alpha of 128 or
+    /// more, colors are set when their brightness is 128 or more.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.allocate(128, 64, OFX_HEADLESS_FBO_PACKED_MONO1);
+    /// hfbo.setColor(ofColor::white);
+    /// hfbo.drawCircle(64, 32, 20);
+    /// sendToDisplay(hfbo.getData(), hfbo.getStride() * hfbo.getHeight());
+    /// ~~~~
+    ///
+    /// @param w Width of pixel array
+    /// @param h Height of pixel array
+    /// @param packedFormat Storage format of the pixels
+    void allocate(size_t w, size_t h, ofxHeadlessFboPackedFormat packedFormat);
+
+    /// @brief Allocates space for pixel data with more than 8 bits per channel
+    ///
+    /// Spans are filled and blended at the stored precision, so repeated
+    /// translucent draws and fades don't band and reach black. getPixels()
+    /// and readPixels() quantize the buffer to 8 bits using the dither mode
+    /// set with setDither(), getShortPixels() and getFloatPixels() give the
+    /// full precision.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.allocate(800, 300, OF_PIXELS_RGB, OFX_HEADLESS_FBO_PRECISION_16);
+    /// hfbo.enableAlphaBlending();
+    /// hfbo.setColor(ofColor(0, 0, 0, 8)); // slow fade to black
+    /// hfbo.drawRectangle(0, 0, 800, 300);
+    /// ~~~~
+    ///
+    /// @param w Width of pixel array
+    /// @param h Height of pixel array
+    /// @param pixelFormat One of the 8 bit per channel formats
+    /// @param precision Precision of the stored channels
+    void allocate(size_t w, size_t h, ofPixelFormat pixelFormat, ofxHeadlessFboPrecision precision);
+
+    /// @brief Draws straight into memory owned by the caller
+    ///
+    /// The memory is not copied or freed, it has to stay valid as long as the
+    /// buffer uses it. Useful to render into DMA buffers, shared memory
+    /// segments or mapped files.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.allocateFromExternal(shm, 800, 300, 800 * 4 + 64, OF_PIXELS_BGRA);
+    /// ~~~~
+    ///
+    /// @param data Pointer to the first row
+    /// @param w Width of pixel array
+    /// @param h Height of pixel array
+    /// @param stride Distance between two rows in bytes, 0 for tightly packed rows
+    /// @param pixelFormat One of the 8 bit per channel formats
+    void allocateFromExternal(unsigned char *data, size_t w, size_t h, size_t stride, ofPixelFormat pixelFormat);
+    /// @brief Draws straight into caller owned memory in a packed format.
+    ///
+    /// RGB565 data and stride have to be 2 byte aligned.
+    void allocateFromExternal(unsigned char *data, size_t w, size_t h, size_t stride,
+                              ofxHeadlessFboPackedFormat packedFormat);
+
     /// @brief Get whether memory has been allocated for an ofPixels object or not
     ///
     /// Many operations like copying pixels, etc, automatically allocate
     /// the memory needed, but it's sometimes good to check.
-    bool isAllocated();
+    bool isAllocated() const;
 
     /// @brief Sets the draw color.
     ///
@@ -84,15 +224,80 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void setColor(const ofColor &color);
+    /// @brief Sets the draw color with more than 8 bits precision.
+    ///
+    /// 16 bit and float buffers use the full precision, 8 bit buffers round
+    /// the color.
+    void setColor(const ofFloatColor &color);
 
     /// @brief fill the buffer with a single color.
     void clear(const ofColor &color);
 
+    /// @brief Makes clear() only mark the tiles of the buffer as solid.
+    ///
+    /// With lazy clears clear() costs one flag per 64x64 tile instead of a
+    /// pass over the buffer. A tile is filled in memory on its first write,
+    /// spans blended onto a solid tile blend a single pixel and copy it.
+    /// readPixels() and readPixelsAs() fill solid tiles straight into the
+    /// target, getData() and getPixels() write all of them to memory first.
+    /// Only 8 bit buffers clear lazily, don't use it when something else
+    /// reads external memory directly.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.allocate(3840, 2160, OF_PIXELS_RGB);
+    /// hfbo.setLazyClear(true);
+    ///
+    /// void ofApp::update(){
+    ///     hfbo.clear(ofColor::black); // no pass over the 25 MB buffer
+    ///     drawScene(hfbo);
+    /// }
+    /// ~~~~
+    void setLazyClear(bool lazyClear);
+    bool isLazyClear() const;
+
+    /// @brief Width and height of the tiles of lazy clears in pixels.
+    size_t getTileSize() const;
+    /// @brief Pixel of a tile untouched since the last lazy clear().
+    ///
+    /// Encoders use it to send a fill instead of the pixels of the tile.
+    ///
+    /// @returns The pixel in the format of the buffer, nullptr if the tile was drawn to
+    const unsigned char *getSolidTile(size_t tileX, size_t tileY) const;
+    /// @brief Writes the tiles left solid by a lazy clear() to memory.
+    ///
+    /// getData() and getPixels() call it, code reading the memory some other
+    /// way has to call it first.
+    void materializeTiles() const;
+
     /// @brief Read current data from the CPU into pixels.
     ///
     /// @param pixels Target ofPixels reference.
     void readPixels(ofPixels &pixels) const;
 
+    /// @brief Reads the pixels converted to another format in a single pass.
+    ///
+    /// Replaces readPixels() followed by ofPixels::setImageType(). Rows are
+    /// converted straight from the buffer with SSSE3 or NEON shuffles, gray
+    /// takes the brightest channel like drawing in gray does. 16 bit, float
+    /// and packed buffers are expanded one row at a time on the way.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.allocate(800, 300, OF_PIXELS_RGBA);
+    /// hfbo.readPixelsAs(preview, OF_PIXELS_GRAY, ofRectangle(0, 0, 200, 100));
+    /// ~~~~
+    ///
+    /// @param pixels Target ofPixels reference, reallocated only when the size or format changes
+    /// @param pixelFormat RGB, BGR, RGBA, BGRA, GRAY, GRAY_ALPHA or RGB565
+    /// @param region Part of the buffer to read, an empty rectangle reads all of it
+    void readPixelsAs(ofPixels &pixels, ofPixelFormat pixelFormat, const ofRectangle &region = ofRectangle()) const;
+    /// @brief Reads the converted pixels into caller owned memory.
+    ///
+    /// @param data Pointer to the first row, large enough for the region
+    /// @param stride Distance between two rows in bytes, 0 for tightly packed rows
+    /// @returns false if the buffer isn't allocated or a format isn't supported
+    bool readPixelsAs(unsigned char *data, size_t stride, ofPixelFormat pixelFormat,
+                      const ofRectangle &region = ofRectangle()) const;
+
     /// /brief Set the internal pixels from existing pixel data
     ///
     /// @param newPixels The new pixel array
@@ -101,8 +306,39 @@ class ofxHeadlessFbo {
     /// @param pixelFormat ofPixelFormat defining number of channels per pixel
     void setFromPixels(ofPixels newPixels, size_t w, size_t h, ofPixelFormat pixelFormat);
 
+    /// /brief Copy raw pixel data into the internal pixels
+    ///
+    /// The data has to be tightly packed, the buffer is only reallocated
+    /// when the size or format changes.
+    ///
+    /// @param data Pointer to the pixel data
+    /// @param w Width of pixel array
+    /// @param h Height of pixel array
+    /// @param pixelFormat ofPixelFormat defining number of channels per pixel
+    void setFromPixels(const unsigned char *data, size_t w, size_t h, ofPixelFormat pixelFormat);
+
+    /// /brief Copies 16 bit or float pixels, the buffer keeps their precision.
+    void setFromPixels(const ofShortPixels &newPixels);
+    void setFromPixels(const ofFloatPixels &newPixels);
+
+#ifndef OFX_HEADLESS_FBO_NO_GL
     /// @brief draw the current data as texture.
+    ///
+    /// The texture is created on first use and only uploaded again after
+    /// the pixels changed.
     void draw(float x, float y);
+#endif
+
+    /// Primitives share one set of rules: the pixel x,y covers the area from
+    /// x,y to x+1,y+1. Rectangles, triangles and rounded rectangles cover
+    /// the pixels whose centers lie inside them, their left and top edges
+    /// included and their right and bottom edges left out, so shapes sharing
+    /// an edge tile without gaps or overlaps. Points, lines, circles and
+    /// ellipses start in the pixel that contains their coordinates.
+    ///
+    /// Coordinates are converted once to ofxHeadlessFboFixed. Every
+    /// primitive also has an integer version, called when all arguments are
+    /// integers, which skips the float conversion.
 
     /// Draws a point: (x1,y1).
     /// ~~~~{.cpp}
@@ -111,6 +347,10 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawPoint(float x, float y);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawPoint(T x, T y) {
+        drawPointFixed(toFixed(x) + translateX, toFixed(y) + translateY);
+    }
 
     /// Draws a line between two points: (x1,y1),(x2,y2).
     /// ~~~~{.cpp}
@@ -119,6 +359,11 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawLine(float x1, float y1, float x2, float y2);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawLine(T x1, T y1, T x2, T y2) {
+        drawLineFixed(toFixed(x1) + translateX, toFixed(y1) + translateY, toFixed(x2) + translateX,
+                      toFixed(y2) + translateY);
+    }
 
     /// @brief Draws a rectangle from point x,y with a given width and height.
     /// ~~~~{.cpp}
@@ -127,10 +372,23 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawRectangle(float x, float y, float w, float h);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawRectangle(T x, T y, T w, T h) {
+        drawRectangleFixed(toFixed(x) + translateX, toFixed(y) + translateY, toFixed(w), toFixed(h));
+    }
     /// @brief Draws a square from point x,y with a given dimension.
     void drawSquare(float x, float y, float d);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawSquare(T x, T y, T d) {
+        drawRectangleFixed(toFixed(x) + translateX, toFixed(y) + translateY, toFixed(d), toFixed(d));
+    }
     /// @brief Draws a square centered at point x,y with a given dimension.
     void drawSquareCentered(float x, float y, float d);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawSquareCentered(T x, T y, T d) {
+        const ofxHeadlessFboFixed size = toFixed(d);
+        drawRectangleFixed(toFixed(x) - size / 2 + translateX, toFixed(y) - size / 2 + translateY, size, size);
+    }
 
     /// @brief Draws a triangle, with the three points: (x1,y1),(x2, y2),(x3, y3).
     /// ~~~~{.cpp}
@@ -139,6 +397,64 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawTriangle(T x1, T y1, T x2, T y2, T x3, T y3) {
+        drawTriangleFixed(toFixed(x1) + translateX, toFixed(y1) + translateY, toFixed(x2) + translateX,
+                          toFixed(y2) + translateY, toFixed(x3) + translateX, toFixed(y3) + translateY);
+    }
+
+    /// @brief Draws a filled triangle with a color per corner, blended smoothly in between.
+    ///
+    /// Covers the same pixels as the flat triangle. The colors are
+    /// interpolated at the pixel centers in 16.16 fixed point, stepped along
+    /// the rows and spans, and blended like the current color would be. They
+    /// have 8 bits per channel, whatever the buffer stores. Moving the
+    /// triangle by whole pixels gives the same colors. A triangle without
+    /// area is drawn as its longest edge, like the flat triangle, one pixel
+    /// wide and blended between the colors of that edge's corners.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.drawTriangle(50, 10, 10, 90, 90, 90, ofColor::red, ofColor::green, ofColor::blue);
+    /// ~~~~
+    void drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3, const ofColor &c1,
+                      const ofColor &c2, const ofColor &c3);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawTriangle(T x1, T y1, T x2, T y2, T x3, T y3, const ofColor &c1, const ofColor &c2, const ofColor &c3) {
+        const ofxHeadlessFboFixed xs[3] = {toFixed(x1) + translateX, toFixed(x2) + translateX, toFixed(x3) + translateX};
+        const ofxHeadlessFboFixed ys[3] = {toFixed(y1) + translateY, toFixed(y2) + translateY, toFixed(y3) + translateY};
+        drawTriangleFixed(xs, ys, c1, c2, c3);
+    }
+
+    /// @brief Draws the triangles of a mesh, TRIANGLES, TRIANGLE_STRIP or TRIANGLE_FAN.
+    ///
+    /// Indices are used when the mesh has them. Every vertex is converted
+    /// to fixed point once however many triangles share it. With a color
+    /// per vertex the triangles are shaded like the drawTriangle() with
+    /// corner colors, otherwise they are filled with the current color.
+    /// Triangles sharing an edge never leave gaps or blend a pixel twice.
+    /// Triangles without area, as strips use to join rows, are skipped
+    /// whether flat or shaded, so the edges they lie on are not drawn twice.
+    ///
+    /// With binRows the triangles are sorted into bands of that many rows
+    /// and drawn one band at a time, so meshes larger than the cache touch
+    /// every row only once. Each pixel still gets its triangles in mesh
+    /// order, the result is the same.
+    ///
+    /// ~~~~{.cpp}
+    /// ofMesh warp = ofMesh::plane(800, 300, 32, 12);
+    /// for (auto &color : colors) {
+    ///     warp.addColor(color);
+    /// }
+    /// hfbo.drawMesh(warp, 32);
+    /// ~~~~
+    ///
+    /// Mesh is an ofMesh. drawMesh() lives in ofxHeadlessFboMesh.cpp, so
+    /// this header doesn't pull in ofMesh.h and builds that leave that file
+    /// out keep the rasterizer free of it.
+    ///
+    /// @param binRows Height of the bands, 0 draws the triangles in order
+    template <typename Mesh>
+    void drawMesh(const Mesh &mesh, size_t binRows = 0);
 
     /// @brief Draws a circle, centered at x,y, with a given radius.
     ///
@@ -148,6 +464,10 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawCircle(float x, float y, float r);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawCircle(T x, T y, T r) {
+        drawCircleFixed(toFixed(x) + translateX, toFixed(y) + translateY, toFixed(r));
+    }
 
     /// @brief Draws a rectangle from point X, Y with a given width, height and radius of
     /// rounded corners.
@@ -158,6 +478,10 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawRectRounded(float x, float y, float w, float h, float r);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawRectRounded(T x, T y, T w, T h, T r) {
+        drawRectRoundedFixed(toFixed(x) + translateX, toFixed(y) + translateY, toFixed(w), toFixed(h), toFixed(r));
+    }
 
     /// @brief Draws an ellipse from point (x,y) with a given width (w) and height (h).
     /// ~~~~{.cpp}
@@ -166,40 +490,482 @@ class ofxHeadlessFbo {
     /// }
     /// ~~~~
     void drawEllipse(float x, float y, float w, float h);
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void drawEllipse(T x, T y, T w, T h) {
+        drawEllipseFixed(toFixed(x) + translateX, toFixed(y) + translateY, toFixed(w), toFixed(h));
+    }
+
+    /// @brief Fills the area around x,y that has the color of that pixel.
+    ///
+    /// Pixels are connected horizontally and vertically and match when no
+    /// channel differs from the start pixel by more than the tolerance. The
+    /// area is found row by row with an explicit stack before anything is
+    /// drawn, so blending doesn't change what matches, then every row of it
+    /// is drawn as whole spans with the current color, blending and mask.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.setColor(ofColor::red);
+    /// hfbo.floodFill(10, 10, 8);
+    /// ~~~~
+    ///
+    /// @param tolerance Largest difference per 8 bit channel
+    void floodFill(float x, float y, float tolerance = 0);
+
+    /// @brief Fills a rectangle pixel by pixel from a procedural generator.
+    ///
+    /// The generator produces a row of RGBA pixels at a time, which is
+    /// written as one span with the current blending and mask, the current
+    /// color isn't used. The generator sees drawing coordinates, the same
+    /// ones the region is given in. The rows can be split between several
+    /// threads, for 8 bit buffers without a mask, they are written straight
+    /// into the pixels. Masked, packed, 16 bit and float buffers are filled
+    /// on the calling thread only, numThreads is ignored for them; their
+    /// rows are still converted and blended a whole row at a time.
+    ///
+    /// ~~~~{.cpp}
+    /// auto plasma = ofxHeadlessFboGenerator::plasma(120, ofGetElapsedTimef());
+    /// hfbo.fillWith(plasma, ofRectangle(0, 0, hfbo.getWidth(), hfbo.getHeight()), 4);
+    /// ~~~~
+    ///
+    /// @param numThreads Threads filling rows, 0 for one per hardware thread
+    void fillWith(const ofxHeadlessFboGenerator &generator, const ofRectangle &region, size_t numThreads = 1);
+    /// @brief Fills a rectangle from a function called with every row buffer.
+    ///
+    /// Threads are used as with a generator, so the function must be safe
+    /// to call from several threads at once when numThreads isn't 1.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.fillWith([](int x, int y, size_t span, unsigned char *rgba) {
+    ///     for (size_t i = 0; i < span; ++i, rgba += 4) {
+    ///         rgba[0] = x + i;
+    ///         rgba[1] = y;
+    ///         rgba[2] = 0;
+    ///         rgba[3] = 255;
+    ///     }
+    /// }, ofRectangle(0, 0, 256, 256));
+    /// ~~~~
+    void fillWith(const ofxHeadlessFboGenerator::RowFunction &row, const ofRectangle &region, size_t numThreads = 1);
 
     void setFill();
     void setNoFill();
 
+    /// @brief Sets the width of lines and outlines drawn with setNoFill().
+    ///
+    /// Outlines wider than 1 pixel are collected as spans per row and
+    /// merged before drawing, so every pixel is written once and blended
+    /// outlines have no darker joins.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.setNoFill();
+    /// hfbo.setLineWidth(6);
+    /// hfbo.setLineJoin(OFX_HEADLESS_FBO_JOIN_ROUND);
+    /// hfbo.drawTriangle(50, 10, 10, 40, 90, 40);
+    /// ~~~~
+    void setLineWidth(float lineWidth);
+    float getLineWidth() const;
+
+    /// @brief Sets the corners of thick lines and outlines.
+    void setLineJoin(ofxHeadlessFboLineJoin lineJoin);
+    ofxHeadlessFboLineJoin getLineJoin() const;
+
+    /// @brief Offsets the coordinates of all following primitives.
+    ///
+    /// Like ofTranslate(), limited to a translation so the rasterizers stay
+    /// axis aligned. The offset is added in fixed point, integer primitives
+    /// stay on the integer path.
+    ///
+    /// ~~~~{.cpp}
+    /// hfbo.setTranslation(200, 100);
+    /// hfbo.drawCircle(0, 0, 50); // centered at 200,100
+    /// ~~~~
+    void setTranslation(float x, float y);
+    float getTranslationX() const;
+    float getTranslationY() const;
+
     /// @brief Turns off alpha blending
     void enableAlphaBlending();
 
     /// @brief Turns off alpha blending
     void disableAlphaBlending();
 
-    size_t getWidth();
-    size_t getHeight();
+    /// @brief Restricts drawing to the pixels set in a mask.
+    ///
+    /// The mask is another buffer drawn with the usual primitives. An 8 bit
+    /// GRAY mask gives the coverage of every pixel, partly covered pixels are
+    /// blended by their coverage. A MONO1 mask lets pixels through or not.
+    /// The rows of the mask are turned into runs once after every change and
+    /// spans are clipped against them, so masked drawing costs about the
+    /// same as drawing the visible part. Pixels outside the mask are masked
+    /// out, clear() and setFromPixels() ignore the mask.
+    ///
+    /// The mask isn't copied, it has to stay valid while it is set.
+    ///
+    /// ~~~~{.cpp}
+    /// mask.allocate(800, 300, OFX_HEADLESS_FBO_PACKED_MONO1);
+    /// mask.clear(ofColor::black);
+    /// mask.setColor(ofColor::white);
+    /// mask.drawCircle(400, 150, 140);
+    ///
+    /// hfbo.setMask(&mask);
+    /// drawScene(hfbo);
+    /// hfbo.setMask(nullptr);
+    /// ~~~~
+    ///
+    /// @param mask GRAY or MONO1 buffer, nullptr to draw everywhere
+    void setMask(const ofxHeadlessFbo *mask);
+    const ofxHeadlessFbo *getMask() const;
+
+    size_t getWidth() const;
+    size_t getHeight() const;
+
+    /// @brief Get the pixel format the buffer was allocated with.
+    ///
+    /// Packed buffers report the format of getPixels(): OF_PIXELS_RGB565,
+    /// OF_PIXELS_GRAY for MONO1 and OF_PIXELS_RGB for INDEXED8.
+    ofPixelFormat getPixelFormat() const;
+    /// @brief Get the packed storage format, OFX_HEADLESS_FBO_PACKED_NONE for 8 bit channels.
+    ofxHeadlessFboPackedFormat getPackedFormat() const;
+    /// @brief Get the precision of the stored channels.
+    ofxHeadlessFboPrecision getPrecision() const;
+
+    /// @brief Full precision pixels of 16 bit and float buffers, empty otherwise.
+    const ofShortPixels &getShortPixels() const;
+    const ofFloatPixels &getFloatPixels() const;
+
+    /// @brief Sets how 16 bit and float buffers are quantized by getPixels() and readPixels().
+    ///
+    /// Defaults to OFX_HEADLESS_FBO_DITHER_ORDERED. With temporal dithering
+    /// every call to getPixels() or readPixels() produces the next frame of
+    /// the pattern, call it once per frame sent out.
+    void setDither(ofxHeadlessFboDither dither);
+    ofxHeadlessFboDither getDither() const;
+    /// @brief Get the number of channels per pixel.
+    size_t getNumChannels() const;
+
+    /// @brief Read-only access to the internal pixel buffer, without copying.
+    ///
+    /// Useful for encoders and senders that consume the frame in place,
+    /// the reference stays valid until the buffer is reallocated. Buffers
+    /// with padded rows return a packed copy instead, updated after changes.
+    const ofPixels &getPixels() const;
+
+    /// @brief Sets the colors of an INDEXED8 buffer, up to 256.
+    ///
+    /// Drawing colors are mapped to the closest entry. Without a palette
+    /// the indices are 3 bits red, 3 bits green and 2 bits blue.
+    void setPalette(const std::vector<ofColor> &palette);
+    const std::vector<ofColor> &getPalette() const;
+
+    /// @brief Pointer to the first row of the buffer.
+    const unsigned char *getData() const;
+    /// @brief Distance between two rows in bytes.
+    size_t getStride() const;
+    /// @brief Bytes of a tightly packed row of w pixels, 0 for formats the
+    /// buffer can't draw into.
+    static size_t getRowBytes(size_t w, ofPixelFormat pixelFormat);
+    static size_t getRowBytes(size_t w, ofxHeadlessFboPackedFormat packedFormat);
+
+    /// @brief Counter that changes whenever the pixels are modified.
+    ///
+    /// Consumers like textures or outputs compare it with the value of
+    /// their last update to skip unchanged frames.
+    uint64_t getVersion() const;
+
+    /// @brief Bounding box of all pixels written since the last resetDirtyRegion().
+    ///
+    /// Outputs that copy the frame somewhere else use it to only transfer
+    /// what changed. The rectangle has a width of 0 when nothing was drawn.
+    ///
+    /// ~~~~{.cpp}
+    /// ofRectangle dirty = hfbo.getDirtyRegion();
+    /// sendRegion(dirty);
+    /// hfbo.resetDirtyRegion();
+    /// ~~~~
+    ofRectangle getDirtyRegion() const;
+    void resetDirtyRegion();
+
+    /// @brief Bounding box of all pixels written after the given version.
+    ///
+    /// Lets several outputs track their own changes without resetting the
+    /// dirty region of the buffer. Each one keeps the getVersion() read right
+    /// after the call. Versions older than the last few calls return the
+    /// whole buffer.
+    ///
+    /// ~~~~{.cpp}
+    /// ofRectangle dirty = hfbo.getDirtyRegionSince(sentVersion);
+    /// sentVersion = hfbo.getVersion();
+    /// sendRegion(dirty);
+    /// ~~~~
+    ofRectangle getDirtyRegionSince(uint64_t version);
+
+    /// @brief Hot path counters collected since the last resetStats().
+    ///
+    /// Only collected when compiled with OFX_HEADLESS_FBO_STATS, otherwise
+    /// all counters stay zero. Also resets the counters of the shape cache.
+    const ofxHeadlessFboStats &getStats() const;
+    void resetStats();
+
+    /// @brief Sets the memory cap of the filled shape cache in bytes, 0 disables it.
+    ///
+    /// Filled circles, ellipses and rounded rectangles are recorded as one
+    /// span per row the first time a size is drawn and replayed at any
+    /// position afterwards. Shapes larger than the canvas or the cap are
+    /// drawn without the cache, the pixels are the same either way.
+    /// Defaults to 1 MB.
+    void setShapeCacheSize(size_t bytes);
+    size_t getShapeCacheSize() const;
+    /// @brief Hits, misses and memory use of the shape cache.
+    const ofxHeadlessFboShapeCache::Stats &getShapeCacheStats() const;
+    void clearShapeCache();
 
     private:
+    friend class ofxHeadlessFboDrawContext;
+    friend class ofxHeadlessFboPool;
+
+    /// Integers beyond 2M pixels are clamped, so sums of two coordinates still fit.
+    static ofxHeadlessFboFixed toFixed(long long v) {
+        const long long limit = 1 << 21;
+        return static_cast<ofxHeadlessFboFixed>((v < -limit ? -limit : (v > limit ? limit : v)) * 256);
+    }
+    void drawPointFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y);
+    void drawLineFixed(ofxHeadlessFboFixed x1, ofxHeadlessFboFixed y1, ofxHeadlessFboFixed x2,
+                       ofxHeadlessFboFixed y2);
+    void drawRectangleFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed w,
+                            ofxHeadlessFboFixed h);
+    void drawTriangleFixed(ofxHeadlessFboFixed x1, ofxHeadlessFboFixed y1, ofxHeadlessFboFixed x2,
+                           ofxHeadlessFboFixed y2, ofxHeadlessFboFixed x3, ofxHeadlessFboFixed y3);
+    void drawCircleFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed r);
+    void drawRectRoundedFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed w,
+                              ofxHeadlessFboFixed h, ofxHeadlessFboFixed r);
+    void drawEllipseFixed(ofxHeadlessFboFixed x, ofxHeadlessFboFixed y, ofxHeadlessFboFixed w,
+                          ofxHeadlessFboFixed h);
+    void drawTriangleFixed(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys, const ofColor &c1,
+                           const ofColor &c2, const ofColor &c3);
+    /// Draws meshScratch.triangles, 2 position floats and optionally 4
+    /// color floats per vertex at the given strides.
+    void drawTriangles(const float *positions, size_t positionStride, const float *colors, size_t colorStride,
+                       size_t numVertices, size_t binRows);
+    void fillTriangle(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys, const unsigned char *const *colors,
+                      int rowStart, int rowEnd);
+    template <typename SpanFunction>
+    void rasterizeTriangle(const ofxHeadlessFboFixed *xs, const ofxHeadlessFboFixed *ys, int rowStart, int rowEnd,
+                           SpanFunction span);
+    void writeSpanRGBA(size_t x, size_t y, size_t span, const unsigned char *rgba);
     void writePoint(size_t x, size_t y);
     void writeLine(int x1, int y1, int x2, int y2);
+    void writeLineRGBA(int x1, int y1, int x2, int y2, const unsigned char *rgba1, const unsigned char *rgba2);
+    template <typename PointFunction>
+    void stepLine(int x1, int y1, int x2, int y2, PointFunction point);
     void writeLineH(int x, int y, int span);
     void writeLineV(int x, int y, int span);
     void writeSpanHFast(size_t x, size_t y, size_t span);
+    void writeSpan(size_t x, size_t y, size_t span);
+    void writeSpanPixels(size_t x, size_t y, size_t span);
+    void fillTile(size_t tileX, size_t tileY) const;
+    void readRow(size_t y, unsigned char *dst) const;
+    void resetTiles();
+    void writeSpanMasked(size_t x, size_t y, size_t span);
+    void updateMaskRuns();
     void circleHelper(int x0, int y0, int r, int corners);
     void fillCircleHelper(int x0, int y0, int r, int corners, int delta);
-    void markTextureDirty();
+    void rasterizeEllipse(int x0, int y0, int x1, int y1);
+    void writeSpanPacked(unsigned char *data, size_t x, size_t y, size_t span);
+    template <typename T>
+    void writeSpanWide(T *dst, size_t span);
+    void writeRowRGBA(size_t x, size_t y, size_t span, const unsigned char *rgba, const unsigned char *coverage);
+    void writeRowPacked(unsigned char *row, size_t x, size_t span, const unsigned char *rgba, bool blending);
+    template <typename T>
+    void writeRowWide(T *dst, size_t span, const unsigned char *rgba, const unsigned char *coverage);
+    template <typename T>
+    void clearWide(T *data, const ofFloatColor &color);
+    void quantizeRows(unsigned char *dst) const;
+    void clearWideStorage();
+    void clearPacked(unsigned char *data, const ofColor &color);
+    uint16_t getPackedValue(const ofColor &color) const;
+    void packRows(const unsigned char *src);
+    void unpackRows(unsigned char *dst) const;
+    void unpackRow(size_t y, unsigned char *dst) const;
+    unsigned int nextDitherOffset() const;
+    size_t getRowBytes() const;
+    void markDirty();
+    void closeDirtyEpoch();
+    void setLayout(size_t w, size_t h, ofPixelFormat pixelFormat, size_t numChannels, size_t stride,
+                   ofxHeadlessFboPackedFormat packedFormat = OFX_HEADLESS_FBO_PACKED_NONE);
+    unsigned char *getBase();
+    const unsigned char *getBase() const;
+    void copyRows(const unsigned char *src, size_t srcStride, unsigned char *dst, size_t dstStride) const;
+
+    /// Pixel spans of a thick outline per row, merged before they are drawn.
+    struct SpanAccumulator {
+        void begin(size_t rows);
+        /// Adds the pixels whose centers lie between left and right.
+        void add(int row, float left, float right);
+        void addPolygon(const float *xs, const float *ys, size_t n);
+        void addDisc(float cx, float cy, float r);
+        void addEllipseRing(float cx, float cy, float rx, float ry, float halfWidth);
+        void addRoundedRectRing(float x0, float y0, float x1, float y1, float r, float halfWidth);
+        void flush(ofxHeadlessFbo &fbo);
+
+        std::vector<std::vector<std::pair<int, int>>> rows;
+        int minRow = 0;
+        int maxRow = -1;
+    };
+
+    /// Pixels of a mask row that are let through, fully or with their coverage.
+    struct MaskRun {
+        uint32_t start;
+        uint32_t end;
+        bool partial;
+    };
+
+    /// Memory of floodFill() kept between calls, the visited bits are
+    /// cleared again after every fill.
+    struct FloodScratch {
+        std::vector<uint64_t> visited;
+        std::vector<std::pair<uint32_t, uint32_t>> stack;
+        std::vector<ofxHeadlessFboShapeCache::Span> spans;
+        /// 8 bit copies of the rows of packed, 16 bit and float buffers
+        std::vector<unsigned char> rows;
+        std::vector<unsigned char> rowReady;
+    };
+    const unsigned char *getFloodRow(size_t y);
+
+    struct MeshScratch {
+        std::vector<ofxHeadlessFboFixed> xs;
+        std::vector<ofxHeadlessFboFixed> ys;
+        /// RGBA per vertex
+        std::vector<unsigned char> colors;
+        /// 3 vertex indices per triangle
+        std::vector<uint32_t> triangles;
+        std::vector<uint32_t> binStarts;
+        std::vector<uint32_t> binTriangles;
+        /// interpolated colors of the current span
+        std::vector<unsigned char> span;
+    };
+
+    /// Leftmost and rightmost pixel of every row a filled shape covers,
+    /// collected while its rasterizer runs instead of writing pixels.
+    struct RowExtents {
+        void begin(int top, int rows);
+        void addSpan(int x, int y, int span);
+        void addColumn(int x, int y, int span);
+
+        int top = 0;
+        std::vector<int32_t> left;
+        std::vector<int32_t> right;
+    };
+
+    /// Draws a filled convex shape as one span per row, replayed from the
+    /// shape cache when it fits, so both paths write the same pixels once.
+    template <typename Rasterize>
+    void drawFilled(const ofxHeadlessFboShapeCache::Key &key, int left, int top, int width, int height,
+                    Rasterize rasterize);
+
+    void strokePolyline(const float *xs, const float *ys, size_t n, bool closed);
+    void addStrokeJoin(float px, float py, float d1x, float d1y, float d2x, float d2y);
+
+    struct AlignedBuffer {
+        AlignedBuffer() = default;
+        AlignedBuffer(const AlignedBuffer &other);
+        AlignedBuffer &operator=(const AlignedBuffer &other);
+        void allocate(size_t size, size_t alignment);
+        void clear();
+
+        unsigned char *data = nullptr;
+        size_t size = 0;
+        size_t alignment = 0;
+        std::unique_ptr<unsigned char[]> storage;
+    };
+
+#ifdef OFX_HEADLESS_FBO_STATS
+    struct StatsScope {
+        StatsScope(ofxHeadlessFbo &fbo, ofxHeadlessFboStats::Primitive primitive);
+        ~StatsScope();
+        ofxHeadlessFbo &fbo;
+        ofxHeadlessFboStats::Primitive primitive;
+        bool outermost;
+        uint64_t spansBefore;
+#ifdef OFX_HEADLESS_FBO_STATS_TIMING
+        std::chrono::steady_clock::time_point start;
+#endif
+    };
+    void countSpan(size_t span);
+
+    ofxHeadlessFboStats stats;
+    int statsDepth = 0;
+    ofxHeadlessFboStats::Primitive statsPrimitive = ofxHeadlessFboStats::CLEAR;
+#endif
 
     size_t w = 0;
     size_t h = 0;
     bool fill = true;
+    float lineWidth = 1;
+    ofxHeadlessFboFixed translateX = 0;
+    ofxHeadlessFboFixed translateY = 0;
+    ofxHeadlessFboLineJoin lineJoin = OFX_HEADLESS_FBO_JOIN_MITER;
+    SpanAccumulator strokeSpans;
+    FloodScratch flood;
+    MeshScratch meshScratch;
+    /// RGBA row of writeSpanRGBA() with the mask coverage in its alpha
+    std::vector<unsigned char> coveredRow;
+    ofxHeadlessFboShapeCache shapeCache;
+    std::vector<ofxHeadlessFboShapeCache::Span> recordedSpans;
+    RowExtents recordedRows;
+    bool recording = false;
     bool alphaBlending = false;
+    bool lazyClear = false;
+    /// tiles still holding solidPixel, filled in memory on their first write
+    mutable std::vector<unsigned char> solidTiles;
+    mutable size_t numSolidTiles = 0;
+    size_t tilesX = 0;
+    unsigned char solidPixel[4] = {};
+    const ofxHeadlessFbo *mask = nullptr;
+    /// position of pixel 0,0 in the mask, draw contexts use the canvas mask at their clip
+    size_t maskX = 0;
+    size_t maskY = 0;
+    bool maskRunsValid = false;
+    uint64_t maskVersion = 0;
+    std::vector<MaskRun> maskRuns;
+    /// index of the first run of every row, one more entry than rows
+    std::vector<size_t> maskRows;
     ofPixelFormat pixelFormat = OF_PIXELS_UNKNOWN;
     size_t numChannels = 0;
-    bool textureDirty = true;
-    size_t textureW = 0;
-    size_t textureH = 0;
-    ofPixelFormat texturePixelFormat = OF_PIXELS_UNKNOWN;
-    ofTexture textureCache;
+    ofxHeadlessFboPackedFormat packedFormat = OFX_HEADLESS_FBO_PACKED_NONE;
+    std::vector<ofColor> palette;
+    uint16_t packedColor = 0;
+    uint64_t version = 0;
+    /// pixels written since the last closeDirtyEpoch()
+    size_t dirtyX1 = SIZE_MAX;
+    size_t dirtyY1 = SIZE_MAX;
+    size_t dirtyX2 = 0;
+    size_t dirtyY2 = 0;
+    struct DirtyEpoch {
+        uint64_t version;
+        size_t x1;
+        size_t y1;
+        size_t x2;
+        size_t y2;
+    };
+    /// closed regions up to resetDirtyRegion(), and the last few for getDirtyRegionSince()
+    DirtyEpoch userDirty = {0, SIZE_MAX, SIZE_MAX, 0, 0};
+    std::vector<DirtyEpoch> dirtyEpochs;
+    uint64_t dirtyClosedVersion = 0;
+    uint64_t dirtyForgottenVersion = 0;
+#ifndef OFX_HEADLESS_FBO_NO_GL
+    std::shared_ptr<ofxHeadlessFboTexture> texture;
+#endif
+    size_t stride = 0;
     ofPixels pixels;
+    ofShortPixels shortPixels;
+    ofFloatPixels floatPixels;
+    AlignedBuffer aligned;
+    unsigned char *external = nullptr;
+    mutable ofPixels view;
+    mutable uint64_t viewVersion = 0;
+    mutable bool viewOwned = false;
+    mutable uint64_t ditherFrame = 0;
+    ofxHeadlessFboPrecision precision = OFX_HEADLESS_FBO_PRECISION_8;
+    ofxHeadlessFboDither dither = OFX_HEADLESS_FBO_DITHER_ORDERED;
     ofColor color;
+    ofFloatColor wideColor;
 };
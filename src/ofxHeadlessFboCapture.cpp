@@ -0,0 +1,187 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboCapture.h"
+#include "ofFileUtils.h"
+#include "ofImage.h"
+#include "ofLog.h"
+#include "ofxHeadlessFboTrace.h"
+
+ofxHeadlessFboCapture::~ofxHeadlessFboCapture() {
+    close();
+}
+
+void ofxHeadlessFboCapture::setup(size_t numBuffers) {
+    close();
+    numBuffers = std::max<size_t>(numBuffers, 1);
+    buffers.assign(numBuffers, ofPixels());
+    freeBuffers.clear();
+    for (size_t i = 0; i < numBuffers; ++i) {
+        freeBuffers.push_back(i);
+    }
+    captured = false;
+    running = true;
+    thread = std::thread(&ofxHeadlessFboCapture::encodeLoop, this);
+}
+
+void ofxHeadlessFboCapture::close() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    condition.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void ofxHeadlessFboCapture::setMinInterval(float seconds) {
+    minInterval = std::max(seconds, 0.0f);
+}
+
+float ofxHeadlessFboCapture::getMinInterval() const {
+    return minInterval;
+}
+
+std::future<ofxHeadlessFboSnapshot> ofxHeadlessFboCapture::capture(const ofxHeadlessFbo &fbo,
+                                                                   ofxHeadlessFboCaptureFormat format,
+                                                                   const std::string &path) {
+    Job job;
+    job.format = format;
+    job.path = path;
+    job.promise = std::make_shared<std::promise<ofxHeadlessFboSnapshot>>();
+    std::future<ofxHeadlessFboSnapshot> future = job.promise->get_future();
+    if (!enqueue(fbo, job)) {
+        ofxHeadlessFboSnapshot snapshot;
+        snapshot.format = format;
+        job.promise->set_value(snapshot);
+    }
+    return future;
+}
+
+bool ofxHeadlessFboCapture::capture(const ofxHeadlessFbo &fbo, ofxHeadlessFboCaptureFormat format, Callback callback,
+                                    const std::string &path) {
+    Job job;
+    job.format = format;
+    job.path = path;
+    job.callback = std::move(callback);
+    return enqueue(fbo, job);
+}
+
+uint64_t ofxHeadlessFboCapture::getSkipped() const {
+    return skipped;
+}
+
+bool ofxHeadlessFboCapture::enqueue(const ofxHeadlessFbo &fbo, Job &job) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("capture");
+    if (!running) {
+        setup();
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (!fbo.isAllocated() ||
+        (captured && std::chrono::duration<float>(now - lastCapture).count() < minInterval)) {
+        skipped++;
+        return false;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeBuffers.empty()) {
+            skipped++;
+            return false;
+        }
+        job.buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+
+    // the buffer belongs to this thread until the job is queued
+    fbo.readPixels(buffers[job.buffer]);
+    job.version = fbo.getVersion();
+    captured = true;
+    lastCapture = now;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    condition.notify_one();
+    return true;
+}
+
+void ofxHeadlessFboCapture::encodeLoop() {
+    OFX_HEADLESS_FBO_TRACE_THREAD("ofxHeadlessFboCapture");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]() { return !running || !jobs.empty(); });
+        if (jobs.empty()) {
+            // only stop once the pending captures are done
+            return;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+
+        const ofPixels &pixels = buffers[job.buffer];
+        ofxHeadlessFboSnapshot snapshot;
+        snapshot.format = job.format;
+        snapshot.w = pixels.getWidth();
+        snapshot.h = pixels.getHeight();
+        snapshot.version = job.version;
+        {
+            OFX_HEADLESS_FBO_TRACE_SCOPE("encodeSnapshot");
+            if (job.format == OFX_HEADLESS_FBO_CAPTURE_QOI) {
+                snapshot.ok = encodeQoi(pixels, snapshot.data);
+            } else {
+                ofBuffer buffer;
+                snapshot.ok = ofSaveImage(pixels, buffer, OF_IMAGE_FORMAT_PNG);
+                snapshot.data.assign(buffer.getData(), buffer.getData() + buffer.size());
+            }
+        }
+        if (snapshot.ok && !job.path.empty()) {
+            ofBuffer buffer;
+            buffer.set(reinterpret_cast<const char *>(snapshot.data.data()), snapshot.data.size());
+            if (ofBufferToFile(job.path, buffer, true)) {
+                snapshot.path = job.path;
+            } else {
+                ofLogError("ofxHeadlessFboCapture") << "capture(): couldn't write " << job.path;
+            }
+        }
+
+        lock.lock();
+        freeBuffers.push_back(job.buffer);
+        lock.unlock();
+
+        if (job.callback) {
+            job.callback(snapshot);
+        }
+        if (job.promise) {
+            job.promise->set_value(std::move(snapshot));
+        }
+        lock.lock();
+    }
+}
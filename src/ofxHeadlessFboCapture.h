@@ -0,0 +1,148 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofPixels.h"
+#include "ofxHeadlessFbo.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @file
+/// Snapshots of ofxHeadlessFbo encoded as QOI or PNG on a background thread.
+///
+/// capture() copies the buffer into one of a few pooled pixel buffers and
+/// returns right away, the encoding happens on a worker thread. Captures are
+/// skipped instead of waiting when all buffers are in use or when they come
+/// faster than the configured interval, so monitoring never stalls the
+/// frame loop.
+///
+/// ~~~~{.cpp}
+/// capture.setup();
+/// capture.setMinInterval(0.5);
+///
+/// void ofApp::update(){
+///     drawScene(hfbo);
+///     capture.capture(hfbo, OFX_HEADLESS_FBO_CAPTURE_QOI, [](const ofxHeadlessFboSnapshot &snapshot) {
+///         monitor.send(snapshot.data);
+///     });
+/// }
+/// ~~~~
+
+enum ofxHeadlessFboCaptureFormat {
+    /// The Quite OK Image format, fast to encode with a ratio close to PNG.
+    OFX_HEADLESS_FBO_CAPTURE_QOI,
+    /// PNG encoded with ofSaveImage().
+    OFX_HEADLESS_FBO_CAPTURE_PNG,
+};
+
+struct ofxHeadlessFboSnapshot {
+    /// false if the capture was skipped or encoding failed
+    bool ok = false;
+    ofxHeadlessFboCaptureFormat format = OFX_HEADLESS_FBO_CAPTURE_QOI;
+    size_t w = 0;
+    size_t h = 0;
+    /// ofxHeadlessFbo::getVersion() of the captured buffer
+    uint64_t version = 0;
+    /// encoded file
+    std::vector<unsigned char> data;
+    /// file the snapshot was saved to, empty if it wasn't saved
+    std::string path;
+};
+
+class ofxHeadlessFboCapture {
+    public:
+    typedef std::function<void(const ofxHeadlessFboSnapshot &snapshot)> Callback;
+
+    ~ofxHeadlessFboCapture();
+
+    /// @brief Starts the encoder thread.
+    ///
+    /// @param numBuffers Captures waiting or being encoded at most
+    void setup(size_t numBuffers = 2);
+    /// @brief Finishes the pending captures and stops the encoder thread.
+    void close();
+
+    /// @brief Minimum time between two accepted captures in seconds, 0 to accept all.
+    void setMinInterval(float seconds);
+    float getMinInterval() const;
+
+    /// @brief Snapshots the buffer and encodes it in the background.
+    ///
+    /// @param fbo Buffer to capture
+    /// @param format Encoding of the snapshot
+    /// @param path File to save the snapshot to, relative to the data folder, empty to only encode
+    /// @returns A future of the snapshot, ready right away with ok set to false when skipped
+    std::future<ofxHeadlessFboSnapshot> capture(const ofxHeadlessFbo &fbo, ofxHeadlessFboCaptureFormat format,
+                                                const std::string &path = "");
+    /// @brief Snapshots the buffer and calls back from the encoder thread.
+    ///
+    /// @returns false if the capture was skipped, the callback isn't called then
+    bool capture(const ofxHeadlessFbo &fbo, ofxHeadlessFboCaptureFormat format, Callback callback,
+                 const std::string &path = "");
+
+    /// @brief Captures skipped because of the interval or the buffers in use.
+    uint64_t getSkipped() const;
+
+    /// @brief Encodes 8 bit pixels as QOI, gray is stored as RGB.
+    static bool encodeQoi(const ofPixels &pixels, std::vector<unsigned char> &out);
+
+    private:
+    struct Job {
+        size_t buffer;
+        ofxHeadlessFboCaptureFormat format;
+        uint64_t version;
+        std::string path;
+        Callback callback;
+        std::shared_ptr<std::promise<ofxHeadlessFboSnapshot>> promise;
+    };
+
+    bool enqueue(const ofxHeadlessFbo &fbo, Job &job);
+    void encodeLoop();
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> jobs;
+    std::vector<ofPixels> buffers;
+    std::vector<size_t> freeBuffers;
+    bool running = false;
+
+    float minInterval = 0;
+    bool captured = false;
+    std::chrono::steady_clock::time_point lastCapture;
+    uint64_t skipped = 0;
+};
@@ -0,0 +1,130 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// The QOI encoder is kept apart from the capture thread, so it links
+// without ofImage and ofFileUtils.
+
+#include "ofxHeadlessFboCapture.h"
+
+namespace {
+
+const unsigned char qoiOpIndex = 0x00;
+const unsigned char qoiOpDiff = 0x40;
+const unsigned char qoiOpLuma = 0x80;
+const unsigned char qoiOpRun = 0xc0;
+const unsigned char qoiOpRgb = 0xfe;
+const unsigned char qoiOpRgba = 0xff;
+
+void putU32(std::vector<unsigned char> &out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back((value >> 16) & 0xff);
+    out.push_back((value >> 8) & 0xff);
+    out.push_back(value & 0xff);
+}
+
+struct QoiPixel {
+    unsigned char r, g, b, a;
+    bool operator==(const QoiPixel &other) const {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+};
+
+} // namespace
+
+bool ofxHeadlessFboCapture::encodeQoi(const ofPixels &pixels, std::vector<unsigned char> &out) {
+    const size_t w = pixels.getWidth();
+    const size_t h = pixels.getHeight();
+    const size_t channels = pixels.getNumChannels();
+    const ofPixelFormat format = pixels.getPixelFormat();
+    const bool swap = format == OF_PIXELS_BGR || format == OF_PIXELS_BGRA;
+    if (w == 0 || h == 0 || channels == 0 || channels > 4 || format == OF_PIXELS_RGB565) {
+        return false;
+    }
+    const bool alpha = channels == 2 || channels == 4;
+    const size_t count = w * h;
+
+    out.clear();
+    // worst case is a full RGBA op per pixel
+    out.reserve(14 + count * (alpha ? 5 : 4) + 8);
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    putU32(out, static_cast<uint32_t>(w));
+    putU32(out, static_cast<uint32_t>(h));
+    out.push_back(alpha ? 4 : 3);
+    out.push_back(0);
+
+    QoiPixel index[64] = {};
+    QoiPixel previous = {0, 0, 0, 255};
+    size_t run = 0;
+    const unsigned char *src = pixels.getData();
+    for (size_t i = 0; i < count; ++i, src += channels) {
+        QoiPixel pixel;
+        if (channels <= 2) {
+            pixel = {src[0], src[0], src[0], channels == 2 ? src[1] : static_cast<unsigned char>(255)};
+        } else {
+            pixel = {src[swap ? 2 : 0], src[1], src[swap ? 0 : 2], channels == 4 ? src[3] : static_cast<unsigned char>(255)};
+        }
+
+        if (pixel == previous) {
+            if (++run == 62 || i + 1 == count) {
+                out.push_back(qoiOpRun | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            out.push_back(qoiOpRun | (run - 1));
+            run = 0;
+        }
+
+        const size_t hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+        if (index[hash] == pixel) {
+            out.push_back(qoiOpIndex | hash);
+        } else {
+            index[hash] = pixel;
+            if (pixel.a == previous.a) {
+                const signed char dr = static_cast<signed char>(pixel.r - previous.r);
+                const signed char dg = static_cast<signed char>(pixel.g - previous.g);
+                const signed char db = static_cast<signed char>(pixel.b - previous.b);
+                const int drg = dr - dg;
+                const int dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out.push_back(qoiOpDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    out.push_back(qoiOpLuma | (dg + 32));
+                    out.push_back(((drg + 8) << 4) | (dbg + 8));
+                } else {
+                    out.insert(out.end(), {qoiOpRgb, pixel.r, pixel.g, pixel.b});
+                }
+            } else {
+                out.insert(out.end(), {qoiOpRgba, pixel.r, pixel.g, pixel.b, pixel.a});
+            }
+        }
+        previous = pixel;
+    }
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    return true;
+}
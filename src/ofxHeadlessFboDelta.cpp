@@ -0,0 +1,359 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboDelta.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OFX_HEADLESS_FBO_DELTA_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OFX_HEADLESS_FBO_DELTA_NEON
+#endif
+
+namespace {
+const size_t blockSize = 64;
+const size_t headerSize = 24;
+const size_t runHeaderSize = 8;
+const unsigned char streamVersion = 1;
+const unsigned char flagKeyframe = 0x1;
+
+inline void putU32(unsigned char *p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v);
+    p[1] = static_cast<unsigned char>(v >> 8);
+    p[2] = static_cast<unsigned char>(v >> 16);
+    p[3] = static_cast<unsigned char>(v >> 24);
+}
+
+inline uint32_t getU32(const unsigned char *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Compares two 64 byte blocks, the pointers don't need to be aligned.
+inline bool blockEqual(const unsigned char *a, const unsigned char *b) {
+#if defined(OFX_HEADLESS_FBO_DELTA_SSE2)
+    const __m128i *pa = reinterpret_cast<const __m128i *>(a);
+    const __m128i *pb = reinterpret_cast<const __m128i *>(b);
+    const __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128(pa + 0), _mm_loadu_si128(pb + 0));
+    const __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128(pa + 1), _mm_loadu_si128(pb + 1));
+    const __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128(pa + 2), _mm_loadu_si128(pb + 2));
+    const __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128(pa + 3), _mm_loadu_si128(pb + 3));
+    const __m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+    return _mm_movemask_epi8(all) == 0xFFFF;
+#elif defined(OFX_HEADLESS_FBO_DELTA_NEON)
+    const uint8x16_t d0 = veorq_u8(vld1q_u8(a + 0), vld1q_u8(b + 0));
+    const uint8x16_t d1 = veorq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16));
+    const uint8x16_t d2 = veorq_u8(vld1q_u8(a + 32), vld1q_u8(b + 32));
+    const uint8x16_t d3 = veorq_u8(vld1q_u8(a + 48), vld1q_u8(b + 48));
+    const uint64x2_t any = vreinterpretq_u64_u8(vorrq_u8(vorrq_u8(d0, d1), vorrq_u8(d2, d3)));
+    return (vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) == 0;
+#else
+    uint64_t diff = 0;
+    for (size_t i = 0; i < blockSize; i += sizeof(uint64_t)) {
+        uint64_t wa;
+        uint64_t wb;
+        std::memcpy(&wa, a + i, sizeof(uint64_t));
+        std::memcpy(&wb, b + i, sizeof(uint64_t));
+        diff |= wa ^ wb;
+    }
+    return diff == 0;
+#endif
+}
+
+void writeHeader(unsigned char *p, bool keyframe, ofPixelFormat pixelFormat, uint32_t sequence, size_t w,
+                 size_t h, uint32_t runCount) {
+    p[0] = 'H';
+    p[1] = 'F';
+    p[2] = 'B';
+    p[3] = 'D';
+    p[4] = streamVersion;
+    p[5] = keyframe ? flagKeyframe : 0;
+    p[6] = static_cast<unsigned char>(pixelFormat);
+    p[7] = 0;
+    putU32(p + 8, sequence);
+    putU32(p + 12, static_cast<uint32_t>(w));
+    putU32(p + 16, static_cast<uint32_t>(h));
+    putU32(p + 20, runCount);
+}
+} // namespace
+
+size_t ofxHeadlessFboDeltaEncoder::encode(const ofxHeadlessFbo &fbo, std::vector<unsigned char> &out) {
+    if (!fbo.isAllocated()) {
+        out.clear();
+        return 0;
+    }
+    const ofPixels &pixels = fbo.getPixels();
+    return encode(pixels.getData(), pixels.getWidth(), pixels.getHeight(), pixels.getPixelFormat(), out);
+}
+
+size_t ofxHeadlessFboDeltaEncoder::encode(const unsigned char *data, size_t w, size_t h, ofPixelFormat pixelFormat,
+                                          std::vector<unsigned char> &out) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("deltaEncode");
+    out.clear();
+    if (data == nullptr || w == 0 || h == 0 || pixelFormat == OF_PIXELS_UNKNOWN) {
+        return 0;
+    }
+
+    const size_t size = ofPixels::bytesFromPixelFormat(w, h, pixelFormat);
+    const uint32_t frameSequence = sequence++;
+
+    bool keyframe = forceKeyframe || w != prevW || h != prevH || pixelFormat != prevPixelFormat ||
+                    previous.size() != size || (keyframeInterval > 0 && framesSinceKeyframe >= keyframeInterval);
+
+    if (!keyframe) {
+        out.resize(headerSize);
+        unsigned char *prev = previous.data();
+        uint32_t runCount = 0;
+        size_t runHeaderPos = 0;
+        size_t runEnd = 0;
+        size_t payload = 0;
+
+        size_t pos = 0;
+        while (pos < size) {
+            // skip identical blocks
+            while (pos + blockSize <= size && blockEqual(data + pos, prev + pos)) {
+                pos += blockSize;
+            }
+            if (pos >= size) {
+                break;
+            }
+
+            const size_t blockEnd = std::min(pos + blockSize, size);
+            size_t first = pos;
+            while (first < blockEnd && data[first] == prev[first]) {
+                ++first;
+            }
+            if (first == blockEnd) {
+                pos = blockEnd;
+                continue;
+            }
+
+            // extend the run over following changed blocks
+            size_t end = blockEnd;
+            while (end + blockSize <= size && !blockEqual(data + end, prev + end)) {
+                end += blockSize;
+            }
+            if (end < size && end + blockSize > size) {
+                if (std::memcmp(data + end, prev + end, size - end) != 0) {
+                    end = size;
+                }
+            }
+
+            size_t last = end;
+            while (last > first && data[last - 1] == prev[last - 1]) {
+                --last;
+            }
+
+            if (runCount > 0 && first - runEnd <= runHeaderSize) {
+                // a short gap is cheaper to resend than to open a new run
+                out.insert(out.end(), data + runEnd, data + last);
+                putU32(out.data() + runHeaderPos + 4, static_cast<uint32_t>(last - getU32(out.data() + runHeaderPos)));
+                payload += last - runEnd;
+            } else {
+                runHeaderPos = out.size();
+                out.resize(out.size() + runHeaderSize);
+                putU32(out.data() + runHeaderPos, static_cast<uint32_t>(first));
+                putU32(out.data() + runHeaderPos + 4, static_cast<uint32_t>(last - first));
+                out.insert(out.end(), data + first, data + last);
+                payload += last - first;
+                ++runCount;
+            }
+            std::memcpy(prev + first, data + first, last - first);
+            runEnd = last;
+            pos = end;
+        }
+
+        if (out.size() < headerSize + runHeaderSize + size) {
+            writeHeader(out.data(), false, pixelFormat, frameSequence, w, h, runCount);
+            ++framesSinceKeyframe;
+            lastKeyframe = false;
+            lastRunCount = runCount;
+            lastPayloadSize = payload;
+            return out.size();
+        }
+        // the delta is larger than the frame itself
+        out.clear();
+    }
+
+    out.resize(headerSize + runHeaderSize + size);
+    writeHeader(out.data(), true, pixelFormat, frameSequence, w, h, 1);
+    putU32(out.data() + headerSize, 0);
+    putU32(out.data() + headerSize + 4, static_cast<uint32_t>(size));
+    std::memcpy(out.data() + headerSize + runHeaderSize, data, size);
+
+    previous.assign(data, data + size);
+    prevW = w;
+    prevH = h;
+    prevPixelFormat = pixelFormat;
+    forceKeyframe = false;
+    framesSinceKeyframe = 1;
+    lastKeyframe = true;
+    lastRunCount = 1;
+    lastPayloadSize = size;
+    return out.size();
+}
+
+void ofxHeadlessFboDeltaEncoder::setKeyframeInterval(size_t n) {
+    keyframeInterval = n;
+}
+
+size_t ofxHeadlessFboDeltaEncoder::getKeyframeInterval() const {
+    return keyframeInterval;
+}
+
+void ofxHeadlessFboDeltaEncoder::requestKeyframe() {
+    forceKeyframe = true;
+}
+
+void ofxHeadlessFboDeltaEncoder::reset() {
+    previous.clear();
+    prevW = 0;
+    prevH = 0;
+    prevPixelFormat = OF_PIXELS_UNKNOWN;
+    framesSinceKeyframe = 0;
+    forceKeyframe = true;
+}
+
+bool ofxHeadlessFboDeltaEncoder::isLastKeyframe() const {
+    return lastKeyframe;
+}
+
+size_t ofxHeadlessFboDeltaEncoder::getLastRunCount() const {
+    return lastRunCount;
+}
+
+size_t ofxHeadlessFboDeltaEncoder::getLastPayloadSize() const {
+    return lastPayloadSize;
+}
+
+bool ofxHeadlessFboDeltaDecoder::decode(const unsigned char *data, size_t size) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("deltaDecode");
+    if (data == nullptr || size < headerSize) {
+        return false;
+    }
+    if (data[0] != 'H' || data[1] != 'F' || data[2] != 'B' || data[3] != 'D' || data[4] != streamVersion) {
+        return false;
+    }
+
+    const bool keyframe = (data[5] & flagKeyframe) != 0;
+    const ofPixelFormat pixelFormat = static_cast<ofPixelFormat>(data[6]);
+    const uint32_t frameSequence = getU32(data + 8);
+    const size_t w = getU32(data + 12);
+    const size_t h = getU32(data + 16);
+    const uint32_t runCount = getU32(data + 20);
+    if (w == 0 || h == 0) {
+        return false;
+    }
+    // a keyframe carries every row and column, larger sizes can't be genuine
+    if (keyframe && (w > size || h > size)) {
+        return false;
+    }
+    const size_t frameSize = ofPixels::bytesFromPixelFormat(w, h, pixelFormat);
+    if (frameSize == 0) {
+        return false;
+    }
+
+    if (!keyframe) {
+        if (!synced || frameSequence != lastSequence + 1 || w != pixels.getWidth() || h != pixels.getHeight() ||
+            pixelFormat != pixels.getPixelFormat()) {
+            synced = false;
+            return false;
+        }
+    }
+
+    // validate every run before touching the buffer, keyframe runs have to
+    // follow each other and cover the whole frame
+    size_t pos = headerSize;
+    size_t covered = 0;
+    for (uint32_t i = 0; i < runCount; ++i) {
+        if (size - pos < runHeaderSize) {
+            return false;
+        }
+        const size_t offset = getU32(data + pos);
+        const size_t length = getU32(data + pos + 4);
+        pos += runHeaderSize;
+        if (offset > frameSize || length > frameSize - offset || length > size - pos) {
+            return false;
+        }
+        if (keyframe && offset != covered) {
+            return false;
+        }
+        covered = offset + length;
+        pos += length;
+    }
+    if (keyframe && covered != frameSize) {
+        return false;
+    }
+
+    if (keyframe && (!pixels.isAllocated() || w != pixels.getWidth() || h != pixels.getHeight() ||
+                     pixelFormat != pixels.getPixelFormat())) {
+        pixels.allocate(w, h, pixelFormat);
+    }
+
+    unsigned char *dst = pixels.getData();
+    pos = headerSize;
+    for (uint32_t i = 0; i < runCount; ++i) {
+        const size_t offset = getU32(data + pos);
+        const size_t length = getU32(data + pos + 4);
+        pos += runHeaderSize;
+        std::memcpy(dst + offset, data + pos, length);
+        pos += length;
+    }
+
+    lastSequence = frameSequence;
+    synced = true;
+    return true;
+}
+
+bool ofxHeadlessFboDeltaDecoder::decode(const std::vector<unsigned char> &data) {
+    return decode(data.data(), data.size());
+}
+
+bool ofxHeadlessFboDeltaDecoder::decode(const unsigned char *data, size_t size, ofxHeadlessFbo &fbo) {
+    if (!decode(data, size)) {
+        return false;
+    }
+    fbo.setFromPixels(pixels.getData(), pixels.getWidth(), pixels.getHeight(), pixels.getPixelFormat());
+    return true;
+}
+
+bool ofxHeadlessFboDeltaDecoder::needsKeyframe() const {
+    return !synced;
+}
+
+const ofPixels &ofxHeadlessFboDeltaDecoder::getPixels() const {
+    return pixels;
+}
+
+void ofxHeadlessFboDeltaDecoder::reset() {
+    pixels.clear();
+    lastSequence = 0;
+    synced = false;
+}
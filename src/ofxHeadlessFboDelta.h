@@ -0,0 +1,137 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofPixels.h"
+#include "ofxHeadlessFbo.h"
+#include <cstdint>
+#include <vector>
+
+/// @file
+/// Delta frame encoding for streaming an ofxHeadlessFbo over the network.
+///
+/// The encoder compares every frame against the previously emitted one and
+/// only emits the byte runs that changed. A keyframe carrying the full
+/// buffer is emitted periodically so that receivers can recover from lost
+/// packets.
+///
+/// Stream layout, all integers little endian:
+///
+///     magic       4 bytes  "HFBD"
+///     version     uint8
+///     flags       uint8    bit 0 set for keyframes
+///     format      uint8    ofPixelFormat of the frame
+///     reserved    uint8
+///     sequence    uint32   incremented for every encoded frame
+///     width       uint32
+///     height      uint32
+///     runCount    uint32
+///     runs        runCount x { uint32 offset, uint32 length, length bytes }
+///
+/// Run offsets and lengths are in bytes relative to the start of the pixel
+/// buffer. The runs of a keyframe follow each other and cover the whole
+/// buffer, decoders drop keyframes that don't.
+
+class ofxHeadlessFboDeltaEncoder {
+    public:
+    /// @brief Encodes the current content of the buffer.
+    ///
+    /// ~~~~{.cpp}
+    /// std::vector<unsigned char> packet;
+    /// encoder.encode(hfbo, packet);
+    /// udp.Send(reinterpret_cast<const char *>(packet.data()), packet.size());
+    /// ~~~~
+    ///
+    /// @param fbo Buffer to encode.
+    /// @param out Target stream, cleared before writing.
+    /// @returns Number of bytes written to out, 0 if fbo is not allocated.
+    size_t encode(const ofxHeadlessFbo &fbo, std::vector<unsigned char> &out);
+
+    /// @brief Encodes a raw tightly packed frame.
+    size_t encode(const unsigned char *data, size_t w, size_t h, ofPixelFormat pixelFormat,
+                  std::vector<unsigned char> &out);
+
+    /// @brief Emit a keyframe every n frames, 0 disables periodic keyframes.
+    void setKeyframeInterval(size_t n);
+    size_t getKeyframeInterval() const;
+
+    /// @brief Force the next encoded frame to be a keyframe.
+    void requestKeyframe();
+
+    /// @brief Forget the previous frame, the next frame will be a keyframe.
+    void reset();
+
+    /// @brief Whether the last encoded frame was a keyframe.
+    bool isLastKeyframe() const;
+    /// @brief Number of runs in the last encoded frame.
+    size_t getLastRunCount() const;
+    /// @brief Number of pixel bytes carried by the last encoded frame.
+    size_t getLastPayloadSize() const;
+
+    private:
+
+    std::vector<unsigned char> previous;
+    size_t prevW = 0;
+    size_t prevH = 0;
+    ofPixelFormat prevPixelFormat = OF_PIXELS_UNKNOWN;
+    uint32_t sequence = 0;
+    size_t keyframeInterval = 60;
+    size_t framesSinceKeyframe = 0;
+    bool forceKeyframe = true;
+    bool lastKeyframe = false;
+    size_t lastRunCount = 0;
+    size_t lastPayloadSize = 0;
+};
+
+class ofxHeadlessFboDeltaDecoder {
+    public:
+    /// @brief Applies an encoded frame to the internal pixel buffer.
+    ///
+    /// Delta frames are only accepted when they directly follow the last
+    /// decoded frame, otherwise they are dropped until the next keyframe.
+    ///
+    /// @returns true if the frame was applied.
+    bool decode(const unsigned char *data, size_t size);
+    bool decode(const std::vector<unsigned char> &data);
+
+    /// @brief Decodes a frame and copies the result into the buffer.
+    bool decode(const unsigned char *data, size_t size, ofxHeadlessFbo &fbo);
+
+    /// @brief Whether the decoder is waiting for a keyframe to resynchronize.
+    bool needsKeyframe() const;
+
+    /// @brief The last decoded frame.
+    const ofPixels &getPixels() const;
+
+    void reset();
+
+    private:
+    ofPixels pixels;
+    uint32_t lastSequence = 0;
+    bool synced = false;
+};
@@ -0,0 +1,394 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboDmx.h"
+
+#ifndef TARGET_WIN32
+
+#include "ofLog.h"
+#include "ofxHeadlessFboTrace.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+
+namespace {
+
+const size_t maxSlots = 512;
+const uint16_t artNetPort = 6454;
+const uint16_t sacnPort = 5568;
+const size_t artNetHeaderSize = 18;
+const size_t artNetSequenceOffset = 12;
+const size_t sacnHeaderSize = 126;
+const size_t sacnSequenceOffset = 111;
+const unsigned char zeros[maxSlots] = {};
+
+// Art-Net port addresses are 15 bits, sACN reserves universe 0 and 64000 up
+uint16_t getFirstUniverse(ofxHeadlessFboDmxProtocol protocol) {
+    return protocol == OFX_HEADLESS_FBO_DMX_SACN ? 1 : 0;
+}
+
+uint16_t getLastUniverse(ofxHeadlessFboDmxProtocol protocol) {
+    return protocol == OFX_HEADLESS_FBO_DMX_SACN ? 63999 : 32767;
+}
+
+size_t getPixelsPerUniverse(size_t pixelsPerUniverse, size_t channels) {
+    const size_t perUniverse = maxSlots / channels;
+    return pixelsPerUniverse > 0 ? std::min(pixelsPerUniverse, perUniverse) : perUniverse;
+}
+
+void putU16(unsigned char *p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xff;
+}
+
+/// Flags of an ACN PDU followed by the length from offset to the end of the packet.
+void putPduLength(unsigned char *p, size_t offset, size_t packetSize) {
+    putU16(p + offset, 0x7000 | static_cast<uint16_t>(packetSize - offset));
+}
+
+} // namespace
+
+ofxHeadlessFboDmxSender::~ofxHeadlessFboDmxSender() {
+    close();
+}
+
+bool ofxHeadlessFboDmxSender::setup(ofxHeadlessFboDmxProtocol protocol, const std::string &host, int port) {
+    close();
+    this->protocol = protocol;
+    this->port = port > 0 ? port : protocol == OFX_HEADLESS_FBO_DMX_ARTNET ? artNetPort : sacnPort;
+    hasHost = !host.empty();
+    if (hasHost && inet_pton(AF_INET, host.c_str(), &this->host) != 1) {
+        ofLogError("ofxHeadlessFboDmxSender") << "setup(): invalid IPv4 address " << host;
+        return false;
+    }
+
+    descriptor = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (descriptor < 0) {
+        ofLogError("ofxHeadlessFboDmxSender") << "setup(): couldn't create socket, " << strerror(errno);
+        return false;
+    }
+    if (protocol == OFX_HEADLESS_FBO_DMX_ARTNET) {
+        const int broadcast = 1;
+        setsockopt(descriptor, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+    }
+
+    std::random_device random;
+    for (auto &byte : cid) {
+        byte = random() & 0xff;
+    }
+    sequence = 0;
+    compiled = false;
+    return true;
+}
+
+void ofxHeadlessFboDmxSender::close() {
+    if (descriptor >= 0) {
+        ::close(descriptor);
+        descriptor = -1;
+    }
+}
+
+bool ofxHeadlessFboDmxSender::isOpen() const {
+    return descriptor >= 0;
+}
+
+size_t ofxHeadlessFboDmxSender::mapRegion(int x, int y, size_t w, size_t h, uint16_t firstUniverse,
+                                          size_t pixelsPerUniverse, size_t channels) {
+    if (w == 0 || h == 0) {
+        return 0;
+    }
+    if (channels != 1 && channels != 3) {
+        ofLogWarning("ofxHeadlessFboDmxSender") << "mapRegion(): " << channels << " channels, expected 1 or 3";
+        return 0;
+    }
+    const size_t perUniverse = getPixelsPerUniverse(pixelsPerUniverse, channels);
+    const size_t count = (w * h + perUniverse - 1) / perUniverse;
+    if (firstUniverse < getFirstUniverse(protocol) || firstUniverse + count - 1 > getLastUniverse(protocol)) {
+        ofLogWarning("ofxHeadlessFboDmxSender") << "mapRegion(): universes " << firstUniverse << " to "
+                                                << firstUniverse + count - 1 << " are out of range "
+                                                << getFirstUniverse(protocol) << " to " << getLastUniverse(protocol);
+        return 0;
+    }
+    regions.push_back(Region{x, y, w, h, firstUniverse, pixelsPerUniverse});
+    compiled = false;
+    return count;
+}
+
+void ofxHeadlessFboDmxSender::clearMap() {
+    regions.clear();
+    universes.clear();
+    compiled = false;
+}
+
+size_t ofxHeadlessFboDmxSender::getNumUniverses() const {
+    return universes.size();
+}
+
+void ofxHeadlessFboDmxSender::setSourceName(const std::string &name) {
+    sourceName = name;
+    compiled = false;
+}
+
+void ofxHeadlessFboDmxSender::setPriority(uint8_t priority) {
+    this->priority = std::min<uint8_t>(priority, 200);
+    compiled = false;
+}
+
+size_t ofxHeadlessFboDmxSender::send(const ofxHeadlessFbo &fbo) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("dmxSend");
+    if (!isOpen() || regions.empty()) {
+        return 0;
+    }
+    size_t channels = 0;
+    size_t stride = 0;
+    const unsigned char *source = getSource(fbo, channels, stride);
+    if (source == nullptr) {
+        return 0;
+    }
+    if (!compiled || compiledW != fbo.getWidth() || compiledH != fbo.getHeight() || compiledChannels != channels ||
+        compiledStride != stride) {
+        compile(fbo.getWidth(), fbo.getHeight(), channels, stride);
+    }
+
+    // Art-Net reserves sequence 0 for disabled sequencing
+    sequence++;
+    if (sequence == 0 && protocol == OFX_HEADLESS_FBO_DMX_ARTNET) {
+        sequence = 1;
+    }
+    const size_t sequenceOffset = protocol == OFX_HEADLESS_FBO_DMX_ARTNET ? artNetSequenceOffset : sacnSequenceOffset;
+    for (auto &universe : universes) {
+        universe.header[sequenceOffset] = sequence;
+    }
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (pieces[i].kind == Piece::PIXELS) {
+            vectors[i].iov_base = const_cast<unsigned char *>(source + pieces[i].offset);
+        }
+    }
+    return flush(universes.size());
+}
+
+uint64_t ofxHeadlessFboDmxSender::getPacketsSent() const {
+    return packetsSent;
+}
+
+uint64_t ofxHeadlessFboDmxSender::getSyscalls() const {
+    return syscalls;
+}
+
+void ofxHeadlessFboDmxSender::compile(size_t w, size_t h, size_t channels, size_t stride) {
+    universes.clear();
+    pieces.clear();
+
+    for (const auto &region : regions) {
+        const size_t perUniverse = getPixelsPerUniverse(region.pixelsPerUniverse, channels);
+        const size_t total = region.w * region.h;
+        for (size_t first = 0, n = 0; first < total; first += perUniverse, ++n) {
+            // mapped for fewer channels or another protocol than sent with
+            if (region.firstUniverse < getFirstUniverse(protocol) ||
+                region.firstUniverse + n > getLastUniverse(protocol)) {
+                ofLogWarning("ofxHeadlessFboDmxSender")
+                    << "send(): universe " << region.firstUniverse + n << " is out of range, region cut short";
+                break;
+            }
+            const size_t count = std::min(perUniverse, total - first);
+            Universe universe;
+            universe.number = static_cast<uint16_t>(region.firstUniverse + n);
+            universe.firstVector = pieces.size();
+            pieces.push_back(Piece{Piece::HEADER, universes.size(), 0, 0});
+
+            // runs of pixels along a row, clipped to the canvas
+            for (size_t i = first; i < first + count;) {
+                const size_t column = i % region.w;
+                const size_t run = std::min(region.w - column, first + count - i);
+                const long long row = static_cast<long long>(region.y) + static_cast<long long>(i / region.w);
+                const long long left = static_cast<long long>(region.x) + static_cast<long long>(column);
+                const long long right = left + static_cast<long long>(run);
+                const long long visibleLeft = std::max(left, 0ll);
+                const long long visibleRight = std::min(right, static_cast<long long>(w));
+                if (row < 0 || row >= static_cast<long long>(h) || visibleLeft >= visibleRight) {
+                    pieces.push_back(Piece{Piece::ZEROS, universes.size(), 0, run * channels});
+                } else {
+                    if (visibleLeft > left) {
+                        pieces.push_back(Piece{Piece::ZEROS, universes.size(), 0, (visibleLeft - left) * channels});
+                    }
+                    pieces.push_back(Piece{Piece::PIXELS, universes.size(),
+                                           static_cast<size_t>(row) * stride + visibleLeft * channels,
+                                           static_cast<size_t>(visibleRight - visibleLeft) * channels});
+                    if (right > visibleRight) {
+                        pieces.push_back(Piece{Piece::ZEROS, universes.size(), 0, (right - visibleRight) * channels});
+                    }
+                }
+                i += run;
+            }
+
+            const size_t slots = count * channels;
+            if (protocol == OFX_HEADLESS_FBO_DMX_ARTNET && slots % 2 != 0) {
+                // ArtDmx lengths are even
+                pieces.push_back(Piece{Piece::ZEROS, universes.size(), 0, 1});
+            }
+            universe.numVectors = pieces.size() - universe.firstVector;
+            buildHeader(universe, slots + (protocol == OFX_HEADLESS_FBO_DMX_ARTNET ? slots % 2 : 0));
+
+            universe.destination = {};
+            universe.destination.sin_family = AF_INET;
+            universe.destination.sin_port = htons(port);
+            if (hasHost) {
+                universe.destination.sin_addr = host;
+            } else if (protocol == OFX_HEADLESS_FBO_DMX_ARTNET) {
+                universe.destination.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+            } else {
+                universe.destination.sin_addr.s_addr = htonl(0xefff0000 | universe.number);
+            }
+            universes.push_back(std::move(universe));
+        }
+    }
+
+    // the tables don't move anymore, point the vectors and messages at them
+    vectors.resize(pieces.size());
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        const Piece &piece = pieces[i];
+        if (piece.kind == Piece::HEADER) {
+            vectors[i].iov_base = universes[piece.universe].header.data();
+            vectors[i].iov_len = universes[piece.universe].header.size();
+        } else {
+            vectors[i].iov_base = const_cast<unsigned char *>(zeros);
+            vectors[i].iov_len = piece.length;
+        }
+    }
+    messages.assign(universes.size(), {});
+    for (size_t i = 0; i < universes.size(); ++i) {
+#ifdef TARGET_LINUX
+        msghdr &message = messages[i].msg_hdr;
+#else
+        msghdr &message = messages[i];
+#endif
+        message.msg_name = &universes[i].destination;
+        message.msg_namelen = sizeof(sockaddr_in);
+        message.msg_iov = vectors.data() + universes[i].firstVector;
+        message.msg_iovlen = universes[i].numVectors;
+    }
+
+    compiled = true;
+    compiledW = w;
+    compiledH = h;
+    compiledChannels = channels;
+    compiledStride = stride;
+}
+
+void ofxHeadlessFboDmxSender::buildHeader(Universe &universe, size_t slots) {
+    if (protocol == OFX_HEADLESS_FBO_DMX_ARTNET) {
+        universe.header.assign(artNetHeaderSize, 0);
+        unsigned char *p = universe.header.data();
+        std::memcpy(p, "Art-Net", 8);
+        p[8] = 0x00; // OpDmx, little endian
+        p[9] = 0x50;
+        p[11] = 14; // protocol version
+        p[14] = universe.number & 0xff;
+        p[15] = (universe.number >> 8) & 0x7f;
+        putU16(p + 16, static_cast<uint16_t>(slots));
+        return;
+    }
+
+    const size_t packetSize = sacnHeaderSize + slots;
+    universe.header.assign(sacnHeaderSize, 0);
+    unsigned char *p = universe.header.data();
+    // root layer
+    putU16(p, 0x0010);
+    std::memcpy(p + 4, "ASC-E1.17\0\0\0", 12);
+    putPduLength(p, 16, packetSize);
+    p[21] = 0x04;
+    std::memcpy(p + 22, cid, sizeof(cid));
+    // framing layer
+    putPduLength(p, 38, packetSize);
+    p[43] = 0x02;
+    std::memcpy(p + 44, sourceName.c_str(), std::min<size_t>(sourceName.size(), 63));
+    p[108] = priority;
+    putU16(p + 113, universe.number);
+    // DMP layer
+    putPduLength(p, 115, packetSize);
+    p[117] = 0x02;
+    p[118] = 0xa1;
+    putU16(p + 121, 1);
+    putU16(p + 123, static_cast<uint16_t>(slots + 1));
+}
+
+const unsigned char *ofxHeadlessFboDmxSender::getSource(const ofxHeadlessFbo &fbo, size_t &channels, size_t &stride) {
+    if (!fbo.isAllocated()) {
+        return nullptr;
+    }
+    const ofPixelFormat format = fbo.getPixelFormat();
+    if (fbo.getPackedFormat() == OFX_HEADLESS_FBO_PACKED_NONE && fbo.getPrecision() == OFX_HEADLESS_FBO_PRECISION_8 &&
+        (format == OF_PIXELS_RGB || format == OF_PIXELS_GRAY)) {
+        channels = fbo.getNumChannels();
+        stride = fbo.getStride();
+        return fbo.getData();
+    }
+
+    // other layouts are converted to RGB or GRAY first
+    const bool gray = format == OF_PIXELS_GRAY || format == OF_PIXELS_GRAY_ALPHA;
+    fbo.readPixelsAs(staging, gray ? OF_PIXELS_GRAY : OF_PIXELS_RGB);
+    if (!staging.isAllocated()) {
+        ofLogWarning("ofxHeadlessFboDmxSender") << "send(): unsupported pixel format " << format;
+        return nullptr;
+    }
+    channels = staging.getNumChannels();
+    stride = staging.getBytesStride();
+    return staging.getData();
+}
+
+size_t ofxHeadlessFboDmxSender::flush(size_t count) {
+    size_t sent = 0;
+#ifdef TARGET_LINUX
+    while (sent < count) {
+        const int result = sendmmsg(descriptor, messages.data() + sent, std::min<size_t>(count - sent, 1024), 0);
+        syscalls++;
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ofLogWarning("ofxHeadlessFboDmxSender") << "send(): " << strerror(errno);
+            break;
+        }
+        sent += result;
+    }
+#else
+    for (; sent < count; ++sent) {
+        syscalls++;
+        if (sendmsg(descriptor, &messages[sent], 0) < 0) {
+            ofLogWarning("ofxHeadlessFboDmxSender") << "send(): " << strerror(errno);
+            break;
+        }
+    }
+#endif
+    packetsSent += sent;
+    return sent;
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofConstants.h"
+#include "ofPixels.h"
+#include "ofxHeadlessFbo.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @file
+/// Art-Net and sACN (E1.31) output of ofxHeadlessFbo pixels to LED
+/// controllers.
+///
+/// Regions of the canvas are mapped to DMX universes. The mapping is compiled
+/// into a table of packet headers, built once, and pointers into the pixel
+/// rows. Sending a frame gathers every universe straight from the canvas
+/// with scatter/gather I/O and hands all packets to the kernel in one
+/// sendmmsg() call on Linux. RGB and GRAY canvases are sent without copying,
+/// other formats are converted into a staging buffer first.
+///
+/// Not available on Windows.
+
+#ifndef TARGET_WIN32
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+enum ofxHeadlessFboDmxProtocol {
+    /// ArtDmx packets, UDP port 6454.
+    OFX_HEADLESS_FBO_DMX_ARTNET,
+    /// E1.31 data packets, UDP port 5568.
+    OFX_HEADLESS_FBO_DMX_SACN,
+};
+
+class ofxHeadlessFboDmxSender {
+    public:
+    ~ofxHeadlessFboDmxSender();
+
+    /// @brief Opens the socket.
+    ///
+    /// Without a host Art-Net is broadcast to 255.255.255.255 and sACN is
+    /// sent to the multicast group of every universe, 239.255.hi.lo.
+    ///
+    /// ~~~~{.cpp}
+    /// dmx.setup(OFX_HEADLESS_FBO_DMX_ARTNET, "192.168.1.50");
+    /// dmx.mapRegion(0, 0, 170, 8, 0); // 8 rows of 170 pixels, universes 0 to 7
+    /// // every frame
+    /// dmx.send(hfbo);
+    /// ~~~~
+    ///
+    /// @param protocol Packet format
+    /// @param host IPv4 address of the receiver, empty for broadcast or multicast
+    /// @param port UDP port, 0 for the default port of the protocol
+    bool setup(ofxHeadlessFboDmxProtocol protocol, const std::string &host = "", int port = 0);
+    void close();
+    bool isOpen() const;
+
+    /// @brief Maps a region of the canvas to consecutive universes.
+    ///
+    /// Pixels are taken row by row, left to right, and a pixel never
+    /// straddles two universes. Parts of the region outside of the canvas
+    /// are sent as zeros.
+    ///
+    /// Universes are Art-Net port addresses 0 to 32767 or sACN universes 1
+    /// to 63999, so call setup() first. A region whose universes don't all
+    /// fit in that range isn't mapped. Canvases with a gray pixel format are
+    /// sent with one channel per pixel, all others with three.
+    ///
+    /// ~~~~{.cpp}
+    /// dmx.mapRegion(0, 0, 512, 2, 1, 0, 1); // 2 rows of a GRAY canvas, universes 1 and 2
+    /// ~~~~
+    ///
+    /// @param x Left column of the region
+    /// @param y Top row of the region
+    /// @param w Width of the region in pixels
+    /// @param h Height of the region in pixels
+    /// @param firstUniverse Universe of the first pixel, Art-Net port address or sACN universe
+    /// @param pixelsPerUniverse Pixels per universe, 0 to fill the 512 channels
+    /// @param channels Channels per pixel of the canvas to send, 3 or 1
+    /// @returns Number of universes used by the region, 0 when it isn't mapped
+    size_t mapRegion(int x, int y, size_t w, size_t h, uint16_t firstUniverse, size_t pixelsPerUniverse = 0,
+                     size_t channels = 3);
+    /// @brief Removes all mapped regions.
+    void clearMap();
+    size_t getNumUniverses() const;
+
+    /// @brief Name and priority of the source in sACN packets.
+    void setSourceName(const std::string &name);
+    void setPriority(uint8_t priority);
+
+    /// @brief Sends all mapped universes of the canvas.
+    ///
+    /// @returns Number of packets sent
+    size_t send(const ofxHeadlessFbo &fbo);
+
+    uint64_t getPacketsSent() const;
+    /// @brief Send calls made, one per frame with sendmmsg().
+    uint64_t getSyscalls() const;
+
+    private:
+    struct Region {
+        int x;
+        int y;
+        size_t w;
+        size_t h;
+        uint16_t firstUniverse;
+        size_t pixelsPerUniverse;
+    };
+
+    struct Universe {
+        uint16_t number;
+        sockaddr_in destination;
+        std::vector<unsigned char> header;
+        size_t firstVector;
+        size_t numVectors;
+    };
+
+    /// Piece of a packet, either the header, pixel bytes or zero padding.
+    struct Piece {
+        enum Kind { HEADER, PIXELS, ZEROS };
+        Kind kind;
+        size_t universe;
+        size_t offset;
+        size_t length;
+    };
+
+    void compile(size_t w, size_t h, size_t channels, size_t stride);
+    void buildHeader(Universe &universe, size_t slots);
+    const unsigned char *getSource(const ofxHeadlessFbo &fbo, size_t &channels, size_t &stride);
+    size_t flush(size_t count);
+
+    int descriptor = -1;
+    ofxHeadlessFboDmxProtocol protocol = OFX_HEADLESS_FBO_DMX_ARTNET;
+    bool hasHost = false;
+    in_addr host = {};
+    uint16_t port = 0;
+    std::string sourceName = "ofxHeadlessFbo";
+    uint8_t priority = 100;
+    unsigned char cid[16] = {};
+    uint8_t sequence = 0;
+
+    std::vector<Region> regions;
+    std::vector<Universe> universes;
+    std::vector<Piece> pieces;
+    std::vector<iovec> vectors;
+#ifdef TARGET_LINUX
+    std::vector<mmsghdr> messages;
+#else
+    std::vector<msghdr> messages;
+#endif
+    bool compiled = false;
+    size_t compiledW = 0;
+    size_t compiledH = 0;
+    size_t compiledChannels = 0;
+    size_t compiledStride = 0;
+
+    ofPixels staging;
+
+    uint64_t packetsSent = 0;
+    uint64_t syscalls = 0;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboDrawContext.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// first pixel whose center lies at or after v
+size_t clipEdge(float v, size_t limit) {
+    return static_cast<size_t>(std::min(std::max(std::ceil(v - 0.5f), 0.0f), static_cast<float>(limit)));
+}
+} // namespace
+
+ofxHeadlessFboDrawContext::ofxHeadlessFboDrawContext(ofxHeadlessFbo &canvas, const ofRectangle &clip) {
+    setup(canvas, clip);
+}
+
+bool ofxHeadlessFboDrawContext::setup(ofxHeadlessFbo &canvas, const ofRectangle &clip) {
+    this->canvas = nullptr;
+    if (!canvas.isAllocated() || canvas.precision != OFX_HEADLESS_FBO_PRECISION_8) {
+        ofLogWarning("ofxHeadlessFboDrawContext") << "setup(): the canvas has to be an allocated 8 bit or packed buffer";
+        return false;
+    }
+
+    size_t x0 = 0;
+    size_t y0 = 0;
+    size_t x1 = canvas.w;
+    size_t y1 = canvas.h;
+    if (clip.width > 0 && clip.height > 0) {
+        x0 = clipEdge(clip.x, canvas.w);
+        y0 = clipEdge(clip.y, canvas.h);
+        x1 = clipEdge(clip.x + clip.width, canvas.w);
+        y1 = clipEdge(clip.y + clip.height, canvas.h);
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        ofLogWarning("ofxHeadlessFboDrawContext") << "setup(): the clip is outside of the canvas";
+        return false;
+    }
+
+    size_t offset = 0;
+    switch (canvas.packedFormat) {
+        case OFX_HEADLESS_FBO_PACKED_MONO1:
+            // two contexts sharing a byte would race
+            if (x0 % 8 != 0 || (x1 % 8 != 0 && x1 != canvas.w)) {
+                ofLogWarning("ofxHeadlessFboDrawContext") << "setup(): MONO1 clips have to start and end on whole bytes";
+                return false;
+            }
+            offset = x0 / 8;
+            break;
+        case OFX_HEADLESS_FBO_PACKED_RGB565:
+            offset = x0 * 2;
+            break;
+        case OFX_HEADLESS_FBO_PACKED_INDEXED8:
+            offset = x0;
+            break;
+        default:
+            offset = x0 * canvas.numChannels;
+            break;
+    }
+
+    // drawing through the context writes the pixels directly
+    canvas.materializeTiles();
+    unsigned char *data = canvas.getBase() + y0 * canvas.stride + offset;
+    if (canvas.packedFormat == OFX_HEADLESS_FBO_PACKED_NONE) {
+        allocateFromExternal(data, x1 - x0, y1 - y0, canvas.stride, canvas.pixelFormat);
+    } else {
+        allocateFromExternal(data, x1 - x0, y1 - y0, canvas.stride, canvas.packedFormat);
+        if (canvas.packedFormat == OFX_HEADLESS_FBO_PACKED_INDEXED8) {
+            setPalette(canvas.getPalette());
+        }
+    }
+    if (!ofxHeadlessFbo::isAllocated()) {
+        return false;
+    }
+
+    this->canvas = &canvas;
+    clipX = x0;
+    clipY = y0;
+    // the canvas mask applies at the clip, the context builds its own runs
+    // from it here, so drawing threads only read a materialized mask
+    mask = canvas.mask;
+    maskX = canvas.maskX + x0;
+    maskY = canvas.maskY + y0;
+    maskRunsValid = false;
+    if (mask != nullptr) {
+        mask->materializeTiles();
+        updateMaskRuns();
+    }
+    resetDirtyRegion();
+    setTranslation(userTranslateX, userTranslateY);
+    return true;
+}
+
+void ofxHeadlessFboDrawContext::merge() {
+    const ofRectangle region = ofxHeadlessFbo::getDirtyRegion();
+    if (canvas == nullptr || region.width <= 0) {
+        return;
+    }
+    const size_t x1 = clipX + static_cast<size_t>(region.x);
+    const size_t y1 = clipY + static_cast<size_t>(region.y);
+    canvas->dirtyX1 = std::min(canvas->dirtyX1, x1);
+    canvas->dirtyY1 = std::min(canvas->dirtyY1, y1);
+    canvas->dirtyX2 = std::max(canvas->dirtyX2, x1 + static_cast<size_t>(region.width));
+    canvas->dirtyY2 = std::max(canvas->dirtyY2, y1 + static_cast<size_t>(region.height));
+    ++canvas->version;
+    resetDirtyRegion();
+}
+
+ofxHeadlessFbo *ofxHeadlessFboDrawContext::getCanvas() const {
+    return canvas;
+}
+
+ofRectangle ofxHeadlessFboDrawContext::getClip() const {
+    if (canvas == nullptr) {
+        return ofRectangle(0, 0, 0, 0);
+    }
+    return ofRectangle(clipX, clipY, w, h);
+}
+
+ofRectangle ofxHeadlessFboDrawContext::getDirtyRegion() const {
+    ofRectangle region = ofxHeadlessFbo::getDirtyRegion();
+    if (region.width > 0) {
+        region.x += clipX;
+        region.y += clipY;
+    }
+    return region;
+}
+
+void ofxHeadlessFboDrawContext::setTranslation(float x, float y) {
+    userTranslateX = x;
+    userTranslateY = y;
+    // primitives are drawn relative to the clip
+    ofxHeadlessFbo::setTranslation(x - clipX, y - clipY);
+}
+
+float ofxHeadlessFboDrawContext::getTranslationX() const {
+    return userTranslateX;
+}
+
+float ofxHeadlessFboDrawContext::getTranslationY() const {
+    return userTranslateY;
+}
@@ -0,0 +1,138 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofRectangle.h"
+#include "ofxHeadlessFbo.h"
+
+/// @file
+/// Drawing state of one thread, drawing into a region of a shared canvas.
+///
+/// A context points at the pixels of a canvas inside its clip rectangle
+/// and keeps its own color, fill, blending, line width, translation, shape
+/// cache and dirty region. Threads drawing through contexts with clips that
+/// don't overlap never touch the same memory, so they can rasterize into
+/// one canvas at once without locks. Coordinates stay the canvas'
+/// coordinates, everything outside the clip is cut off.
+///
+/// Contexts are set up and merged on the canvas' thread, drawing happens on
+/// any thread. The canvas and its mask mustn't be cleared, reallocated or
+/// drawn on directly while contexts draw into it.
+///
+/// ~~~~{.cpp}
+/// std::vector<ofxHeadlessFboDrawContext> contexts(4);
+/// for (size_t i = 0; i < contexts.size(); ++i) {
+///     contexts[i].setup(hfbo, ofRectangle(0, i * 75, 800, 75));
+/// }
+/// std::vector<std::thread> threads;
+/// for (auto &context : contexts) {
+///     threads.emplace_back([&context]() { drawScene(context); });
+/// }
+/// for (auto &thread : threads) {
+///     thread.join();
+/// }
+/// for (auto &context : contexts) {
+///     context.merge();
+/// }
+/// ~~~~
+
+class ofxHeadlessFboDrawContext : private ofxHeadlessFbo {
+    public:
+    ofxHeadlessFboDrawContext() = default;
+    ofxHeadlessFboDrawContext(ofxHeadlessFbo &canvas, const ofRectangle &clip = ofRectangle());
+
+    /// @brief Points the context at the pixels of canvas inside clip.
+    ///
+    /// The clip covers the pixels whose centers lie inside it, like
+    /// drawRectangle(), so adjacent clips never share a pixel. Lazily
+    /// cleared tiles of the canvas are filled in first. The mask of the
+    /// canvas applies to the context as well and is read by every context
+    /// from its own thread. It must not be drawn into or replaced while
+    /// contexts draw, call setup() again after it changed. The drawing state
+    /// is kept, the dirty region starts empty.
+    ///
+    /// @param canvas 8 bit or packed canvas, MONO1 clips have to start and
+    /// end on whole bytes
+    /// @param clip Region to draw into, empty for the whole canvas
+    /// @returns false if the canvas or the clip isn't supported
+    bool setup(ofxHeadlessFbo &canvas, const ofRectangle &clip = ofRectangle());
+
+    /// @brief Adds the pixels drawn since the last merge to the canvas.
+    ///
+    /// Grows the dirty region of the canvas and bumps its version once, so
+    /// textures and delta encoders pick up the change. Call it on the
+    /// canvas' thread after drawing finished.
+    void merge();
+
+    ofxHeadlessFbo *getCanvas() const;
+    /// @brief Clip in canvas coordinates.
+    ofRectangle getClip() const;
+    /// @brief Bounding box of the pixels drawn since the last merge, in canvas coordinates.
+    ofRectangle getDirtyRegion() const;
+
+    /// @brief Offsets all following primitives, in canvas coordinates.
+    void setTranslation(float x, float y);
+    float getTranslationX() const;
+    float getTranslationY() const;
+
+    using ofxHeadlessFbo::isAllocated;
+    using ofxHeadlessFbo::setColor;
+    using ofxHeadlessFbo::setFill;
+    using ofxHeadlessFbo::setNoFill;
+    using ofxHeadlessFbo::setLineWidth;
+    using ofxHeadlessFbo::getLineWidth;
+    using ofxHeadlessFbo::setLineJoin;
+    using ofxHeadlessFbo::getLineJoin;
+    using ofxHeadlessFbo::enableAlphaBlending;
+    using ofxHeadlessFbo::disableAlphaBlending;
+
+    using ofxHeadlessFbo::drawPoint;
+    using ofxHeadlessFbo::drawLine;
+    using ofxHeadlessFbo::drawRectangle;
+    using ofxHeadlessFbo::drawSquare;
+    using ofxHeadlessFbo::drawSquareCentered;
+    using ofxHeadlessFbo::drawTriangle;
+    using ofxHeadlessFbo::drawCircle;
+    using ofxHeadlessFbo::drawRectRounded;
+    using ofxHeadlessFbo::drawEllipse;
+    using ofxHeadlessFbo::drawMesh;
+    using ofxHeadlessFbo::floodFill;
+    using ofxHeadlessFbo::fillWith;
+
+    using ofxHeadlessFbo::getStats;
+    using ofxHeadlessFbo::resetStats;
+    using ofxHeadlessFbo::setShapeCacheSize;
+    using ofxHeadlessFbo::getShapeCacheSize;
+
+    private:
+    ofxHeadlessFbo *canvas = nullptr;
+    size_t clipX = 0;
+    size_t clipY = 0;
+    float userTranslateX = 0;
+    float userTranslateY = 0;
+};
@@ -0,0 +1,513 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboFramebuffer.h"
+
+#ifndef TARGET_WIN32
+
+#include "ofFileUtils.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef TARGET_LINUX
+#include <linux/fb.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace {
+
+size_t bytesPerPixel(ofxHeadlessFboOutputFormat format) {
+    return format == OFX_HEADLESS_FBO_OUTPUT_RGB565 ? 2 : 4;
+}
+
+bool isSupportedSource(ofPixelFormat format) {
+    switch (format) {
+        case OF_PIXELS_RGB:
+        case OF_PIXELS_BGR:
+        case OF_PIXELS_RGBA:
+        case OF_PIXELS_BGRA:
+        case OF_PIXELS_GRAY:
+        case OF_PIXELS_GRAY_ALPHA:
+        case OF_PIXELS_RGB565:
+            return true;
+        default:
+            return false;
+    }
+}
+
+template <int SrcFormat>
+constexpr size_t sourceChannels() {
+    return SrcFormat == OF_PIXELS_GRAY                                           ? 1
+           : SrcFormat == OF_PIXELS_GRAY_ALPHA || SrcFormat == OF_PIXELS_RGB565 ? 2
+           : SrcFormat == OF_PIXELS_RGB || SrcFormat == OF_PIXELS_BGR ? 3
+                                               : 4;
+}
+
+// the switches only depend on template arguments and are folded away
+template <int SrcFormat>
+inline void loadPixel(const unsigned char *p, unsigned char &r, unsigned char &g, unsigned char &b,
+                      unsigned char &a) {
+    switch (SrcFormat) {
+        case OF_PIXELS_RGB:
+            r = p[0], g = p[1], b = p[2], a = 255;
+            break;
+        case OF_PIXELS_BGR:
+            r = p[2], g = p[1], b = p[0], a = 255;
+            break;
+        case OF_PIXELS_RGBA:
+            r = p[0], g = p[1], b = p[2], a = p[3];
+            break;
+        case OF_PIXELS_BGRA:
+            r = p[2], g = p[1], b = p[0], a = p[3];
+            break;
+        case OF_PIXELS_GRAY:
+            r = g = b = p[0], a = 255;
+            break;
+        case OF_PIXELS_RGB565:
+            {
+                uint16_t v;
+                std::memcpy(&v, p, 2);
+                r = static_cast<unsigned char>(((v >> 11) << 3) | (v >> 13));
+                g = static_cast<unsigned char>((((v >> 5) & 0x3F) << 2) | ((v >> 9) & 0x03));
+                b = static_cast<unsigned char>(((v & 0x1F) << 3) | ((v >> 2) & 0x07));
+                a = 255;
+                break;
+            }
+        default:
+            r = g = b = p[0], a = p[1];
+            break;
+    }
+}
+
+template <int DstFormat>
+inline void storePixel(unsigned char *p, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    switch (DstFormat) {
+        case OFX_HEADLESS_FBO_OUTPUT_RGB565:
+            {
+                const unsigned int v = ((r & 0xF8u) << 8) | ((g & 0xFCu) << 3) | (b >> 3);
+                p[0] = static_cast<unsigned char>(v);
+                p[1] = static_cast<unsigned char>(v >> 8);
+                break;
+            }
+        case OFX_HEADLESS_FBO_OUTPUT_XRGB8888:
+            p[0] = b, p[1] = g, p[2] = r, p[3] = 255;
+            break;
+        default:
+            p[0] = b, p[1] = g, p[2] = r, p[3] = a;
+            break;
+    }
+}
+
+template <int SrcFormat, int DstFormat>
+void convertRow(const unsigned char *src, unsigned char *dst, size_t n) {
+    constexpr size_t srcBytes = sourceChannels<SrcFormat>();
+    constexpr size_t dstBytes = DstFormat == OFX_HEADLESS_FBO_OUTPUT_RGB565 ? 2 : 4;
+    unsigned char r, g, b, a;
+    for (size_t i = 0; i < n; ++i) {
+        loadPixel<SrcFormat>(src, r, g, b, a);
+        storePixel<DstFormat>(dst, r, g, b, a);
+        src += srcBytes;
+        dst += dstBytes;
+    }
+}
+
+template <int SrcFormat>
+void convertRow(const unsigned char *src, unsigned char *dst, size_t n, ofxHeadlessFboOutputFormat format) {
+    switch (format) {
+        case OFX_HEADLESS_FBO_OUTPUT_RGB565:
+            convertRow<SrcFormat, OFX_HEADLESS_FBO_OUTPUT_RGB565>(src, dst, n);
+            break;
+        case OFX_HEADLESS_FBO_OUTPUT_XRGB8888:
+            convertRow<SrcFormat, OFX_HEADLESS_FBO_OUTPUT_XRGB8888>(src, dst, n);
+            break;
+        case OFX_HEADLESS_FBO_OUTPUT_BGRA8888:
+            convertRow<SrcFormat, OFX_HEADLESS_FBO_OUTPUT_BGRA8888>(src, dst, n);
+            break;
+    }
+}
+
+void convertRow(const unsigned char *src, ofPixelFormat srcFormat, unsigned char *dst,
+                ofxHeadlessFboOutputFormat format, size_t n) {
+    switch (srcFormat) {
+        case OF_PIXELS_RGB:
+            convertRow<OF_PIXELS_RGB>(src, dst, n, format);
+            break;
+        case OF_PIXELS_BGR:
+            convertRow<OF_PIXELS_BGR>(src, dst, n, format);
+            break;
+        case OF_PIXELS_RGBA:
+            convertRow<OF_PIXELS_RGBA>(src, dst, n, format);
+            break;
+        case OF_PIXELS_BGRA:
+            if (format == OFX_HEADLESS_FBO_OUTPUT_BGRA8888) {
+                std::memcpy(dst, src, n * 4);
+            } else {
+                convertRow<OF_PIXELS_BGRA>(src, dst, n, format);
+            }
+            break;
+        case OF_PIXELS_GRAY:
+            convertRow<OF_PIXELS_GRAY>(src, dst, n, format);
+            break;
+        case OF_PIXELS_GRAY_ALPHA:
+            convertRow<OF_PIXELS_GRAY_ALPHA>(src, dst, n, format);
+            break;
+        case OF_PIXELS_RGB565:
+            if (format == OFX_HEADLESS_FBO_OUTPUT_RGB565) {
+                std::memcpy(dst, src, n * 2);
+            } else {
+                convertRow<OF_PIXELS_RGB565>(src, dst, n, format);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool growDescriptor(int fd, size_t size) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+    if (static_cast<size_t>(info.st_size) >= size) {
+        return true;
+    }
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+}
+
+} // namespace
+
+//--------------------------------------------------------------
+bool ofxHeadlessFboFramebuffer::Region::isEmpty() const {
+    return x2 <= x1 || y2 <= y1;
+}
+
+void ofxHeadlessFboFramebuffer::Region::add(const Region &other) {
+    if (other.isEmpty()) {
+        return;
+    }
+    if (isEmpty()) {
+        *this = other;
+        return;
+    }
+    x1 = std::min(x1, other.x1);
+    y1 = std::min(y1, other.y1);
+    x2 = std::max(x2, other.x2);
+    y2 = std::max(y2, other.y2);
+}
+
+//--------------------------------------------------------------
+ofxHeadlessFboFramebuffer::~ofxHeadlessFboFramebuffer() {
+    close();
+}
+
+bool ofxHeadlessFboFramebuffer::openDevice(const std::string &path, bool doubleBuffer) {
+    close();
+#ifdef TARGET_LINUX
+    const int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        ofLogError("ofxHeadlessFboFramebuffer") << "openDevice(): couldn't open " << path;
+        return false;
+    }
+
+    fb_var_screeninfo var;
+    fb_fix_screeninfo fix;
+    if (ioctl(fd, FBIOGET_VSCREENINFO, &var) != 0 || ioctl(fd, FBIOGET_FSCREENINFO, &fix) != 0) {
+        ofLogError("ofxHeadlessFboFramebuffer") << "openDevice(): " << path << " is not a framebuffer device";
+        ::close(fd);
+        return false;
+    }
+
+    ofxHeadlessFboOutputFormat deviceFormat;
+    if (var.bits_per_pixel == 16 && var.red.offset == 11 && var.green.offset == 5 && var.blue.offset == 0) {
+        deviceFormat = OFX_HEADLESS_FBO_OUTPUT_RGB565;
+    } else if (var.bits_per_pixel == 32 && var.red.offset == 16 && var.green.offset == 8 && var.blue.offset == 0) {
+        deviceFormat = var.transp.length > 0 ? OFX_HEADLESS_FBO_OUTPUT_BGRA8888 : OFX_HEADLESS_FBO_OUTPUT_XRGB8888;
+    } else {
+        ofLogError("ofxHeadlessFboFramebuffer") << "openDevice(): unsupported pixel layout, " << var.bits_per_pixel
+                                                << " bits per pixel";
+        ::close(fd);
+        return false;
+    }
+
+    size_t buffers = 1;
+    if (doubleBuffer) {
+        if (var.yres_virtual < var.yres * 2) {
+            fb_var_screeninfo wanted = var;
+            wanted.yres_virtual = var.yres * 2;
+            if (ioctl(fd, FBIOPUT_VSCREENINFO, &wanted) == 0) {
+                ioctl(fd, FBIOGET_VSCREENINFO, &var);
+                ioctl(fd, FBIOGET_FSCREENINFO, &fix);
+            }
+        }
+        if (var.yres_virtual >= var.yres * 2 && fix.ypanstep != 0 &&
+            fix.smem_len >= static_cast<size_t>(fix.line_length) * var.yres * 2) {
+            buffers = 2;
+        } else {
+            ofLogWarning("ofxHeadlessFboFramebuffer") << "openDevice(): " << path
+                                                      << " can't pan, using a single buffer";
+        }
+    }
+
+    if (!setLayout(var.xres, var.yres, deviceFormat, fix.line_length) ||
+        !mapDescriptor(fd, std::max<size_t>(fix.smem_len, static_cast<size_t>(fix.line_length) * var.yres), path)) {
+        ::close(fd);
+        close();
+        return false;
+    }
+    device = fd;
+    numBuffers = buffers;
+    front = buffers == 2 && var.yoffset >= var.yres ? 1 : 0;
+    return true;
+#else
+    ofLogError("ofxHeadlessFboFramebuffer") << "openDevice(): framebuffer devices are only supported on Linux";
+    return false;
+#endif
+}
+
+bool ofxHeadlessFboFramebuffer::openFile(const std::string &path, size_t w, size_t h,
+                                         ofxHeadlessFboOutputFormat format, size_t stride) {
+    close();
+    if (!setLayout(w, h, format, stride)) {
+        return false;
+    }
+
+    const int fd = ::open(ofToDataPath(path, true).c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        ofLogError("ofxHeadlessFboFramebuffer") << "openFile(): couldn't open " << path;
+        close();
+        return false;
+    }
+    const bool mappedFile = growDescriptor(fd, this->stride * h) && mapDescriptor(fd, this->stride * h, path);
+    ::close(fd);
+    if (!mappedFile) {
+        close();
+    }
+    return mappedFile;
+}
+
+bool ofxHeadlessFboFramebuffer::openSharedMemory(const std::string &name, size_t w, size_t h,
+                                                 ofxHeadlessFboOutputFormat format, size_t stride) {
+    close();
+    if (!setLayout(w, h, format, stride)) {
+        return false;
+    }
+
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        ofLogError("ofxHeadlessFboFramebuffer") << "openSharedMemory(): couldn't open " << name;
+        close();
+        return false;
+    }
+    const bool mappedSegment = growDescriptor(fd, this->stride * h) && mapDescriptor(fd, this->stride * h, name);
+    ::close(fd);
+    if (!mappedSegment) {
+        close();
+    }
+    return mappedSegment;
+}
+
+bool ofxHeadlessFboFramebuffer::setLayout(size_t w, size_t h, ofxHeadlessFboOutputFormat format, size_t stride) {
+    const size_t rowBytes = w * bytesPerPixel(format);
+    if (w == 0 || h == 0 || (stride != 0 && stride < rowBytes)) {
+        ofLogError("ofxHeadlessFboFramebuffer") << "invalid layout " << w << "x" << h << ", stride " << stride;
+        return false;
+    }
+    this->w = w;
+    this->h = h;
+    this->format = format;
+    this->stride = stride == 0 ? rowBytes : stride;
+    return true;
+}
+
+bool ofxHeadlessFboFramebuffer::mapDescriptor(int fd, size_t size, const std::string &name) {
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        ofLogError("ofxHeadlessFboFramebuffer") << "couldn't map " << size << " bytes of " << name;
+        return false;
+    }
+    mapped = static_cast<unsigned char *>(address);
+    mappedSize = size;
+    return true;
+}
+
+void ofxHeadlessFboFramebuffer::close() {
+    if (mapped != nullptr) {
+        munmap(mapped, mappedSize);
+    }
+    if (device >= 0) {
+        ::close(device);
+    }
+    mapped = nullptr;
+    mappedSize = 0;
+    device = -1;
+    w = 0;
+    h = 0;
+    stride = 0;
+    numBuffers = 1;
+    front = 0;
+    source = nullptr;
+    invalidate();
+}
+
+bool ofxHeadlessFboFramebuffer::isOpen() const {
+    return mapped != nullptr;
+}
+
+void ofxHeadlessFboFramebuffer::invalidate() {
+    for (size_t i = 0; i < 2; ++i) {
+        stale[i] = true;
+        pending[i] = Region();
+    }
+}
+
+void ofxHeadlessFboFramebuffer::present(ofxHeadlessFbo &fbo, size_t x, size_t y) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("framebufferPresent");
+    if (mapped == nullptr || !fbo.isAllocated()) {
+        return;
+    }
+    if (!isSupportedSource(fbo.getPixelFormat())) {
+        ofLogWarning("ofxHeadlessFboFramebuffer") << "present(): unsupported pixel format";
+        return;
+    }
+
+    if (&fbo != source || fbo.getWidth() != sourceW || fbo.getHeight() != sourceH ||
+        fbo.getPixelFormat() != sourceFormat || x != sourceX || y != sourceY) {
+        source = &fbo;
+        sourceW = fbo.getWidth();
+        sourceH = fbo.getHeight();
+        sourceFormat = fbo.getPixelFormat();
+        sourceX = x;
+        sourceY = y;
+        invalidate();
+    }
+
+    // tracked per output, the dirty region of the buffer stays with its owner
+    const ofRectangle dirtyRect = fbo.getDirtyRegionSince(presentedVersion);
+    presentedVersion = fbo.getVersion();
+    Region dirty;
+    dirty.x1 = static_cast<size_t>(dirtyRect.x);
+    dirty.y1 = static_cast<size_t>(dirtyRect.y);
+    dirty.x2 = dirty.x1 + static_cast<size_t>(dirtyRect.width);
+    dirty.y2 = dirty.y1 + static_cast<size_t>(dirtyRect.height);
+    for (size_t i = 0; i < numBuffers; ++i) {
+        pending[i].add(dirty);
+    }
+
+    // with two buffers the hidden one also misses the changes shown last frame
+    const size_t target = numBuffers == 2 ? 1 - front : front;
+    Region region = pending[target];
+    if (stale[target]) {
+        region.x1 = 0;
+        region.y1 = 0;
+        region.x2 = sourceW;
+        region.y2 = sourceH;
+    }
+    pending[target] = Region();
+    stale[target] = false;
+
+    if (x >= w || y >= h) {
+        return;
+    }
+    region.x2 = std::min(region.x2, w - x);
+    region.y2 = std::min(region.y2, h - y);
+    if (region.isEmpty()) {
+        return;
+    }
+
+    copyRegion(fbo, mapped + target * h * stride, region, x, y);
+    if (numBuffers == 2) {
+        pan(target);
+    }
+}
+
+void ofxHeadlessFboFramebuffer::copyRegion(const ofxHeadlessFbo &fbo, unsigned char *target, const Region &region,
+                                           size_t x, size_t y) {
+    // 1 bit, indexed, 16 bit and float buffers are read through their 8 bit pixels
+    const ofxHeadlessFboPackedFormat packedFormat = fbo.getPackedFormat();
+    const bool expanded = packedFormat == OFX_HEADLESS_FBO_PACKED_MONO1 ||
+                          packedFormat == OFX_HEADLESS_FBO_PACKED_INDEXED8 ||
+                          fbo.getPrecision() != OFX_HEADLESS_FBO_PRECISION_8;
+    const unsigned char *base = expanded ? fbo.getPixels().getData() : fbo.getData();
+    const size_t srcStride = expanded ? fbo.getWidth() * fbo.getNumChannels() : fbo.getStride();
+
+    const unsigned char *src = base + region.y1 * srcStride + region.x1 * fbo.getNumChannels();
+    unsigned char *dst = target + (y + region.y1) * stride + (x + region.x1) * bytesPerPixel(format);
+    const size_t n = region.x2 - region.x1;
+    for (size_t row = region.y1; row < region.y2; ++row) {
+        convertRow(src, fbo.getPixelFormat(), dst, format, n);
+        src += srcStride;
+        dst += stride;
+    }
+}
+
+void ofxHeadlessFboFramebuffer::pan(size_t buffer) {
+#ifdef TARGET_LINUX
+    fb_var_screeninfo var;
+    if (ioctl(device, FBIOGET_VSCREENINFO, &var) == 0) {
+        var.xoffset = 0;
+        var.yoffset = static_cast<uint32_t>(buffer * h);
+        if (ioctl(device, FBIOPAN_DISPLAY, &var) == 0) {
+            front = buffer;
+            return;
+        }
+    }
+    ofLogWarning("ofxHeadlessFboFramebuffer") << "present(): panning failed, using a single buffer";
+    numBuffers = 1;
+    stale[front] = true;
+#endif
+}
+
+size_t ofxHeadlessFboFramebuffer::getWidth() const {
+    return w;
+}
+
+size_t ofxHeadlessFboFramebuffer::getHeight() const {
+    return h;
+}
+
+size_t ofxHeadlessFboFramebuffer::getStride() const {
+    return stride;
+}
+
+ofxHeadlessFboOutputFormat ofxHeadlessFboFramebuffer::getFormat() const {
+    return format;
+}
+
+bool ofxHeadlessFboFramebuffer::isDoubleBuffered() const {
+    return numBuffers == 2;
+}
+
+unsigned char *ofxHeadlessFboFramebuffer::getData() {
+    return mapped == nullptr ? nullptr : mapped + front * h * stride;
+}
+
+#endif
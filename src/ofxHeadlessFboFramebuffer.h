@@ -0,0 +1,154 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofConstants.h"
+#include "ofxHeadlessFbo.h"
+#include <string>
+
+/// @file
+/// Output of ofxHeadlessFbo frames into a memory mapped framebuffer: a Linux
+/// fbdev device like /dev/fb0, a POSIX shared memory segment or a regular
+/// file. Only the rows and columns that changed since the last frame are
+/// converted and copied.
+///
+/// Not available on Windows.
+
+#ifndef TARGET_WIN32
+
+enum ofxHeadlessFboOutputFormat {
+    /// 16 bit words, 5 bits red, 6 bits green, 5 bits blue.
+    OFX_HEADLESS_FBO_OUTPUT_RGB565,
+    /// 32 bit words with an unused alpha byte, B,G,R,X in memory.
+    OFX_HEADLESS_FBO_OUTPUT_XRGB8888,
+    /// 32 bit words with alpha, B,G,R,A in memory.
+    OFX_HEADLESS_FBO_OUTPUT_BGRA8888,
+};
+
+class ofxHeadlessFboFramebuffer {
+    public:
+    ~ofxHeadlessFboFramebuffer();
+
+    /// @brief Maps a framebuffer device, Linux only.
+    ///
+    /// Size, stride and pixel format are taken from the device. With double
+    /// buffering frames are written into the hidden half of the virtual
+    /// screen and shown by panning, without waiting for vsync. Falls back to
+    /// a single buffer when the driver can't pan.
+    ///
+    /// ~~~~{.cpp}
+    /// fb.openDevice("/dev/fb0", true);
+    /// // every frame
+    /// fb.present(hfbo);
+    /// ~~~~
+    bool openDevice(const std::string &device = "/dev/fb0", bool doubleBuffer = false);
+
+    /// @brief Maps a regular file, created or grown to fit the frame.
+    ///
+    /// @param path File to write, relative paths are resolved in the data folder
+    /// @param w Width of the target in pixels
+    /// @param h Height of the target in pixels
+    /// @param format Pixel layout of the target
+    /// @param stride Distance between two rows in bytes, 0 for tightly packed rows
+    bool openFile(const std::string &path, size_t w, size_t h, ofxHeadlessFboOutputFormat format, size_t stride = 0);
+
+    /// @brief Maps a POSIX shared memory segment, created when it doesn't exist.
+    ///
+    /// ~~~~{.cpp}
+    /// fb.openSharedMemory("/leds", 800, 300, OFX_HEADLESS_FBO_OUTPUT_XRGB8888);
+    /// ~~~~
+    bool openSharedMemory(const std::string &name, size_t w, size_t h, ofxHeadlessFboOutputFormat format,
+                          size_t stride = 0);
+
+    void close();
+    bool isOpen() const;
+
+    /// @brief Converts the changed part of the buffer into the target.
+    ///
+    /// Only copies what changed since the last present() of this output,
+    /// the first frame and frames after the buffer or position changed are
+    /// copied completely. The dirty region of the buffer is left alone, so
+    /// several outputs can show the same buffer.
+    /// Parts outside of the target are clipped.
+    ///
+    /// @param fbo Buffer to show, any 8 bit per channel or packed format
+    /// @param x Horizontal position in the target
+    /// @param y Vertical position in the target
+    void present(ofxHeadlessFbo &fbo, size_t x = 0, size_t y = 0);
+
+    /// @brief Copy the whole buffer on the next present().
+    void invalidate();
+
+    size_t getWidth() const;
+    size_t getHeight() const;
+    size_t getStride() const;
+    ofxHeadlessFboOutputFormat getFormat() const;
+    bool isDoubleBuffered() const;
+
+    /// @brief Pointer to the first row of the visible buffer.
+    unsigned char *getData();
+
+    private:
+    struct Region {
+        size_t x1 = 0;
+        size_t y1 = 0;
+        size_t x2 = 0;
+        size_t y2 = 0;
+        bool isEmpty() const;
+        void add(const Region &other);
+    };
+
+    bool mapDescriptor(int fd, size_t size, const std::string &name);
+    bool setLayout(size_t w, size_t h, ofxHeadlessFboOutputFormat format, size_t stride);
+    void copyRegion(const ofxHeadlessFbo &fbo, unsigned char *target, const Region &region, size_t x, size_t y);
+    void pan(size_t buffer);
+
+    unsigned char *mapped = nullptr;
+    size_t mappedSize = 0;
+    int device = -1;
+    size_t w = 0;
+    size_t h = 0;
+    size_t stride = 0;
+    ofxHeadlessFboOutputFormat format = OFX_HEADLESS_FBO_OUTPUT_XRGB8888;
+
+    // one entry per buffer, the second one is only used with double buffering
+    size_t numBuffers = 1;
+    size_t front = 0;
+    bool stale[2] = {true, true};
+    Region pending[2];
+
+    const ofxHeadlessFbo *source = nullptr;
+    uint64_t presentedVersion = 0;
+    size_t sourceW = 0;
+    size_t sourceH = 0;
+    ofPixelFormat sourceFormat = OF_PIXELS_UNKNOWN;
+    size_t sourceX = 0;
+    size_t sourceY = 0;
+};
+
+#endif
@@ -0,0 +1,464 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboGenerator.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OFX_HEADLESS_FBO_GENERATOR_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define OFX_HEADLESS_FBO_GENERATOR_NEON
+#endif
+
+namespace {
+
+// Four lanes of floats and of 32 bit integers, integer math wraps around.
+// Comparisons return masks with all bits of a lane set or clear.
+#if defined(OFX_HEADLESS_FBO_GENERATOR_SSE2)
+struct F4 {
+    __m128 v;
+};
+struct I4 {
+    __m128i v;
+};
+
+inline F4 splat(float a) { return {_mm_set1_ps(a)}; }
+inline I4 splatInt(int32_t a) { return {_mm_set1_epi32(a)}; }
+inline F4 ramp(float a) { return {_mm_setr_ps(a, a + 1, a + 2, a + 3)}; }
+inline F4 operator+(F4 a, F4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline F4 operator-(F4 a, F4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline F4 operator*(F4 a, F4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline F4 minOf(F4 a, F4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline F4 maxOf(F4 a, F4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline F4 sqrtOf(F4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline F4 absOf(F4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline I4 truncate(F4 a) { return {_mm_cvttps_epi32(a.v)}; }
+inline F4 toFloat(I4 a) { return {_mm_cvtepi32_ps(a.v)}; }
+inline F4 floorOf(F4 a) {
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return {_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)))};
+}
+inline I4 greaterEqual(F4 a, F4 b) { return {_mm_castps_si128(_mm_cmpge_ps(a.v, b.v))}; }
+inline F4 select(I4 mask, F4 a, F4 b) {
+    const __m128 m = _mm_castsi128_ps(mask.v);
+    return {_mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v))};
+}
+inline F4 flipSign(F4 a, I4 signBits) { return {_mm_xor_ps(a.v, _mm_castsi128_ps(signBits.v))}; }
+inline I4 operator+(I4 a, I4 b) { return {_mm_add_epi32(a.v, b.v)}; }
+inline I4 operator^(I4 a, I4 b) { return {_mm_xor_si128(a.v, b.v)}; }
+inline I4 operator&(I4 a, I4 b) { return {_mm_and_si128(a.v, b.v)}; }
+inline I4 operator|(I4 a, I4 b) { return {_mm_or_si128(a.v, b.v)}; }
+inline I4 andNot(I4 a, I4 b) { return {_mm_andnot_si128(a.v, b.v)}; }
+inline I4 operator*(I4 a, I4 b) {
+    // SSE2 has no 32 bit multiply, even and odd lanes are multiplied to 64 bits
+    const __m128i even = _mm_mul_epu32(a.v, b.v);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+    return {_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                               _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)))};
+}
+template <int n>
+inline I4 shiftLeft(I4 a) { return {_mm_slli_epi32(a.v, n)}; }
+template <int n>
+inline I4 shiftRight(I4 a) { return {_mm_srli_epi32(a.v, n)}; }
+inline I4 equal(I4 a, I4 b) { return {_mm_cmpeq_epi32(a.v, b.v)}; }
+inline I4 lessThan(I4 a, I4 b) { return {_mm_cmplt_epi32(a.v, b.v)}; }
+inline void store(I4 a, int32_t *out) { _mm_storeu_si128(reinterpret_cast<__m128i *>(out), a.v); }
+#elif defined(OFX_HEADLESS_FBO_GENERATOR_NEON)
+struct F4 {
+    float32x4_t v;
+};
+struct I4 {
+    int32x4_t v;
+};
+
+inline F4 splat(float a) { return {vdupq_n_f32(a)}; }
+inline I4 splatInt(int32_t a) { return {vdupq_n_s32(a)}; }
+inline F4 ramp(float a) {
+    const float lanes[4] = {a, a + 1, a + 2, a + 3};
+    return {vld1q_f32(lanes)};
+}
+inline F4 operator+(F4 a, F4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline F4 operator-(F4 a, F4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline F4 operator*(F4 a, F4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline F4 minOf(F4 a, F4 b) { return {vminq_f32(a.v, b.v)}; }
+inline F4 maxOf(F4 a, F4 b) { return {vmaxq_f32(a.v, b.v)}; }
+inline F4 sqrtOf(F4 a) { return {vsqrtq_f32(a.v)}; }
+inline F4 absOf(F4 a) { return {vabsq_f32(a.v)}; }
+inline I4 truncate(F4 a) { return {vcvtq_s32_f32(a.v)}; }
+inline F4 toFloat(I4 a) { return {vcvtq_f32_s32(a.v)}; }
+inline F4 floorOf(F4 a) { return {vrndmq_f32(a.v)}; }
+inline I4 greaterEqual(F4 a, F4 b) { return {vreinterpretq_s32_u32(vcgeq_f32(a.v, b.v))}; }
+inline F4 select(I4 mask, F4 a, F4 b) { return {vbslq_f32(vreinterpretq_u32_s32(mask.v), a.v, b.v)}; }
+inline F4 flipSign(F4 a, I4 signBits) {
+    return {vreinterpretq_f32_s32(veorq_s32(vreinterpretq_s32_f32(a.v), signBits.v))};
+}
+inline I4 operator+(I4 a, I4 b) { return {vaddq_s32(a.v, b.v)}; }
+inline I4 operator^(I4 a, I4 b) { return {veorq_s32(a.v, b.v)}; }
+inline I4 operator&(I4 a, I4 b) { return {vandq_s32(a.v, b.v)}; }
+inline I4 operator|(I4 a, I4 b) { return {vorrq_s32(a.v, b.v)}; }
+inline I4 andNot(I4 a, I4 b) { return {vbicq_s32(b.v, a.v)}; }
+inline I4 operator*(I4 a, I4 b) { return {vmulq_s32(a.v, b.v)}; }
+template <int n>
+inline I4 shiftLeft(I4 a) { return {vshlq_n_s32(a.v, n)}; }
+template <int n>
+inline I4 shiftRight(I4 a) { return {vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a.v), n))}; }
+inline I4 equal(I4 a, I4 b) { return {vreinterpretq_s32_u32(vceqq_s32(a.v, b.v))}; }
+inline I4 lessThan(I4 a, I4 b) { return {vreinterpretq_s32_u32(vcltq_s32(a.v, b.v))}; }
+inline void store(I4 a, int32_t *out) { vst1q_s32(out, a.v); }
+#else
+struct F4 {
+    float v[4];
+};
+struct I4 {
+    uint32_t v[4];
+};
+
+template <typename Function>
+inline F4 mapFloat(Function function) {
+    F4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = function(i);
+    }
+    return r;
+}
+
+template <typename Function>
+inline I4 mapInt(Function function) {
+    I4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = static_cast<uint32_t>(function(i));
+    }
+    return r;
+}
+
+inline uint32_t maskOf(bool b) { return b ? 0xffffffffu : 0; }
+
+inline F4 splat(float a) { return mapFloat([&](int) { return a; }); }
+inline I4 splatInt(int32_t a) { return mapInt([&](int) { return a; }); }
+inline F4 ramp(float a) { return mapFloat([&](int i) { return a + i; }); }
+inline F4 operator+(F4 a, F4 b) { return mapFloat([&](int i) { return a.v[i] + b.v[i]; }); }
+inline F4 operator-(F4 a, F4 b) { return mapFloat([&](int i) { return a.v[i] - b.v[i]; }); }
+inline F4 operator*(F4 a, F4 b) { return mapFloat([&](int i) { return a.v[i] * b.v[i]; }); }
+inline F4 minOf(F4 a, F4 b) { return mapFloat([&](int i) { return std::min(a.v[i], b.v[i]); }); }
+inline F4 maxOf(F4 a, F4 b) { return mapFloat([&](int i) { return std::max(a.v[i], b.v[i]); }); }
+inline F4 sqrtOf(F4 a) { return mapFloat([&](int i) { return std::sqrt(a.v[i]); }); }
+inline F4 absOf(F4 a) { return mapFloat([&](int i) { return std::fabs(a.v[i]); }); }
+inline I4 truncate(F4 a) { return mapInt([&](int i) { return static_cast<int32_t>(a.v[i]); }); }
+inline F4 toFloat(I4 a) { return mapFloat([&](int i) { return static_cast<float>(static_cast<int32_t>(a.v[i])); }); }
+inline F4 floorOf(F4 a) { return mapFloat([&](int i) { return std::floor(a.v[i]); }); }
+inline I4 greaterEqual(F4 a, F4 b) { return mapInt([&](int i) { return maskOf(a.v[i] >= b.v[i]); }); }
+inline F4 select(I4 mask, F4 a, F4 b) { return mapFloat([&](int i) { return mask.v[i] ? a.v[i] : b.v[i]; }); }
+inline F4 flipSign(F4 a, I4 signBits) {
+    return mapFloat([&](int i) { return signBits.v[i] & 0x80000000u ? -a.v[i] : a.v[i]; });
+}
+inline I4 operator+(I4 a, I4 b) { return mapInt([&](int i) { return a.v[i] + b.v[i]; }); }
+inline I4 operator^(I4 a, I4 b) { return mapInt([&](int i) { return a.v[i] ^ b.v[i]; }); }
+inline I4 operator&(I4 a, I4 b) { return mapInt([&](int i) { return a.v[i] & b.v[i]; }); }
+inline I4 operator|(I4 a, I4 b) { return mapInt([&](int i) { return a.v[i] | b.v[i]; }); }
+inline I4 andNot(I4 a, I4 b) { return mapInt([&](int i) { return ~a.v[i] & b.v[i]; }); }
+inline I4 operator*(I4 a, I4 b) { return mapInt([&](int i) { return a.v[i] * b.v[i]; }); }
+template <int n>
+inline I4 shiftLeft(I4 a) { return mapInt([&](int i) { return a.v[i] << n; }); }
+template <int n>
+inline I4 shiftRight(I4 a) { return mapInt([&](int i) { return a.v[i] >> n; }); }
+inline I4 equal(I4 a, I4 b) { return mapInt([&](int i) { return maskOf(a.v[i] == b.v[i]); }); }
+inline I4 lessThan(I4 a, I4 b) {
+    return mapInt([&](int i) { return maskOf(static_cast<int32_t>(a.v[i]) < static_cast<int32_t>(b.v[i])); });
+}
+inline void store(I4 a, int32_t *out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<int32_t>(a.v[i]);
+    }
+}
+#endif
+
+// sin(2 pi x), a parabola refined once, within 0.001
+inline F4 sinTurns(F4 x) {
+    const F4 r = x - floorOf(x + splat(0.5f));
+    const F4 y = splat(8.0f) * r - splat(16.0f) * r * absOf(r);
+    return splat(0.225f) * (y * absOf(y) - y) + y;
+}
+
+// lattice coordinates are multiplied by a constant per axis, so a neighbour
+// is one add away, and the xor of the three is mixed into a hash
+const int32_t primeX = static_cast<int32_t>(0x8da6b343u);
+const int32_t primeY = static_cast<int32_t>(0xd8163841u);
+const int32_t primeZ = static_cast<int32_t>(0xcb1ab31fu);
+
+inline I4 hash(I4 hx, I4 hy, I4 hz) {
+    I4 h = hx ^ hy ^ hz;
+    h = h ^ shiftRight<15>(h);
+    h = h * splatInt(0x2c1b3c6d);
+    h = h ^ shiftRight<12>(h);
+    h = h * splatInt(0x297a2d39);
+    return h ^ shiftRight<15>(h);
+}
+
+inline F4 lerp(F4 a, F4 b, F4 t) {
+    return a + (b - a) * t;
+}
+
+// random values on the lattice, blended with a smoothstep, in [0, 1)
+F4 valueNoiseAt(F4 x, F4 y, F4 z) {
+    const F4 fx = floorOf(x);
+    const F4 fy = floorOf(y);
+    const F4 fz = floorOf(z);
+    const I4 x0 = truncate(fx) * splatInt(primeX);
+    const I4 y0 = truncate(fy) * splatInt(primeY);
+    const I4 z0 = truncate(fz) * splatInt(primeZ);
+    const I4 x1 = x0 + splatInt(primeX);
+    const I4 y1 = y0 + splatInt(primeY);
+    const I4 z1 = z0 + splatInt(primeZ);
+
+    auto smooth = [](F4 t) { return t * t * (splat(3.0f) - splat(2.0f) * t); };
+    const F4 ux = smooth(x - fx);
+    const F4 uy = smooth(y - fy);
+    const F4 uz = smooth(z - fz);
+    auto corner = [](I4 hx, I4 hy, I4 hz) {
+        return toFloat(shiftRight<8>(hash(hx, hy, hz))) * splat(1.0f / 16777216.0f);
+    };
+    const F4 near = lerp(lerp(corner(x0, y0, z0), corner(x1, y0, z0), ux),
+                         lerp(corner(x0, y1, z0), corner(x1, y1, z0), ux), uy);
+    const F4 far = lerp(lerp(corner(x0, y0, z1), corner(x1, y0, z1), ux),
+                        lerp(corner(x0, y1, z1), corner(x1, y1, z1), ux), uy);
+    return lerp(near, far, uz);
+}
+
+// one corner of a simplex, the gradient is one of the 12 edges of a cube
+inline F4 simplexCorner(I4 h, F4 x, F4 y, F4 z) {
+    const F4 t = maxOf(splat(0.5f) - x * x - y * y - z * z, splat(0.0f));
+    const I4 g = shiftRight<28>(h);
+    const F4 u = select(lessThan(g, splatInt(8)), x, y);
+    const I4 useX = equal(g, splatInt(12)) | equal(g, splatInt(14));
+    const F4 v = select(lessThan(g, splatInt(4)), y, select(useX, x, z));
+    const I4 signBit = splatInt(static_cast<int32_t>(0x80000000u));
+    const F4 dot = flipSign(u, shiftLeft<31>(g)) + flipSign(v, shiftLeft<30>(g) & signBit);
+    const F4 t2 = t * t;
+    return t2 * t2 * dot;
+}
+
+// scales the sum of the corners to about [-0.5, 0.5]
+const float simplexRange = 38.0f;
+
+// 3D simplex noise, in [0, 1]
+F4 simplexNoiseAt(F4 x, F4 y, F4 z) {
+    const float skew = 1.0f / 3.0f;
+    const float unskew = 1.0f / 6.0f;
+    const F4 s = (x + y + z) * splat(skew);
+    const F4 fi = floorOf(x + s);
+    const F4 fj = floorOf(y + s);
+    const F4 fk = floorOf(z + s);
+    const F4 t = (fi + fj + fk) * splat(unskew);
+    const F4 x0 = x - fi + t;
+    const F4 y0 = y - fj + t;
+    const F4 z0 = z - fk + t;
+
+    // the simplex the point is in, from the order of x0, y0 and z0
+    const I4 xy = greaterEqual(x0, y0);
+    const I4 yz = greaterEqual(y0, z0);
+    const I4 xz = greaterEqual(x0, z0);
+    const I4 all = splatInt(-1);
+    const I4 i1 = xy & xz;
+    const I4 j1 = andNot(xy, yz);
+    const I4 k1 = andNot(xz | yz, all);
+    const I4 i2 = xy | xz;
+    const I4 j2 = andNot(xy, all) | yz;
+    const I4 k2 = andNot(xz & yz, all);
+
+    const F4 one = splat(1.0f);
+    const F4 zero = splat(0.0f);
+    const F4 x1 = x0 - select(i1, one, zero) + splat(unskew);
+    const F4 y1 = y0 - select(j1, one, zero) + splat(unskew);
+    const F4 z1 = z0 - select(k1, one, zero) + splat(unskew);
+    const F4 x2 = x0 - select(i2, one, zero) + splat(2 * unskew);
+    const F4 y2 = y0 - select(j2, one, zero) + splat(2 * unskew);
+    const F4 z2 = z0 - select(k2, one, zero) + splat(2 * unskew);
+    const F4 x3 = x0 - splat(1 - 3 * unskew);
+    const F4 y3 = y0 - splat(1 - 3 * unskew);
+    const F4 z3 = z0 - splat(1 - 3 * unskew);
+
+    const I4 px = splatInt(primeX);
+    const I4 py = splatInt(primeY);
+    const I4 pz = splatInt(primeZ);
+    const I4 hx = truncate(fi) * px;
+    const I4 hy = truncate(fj) * py;
+    const I4 hz = truncate(fk) * pz;
+    const F4 n = simplexCorner(hash(hx, hy, hz), x0, y0, z0) +
+                 simplexCorner(hash(hx + (i1 & px), hy + (j1 & py), hz + (k1 & pz)), x1, y1, z1) +
+                 simplexCorner(hash(hx + (i2 & px), hy + (j2 & py), hz + (k2 & pz)), x2, y2, z2) +
+                 simplexCorner(hash(hx + px, hy + py, hz + pz), x3, y3, z3);
+    return splat(0.5f) + n * splat(simplexRange);
+}
+
+// Evaluates field(x, y) for four pixel centers at a time, in units of the
+// scale, and looks the results in [0, 1] up in the palette.
+template <typename Field>
+void fillRow(int x, int y, size_t span, unsigned char *rgba, float scale, const unsigned char *palette,
+             Field field) {
+    const float inv = 1.0f / scale;
+    const F4 py = splat((y + 0.5f) * inv);
+    const F4 step = splat(inv);
+    int32_t index[4];
+    for (size_t i = 0; i < span; i += 4) {
+        const F4 px = ramp(x + static_cast<float>(i) + 0.5f) * step;
+        const F4 t = minOf(maxOf(field(px, py), splat(0.0f)), splat(1.0f));
+        store(truncate(t * splat(255.0f) + splat(0.5f)), index);
+        const size_t n = std::min<size_t>(4, span - i);
+        for (size_t k = 0; k < n; ++k) {
+            std::memcpy(rgba + (i + k) * 4, palette + index[k] * 4, 4);
+        }
+    }
+}
+
+std::vector<unsigned char> makePalette(const std::vector<ofColor> &stops) {
+    std::vector<unsigned char> palette(256 * 4);
+    for (size_t i = 0; i < 256; ++i) {
+        const float position = stops.size() > 1 ? i / 255.0f * (stops.size() - 1) : 0;
+        const size_t k = std::min(static_cast<size_t>(position), stops.size() > 1 ? stops.size() - 2 : 0);
+        const float f = position - k;
+        const ofColor &a = stops[k];
+        const ofColor &b = stops[std::min(k + 1, stops.size() - 1)];
+        for (size_t c = 0; c < 4; ++c) {
+            const float value = (&a.r)[c] + ((&b.r)[c] - (&a.r)[c]) * f;
+            palette[i * 4 + c] = static_cast<unsigned char>(value + 0.5f);
+        }
+    }
+    return palette;
+}
+} // namespace
+
+ofxHeadlessFboGenerator::ofxHeadlessFboGenerator() {
+}
+
+ofxHeadlessFboGenerator::ofxHeadlessFboGenerator(RowFunction row) : kind(row ? FUNCTION : EMPTY), row(row) {
+}
+
+ofxHeadlessFboGenerator::ofxHeadlessFboGenerator(Kind kind, float scale, float param,
+                                                 const std::vector<ofColor> &stops)
+    : kind(kind), scale(scale > 0 ? scale : 1), param(param), palette(makePalette(stops)) {
+}
+
+ofxHeadlessFboGenerator ofxHeadlessFboGenerator::checkerboard(float cellSize, const ofColor &a, const ofColor &b) {
+    return ofxHeadlessFboGenerator(CHECKERBOARD, cellSize, 0, {a, b});
+}
+
+ofxHeadlessFboGenerator ofxHeadlessFboGenerator::stripes(float period, float angle, const ofColor &a,
+                                                         const ofColor &b) {
+    return ofxHeadlessFboGenerator(STRIPES, period, angle, {a, b});
+}
+
+ofxHeadlessFboGenerator ofxHeadlessFboGenerator::valueNoise(float scale, float time, const ofColor &a,
+                                                            const ofColor &b) {
+    return ofxHeadlessFboGenerator(VALUE_NOISE, scale, time, {a, b});
+}
+
+ofxHeadlessFboGenerator ofxHeadlessFboGenerator::simplexNoise(float scale, float time, const ofColor &a,
+                                                              const ofColor &b) {
+    return ofxHeadlessFboGenerator(SIMPLEX_NOISE, scale, time, {a, b});
+}
+
+ofxHeadlessFboGenerator ofxHeadlessFboGenerator::plasma(float scale, float time) {
+    return ofxHeadlessFboGenerator(PLASMA, scale, time,
+                                   {ofColor::red, ofColor::yellow, ofColor::green, ofColor::cyan, ofColor::blue,
+                                    ofColor::magenta, ofColor::red});
+}
+
+ofxHeadlessFboGenerator &ofxHeadlessFboGenerator::setPalette(const std::vector<ofColor> &stops) {
+    if (stops.empty()) {
+        ofLogWarning("ofxHeadlessFboGenerator") << "setPalette(): no color stops";
+        return *this;
+    }
+    palette = makePalette(stops);
+    return *this;
+}
+
+bool ofxHeadlessFboGenerator::isEmpty() const {
+    return kind == EMPTY;
+}
+
+void ofxHeadlessFboGenerator::generate(int x, int y, size_t span, unsigned char *rgba) const {
+    const unsigned char *colors = palette.data();
+    switch (kind) {
+        case EMPTY:
+            break;
+        case FUNCTION:
+            row(x, y, span, rgba);
+            break;
+        case CHECKERBOARD:
+            fillRow(x, y, span, rgba, scale, colors, [](F4 px, F4 py) {
+                return toFloat((truncate(floorOf(px)) + truncate(floorOf(py))) & splatInt(1));
+            });
+            break;
+        case STRIPES:
+            {
+                const float radians = param * (6.28318531f / 360.0f);
+                const F4 dx = splat(2 * std::cos(radians));
+                const F4 dy = splat(2 * std::sin(radians));
+                fillRow(x, y, span, rgba, scale, colors, [&](F4 px, F4 py) {
+                    return toFloat(truncate(floorOf(px * dx + py * dy)) & splatInt(1));
+                });
+                break;
+            }
+        case VALUE_NOISE:
+            {
+                const F4 pz = splat(param);
+                fillRow(x, y, span, rgba, scale, colors, [&](F4 px, F4 py) { return valueNoiseAt(px, py, pz); });
+                break;
+            }
+        case SIMPLEX_NOISE:
+            {
+                const F4 pz = splat(param);
+                fillRow(x, y, span, rgba, scale, colors, [&](F4 px, F4 py) { return simplexNoiseAt(px, py, pz); });
+                break;
+            }
+        case PLASMA:
+            {
+                // a wave along each axis, a diagonal one and rings around a wandering center
+                const F4 shiftX = splat(0.25f * param);
+                const F4 shiftY = splat(-0.2f * param);
+                const F4 shiftDiagonal = splat(0.15f * param);
+                const F4 shiftRing = splat(-0.3f * param);
+                const F4 centerX = splat(2.0f * std::sin(0.3f * param));
+                const F4 centerY = splat(2.0f * std::cos(0.23f * param));
+                fillRow(x, y, span, rgba, scale, colors, [&](F4 px, F4 py) {
+                    const F4 rx = px - centerX;
+                    const F4 ry = py - centerY;
+                    const F4 sum = sinTurns(px + shiftX) + sinTurns(py * splat(0.8f) + shiftY) +
+                                   sinTurns((px + py) * splat(0.6f) + shiftDiagonal) +
+                                   sinTurns(sqrtOf(rx * rx + ry * ry) + shiftRing);
+                    return splat(0.5f) + sum * splat(0.125f);
+                });
+                break;
+            }
+    }
+}
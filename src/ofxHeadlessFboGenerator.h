@@ -0,0 +1,110 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofColor.h"
+#include <functional>
+#include <vector>
+
+/// @file
+/// Procedural fills for ofxHeadlessFbo::fillWith().
+///
+/// A generator produces a row of RGBA pixels at a time. The built-in ones
+/// evaluate a scalar field, four pixels per SSE2 or NEON step, and look
+/// the result up in a palette of 256 colors spread between the given color
+/// stops. A user function can fill the rows instead, it gets a whole row
+/// buffer per call.
+///
+/// Positions are drawing coordinates, the center of the pixel at x, y is
+/// sampled at x + 0.5, y + 0.5 before the scale is applied.
+///
+/// ~~~~{.cpp}
+/// auto noise = ofxHeadlessFboGenerator::simplexNoise(40, ofGetElapsedTimef(), ofColor::black, ofColor::orange);
+/// hfbo.fillWith(noise, ofRectangle(0, 0, 800, 300));
+/// ~~~~
+
+class ofxHeadlessFboGenerator {
+    public:
+    /// @brief Fills span RGBA pixels starting at x, y in drawing coordinates.
+    ///
+    /// fillWith() calls it from several threads at once when it runs on more
+    /// than one, every call gets its own buffer.
+    typedef std::function<void(int x, int y, size_t span, unsigned char *rgba)> RowFunction;
+
+    /// @brief A generator that fills nothing.
+    ofxHeadlessFboGenerator();
+    /// @brief A generator calling a function for every row.
+    explicit ofxHeadlessFboGenerator(RowFunction row);
+
+    /// @brief Squares of cellSize pixels alternating between two colors.
+    static ofxHeadlessFboGenerator checkerboard(float cellSize, const ofColor &a, const ofColor &b);
+    /// @brief Stripes of half a period each, rotated by angle degrees.
+    static ofxHeadlessFboGenerator stripes(float period, float angle, const ofColor &a, const ofColor &b);
+    /// @brief Smoothed value noise with features about scale pixels wide, time moves through a third dimension.
+    static ofxHeadlessFboGenerator valueNoise(float scale, float time, const ofColor &a, const ofColor &b);
+    /// @brief Simplex noise with features about scale pixels wide, time moves through a third dimension.
+    static ofxHeadlessFboGenerator simplexNoise(float scale, float time, const ofColor &a, const ofColor &b);
+    /// @brief The sum of four sine waves over a rainbow, waves about scale pixels long moving with time.
+    static ofxHeadlessFboGenerator plasma(float scale, float time);
+
+    /// @brief Replaces the palette of a built-in generator with evenly spaced color stops.
+    ///
+    /// ~~~~{.cpp}
+    /// auto fire = ofxHeadlessFboGenerator::valueNoise(25, t, ofColor::black, ofColor::white);
+    /// fire.setPalette({ofColor::black, ofColor::red, ofColor::orange, ofColor::yellow});
+    /// ~~~~
+    ofxHeadlessFboGenerator &setPalette(const std::vector<ofColor> &stops);
+
+    /// @brief Nothing is filled by an empty generator.
+    bool isEmpty() const;
+
+    /// @brief Fills span RGBA pixels starting at x, y in drawing coordinates, safe to call from several threads.
+    void generate(int x, int y, size_t span, unsigned char *rgba) const;
+
+    private:
+    enum Kind {
+        EMPTY,
+        FUNCTION,
+        CHECKERBOARD,
+        STRIPES,
+        VALUE_NOISE,
+        SIMPLEX_NOISE,
+        PLASMA,
+    };
+
+    ofxHeadlessFboGenerator(Kind kind, float scale, float param, const std::vector<ofColor> &stops);
+
+    Kind kind = EMPTY;
+    RowFunction row;
+    /// pixels per unit of the field
+    float scale = 1;
+    /// time, or the angle of stripes in degrees
+    float param = 0;
+    /// 256 RGBA colors indexed by the field
+    std::vector<unsigned char> palette;
+};
@@ -0,0 +1,79 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFbo.h"
+#include "ofLog.h"
+#include "ofMesh.h"
+
+template <typename Mesh>
+void ofxHeadlessFbo::drawMesh(const Mesh &mesh, size_t binRows) {
+    if (!isAllocated() || w == 0 || h == 0) {
+        return;
+    }
+    const ofPrimitiveMode mode = mesh.getMode();
+    if (mode != OF_PRIMITIVE_TRIANGLES && mode != OF_PRIMITIVE_TRIANGLE_STRIP && mode != OF_PRIMITIVE_TRIANGLE_FAN) {
+        ofLogWarning("ofxHeadlessFbo") << "drawMesh(): only triangles, triangle strips and fans are drawn";
+        return;
+    }
+
+    // corners of every triangle, indices past the vertices are skipped
+    const auto &vertices = mesh.getVertices();
+    const auto &colors = mesh.getColors();
+    const auto &indices = mesh.getIndices();
+    const size_t numVertices = vertices.size();
+    const size_t count = indices.empty() ? numVertices : indices.size();
+    auto corner = [&](size_t i) { return indices.empty() ? static_cast<uint32_t>(i) : indices[i]; };
+    auto &triangles = meshScratch.triangles;
+    triangles.clear();
+    auto addTriangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+        if (a < numVertices && b < numVertices && c < numVertices) {
+            triangles.insert(triangles.end(), {a, b, c});
+        }
+    };
+    if (mode == OF_PRIMITIVE_TRIANGLES) {
+        for (size_t i = 0; i + 2 < count; i += 3) {
+            addTriangle(corner(i), corner(i + 1), corner(i + 2));
+        }
+    } else if (mode == OF_PRIMITIVE_TRIANGLE_STRIP) {
+        for (size_t i = 0; i + 2 < count; ++i) {
+            addTriangle(corner(i), corner(i + 1), corner(i + 2));
+        }
+    } else {
+        for (size_t i = 1; i + 1 < count; ++i) {
+            addTriangle(corner(0), corner(i), corner(i + 1));
+        }
+    }
+    if (triangles.empty()) {
+        return;
+    }
+
+    const bool colored = colors.size() == numVertices;
+    drawTriangles(&vertices[0].x, sizeof(vertices[0]) / sizeof(float), colored ? &colors[0].r : nullptr,
+                  sizeof(colors[0]) / sizeof(float), numVertices, binRows);
+}
+
+template void ofxHeadlessFbo::drawMesh<ofMesh>(const ofMesh &mesh, size_t binRows);
@@ -0,0 +1,289 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboPipeline.h"
+#include "ofLog.h"
+#include "ofxHeadlessFboTrace.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return end > start ? std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() : 0;
+}
+
+/// Spins briefly, then sleeps, while a queue stays empty or full.
+void backoff(size_t &attempt) {
+    if (attempt < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    ++attempt;
+}
+
+} // namespace
+
+double ofxHeadlessFboLatencyHistogram::getMeanNs() const {
+    return count > 0 ? static_cast<double>(totalNs) / count : 0;
+}
+
+uint64_t ofxHeadlessFboLatencyHistogram::getPercentileNs(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const double target = count * std::min(std::max(percentile, 0.0), 100.0) / 100;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        sum += buckets[i];
+        if (sum >= target && sum > 0) {
+            return std::min(maxNs, (uint64_t(2) << i) - 1);
+        }
+    }
+    return maxNs;
+}
+
+void ofxHeadlessFboPipeline::Histogram::add(uint64_t ns) {
+    size_t bucket = 0;
+    while (bucket + 1 < ofxHeadlessFboLatencyHistogram::NUM_BUCKETS && (ns >> (bucket + 1)) != 0) {
+        ++bucket;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t current = minNs.load(std::memory_order_relaxed);
+    while (ns < current && !minNs.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {
+    }
+    current = maxNs.load(std::memory_order_relaxed);
+    while (ns > current && !maxNs.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void ofxHeadlessFboPipeline::Histogram::reset() {
+    for (auto &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    minNs.store(UINT64_MAX, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+    totalNs.store(0, std::memory_order_relaxed);
+}
+
+ofxHeadlessFboLatencyHistogram ofxHeadlessFboPipeline::Histogram::get() const {
+    ofxHeadlessFboLatencyHistogram histogram;
+    for (size_t i = 0; i < ofxHeadlessFboLatencyHistogram::NUM_BUCKETS; ++i) {
+        histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    histogram.count = count.load(std::memory_order_relaxed);
+    histogram.minNs = histogram.count > 0 ? minNs.load(std::memory_order_relaxed) : 0;
+    histogram.maxNs = maxNs.load(std::memory_order_relaxed);
+    histogram.totalNs = totalNs.load(std::memory_order_relaxed);
+    return histogram;
+}
+
+ofxHeadlessFboPipeline::~ofxHeadlessFboPipeline() {
+    close();
+}
+
+void ofxHeadlessFboPipeline::addStage(const std::string &name, StageFunction function, size_t parallelism) {
+    if (running) {
+        ofLogWarning("ofxHeadlessFboPipeline") << "addStage(): can't add stage " << name << " while running";
+        return;
+    }
+    std::unique_ptr<Stage> stage(new Stage());
+    stage->name = name;
+    stage->function = std::move(function);
+    stage->parallelism = std::max<size_t>(parallelism, 1);
+    stages.push_back(std::move(stage));
+}
+
+bool ofxHeadlessFboPipeline::setup(size_t numFrames) {
+    close();
+    if (stages.empty() || numFrames == 0) {
+        ofLogWarning("ofxHeadlessFboPipeline") << "setup(): no stages or frames";
+        return false;
+    }
+
+    // every queue can hold all frames, so passing a frame on never fails
+    freeFrames.reset(new ofxHeadlessFboQueue<ofxHeadlessFboFrame *>(numFrames));
+    frames.clear();
+    for (size_t i = 0; i < numFrames; ++i) {
+        frames.emplace_back(new ofxHeadlessFboFrame());
+        freeFrames->push(frames.back().get());
+    }
+    for (auto &stage : stages) {
+        stage->input.reset(new ofxHeadlessFboQueue<ofxHeadlessFboFrame *>(numFrames));
+        stage->next = 0;
+    }
+    submitted = 0;
+    completed = 0;
+    dropped = 0;
+    resetStats();
+
+    running = true;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        for (size_t t = 0; t < stages[i]->parallelism; ++t) {
+            stages[i]->threads.emplace_back(&ofxHeadlessFboPipeline::stageLoop, this, i);
+        }
+    }
+    return true;
+}
+
+void ofxHeadlessFboPipeline::close() {
+    if (!running) {
+        return;
+    }
+    flush();
+    running = false;
+    for (auto &stage : stages) {
+        for (auto &thread : stage->threads) {
+            thread.join();
+        }
+        stage->threads.clear();
+    }
+}
+
+bool ofxHeadlessFboPipeline::isRunning() const {
+    return running;
+}
+
+bool ofxHeadlessFboPipeline::submit(const ofxHeadlessFbo &fbo, bool block) {
+    if (!running) {
+        return false;
+    }
+    ofxHeadlessFboFrame *frame = nullptr;
+    size_t attempt = 0;
+    while (!freeFrames->pop(frame)) {
+        if (!block) {
+            dropped++;
+            return false;
+        }
+        backoff(attempt);
+    }
+
+    fbo.readPixels(frame->pixels);
+    frame->index = submitted++;
+    frame->submitted = std::chrono::steady_clock::now();
+    frame->queued = frame->submitted;
+    stages.front()->input->push(frame);
+    return true;
+}
+
+void ofxHeadlessFboPipeline::flush() {
+    size_t attempt = 0;
+    while (completed.load(std::memory_order_acquire) != submitted) {
+        backoff(attempt);
+    }
+}
+
+uint64_t ofxHeadlessFboPipeline::getSubmitted() const {
+    return submitted;
+}
+
+uint64_t ofxHeadlessFboPipeline::getCompleted() const {
+    return completed;
+}
+
+uint64_t ofxHeadlessFboPipeline::getDropped() const {
+    return dropped;
+}
+
+std::vector<ofxHeadlessFboPipeline::StageStats> ofxHeadlessFboPipeline::getStageStats() const {
+    std::vector<StageStats> result;
+    for (const auto &stage : stages) {
+        StageStats stats;
+        stats.name = stage->name;
+        stats.wait = stage->wait.get();
+        stats.process = stage->process.get();
+        result.push_back(stats);
+    }
+    return result;
+}
+
+ofxHeadlessFboLatencyHistogram ofxHeadlessFboPipeline::getLatency() const {
+    return latency.get();
+}
+
+void ofxHeadlessFboPipeline::resetStats() {
+    for (auto &stage : stages) {
+        stage->wait.reset();
+        stage->process.reset();
+    }
+    latency.reset();
+}
+
+void ofxHeadlessFboPipeline::stageLoop(size_t index) {
+    Stage &stage = *stages[index];
+    OFX_HEADLESS_FBO_TRACE_THREAD("ofxHeadlessFboPipeline " + stage.name);
+    size_t attempt = 0;
+    while (true) {
+        ofxHeadlessFboFrame *frame = nullptr;
+        if (!stage.input->pop(frame)) {
+            // close() only stops the stages once every frame is back in the pool
+            if (!running) {
+                return;
+            }
+            backoff(attempt);
+            continue;
+        }
+        attempt = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        stage.wait.add(elapsedNs(frame->queued, start));
+        try {
+            OFX_HEADLESS_FBO_TRACE_SCOPE("pipelineStage");
+            stage.function(*frame);
+        } catch (const std::exception &e) {
+            ofLogError("ofxHeadlessFboPipeline") << "stage " << stage.name << ": " << e.what();
+        } catch (...) {
+            ofLogError("ofxHeadlessFboPipeline") << "stage " << stage.name << ": unknown exception";
+        }
+        const auto end = std::chrono::steady_clock::now();
+        stage.process.add(elapsedNs(start, end));
+        frame->queued = end;
+        forward(index, frame);
+    }
+}
+
+void ofxHeadlessFboPipeline::forward(size_t index, ofxHeadlessFboFrame *frame) {
+    Stage &stage = *stages[index];
+    // with several threads per stage, frames leave in submission order
+    while (stage.next.load(std::memory_order_acquire) != frame->index) {
+        std::this_thread::yield();
+    }
+    const uint64_t next = frame->index + 1;
+    if (index + 1 < stages.size()) {
+        stages[index + 1]->input->push(frame);
+        stage.next.store(next, std::memory_order_release);
+    } else {
+        latency.add(elapsedNs(frame->submitted, frame->queued));
+        freeFrames->push(frame);
+        stage.next.store(next, std::memory_order_release);
+        completed.fetch_add(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,184 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofPixels.h"
+#include "ofxHeadlessFbo.h"
+#include "ofxHeadlessFboQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @file
+/// Overlaps drawing, post processing, encoding and sending of frames.
+///
+/// submit() copies the canvas into a frame taken from a fixed pool and
+/// hands it to the first stage. Every stage runs on its own threads and
+/// passes the frame on through a bounded lock-free queue, the last stage
+/// returns it to the pool. While frame N is encoded frame N+1 can already
+/// be drawn and frame N-1 sent. Frames leave every stage in the order they
+/// were submitted, also when a stage runs on several threads.
+///
+/// ~~~~{.cpp}
+/// pipeline.addStage("gamma", [](ofxHeadlessFboFrame &frame) { applyGamma(frame.pixels); });
+/// pipeline.addStage("encode", [](ofxHeadlessFboFrame &frame) { encode(frame.pixels, frame.data); }, 2);
+/// pipeline.addStage("send", [&](ofxHeadlessFboFrame &frame) { udp.send(frame.data); });
+/// pipeline.setup(4);
+///
+/// void ofApp::update(){
+///     drawScene(hfbo);
+///     pipeline.submit(hfbo);
+/// }
+/// ~~~~
+
+/// A frame travelling through the pipeline, reused once it left the last stage.
+struct ofxHeadlessFboFrame {
+    /// submission number, starting at 0
+    uint64_t index = 0;
+    /// copy of the canvas made by submit()
+    ofPixels pixels;
+    /// free for the stages, for example the encoded frame
+    std::vector<unsigned char> data;
+    /// when the frame was submitted
+    std::chrono::steady_clock::time_point submitted;
+
+    private:
+    friend class ofxHeadlessFboPipeline;
+    std::chrono::steady_clock::time_point queued;
+};
+
+/// Distribution of durations in power of two nanosecond buckets.
+struct ofxHeadlessFboLatencyHistogram {
+    static const size_t NUM_BUCKETS = 40;
+
+    /// bucket i counts durations from 2^i up to 2^(i+1) nanoseconds, bucket 0 also counts 0
+    uint64_t buckets[NUM_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t minNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t totalNs = 0;
+
+    double getMeanNs() const;
+    /// @brief Upper bound of the bucket holding the given percentile, 0 to 100.
+    uint64_t getPercentileNs(double percentile) const;
+};
+
+class ofxHeadlessFboPipeline {
+    public:
+    typedef std::function<void(ofxHeadlessFboFrame &frame)> StageFunction;
+
+    struct StageStats {
+        std::string name;
+        /// time frames waited in the queue in front of the stage
+        ofxHeadlessFboLatencyHistogram wait;
+        /// time the stage function took
+        ofxHeadlessFboLatencyHistogram process;
+    };
+
+    ~ofxHeadlessFboPipeline();
+
+    /// @brief Appends a stage, only before setup().
+    ///
+    /// @param name Name used in the stats and traces
+    /// @param function Called once per frame on one of the stage's threads
+    /// @param parallelism Number of threads working on this stage
+    void addStage(const std::string &name, StageFunction function, size_t parallelism = 1);
+
+    /// @brief Allocates the frame pool and starts the stages.
+    ///
+    /// @param numFrames Frames in flight at most, submit() waits or drops
+    /// frames when all of them are in use
+    /// @returns false without stages
+    bool setup(size_t numFrames = 4);
+    /// @brief Waits for the frames in flight and stops the stages.
+    void close();
+    bool isRunning() const;
+
+    /// @brief Copies the canvas into a free frame and starts it down the pipeline.
+    ///
+    /// @param fbo Canvas to copy
+    /// @param block Wait for a free frame, otherwise the frame is dropped
+    /// @returns false if the frame was dropped or the pipeline isn't running
+    bool submit(const ofxHeadlessFbo &fbo, bool block = true);
+    /// @brief Waits until every submitted frame left the last stage.
+    void flush();
+
+    uint64_t getSubmitted() const;
+    uint64_t getCompleted() const;
+    uint64_t getDropped() const;
+
+    /// @brief Latency histograms of every stage, in the order they were added.
+    std::vector<StageStats> getStageStats() const;
+    /// @brief Time from submit() until the frame left the last stage.
+    ofxHeadlessFboLatencyHistogram getLatency() const;
+    void resetStats();
+
+    private:
+    class Histogram {
+        public:
+        void add(uint64_t ns);
+        void reset();
+        ofxHeadlessFboLatencyHistogram get() const;
+
+        private:
+        std::atomic<uint64_t> buckets[ofxHeadlessFboLatencyHistogram::NUM_BUCKETS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> minNs{UINT64_MAX};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> totalNs{0};
+    };
+
+    struct Stage {
+        std::string name;
+        StageFunction function;
+        size_t parallelism;
+        std::unique_ptr<ofxHeadlessFboQueue<ofxHeadlessFboFrame *>> input;
+        std::vector<std::thread> threads;
+        /// index of the next frame allowed to leave the stage
+        std::atomic<uint64_t> next{0};
+        Histogram wait;
+        Histogram process;
+    };
+
+    void stageLoop(size_t stage);
+    void forward(size_t stage, ofxHeadlessFboFrame *frame);
+
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::vector<std::unique_ptr<ofxHeadlessFboFrame>> frames;
+    std::unique_ptr<ofxHeadlessFboQueue<ofxHeadlessFboFrame *>> freeFrames;
+    std::atomic<bool> running{false};
+    uint64_t submitted = 0;
+    std::atomic<uint64_t> completed{0};
+    uint64_t dropped = 0;
+    Histogram latency;
+};
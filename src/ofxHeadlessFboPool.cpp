@@ -0,0 +1,207 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboPool.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+bool isPowerOfTwo(size_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+} // namespace
+
+bool ofxHeadlessFboPool::allocate(size_t count, size_t w, size_t h, ofPixelFormat pixelFormat, size_t alignment) {
+    if (pixelFormat == OF_PIXELS_RGB565) {
+        return allocate(count, w, h, OFX_HEADLESS_FBO_PACKED_RGB565, alignment);
+    }
+    const size_t rowBytes = ofxHeadlessFbo::getRowBytes(w, pixelFormat);
+    if (rowBytes == 0) {
+        ofLogWarning("ofxHeadlessFboPool") << "allocate(): unsupported pixel format " << pixelFormat;
+        return false;
+    }
+    if (!allocateArena(count, h, rowBytes, alignment)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        canvases[i].allocateFromExternal(data + i * canvasStride, w, h, rowBytes, pixelFormat);
+        canvases[i].setShapeCacheSize(0);
+    }
+    return true;
+}
+
+bool ofxHeadlessFboPool::allocate(size_t count, size_t w, size_t h, ofxHeadlessFboPackedFormat packedFormat,
+                                  size_t alignment) {
+    if (packedFormat == OFX_HEADLESS_FBO_PACKED_NONE) {
+        ofLogWarning("ofxHeadlessFboPool") << "allocate(): no packed format given";
+        return false;
+    }
+    if (!allocateArena(count, h, ofxHeadlessFbo::getRowBytes(w, packedFormat), alignment)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        canvases[i].allocateFromExternal(data + i * canvasStride, w, h, rowBytes, packedFormat);
+        canvases[i].setShapeCacheSize(0);
+    }
+    return true;
+}
+
+bool ofxHeadlessFboPool::allocateArena(size_t count, size_t h, size_t rowBytes, size_t alignment) {
+    if (count == 0 || h == 0 || rowBytes == 0 || !isPowerOfTwo(alignment)) {
+        ofLogWarning("ofxHeadlessFboPool") << "allocate(): empty canvases or alignment " << alignment
+                                           << " not a power of two";
+        return false;
+    }
+    // RGB565 canvases need 2 byte aligned rows
+    alignment = std::max<size_t>(alignment, 2);
+
+    const size_t frameBytes = rowBytes * h;
+    const size_t canvasStride = (frameBytes + alignment - 1) / alignment * alignment;
+    const size_t size = canvasStride * count + alignment - 1;
+    if (size > capacity) {
+        storage.reset(new unsigned char[size]);
+        capacity = size;
+    }
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+    data = storage.get() + ((alignment - address % alignment) % alignment);
+    std::memset(data, 0, canvasStride * count);
+
+    this->rowBytes = rowBytes;
+    this->frameBytes = frameBytes;
+    this->canvasStride = canvasStride;
+    canvases.clear();
+    canvases.resize(count);
+    return true;
+}
+
+void ofxHeadlessFboPool::clear() {
+    canvases.clear();
+    storage.reset();
+    capacity = 0;
+    data = nullptr;
+    rowBytes = 0;
+    frameBytes = 0;
+    canvasStride = 0;
+}
+
+bool ofxHeadlessFboPool::isAllocated() const {
+    return data != nullptr;
+}
+
+size_t ofxHeadlessFboPool::size() const {
+    return canvases.size();
+}
+
+ofxHeadlessFbo &ofxHeadlessFboPool::operator[](size_t index) {
+    return canvases[index];
+}
+
+const ofxHeadlessFbo &ofxHeadlessFboPool::operator[](size_t index) const {
+    return canvases[index];
+}
+
+std::vector<ofxHeadlessFbo>::iterator ofxHeadlessFboPool::begin() {
+    return canvases.begin();
+}
+
+std::vector<ofxHeadlessFbo>::iterator ofxHeadlessFboPool::end() {
+    return canvases.end();
+}
+
+std::vector<ofxHeadlessFbo>::const_iterator ofxHeadlessFboPool::begin() const {
+    return canvases.begin();
+}
+
+std::vector<ofxHeadlessFbo>::const_iterator ofxHeadlessFboPool::end() const {
+    return canvases.end();
+}
+
+void ofxHeadlessFboPool::clearAll(const ofColor &color) {
+    if (canvases.empty()) {
+        return;
+    }
+    // lazy clears only mark tiles, and indexed canvases with their own
+    // palettes store the color differently
+    const ofxHeadlessFbo &first = canvases.front();
+    const bool sameBytes = std::all_of(canvases.begin(), canvases.end(), [&](const ofxHeadlessFbo &canvas) {
+        return !canvas.isLazyClear() && (canvas.getPackedFormat() != OFX_HEADLESS_FBO_PACKED_INDEXED8 ||
+                                         canvas.getPalette() == first.getPalette());
+    });
+    if (!sameBytes) {
+        for (auto &canvas : canvases) {
+            canvas.clear(color);
+        }
+        return;
+    }
+
+    // clear the first canvas and double the filled part until the arena is full
+    canvases.front().clear(color);
+    const size_t total = canvasStride * canvases.size();
+    for (size_t filled = canvasStride; filled < total; filled *= 2) {
+        std::memcpy(data + filled, data, std::min(filled, total - filled));
+    }
+    for (size_t i = 1; i < canvases.size(); ++i) {
+        canvases[i].resetTiles();
+        canvases[i].markDirty();
+    }
+}
+
+void ofxHeadlessFboPool::readAll(std::vector<unsigned char> &out) const {
+    out.resize(frameBytes * canvases.size());
+    if (out.empty()) {
+        return;
+    }
+    for (const auto &canvas : canvases) {
+        canvas.materializeTiles();
+    }
+    if (canvasStride == frameBytes) {
+        std::memcpy(out.data(), data, out.size());
+        return;
+    }
+    for (size_t i = 0; i < canvases.size(); ++i) {
+        std::memcpy(out.data() + i * frameBytes, data + i * canvasStride, frameBytes);
+    }
+}
+
+size_t ofxHeadlessFboPool::getFrameBytes() const {
+    return frameBytes;
+}
+
+size_t ofxHeadlessFboPool::getCanvasStride() const {
+    return canvasStride;
+}
+
+const unsigned char *ofxHeadlessFboPool::getData() const {
+    for (const auto &canvas : canvases) {
+        canvas.materializeTiles();
+    }
+    return data;
+}
@@ -0,0 +1,116 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofColor.h"
+#include "ofxHeadlessFbo.h"
+#include <memory>
+#include <vector>
+
+/// @file
+/// Many small canvases sharing one contiguous arena.
+///
+/// Every canvas of the pool draws into its own slice of a single aligned
+/// allocation, so iterating over hundreds of tiles walks linear memory and
+/// a whole installation can be cleared or read out in one pass. Canvases
+/// keep their textures unallocated until they are drawn on screen, and start
+/// with the shape cache disabled so hundreds of tiles don't each keep their
+/// own, call setShapeCacheSize() on the canvases that draw repeated shapes.
+///
+/// ~~~~{.cpp}
+/// ofxHeadlessFboPool tiles;
+/// tiles.allocate(400, 16, 16, OF_PIXELS_RGB);
+/// tiles.clearAll(ofColor::black);
+/// for (auto &tile : tiles) {
+///     tile.drawCircle(8, 8, 5);
+/// }
+/// std::vector<unsigned char> frame;
+/// tiles.readAll(frame);
+/// ~~~~
+
+class ofxHeadlessFboPool {
+    public:
+    /// @brief Allocates count canvases of w x h pixels in one arena.
+    ///
+    /// Every canvas starts on a multiple of alignment bytes, its rows are
+    /// tightly packed. Allocating again with a layout that fits in the
+    /// current arena reuses it. References to the canvases are invalidated.
+    ///
+    /// @param count Number of canvases
+    /// @param w Width of every canvas
+    /// @param h Height of every canvas
+    /// @param pixelFormat One of the 8 bit per channel formats or OF_PIXELS_RGB565
+    /// @param alignment Alignment of every canvas in bytes, a power of two
+    /// @returns false if the layout isn't supported
+    bool allocate(size_t count, size_t w, size_t h, ofPixelFormat pixelFormat, size_t alignment = 64);
+    /// @brief Allocates count canvases in a packed format.
+    bool allocate(size_t count, size_t w, size_t h, ofxHeadlessFboPackedFormat packedFormat, size_t alignment = 64);
+
+    /// @brief Releases the canvases and the arena.
+    void clear();
+    bool isAllocated() const;
+
+    size_t size() const;
+    ofxHeadlessFbo &operator[](size_t index);
+    const ofxHeadlessFbo &operator[](size_t index) const;
+    std::vector<ofxHeadlessFbo>::iterator begin();
+    std::vector<ofxHeadlessFbo>::iterator end();
+    std::vector<ofxHeadlessFbo>::const_iterator begin() const;
+    std::vector<ofxHeadlessFbo>::const_iterator end() const;
+
+    /// @brief Fills every canvas with a single color.
+    ///
+    /// The first canvas is cleared and copied through the whole arena in a
+    /// single pass.
+    void clearAll(const ofColor &color);
+
+    /// @brief Copies all canvases back to back into out, in their stored format.
+    ///
+    /// Rows are tightly packed, canvas i starts at i * getFrameBytes(). Packed
+    /// canvases keep their packed rows. When the canvases are not padded
+    /// the arena is copied at once.
+    void readAll(std::vector<unsigned char> &out) const;
+
+    /// @brief Bytes of one canvas in readAll(), its rows tightly packed.
+    size_t getFrameBytes() const;
+    /// @brief Distance between two canvases in the arena in bytes.
+    size_t getCanvasStride() const;
+    /// @brief Pointer to the first canvas of the arena.
+    const unsigned char *getData() const;
+
+    private:
+    bool allocateArena(size_t count, size_t h, size_t rowBytes, size_t alignment);
+
+    std::vector<ofxHeadlessFbo> canvases;
+    std::unique_ptr<unsigned char[]> storage;
+    size_t capacity = 0;
+    unsigned char *data = nullptr;
+    size_t rowBytes = 0;
+    size_t frameBytes = 0;
+    size_t canvasStride = 0;
+};
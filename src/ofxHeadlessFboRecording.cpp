@@ -0,0 +1,725 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboRecording.h"
+#include "ofFileUtils.h"
+#include "ofLog.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef TARGET_WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const size_t fileHeaderSize = 64;
+const size_t indexEntrySize = 16;
+const uint32_t fileVersion = 1;
+const unsigned char entryKeyframe = 0x1;
+
+inline void putU32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+inline void putU64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+inline uint32_t getU32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= static_cast<uint32_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+inline uint64_t getU64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+bool seekFile(std::FILE *file, uint64_t offset) {
+#ifdef TARGET_WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool resizeFile(std::FILE *file, uint64_t size, bool preallocate) {
+    std::fflush(file);
+#ifdef TARGET_WIN32
+    (void)preallocate;
+    return _chsize_s(_fileno(file), static_cast<__int64>(size)) == 0;
+#else
+    if (ftruncate(fileno(file), static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+#ifdef TARGET_LINUX
+    if (preallocate && size > 0) {
+        // reserve the blocks up front so appending never has to grow the file
+        posix_fallocate(fileno(file), 0, static_cast<off_t>(size));
+    }
+#else
+    (void)preallocate;
+#endif
+    return true;
+#endif
+}
+
+// PackBits style encoding on whole pixels: a control byte n < 128 is followed
+// by n + 1 literal pixels, n >= 128 is followed by one pixel repeated n - 126 times.
+void encodeRle(const unsigned char *src, size_t numPixels, size_t bpp, std::vector<unsigned char> &out) {
+    out.clear();
+    size_t i = 0;
+    while (i < numPixels) {
+        size_t run = 1;
+        while (i + run < numPixels && run < 129 && std::memcmp(src + i * bpp, src + (i + run) * bpp, bpp) == 0) {
+            ++run;
+        }
+        if (run >= 2) {
+            out.push_back(static_cast<unsigned char>(run + 126));
+            out.insert(out.end(), src + i * bpp, src + (i + 1) * bpp);
+            i += run;
+            continue;
+        }
+
+        size_t literal = 1;
+        while (i + literal < numPixels && literal < 128) {
+            const unsigned char *p = src + (i + literal) * bpp;
+            if (i + literal + 1 < numPixels && std::memcmp(p, p + bpp, bpp) == 0) {
+                break;
+            }
+            ++literal;
+        }
+        out.push_back(static_cast<unsigned char>(literal - 1));
+        out.insert(out.end(), src + i * bpp, src + (i + literal) * bpp);
+        i += literal;
+    }
+}
+
+bool decodeRle(const unsigned char *src, size_t size, unsigned char *dst, size_t numPixels, size_t bpp) {
+    size_t pos = 0;
+    size_t pixel = 0;
+    while (pixel < numPixels) {
+        if (pos >= size) {
+            return false;
+        }
+        const unsigned char control = src[pos++];
+        if (control < 128) {
+            const size_t count = static_cast<size_t>(control) + 1;
+            if (count > numPixels - pixel || count * bpp > size - pos) {
+                return false;
+            }
+            std::memcpy(dst + pixel * bpp, src + pos, count * bpp);
+            pos += count * bpp;
+            pixel += count;
+        } else {
+            const size_t count = static_cast<size_t>(control) - 126;
+            if (count > numPixels - pixel || bpp > size - pos) {
+                return false;
+            }
+            unsigned char *out = dst + pixel * bpp;
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(out + i * bpp, src + pos, bpp);
+            }
+            pos += bpp;
+            pixel += count;
+        }
+    }
+    return true;
+}
+} // namespace
+
+//--------------------------------------------------------------
+ofxHeadlessFboRecorder::~ofxHeadlessFboRecorder() {
+    close();
+}
+
+bool ofxHeadlessFboRecorder::open(const std::string &path, size_t w, size_t h, ofPixelFormat pixelFormat,
+                                  size_t maxFrames, ofxHeadlessFboCompression compression, float frameRate) {
+    close();
+    if (w == 0 || h == 0 || maxFrames == 0 || pixelFormat == OF_PIXELS_UNKNOWN) {
+        return false;
+    }
+
+    file = std::fopen(ofToDataPath(path, true).c_str(), "wb+");
+    if (file == nullptr) {
+        ofLogError("ofxHeadlessFboRecorder") << "open(): couldn't create " << path;
+        return false;
+    }
+
+    this->w = w;
+    this->h = h;
+    this->pixelFormat = pixelFormat;
+    this->frameBytes = ofPixels::bytesFromPixelFormat(w, h, pixelFormat);
+    this->pixelBytes = frameBytes / (w * h);
+    this->capacity = maxFrames;
+    this->frameCount = 0;
+    this->frameRate = frameRate;
+    this->compression = compression;
+    this->dataEnd = fileHeaderSize + static_cast<uint64_t>(capacity) * indexEntrySize;
+    deltaEncoder.reset();
+
+    // raw frames have a known size, reserve room for all of them
+    uint64_t reserved = dataEnd;
+    if (compression == OFX_HEADLESS_FBO_COMPRESSION_NONE) {
+        reserved += static_cast<uint64_t>(capacity) * frameBytes;
+    }
+    if (!resizeFile(file, reserved, true)) {
+        ofLogError("ofxHeadlessFboRecorder") << "open(): couldn't preallocate " << reserved << " bytes";
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    writeHeader();
+    return true;
+}
+
+bool ofxHeadlessFboRecorder::addFrame(const ofxHeadlessFbo &fbo) {
+    if (!fbo.isAllocated() || fbo.getWidth() != w || fbo.getHeight() != h || fbo.getPixelFormat() != pixelFormat) {
+        ofLogWarning("ofxHeadlessFboRecorder") << "addFrame(): buffer doesn't match the recording format";
+        return false;
+    }
+    return addFrame(fbo.getPixels().getData());
+}
+
+bool ofxHeadlessFboRecorder::addFrame(const unsigned char *data) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("recordFrame");
+    if (file == nullptr || data == nullptr) {
+        return false;
+    }
+    if (frameCount >= capacity) {
+        ofLogWarning("ofxHeadlessFboRecorder") << "addFrame(): index table is full";
+        return false;
+    }
+
+    const unsigned char *frameData = data;
+    size_t frameSize = frameBytes;
+    unsigned char frameCompression = OFX_HEADLESS_FBO_COMPRESSION_NONE;
+    unsigned char flags = entryKeyframe;
+
+    switch (compression) {
+        case OFX_HEADLESS_FBO_COMPRESSION_RLE:
+            encodeRle(data, w * h, pixelBytes, scratch);
+            if (scratch.size() < frameBytes) {
+                frameData = scratch.data();
+                frameSize = scratch.size();
+                frameCompression = OFX_HEADLESS_FBO_COMPRESSION_RLE;
+            }
+            break;
+        case OFX_HEADLESS_FBO_COMPRESSION_DELTA:
+            deltaEncoder.encode(data, w, h, pixelFormat, scratch);
+            frameData = scratch.data();
+            frameSize = scratch.size();
+            frameCompression = OFX_HEADLESS_FBO_COMPRESSION_DELTA;
+            flags = deltaEncoder.isLastKeyframe() ? entryKeyframe : 0;
+            break;
+        default:
+            break;
+    }
+
+    if (!writeAt(dataEnd, frameData, frameSize)) {
+        return false;
+    }
+
+    unsigned char entry[indexEntrySize] = {};
+    putU64(entry, dataEnd);
+    putU32(entry + 8, static_cast<uint32_t>(frameSize));
+    entry[12] = frameCompression;
+    entry[13] = flags;
+    if (!writeAt(fileHeaderSize + static_cast<uint64_t>(frameCount) * indexEntrySize, entry, indexEntrySize)) {
+        return false;
+    }
+
+    dataEnd += frameSize;
+    ++frameCount;
+
+    // keep the frame count current so an interrupted recording stays readable
+    unsigned char count[4];
+    putU32(count, static_cast<uint32_t>(frameCount));
+    return writeAt(28, count, sizeof(count));
+}
+
+void ofxHeadlessFboRecorder::close() {
+    if (file == nullptr) {
+        return;
+    }
+    writeHeader();
+    resizeFile(file, dataEnd, false);
+    std::fclose(file);
+    file = nullptr;
+}
+
+bool ofxHeadlessFboRecorder::isOpen() const {
+    return file != nullptr;
+}
+
+size_t ofxHeadlessFboRecorder::getNumFrames() const {
+    return frameCount;
+}
+
+void ofxHeadlessFboRecorder::setKeyframeInterval(size_t n) {
+    deltaEncoder.setKeyframeInterval(n);
+}
+
+bool ofxHeadlessFboRecorder::writeAt(uint64_t offset, const void *data, size_t size) {
+    if (!seekFile(file, offset) || std::fwrite(data, 1, size, file) != size) {
+        ofLogError("ofxHeadlessFboRecorder") << "couldn't write " << size << " bytes at " << offset;
+        return false;
+    }
+    return true;
+}
+
+void ofxHeadlessFboRecorder::writeHeader() {
+    unsigned char header[fileHeaderSize] = {};
+    header[0] = 'H';
+    header[1] = 'F';
+    header[2] = 'B';
+    header[3] = 'R';
+    putU32(header + 4, fileVersion);
+    putU32(header + 8, static_cast<uint32_t>(w));
+    putU32(header + 12, static_cast<uint32_t>(h));
+    putU32(header + 16, static_cast<uint32_t>(pixelFormat));
+    putU32(header + 20, static_cast<uint32_t>(frameBytes));
+    putU32(header + 24, static_cast<uint32_t>(capacity));
+    putU32(header + 28, static_cast<uint32_t>(frameCount));
+    uint32_t rate;
+    std::memcpy(&rate, &frameRate, sizeof(rate));
+    putU32(header + 32, rate);
+    writeAt(0, header, fileHeaderSize);
+}
+
+//--------------------------------------------------------------
+ofxHeadlessFboPlayer::~ofxHeadlessFboPlayer() {
+    close();
+}
+
+bool ofxHeadlessFboPlayer::load(const std::string &path) {
+    close();
+    const std::string filePath = ofToDataPath(path, true);
+
+#ifdef TARGET_WIN32
+    HANDLE handle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        ofLogError("ofxHeadlessFboPlayer") << "load(): couldn't open " << path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    if (mapping == nullptr) {
+        CloseHandle(handle);
+        return false;
+    }
+    mapped = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mapped == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+    fileHandle = handle;
+    mappingHandle = mapping;
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ofLogError("ofxHeadlessFboPlayer") << "load(): couldn't open " << path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void *address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        ofLogError("ofxHeadlessFboPlayer") << "load(): couldn't map " << path;
+        return false;
+    }
+    mapped = static_cast<const unsigned char *>(address);
+    mappedSize = static_cast<size_t>(info.st_size);
+#endif
+
+    if (mappedSize < fileHeaderSize || std::memcmp(mapped, "HFBR", 4) != 0 || getU32(mapped + 4) != fileVersion) {
+        ofLogError("ofxHeadlessFboPlayer") << "load(): " << path << " is not a recording";
+        close();
+        return false;
+    }
+
+    w = getU32(mapped + 8);
+    h = getU32(mapped + 12);
+    pixelFormat = static_cast<ofPixelFormat>(getU32(mapped + 16));
+    frameBytes = getU32(mapped + 20);
+    const size_t capacity = getU32(mapped + 24);
+    numFrames = std::min<size_t>(getU32(mapped + 28), capacity);
+    const uint32_t rate = getU32(mapped + 32);
+    std::memcpy(&frameRate, &rate, sizeof(frameRate));
+
+    if (w == 0 || h == 0 || frameBytes != ofPixels::bytesFromPixelFormat(w, h, pixelFormat) ||
+        fileHeaderSize + capacity * indexEntrySize > mappedSize) {
+        ofLogError("ofxHeadlessFboPlayer") << "load(): " << path << " has an invalid header";
+        close();
+        return false;
+    }
+    for (size_t i = 0; i < numFrames; ++i) {
+        const IndexEntry entry = getEntry(i);
+        if (entry.offset > mappedSize || entry.size > mappedSize - entry.offset ||
+            (entry.compression == OFX_HEADLESS_FBO_COMPRESSION_NONE && entry.size != frameBytes)) {
+            ofLogWarning("ofxHeadlessFboPlayer") << "load(): " << path << " is truncated after frame " << i;
+            numFrames = i;
+            break;
+        }
+    }
+
+    current = 0;
+    if (prefetchCount > 0) {
+        startPrefetch();
+    }
+    return true;
+}
+
+void ofxHeadlessFboPlayer::close() {
+    stopPrefetch();
+    framePixels.clear();
+    mainState = DecodeState();
+
+    if (mapped != nullptr) {
+#ifdef TARGET_WIN32
+        UnmapViewOfFile(mapped);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<unsigned char *>(mapped), mappedSize);
+#endif
+    }
+    mapped = nullptr;
+    mappedSize = 0;
+    numFrames = 0;
+    current = 0;
+}
+
+bool ofxHeadlessFboPlayer::isLoaded() const {
+    return mapped != nullptr;
+}
+
+bool ofxHeadlessFboPlayer::getFrame(size_t n, ofxHeadlessFbo &fbo) {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("playFrame");
+    if (!isLoaded() || n >= numFrames) {
+        return false;
+    }
+
+    const IndexEntry entry = getEntry(n);
+    if (entry.compression == OFX_HEADLESS_FBO_COMPRESSION_NONE) {
+        fbo.setFromPixels(mapped + entry.offset, w, h, pixelFormat);
+#ifndef TARGET_WIN32
+        // let the kernel read ahead the frames we are going to need next
+        if (prefetchCount > 0 && n + 1 < numFrames) {
+            const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            const IndexEntry next = getEntry(n + 1);
+            const size_t start = next.offset / pageSize * pageSize;
+            const size_t end = std::min(mappedSize, static_cast<size_t>(next.offset) + prefetchCount * frameBytes);
+            madvise(const_cast<unsigned char *>(mapped + start), end - start, MADV_WILLNEED);
+        }
+#endif
+    } else {
+        bool found = false;
+        {
+            std::unique_lock<std::mutex> lock(prefetchMutex);
+            for (auto it = prefetched.begin(); it != prefetched.end(); ++it) {
+                if (it->index == n) {
+                    framePixels.clear();
+                    framePixels.swap(it->pixels);
+                    prefetched.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            framePixels.clear();
+            if (!decodeFrame(n, framePixels, mainState)) {
+                return false;
+            }
+        }
+        fbo.setFromPixels(framePixels.getData(), w, h, pixelFormat);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(prefetchMutex);
+        current = n + 1;
+        prefetchFrom = wrapIndex(n + 1);
+    }
+    prefetchCondition.notify_one();
+    return true;
+}
+
+const ofPixels &ofxHeadlessFboPlayer::getFramePixels(size_t n) {
+    if (!isLoaded() || n >= numFrames) {
+        framePixels.clear();
+        return framePixels;
+    }
+
+    const IndexEntry entry = getEntry(n);
+    if (entry.compression == OFX_HEADLESS_FBO_COMPRESSION_NONE) {
+        framePixels.setFromExternalPixels(const_cast<unsigned char *>(mapped + entry.offset), w, h, pixelFormat);
+    } else {
+        // never decode into a previously wrapped mapping
+        framePixels.clear();
+        if (!decodeFrame(n, framePixels, mainState)) {
+            framePixels.clear();
+        }
+    }
+    return framePixels;
+}
+
+bool ofxHeadlessFboPlayer::nextFrame(ofxHeadlessFbo &fbo) {
+    if (!isLoaded() || numFrames == 0) {
+        return false;
+    }
+    if (current >= numFrames) {
+        if (!loop) {
+            return false;
+        }
+        current = 0;
+    }
+    return getFrame(current, fbo);
+}
+
+void ofxHeadlessFboPlayer::setFrame(size_t n) {
+    {
+        std::unique_lock<std::mutex> lock(prefetchMutex);
+        current = std::min(n, numFrames);
+        prefetchFrom = wrapIndex(current);
+    }
+    prefetchCondition.notify_one();
+}
+
+size_t ofxHeadlessFboPlayer::getCurrentFrame() const {
+    return current;
+}
+
+void ofxHeadlessFboPlayer::setLoop(bool loop) {
+    {
+        std::unique_lock<std::mutex> lock(prefetchMutex);
+        this->loop = loop;
+        prefetchFrom = wrapIndex(current);
+    }
+    prefetchCondition.notify_one();
+}
+
+bool ofxHeadlessFboPlayer::isLooping() const {
+    return loop;
+}
+
+void ofxHeadlessFboPlayer::setPrefetch(size_t count) {
+    stopPrefetch();
+    prefetchCount = count;
+    if (prefetchCount > 0 && isLoaded()) {
+        startPrefetch();
+    }
+}
+
+size_t ofxHeadlessFboPlayer::getNumFrames() const {
+    return numFrames;
+}
+
+size_t ofxHeadlessFboPlayer::getWidth() const {
+    return w;
+}
+
+size_t ofxHeadlessFboPlayer::getHeight() const {
+    return h;
+}
+
+ofPixelFormat ofxHeadlessFboPlayer::getPixelFormat() const {
+    return pixelFormat;
+}
+
+float ofxHeadlessFboPlayer::getFrameRate() const {
+    return frameRate;
+}
+
+ofxHeadlessFboPlayer::IndexEntry ofxHeadlessFboPlayer::getEntry(size_t n) const {
+    const unsigned char *p = mapped + fileHeaderSize + n * indexEntrySize;
+    IndexEntry entry;
+    entry.offset = getU64(p);
+    entry.size = getU32(p + 8);
+    entry.compression = p[12];
+    entry.flags = p[13];
+    return entry;
+}
+
+size_t ofxHeadlessFboPlayer::wrapIndex(size_t n) const {
+    if (loop && numFrames > 0) {
+        return n % numFrames;
+    }
+    return n;
+}
+
+bool ofxHeadlessFboPlayer::decodeFrame(size_t n, ofPixels &out, DecodeState &state) const {
+    OFX_HEADLESS_FBO_TRACE_SCOPE("decodeFrame");
+    const IndexEntry entry = getEntry(n);
+    const unsigned char *data = mapped + entry.offset;
+
+    switch (entry.compression) {
+        case OFX_HEADLESS_FBO_COMPRESSION_NONE:
+            out.setFromPixels(data, w, h, pixelFormat);
+            return true;
+        case OFX_HEADLESS_FBO_COMPRESSION_RLE:
+            out.allocate(w, h, pixelFormat);
+            return decodeRle(data, entry.size, out.getData(), w * h, frameBytes / (w * h));
+        case OFX_HEADLESS_FBO_COMPRESSION_DELTA:
+            {
+                // deltas apply on top of the previous frame, replay from the last keyframe if needed
+                size_t first = n;
+                if (state.lastIndex < 0 || static_cast<size_t>(state.lastIndex) + 1 != n) {
+                    while (first > 0 && (getEntry(first).flags & entryKeyframe) == 0) {
+                        --first;
+                    }
+                    state.decoder.reset();
+                }
+                for (size_t i = first; i <= n; ++i) {
+                    const IndexEntry e = getEntry(i);
+                    if (!state.decoder.decode(mapped + e.offset, e.size)) {
+                        state.lastIndex = -1;
+                        return false;
+                    }
+                }
+                state.lastIndex = static_cast<long long>(n);
+                const ofPixels &decoded = state.decoder.getPixels();
+                out.setFromPixels(decoded.getData(), w, h, pixelFormat);
+                return true;
+            }
+        default:
+            return false;
+    }
+}
+
+void ofxHeadlessFboPlayer::startPrefetch() {
+    if (prefetchRunning) {
+        return;
+    }
+    prefetchRunning = true;
+    prefetchFrom = wrapIndex(current);
+    prefetchThread = std::thread(&ofxHeadlessFboPlayer::prefetchLoop, this);
+}
+
+void ofxHeadlessFboPlayer::stopPrefetch() {
+    {
+        std::unique_lock<std::mutex> lock(prefetchMutex);
+        if (!prefetchRunning) {
+            return;
+        }
+        prefetchRunning = false;
+    }
+    prefetchCondition.notify_one();
+    if (prefetchThread.joinable()) {
+        prefetchThread.join();
+    }
+    prefetched.clear();
+}
+
+void ofxHeadlessFboPlayer::prefetchLoop() {
+    DecodeState state;
+    OFX_HEADLESS_FBO_TRACE_THREAD("ofxHeadlessFboPlayer prefetch");
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+
+    while (prefetchRunning) {
+        // the frames we want decoded ahead of the playback position
+        std::vector<size_t> wanted;
+        for (size_t i = 0; i < prefetchCount; ++i) {
+            size_t index = prefetchFrom + i;
+            if (index >= numFrames) {
+                if (!loop || numFrames == 0) {
+                    break;
+                }
+                index %= numFrames;
+            }
+            wanted.push_back(index);
+        }
+
+        prefetched.erase(std::remove_if(prefetched.begin(), prefetched.end(),
+                                        [&](const Prefetched &p) {
+                                            return std::find(wanted.begin(), wanted.end(), p.index) == wanted.end();
+                                        }),
+                         prefetched.end());
+
+        bool hasWork = false;
+        size_t next = 0;
+        for (size_t index : wanted) {
+            if (getEntry(index).compression == OFX_HEADLESS_FBO_COMPRESSION_NONE) {
+                continue;
+            }
+            const bool done = std::any_of(prefetched.begin(), prefetched.end(),
+                                          [&](const Prefetched &p) { return p.index == index; });
+            if (!done) {
+                next = index;
+                hasWork = true;
+                break;
+            }
+        }
+
+        if (!hasWork) {
+            prefetchCondition.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        Prefetched frame;
+        frame.index = next;
+        const bool decoded = decodeFrame(next, frame.pixels, state);
+        lock.lock();
+
+        if (!decoded) {
+            // don't spin on a broken frame, wait for the playback position to move
+            prefetchCondition.wait(lock);
+            continue;
+        }
+        prefetched.push_back(std::move(frame));
+    }
+}
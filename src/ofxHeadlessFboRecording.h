@@ -0,0 +1,238 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofPixels.h"
+#include "ofxHeadlessFbo.h"
+#include "ofxHeadlessFboDelta.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @file
+/// Recording of ofxHeadlessFbo frames into a single file and random access
+/// playback through a memory mapping.
+///
+/// File layout, all integers little endian:
+///
+///     header      64 bytes
+///         magic       4 bytes  "HFBR"
+///         version     uint32
+///         width       uint32
+///         height      uint32
+///         format      uint32   ofPixelFormat
+///         frameBytes  uint32   size of an uncompressed frame
+///         capacity    uint32   number of index entries
+///         frameCount  uint32   number of recorded frames
+///         frameRate   float32
+///         reserved    28 bytes
+///     index       capacity x 16 bytes
+///         offset      uint64   absolute file offset of the frame data
+///         size        uint32   size of the frame data
+///         compression uint8    ofxHeadlessFboCompression
+///         flags       uint8    bit 0 set for keyframes
+///         reserved    2 bytes
+///     frame data
+
+enum ofxHeadlessFboCompression {
+    OFX_HEADLESS_FBO_COMPRESSION_NONE = 0,
+    /// PackBits style run length encoding of whole pixels.
+    OFX_HEADLESS_FBO_COMPRESSION_RLE = 1,
+    /// ofxHeadlessFboDeltaEncoder stream, frames depend on the previous keyframe.
+    OFX_HEADLESS_FBO_COMPRESSION_DELTA = 2,
+};
+
+class ofxHeadlessFboRecorder {
+    public:
+    ~ofxHeadlessFboRecorder();
+
+    /// @brief Creates the recording file and preallocates room for the frames.
+    ///
+    /// ~~~~{.cpp}
+    /// recorder.open("show.hfbr", 800, 300, OF_PIXELS_RGB, 60 * 60 * 5);
+    /// // every frame
+    /// recorder.addFrame(hfbo);
+    /// // when done
+    /// recorder.close();
+    /// ~~~~
+    ///
+    /// @param path File to write, relative paths are resolved in the data folder
+    /// @param w Width of the recorded frames
+    /// @param h Height of the recorded frames
+    /// @param pixelFormat Pixel format of the recorded frames
+    /// @param maxFrames Number of frames the index table can hold
+    /// @param compression Compression applied to the frames
+    /// @param frameRate Playback frame rate stored in the header
+    /// @returns false if the file could not be created.
+    bool open(const std::string &path, size_t w, size_t h, ofPixelFormat pixelFormat, size_t maxFrames,
+              ofxHeadlessFboCompression compression = OFX_HEADLESS_FBO_COMPRESSION_NONE, float frameRate = 60);
+
+    /// @brief Appends the current content of the buffer.
+    ///
+    /// @returns false if the buffer doesn't match the recording or the
+    /// index table is full.
+    bool addFrame(const ofxHeadlessFbo &fbo);
+    bool addFrame(const unsigned char *data);
+
+    /// @brief Writes the index table and trims the preallocated space.
+    void close();
+
+    bool isOpen() const;
+    size_t getNumFrames() const;
+
+    /// @brief Emit a keyframe every n frames when using delta compression.
+    void setKeyframeInterval(size_t n);
+
+    private:
+    bool writeAt(uint64_t offset, const void *data, size_t size);
+    void writeHeader();
+
+    std::FILE *file = nullptr;
+    size_t w = 0;
+    size_t h = 0;
+    ofPixelFormat pixelFormat = OF_PIXELS_UNKNOWN;
+    size_t frameBytes = 0;
+    size_t pixelBytes = 0;
+    size_t capacity = 0;
+    size_t frameCount = 0;
+    float frameRate = 60;
+    uint64_t dataEnd = 0;
+    ofxHeadlessFboCompression compression = OFX_HEADLESS_FBO_COMPRESSION_NONE;
+    ofxHeadlessFboDeltaEncoder deltaEncoder;
+    std::vector<unsigned char> scratch;
+};
+
+class ofxHeadlessFboPlayer {
+    public:
+    ~ofxHeadlessFboPlayer();
+
+    /// @brief Maps a recording into memory.
+    ///
+    /// ~~~~{.cpp}
+    /// player.load("show.hfbr");
+    /// player.setLoop(true);
+    /// player.setPrefetch(4);
+    /// // every frame
+    /// player.nextFrame(hfbo);
+    /// ~~~~
+    bool load(const std::string &path);
+    void close();
+    bool isLoaded() const;
+
+    /// @brief Decodes frame n into the buffer.
+    ///
+    /// Uncompressed frames are copied straight from the mapping into the
+    /// buffer, compressed frames are taken from the prefetch queue when they
+    /// are already decoded.
+    bool getFrame(size_t n, ofxHeadlessFbo &fbo);
+
+    /// @brief Direct read-only view of an uncompressed frame in the mapping.
+    ///
+    /// Nothing is copied, the returned pixels stay valid until the next call
+    /// or until the player is closed. Compressed frames are decoded into an
+    /// internal buffer instead.
+    const ofPixels &getFramePixels(size_t n);
+
+    /// @brief Decodes the frame after the current one, wrapping around when looping.
+    ///
+    /// @returns false at the end of a recording that doesn't loop.
+    bool nextFrame(ofxHeadlessFbo &fbo);
+
+    /// @brief Sets the frame returned by the next call to nextFrame().
+    void setFrame(size_t n);
+    size_t getCurrentFrame() const;
+
+    void setLoop(bool loop);
+    bool isLooping() const;
+
+    /// @brief Decodes up to count upcoming frames on a background thread, 0 stops prefetching.
+    void setPrefetch(size_t count);
+
+    size_t getNumFrames() const;
+    size_t getWidth() const;
+    size_t getHeight() const;
+    ofPixelFormat getPixelFormat() const;
+    float getFrameRate() const;
+
+    private:
+    struct IndexEntry {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        unsigned char compression = 0;
+        unsigned char flags = 0;
+    };
+
+    struct DecodeState {
+        ofxHeadlessFboDeltaDecoder decoder;
+        long long lastIndex = -1;
+    };
+
+    struct Prefetched {
+        size_t index;
+        ofPixels pixels;
+    };
+
+    bool decodeFrame(size_t n, ofPixels &out, DecodeState &state) const;
+    IndexEntry getEntry(size_t n) const;
+    size_t wrapIndex(size_t n) const;
+    void startPrefetch();
+    void stopPrefetch();
+    void prefetchLoop();
+
+    const unsigned char *mapped = nullptr;
+    size_t mappedSize = 0;
+#ifdef TARGET_WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+    size_t w = 0;
+    size_t h = 0;
+    ofPixelFormat pixelFormat = OF_PIXELS_UNKNOWN;
+    size_t frameBytes = 0;
+    size_t numFrames = 0;
+    float frameRate = 60;
+    size_t current = 0;
+    bool loop = false;
+
+    ofPixels framePixels;
+    DecodeState mainState;
+
+    std::thread prefetchThread;
+    std::mutex prefetchMutex;
+    std::condition_variable prefetchCondition;
+    std::deque<Prefetched> prefetched;
+    size_t prefetchCount = 0;
+    size_t prefetchFrom = 0;
+    bool prefetchRunning = false;
+};
@@ -0,0 +1,264 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboScheduler.h"
+#include "ofxHeadlessFboTrace.h"
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+namespace {
+const size_t minScratchBlock = 64 * 1024;
+} // namespace
+
+void *ofxHeadlessFboScheduler::Scratch::allocate(size_t bytes, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        alignment = 16;
+    }
+    if (!blocks.empty()) {
+        Block &block = blocks.back();
+        const uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get()) + used;
+        const size_t padding = (alignment - address % alignment) % alignment;
+        if (used + padding + bytes <= block.size) {
+            void *p = block.data.get() + used + padding;
+            used += padding + bytes;
+            return p;
+        }
+    }
+    // earlier blocks stay valid until the next reset
+    const size_t size = std::max({bytes + alignment, capacity, minScratchBlock});
+    blocks.push_back(Block{std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+    capacity += size;
+    used = 0;
+    return allocate(bytes, alignment);
+}
+
+size_t ofxHeadlessFboScheduler::Scratch::getCapacity() const {
+    return capacity;
+}
+
+void ofxHeadlessFboScheduler::Scratch::reset() {
+    // a task that needed several blocks gets them as one from now on
+    if (blocks.size() > 1) {
+        blocks.clear();
+        blocks.push_back(Block{std::unique_ptr<unsigned char[]>(new unsigned char[capacity]), capacity});
+    }
+    used = 0;
+}
+
+ofxHeadlessFboScheduler::~ofxHeadlessFboScheduler() {
+    close();
+}
+
+void ofxHeadlessFboScheduler::setup(size_t numThreads) {
+    close();
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    running = true;
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers[i]->thread = std::thread(&ofxHeadlessFboScheduler::workerLoop, this, i);
+    }
+}
+
+void ofxHeadlessFboScheduler::close() {
+    wait();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_all();
+    for (auto &worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    workers.clear();
+}
+
+size_t ofxHeadlessFboScheduler::getNumThreads() const {
+    return workers.size();
+}
+
+size_t ofxHeadlessFboScheduler::add(ofxHeadlessFbo &fbo, RenderFunction render) {
+    wait();
+    Task task;
+    task.fbo = &fbo;
+    task.render = std::move(render);
+    tasks.push_back(std::move(task));
+    return tasks.size() - 1;
+}
+
+void ofxHeadlessFboScheduler::clear() {
+    wait();
+    tasks.clear();
+}
+
+size_t ofxHeadlessFboScheduler::size() const {
+    return tasks.size();
+}
+
+std::shared_future<void> ofxHeadlessFboScheduler::renderAsync() {
+    wait();
+    if (workers.empty() && !tasks.empty()) {
+        setup();
+    }
+    uint64_t next;
+    {
+        // the last task of the previous frame completes its promise under this lock
+        std::unique_lock<std::mutex> lock(mutex);
+        done = std::promise<void>();
+        current = done.get_future().share();
+        error = nullptr;
+        steals = 0;
+        remaining = tasks.size();
+        frameStart = std::chrono::steady_clock::now();
+        next = frame + 1;
+    }
+    if (tasks.empty()) {
+        done.set_value();
+        return current;
+    }
+
+    // longest tasks first, each to the worker with the least work so far,
+    // tagged with the frame so workers still draining the previous one
+    // leave them alone until they are woken
+    std::vector<size_t> order(tasks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t a, size_t b) { return tasks[a].cost > tasks[b].cost; });
+    std::vector<uint64_t> loads(workers.size(), 0);
+    for (size_t task : order) {
+        const size_t worker = std::min_element(loads.begin(), loads.end()) - loads.begin();
+        std::unique_lock<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->queue.push_back(Queued{next, task});
+        loads[worker] += std::max<uint64_t>(tasks[task].cost, 1);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        frame = next;
+    }
+    condition.notify_all();
+    return current;
+}
+
+void ofxHeadlessFboScheduler::render() {
+    renderAsync().get();
+}
+
+void ofxHeadlessFboScheduler::wait() {
+    if (current.valid()) {
+        current.wait();
+    }
+}
+
+uint64_t ofxHeadlessFboScheduler::getCost(size_t task) const {
+    return task < tasks.size() ? tasks[task].cost : 0;
+}
+
+uint64_t ofxHeadlessFboScheduler::getFrameTime() const {
+    return frameTime;
+}
+
+uint64_t ofxHeadlessFboScheduler::getSteals() const {
+    return steals;
+}
+
+void ofxHeadlessFboScheduler::workerLoop(size_t index) {
+    OFX_HEADLESS_FBO_TRACE_THREAD("ofxHeadlessFboScheduler " + std::to_string(index));
+    Worker &worker = *workers[index];
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() { return !running || frame != seen; });
+            if (!running) {
+                return;
+            }
+            seen = frame;
+        }
+        size_t task;
+        while (popTask(index, seen, task)) {
+            runTask(worker, task);
+        }
+    }
+}
+
+bool ofxHeadlessFboScheduler::popTask(size_t worker, uint64_t frame, size_t &task) {
+    {
+        Worker &own = *workers[worker];
+        std::unique_lock<std::mutex> lock(own.mutex);
+        if (!own.queue.empty() && own.queue.front().frame == frame) {
+            task = own.queue.front().task;
+            own.queue.pop_front();
+            return true;
+        }
+    }
+    // steal the shortest task of another worker
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker &victim = *workers[(worker + i) % workers.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty() && victim.queue.back().frame == frame) {
+            task = victim.queue.back().task;
+            victim.queue.pop_back();
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ofxHeadlessFboScheduler::runTask(Worker &worker, size_t index) {
+    Task &task = tasks[index];
+    const auto start = std::chrono::steady_clock::now();
+    worker.scratch.reset();
+    try {
+        OFX_HEADLESS_FBO_TRACE_SCOPE("renderTask");
+        task.render(*task.fbo, worker.scratch);
+    } catch (...) {
+        std::unique_lock<std::mutex> lock(errorMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    task.cost = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    if (remaining.fetch_sub(1) == 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        frameTime = std::chrono::duration_cast<std::chrono::nanoseconds>(end - frameStart).count();
+        if (error) {
+            done.set_exception(error);
+        } else {
+            done.set_value();
+        }
+    }
+}
@@ -0,0 +1,174 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofxHeadlessFbo.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @file
+/// Renders many independent canvases in parallel.
+///
+/// Every canvas is a task with its own render callback. A frame hands out
+/// the tasks to a pool of worker threads, longest first according to the
+/// time they took in the previous frame, and workers that run out of work
+/// steal tasks queued for the others. Each worker owns a scratch arena the
+/// callbacks can use for temporary memory without allocating.
+///
+/// ~~~~{.cpp}
+/// ofxHeadlessFboScheduler scheduler;
+/// scheduler.setup();
+/// for (auto &panel : panels) {
+///     scheduler.add(panel.fbo, [&panel](ofxHeadlessFbo &fbo, ofxHeadlessFboScheduler::Scratch &scratch) {
+///         panel.draw(fbo);
+///     });
+/// }
+///
+/// void ofApp::update(){
+///     scheduler.render(); // returns once every panel is drawn
+/// }
+/// ~~~~
+
+class ofxHeadlessFboScheduler {
+    public:
+    /// Bump allocator of a worker thread, emptied before every task.
+    class Scratch {
+        public:
+        /// @brief Uninitialized memory that stays valid until the task returns.
+        void *allocate(size_t bytes, size_t alignment = 16);
+        template <typename T>
+        T *allocate(size_t count) {
+            return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+        }
+        /// @brief Bytes reserved by the arena.
+        size_t getCapacity() const;
+
+        private:
+        friend class ofxHeadlessFboScheduler;
+        void reset();
+
+        struct Block {
+            std::unique_ptr<unsigned char[]> data;
+            size_t size;
+        };
+        std::vector<Block> blocks;
+        size_t used = 0;
+        size_t capacity = 0;
+    };
+
+    typedef std::function<void(ofxHeadlessFbo &fbo, Scratch &scratch)> RenderFunction;
+
+    ~ofxHeadlessFboScheduler();
+
+    /// @brief Starts the worker threads.
+    ///
+    /// @param numThreads Number of workers, 0 for one per hardware thread
+    void setup(size_t numThreads = 0);
+    /// @brief Waits for the current frame and stops the workers.
+    void close();
+    size_t getNumThreads() const;
+
+    /// @brief Adds a canvas and the callback drawing it, waits for the current frame.
+    ///
+    /// The canvas has to outlive the scheduler or be removed with clear().
+    /// Callbacks run on the worker threads, concurrently with each other.
+    ///
+    /// @returns Index of the task
+    size_t add(ofxHeadlessFbo &fbo, RenderFunction render);
+    /// @brief Removes all tasks, waits for the current frame.
+    void clear();
+    size_t size() const;
+
+    /// @brief Starts rendering a frame of all tasks and returns right away.
+    ///
+    /// The future becomes ready when every callback returned, it rethrows
+    /// the first exception thrown by a callback. A frame still in flight is
+    /// waited for first. Starts the workers if setup() wasn't called.
+    std::shared_future<void> renderAsync();
+    /// @brief Renders a frame of all tasks and waits for it.
+    void render();
+    /// @brief Waits for the frame in flight, if any.
+    void wait();
+
+    /// @brief Time the task took in the last frame, in nanoseconds.
+    uint64_t getCost(size_t task) const;
+    /// @brief Time from the start of the last frame until its last task finished, in nanoseconds.
+    uint64_t getFrameTime() const;
+    /// @brief Tasks run by another worker than the one they were queued for in the last frame.
+    uint64_t getSteals() const;
+
+    private:
+    struct Task {
+        ofxHeadlessFbo *fbo;
+        RenderFunction render;
+        uint64_t cost = 0;
+    };
+
+    struct Queued {
+        uint64_t frame;
+        size_t task;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Queued> queue;
+        Scratch scratch;
+    };
+
+    void workerLoop(size_t index);
+    bool popTask(size_t worker, uint64_t frame, size_t &task);
+    void runTask(Worker &worker, size_t task);
+
+    std::vector<Task> tasks;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    uint64_t frame = 0;
+    bool running = false;
+
+    std::atomic<size_t> remaining{0};
+    std::atomic<uint64_t> steals{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    std::promise<void> done;
+    std::shared_future<void> current;
+    std::chrono::steady_clock::time_point frameStart;
+    uint64_t frameTime = 0;
+};
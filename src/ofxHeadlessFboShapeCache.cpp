@@ -0,0 +1,117 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboShapeCache.h"
+#include <algorithm>
+
+ofxHeadlessFboShapeCache::Key::Key(Shape shape, std::initializer_list<int32_t> values) : shape(shape) {
+    const size_t count = values.size() < NUM_PARAMS ? values.size() : NUM_PARAMS;
+    std::copy_n(values.begin(), count, params);
+}
+
+bool ofxHeadlessFboShapeCache::Key::operator==(const Key &other) const {
+    return shape == other.shape && std::equal(params, params + NUM_PARAMS, other.params);
+}
+
+size_t ofxHeadlessFboShapeCache::KeyHash::operator()(const Key &key) const {
+    // FNV-1a over the shape and its parameters
+    uint64_t hash = 14695981039346656037ull;
+    hash = (hash ^ static_cast<uint64_t>(key.shape)) * 1099511628211ull;
+    for (int32_t param : key.params) {
+        hash = (hash ^ static_cast<uint32_t>(param)) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+void ofxHeadlessFboShapeCache::setMaxBytes(size_t maxBytes) {
+    this->maxBytes = maxBytes;
+    evict(0);
+}
+
+size_t ofxHeadlessFboShapeCache::getMaxBytes() const {
+    return maxBytes;
+}
+
+bool ofxHeadlessFboShapeCache::isEnabled() const {
+    return maxBytes > 0;
+}
+
+const std::vector<ofxHeadlessFboShapeCache::Span> *ofxHeadlessFboShapeCache::find(const Key &key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+    stats.hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->spans;
+}
+
+size_t ofxHeadlessFboShapeCache::getEntryBytes(size_t numSpans) {
+    // the list and map nodes are counted as part of the entry
+    return sizeof(Entry) + sizeof(Key) + 4 * sizeof(void *) + numSpans * sizeof(Span);
+}
+
+void ofxHeadlessFboShapeCache::insert(const Key &key, const std::vector<Span> &spans) {
+    const size_t bytes = getEntryBytes(spans.size());
+    if (bytes > maxBytes || index.count(key) > 0) {
+        return;
+    }
+    evict(bytes);
+    entries.push_front(Entry{key, spans, bytes});
+    index.emplace(key, entries.begin());
+    stats.entries = entries.size();
+    stats.bytes += bytes;
+}
+
+void ofxHeadlessFboShapeCache::evict(size_t bytes) {
+    while (!entries.empty() && stats.bytes + bytes > maxBytes) {
+        const Entry &last = entries.back();
+        stats.bytes -= last.bytes;
+        stats.evictions++;
+        index.erase(last.key);
+        entries.pop_back();
+    }
+    stats.entries = entries.size();
+}
+
+void ofxHeadlessFboShapeCache::clear() {
+    entries.clear();
+    index.clear();
+    stats.entries = 0;
+    stats.bytes = 0;
+}
+
+const ofxHeadlessFboShapeCache::Stats &ofxHeadlessFboShapeCache::getStats() const {
+    return stats;
+}
+
+void ofxHeadlessFboShapeCache::resetStats() {
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+}
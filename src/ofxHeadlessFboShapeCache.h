@@ -0,0 +1,132 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/// @file
+/// Bounded cache of rasterized filled shapes.
+///
+/// ofxHeadlessFbo records one pixel span per row of filled circles, ellipses
+/// and rounded rectangles, relative to the shape's top left corner. Drawing the same
+/// shape again, anywhere on the canvas, replays the recorded spans instead
+/// of running the rasterizer. The least recently used shapes are dropped
+/// once the cache grows beyond its memory cap.
+///
+/// ~~~~{.cpp}
+/// hfbo.setShapeCacheSize(256 * 1024);
+/// for (auto &particle : particles) {
+///     hfbo.drawCircle(particle.x, particle.y, 4);
+/// }
+/// const auto &stats = hfbo.getShapeCacheStats();
+/// ofLog() << "hits " << stats.hits << " misses " << stats.misses;
+/// ~~~~
+
+class ofxHeadlessFboShapeCache {
+    public:
+    enum Shape {
+        CIRCLE,
+        ELLIPSE,
+        RECT_ROUNDED,
+    };
+
+    /// Integer parameters that fully determine the rasterized shape.
+    struct Key {
+        static const size_t NUM_PARAMS = 7;
+
+        Key(Shape shape, std::initializer_list<int32_t> values);
+        bool operator==(const Key &other) const;
+
+        Shape shape;
+        int32_t params[NUM_PARAMS] = {};
+    };
+
+    /// Horizontal run of pixels relative to the shape's top left corner.
+    struct Span {
+        int32_t row;
+        int32_t left;
+        int32_t right;
+    };
+
+    struct Stats {
+        /// shapes drawn from the cache
+        uint64_t hits = 0;
+        /// shapes rasterized and recorded
+        uint64_t misses = 0;
+        /// shapes dropped to stay below the memory cap
+        uint64_t evictions = 0;
+        /// shapes currently cached
+        size_t entries = 0;
+        /// memory used by the cached shapes
+        size_t bytes = 0;
+    };
+
+    /// @brief Sets the memory cap in bytes, 0 disables the cache.
+    void setMaxBytes(size_t maxBytes);
+    size_t getMaxBytes() const;
+    bool isEnabled() const;
+
+    /// @brief Looks up a shape and marks it as most recently used.
+    /// @returns The recorded spans, nullptr if the shape isn't cached.
+    const std::vector<Span> *find(const Key &key);
+
+    /// @brief Stores the spans of a shape, dropping the least recently used
+    /// shapes when needed. Shapes larger than the cap aren't stored.
+    void insert(const Key &key, const std::vector<Span> &spans);
+
+    /// @brief Memory an entry of numSpans spans takes, including its list
+    /// and map nodes.
+    static size_t getEntryBytes(size_t numSpans);
+
+    void clear();
+    const Stats &getStats() const;
+    void resetStats();
+
+    private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<Span> spans;
+        size_t bytes;
+    };
+
+    void evict(size_t bytes);
+
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    size_t maxBytes = 1024 * 1024;
+    Stats stats;
+};
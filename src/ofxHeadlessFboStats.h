@@ -0,0 +1,106 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/// @file
+/// Hot path counters of ofxHeadlessFbo.
+///
+/// The counters are compiled out unless OFX_HEADLESS_FBO_STATS is defined,
+/// for example with `PROJECT_DEFINES = OFX_HEADLESS_FBO_STATS` in the
+/// project's config.make or `-DOFX_HEADLESS_FBO_STATS` in the compiler flags.
+/// Defining OFX_HEADLESS_FBO_STATS_TIMING additionally measures the time
+/// spent in every draw call family.
+///
+/// ~~~~{.cpp}
+/// hfbo.resetStats();
+/// drawScene();
+/// const auto &stats = hfbo.getStats();
+/// ofLog() << "circles " << stats.primitives[ofxHeadlessFboStats::CIRCLE].calls;
+/// ~~~~
+
+struct ofxHeadlessFboStats {
+    enum Primitive {
+        CLEAR,
+        POINT,
+        LINE,
+        RECTANGLE,
+        TRIANGLE,
+        CIRCLE,
+        RECT_ROUNDED,
+        ELLIPSE,
+        FLOOD_FILL,
+        MESH,
+        FILL_WITH,
+        NUM_PRIMITIVES,
+    };
+
+    struct PrimitiveStats {
+        /// number of draw calls
+        uint64_t calls = 0;
+        /// calls that didn't reach a single pixel, clipped or degenerate
+        uint64_t rejected = 0;
+        /// spans written on behalf of this primitive
+        uint64_t spans = 0;
+        /// pixels covered by those spans
+        uint64_t pixels = 0;
+        /// time spent in the calls, only with OFX_HEADLESS_FBO_STATS_TIMING
+        uint64_t nanoseconds = 0;
+    };
+
+    PrimitiveStats primitives[NUM_PRIMITIVES];
+
+    /// spans passed to the span writer
+    uint64_t spans = 0;
+    /// pixels replaced without blending, including opaque colors when blending
+    uint64_t pixelsOverwritten = 0;
+    /// pixels blended with the destination
+    uint64_t pixelsBlended = 0;
+    /// pixels skipped because the color is fully transparent
+    uint64_t pixelsSkipped = 0;
+    /// pixels written through the generic ofPixels::setColor fallback
+    uint64_t pixelsSlowPath = 0;
+
+    static const char *getPrimitiveName(Primitive primitive) {
+        switch (primitive) {
+            case CLEAR: return "clear";
+            case POINT: return "point";
+            case LINE: return "line";
+            case RECTANGLE: return "rectangle";
+            case TRIANGLE: return "triangle";
+            case CIRCLE: return "circle";
+            case RECT_ROUNDED: return "rectRounded";
+            case ELLIPSE: return "ellipse";
+            case FLOOD_FILL: return "floodFill";
+            case MESH: return "mesh";
+            case FILL_WITH: return "fillWith";
+            default: return "unknown";
+        }
+    }
+};
@@ -0,0 +1,263 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboSwizzle.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define OFX_HEADLESS_FBO_SWIZZLE_SSSE3
+#define OFX_HEADLESS_FBO_SWIZZLE_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+// built without SSSE3, the shuffle is compiled for it and used when the cpu has it
+#include <tmmintrin.h>
+#define OFX_HEADLESS_FBO_SWIZZLE_SSSE3
+#define OFX_HEADLESS_FBO_SWIZZLE_DISPATCH
+#define OFX_HEADLESS_FBO_SWIZZLE_TARGET __attribute__((target("ssse3")))
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <tmmintrin.h>
+#define OFX_HEADLESS_FBO_SWIZZLE_SSSE3
+#define OFX_HEADLESS_FBO_SWIZZLE_DISPATCH
+#define OFX_HEADLESS_FBO_SWIZZLE_TARGET
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define OFX_HEADLESS_FBO_SWIZZLE_NEON
+#endif
+
+namespace {
+
+const unsigned char none = 0x80;
+
+// byte offsets of the channels in a pixel, -1 if missing
+struct Layout {
+    size_t channels;
+    int r, g, b, a;
+    bool gray;
+};
+
+Layout layoutOf(ofPixelFormat pixelFormat) {
+    switch (pixelFormat) {
+        case OF_PIXELS_RGB:
+            return {3, 0, 1, 2, -1, false};
+        case OF_PIXELS_BGR:
+            return {3, 2, 1, 0, -1, false};
+        case OF_PIXELS_RGBA:
+            return {4, 0, 1, 2, 3, false};
+        case OF_PIXELS_BGRA:
+            return {4, 2, 1, 0, 3, false};
+        case OF_PIXELS_GRAY:
+            return {1, 0, 0, 0, -1, true};
+        case OF_PIXELS_GRAY_ALPHA:
+            return {2, 0, 0, 0, 1, true};
+        default:
+            return {0, -1, -1, -1, -1, false};
+    }
+}
+
+// same expansion as the framebuffer output, the high bits are repeated
+void expandRgb565(const unsigned char *src, unsigned char *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i, src += 2, dst += 3) {
+        uint16_t v;
+        std::memcpy(&v, src, 2);
+        dst[0] = static_cast<unsigned char>(((v >> 11) << 3) | (v >> 13));
+        dst[1] = static_cast<unsigned char>((((v >> 5) & 0x3F) << 2) | ((v >> 9) & 0x03));
+        dst[2] = static_cast<unsigned char>(((v & 0x1F) << 3) | ((v >> 2) & 0x07));
+    }
+}
+
+void packRgb565(const unsigned char *src, unsigned char *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i, src += 3, dst += 2) {
+        const uint16_t v = static_cast<uint16_t>(((src[0] & 0xF8u) << 8) | ((src[1] & 0xFCu) << 3) | (src[2] >> 3));
+        std::memcpy(dst, &v, 2);
+    }
+}
+
+#if defined(OFX_HEADLESS_FBO_SWIZZLE_DISPATCH)
+bool hasSsse3() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+#if defined(OFX_HEADLESS_FBO_SWIZZLE_SSSE3)
+// 4 pixels per block, the masks are those of ofxHeadlessFboSwizzle
+OFX_HEADLESS_FBO_SWIZZLE_TARGET
+void shuffleSsse3(const unsigned char *src, unsigned char *dst, size_t blocks, size_t srcChannels, size_t dstChannels,
+                  const unsigned char *maskR, const unsigned char *maskG, const unsigned char *maskB,
+                  const unsigned char *fill, bool reduce) {
+    const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(maskR));
+    const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(maskG));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(maskB));
+    const __m128i alpha = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fill));
+    for (size_t block = 0; block < blocks; ++block, src += 4 * srcChannels, dst += 4 * dstChannels) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i out = _mm_shuffle_epi8(in, r);
+        if (reduce) {
+            out = _mm_max_epu8(out, _mm_max_epu8(_mm_shuffle_epi8(in, g), _mm_shuffle_epi8(in, b)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(out, alpha));
+    }
+}
+#endif
+
+} // namespace
+
+ofxHeadlessFboSwizzle::ofxHeadlessFboSwizzle(ofPixelFormat srcFormat, ofPixelFormat dstFormat)
+    : srcFormat(srcFormat), dstFormat(dstFormat) {
+    valid = isSupported(srcFormat) && isSupported(dstFormat);
+    identity = srcFormat == dstFormat;
+    if (!valid || identity) {
+        return;
+    }
+
+    // RGB565 is converted to and from RGB around the shuffle
+    const Layout src = layoutOf(srcFormat == OF_PIXELS_RGB565 ? OF_PIXELS_RGB : srcFormat);
+    const Layout dst = layoutOf(dstFormat == OF_PIXELS_RGB565 ? OF_PIXELS_RGB : dstFormat);
+    srcChannels = src.channels;
+    dstChannels = dst.channels;
+    reduce = dst.gray && !src.gray;
+    const int dstOffsets[4] = {dst.r, dst.g, dst.b, dst.a};
+    for (size_t pixel = 0; pixel < 4; ++pixel) {
+        const int base = static_cast<int>(pixel * src.channels);
+        for (size_t c = 0; c < 4; ++c) {
+            if (dstOffsets[c] < 0 || (dst.gray && (c == 1 || c == 2))) {
+                continue;
+            }
+            const size_t k = pixel * dst.channels + dstOffsets[c];
+            fill[k] = 0;
+            if (c == 3) {
+                const unsigned char alpha = src.a < 0 ? none : static_cast<unsigned char>(base + src.a);
+                maskR[k] = maskG[k] = maskB[k] = alpha;
+                fill[k] = src.a < 0 ? 255 : 0;
+            } else if (dst.gray) {
+                maskR[k] = static_cast<unsigned char>(base + src.r);
+                maskG[k] = static_cast<unsigned char>(base + src.g);
+                maskB[k] = static_cast<unsigned char>(base + src.b);
+            } else {
+                const int offsets[3] = {src.r, src.g, src.b};
+                maskR[k] = maskG[k] = maskB[k] = static_cast<unsigned char>(base + offsets[c]);
+            }
+        }
+    }
+    // bytes past the 4 pixels are written but overwritten by the next block
+    for (size_t k = 4 * dst.channels; k < 16; ++k) {
+        maskR[k] = maskG[k] = maskB[k] = none;
+        fill[k] = 0;
+    }
+}
+
+bool ofxHeadlessFboSwizzle::isSupported(ofPixelFormat pixelFormat) {
+    return pixelFormat == OF_PIXELS_RGB565 || layoutOf(pixelFormat).channels != 0;
+}
+
+bool ofxHeadlessFboSwizzle::isValid() const {
+    return valid;
+}
+
+void ofxHeadlessFboSwizzle::convert(const unsigned char *src, unsigned char *dst, size_t n) {
+    if (!valid || n == 0) {
+        return;
+    }
+    if (identity) {
+        std::memcpy(dst, src, n * (srcFormat == OF_PIXELS_RGB565 ? 2 : layoutOf(srcFormat).channels));
+        return;
+    }
+    if (srcFormat == OF_PIXELS_RGB565) {
+        scratch.resize(n * 3);
+        expandRgb565(src, scratch.data(), n);
+        if (dstFormat == OF_PIXELS_RGB) {
+            std::memcpy(dst, scratch.data(), n * 3);
+        } else {
+            shuffle(scratch.data(), dst, n);
+        }
+    } else if (dstFormat == OF_PIXELS_RGB565) {
+        if (srcFormat == OF_PIXELS_RGB) {
+            packRgb565(src, dst, n);
+            return;
+        }
+        scratch.resize(n * 3);
+        shuffle(src, scratch.data(), n);
+        packRgb565(scratch.data(), dst, n);
+    } else {
+        shuffle(src, dst, n);
+    }
+}
+
+void ofxHeadlessFboSwizzle::shuffle(const unsigned char *src, unsigned char *dst, size_t n) const {
+    size_t i = 0;
+#if defined(OFX_HEADLESS_FBO_SWIZZLE_SSSE3) || defined(OFX_HEADLESS_FBO_SWIZZLE_NEON)
+    // every block loads and stores 16 bytes, stop while both stay inside the row
+    const size_t reach = std::max((16 + srcChannels - 1) / srcChannels, (16 + dstChannels - 1) / dstChannels);
+    const size_t blocks = n >= reach ? (n - reach) / 4 + 1 : 0;
+#if defined(OFX_HEADLESS_FBO_SWIZZLE_SSSE3)
+#if defined(OFX_HEADLESS_FBO_SWIZZLE_DISPATCH)
+    static const bool ssse3 = hasSsse3();
+    if (ssse3) {
+#endif
+        shuffleSsse3(src, dst, blocks, srcChannels, dstChannels, maskR, maskG, maskB, fill, reduce);
+        i = blocks * 4;
+#if defined(OFX_HEADLESS_FBO_SWIZZLE_DISPATCH)
+    }
+#endif
+#else
+    const uint8x16_t r = vld1q_u8(maskR);
+    const uint8x16_t g = vld1q_u8(maskG);
+    const uint8x16_t b = vld1q_u8(maskB);
+    const uint8x16_t alpha = vld1q_u8(fill);
+    for (size_t block = 0; block < blocks; ++block, i += 4) {
+        const uint8x16_t in = vld1q_u8(src + i * srcChannels);
+        uint8x16_t out = vqtbl1q_u8(in, r);
+        if (reduce) {
+            out = vmaxq_u8(out, vmaxq_u8(vqtbl1q_u8(in, g), vqtbl1q_u8(in, b)));
+        }
+        vst1q_u8(dst + i * dstChannels, vorrq_u8(out, alpha));
+    }
+#endif
+#endif
+
+    // the masks of the first pixel describe every pixel
+    for (; i < n; ++i) {
+        const unsigned char *in = src + i * srcChannels;
+        unsigned char *out = dst + i * dstChannels;
+        for (size_t k = 0; k < dstChannels; ++k) {
+            if (maskR[k] == none) {
+                out[k] = fill[k];
+            } else if (reduce) {
+                out[k] = std::max(in[maskR[k]], std::max(in[maskG[k]], in[maskB[k]]));
+            } else {
+                out[k] = in[maskR[k]];
+            }
+        }
+    }
+}
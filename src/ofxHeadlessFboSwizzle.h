@@ -0,0 +1,82 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofPixels.h"
+#include <vector>
+
+/// @file
+/// Converts rows of 8 bit pixels between pixel formats in a single pass.
+///
+/// Every pair of RGB, BGR, RGBA, BGRA, GRAY and GRAY_ALPHA is a byte shuffle,
+/// optionally followed by the maximum of the color channels for gray and a
+/// constant opaque alpha. Four pixels are converted per SSSE3 or NEON
+/// shuffle, RGB565 is expanded or packed around it. On x86 builds without
+/// `-mssse3` the SSSE3 shuffle is still compiled and used when the cpu
+/// supports it, other cpus get a scalar loop.
+///
+/// ~~~~{.cpp}
+/// ofxHeadlessFboSwizzle swizzle(OF_PIXELS_RGBA, OF_PIXELS_BGR);
+/// for (size_t y = 0; y < h; ++y) {
+///     swizzle.convert(src + y * srcStride, dst + y * dstStride, w);
+/// }
+/// ~~~~
+
+class ofxHeadlessFboSwizzle {
+    public:
+    ofxHeadlessFboSwizzle(ofPixelFormat srcFormat, ofPixelFormat dstFormat);
+
+    /// @brief RGB, BGR, RGBA, BGRA, GRAY, GRAY_ALPHA and RGB565 are supported.
+    static bool isSupported(ofPixelFormat pixelFormat);
+
+    /// @brief Both formats are supported.
+    bool isValid() const;
+
+    /// @brief Converts n pixels, src and dst must not overlap.
+    void convert(const unsigned char *src, unsigned char *dst, size_t n);
+
+    private:
+    void shuffle(const unsigned char *src, unsigned char *dst, size_t n) const;
+
+    ofPixelFormat srcFormat;
+    ofPixelFormat dstFormat;
+    bool valid = false;
+    bool identity = false;
+    /// gray from color, the maximum of three shuffles
+    bool reduce = false;
+    size_t srcChannels = 0;
+    size_t dstChannels = 0;
+    /// source byte of every destination byte in a block of 4 pixels, 0x80 for none
+    unsigned char maskR[16];
+    unsigned char maskG[16];
+    unsigned char maskB[16];
+    /// or-ed into the result, 255 for alpha missing in the source
+    unsigned char fill[16];
+    /// RGB rows around RGB565 conversions
+    std::vector<unsigned char> scratch;
+};
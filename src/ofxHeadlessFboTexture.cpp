@@ -0,0 +1,78 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// the adapter is left out of builds without GL
+#ifndef OFX_HEADLESS_FBO_NO_GL
+
+#include "ofxHeadlessFboTexture.h"
+
+void ofxHeadlessFboTexture::update(const ofxHeadlessFbo &fbo) {
+    if (!fbo.isAllocated()) {
+        return;
+    }
+
+    const ofPixels &pixels = fbo.getPixels();
+    const size_t currentW = pixels.getWidth();
+    const size_t currentH = pixels.getHeight();
+    const ofPixelFormat currentPixelFormat = pixels.getPixelFormat();
+
+    // copies of a buffer share the texture, upload again when the source changes
+    bool dirty = source != &fbo || sourceVersion != fbo.getVersion();
+
+    if (!texture.isAllocated() || currentW != textureW || currentH != textureH ||
+        currentPixelFormat != texturePixelFormat) {
+        texture.allocate(pixels);
+        textureW = currentW;
+        textureH = currentH;
+        texturePixelFormat = currentPixelFormat;
+        dirty = true;
+    }
+
+    if (dirty) {
+        OFX_HEADLESS_FBO_TRACE_SCOPE("textureUpload");
+        texture.loadData(pixels);
+        source = &fbo;
+        sourceVersion = fbo.getVersion();
+    }
+}
+
+void ofxHeadlessFboTexture::draw(const ofxHeadlessFbo &fbo, float x, float y) {
+    update(fbo);
+    if (texture.isAllocated()) {
+        texture.draw(x, y);
+    }
+}
+
+ofTexture &ofxHeadlessFboTexture::getTexture() {
+    return texture;
+}
+
+const ofTexture &ofxHeadlessFboTexture::getTexture() const {
+    return texture;
+}
+
+#endif
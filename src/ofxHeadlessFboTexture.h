@@ -0,0 +1,67 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "ofTexture.h"
+#include "ofxHeadlessFbo.h"
+
+/// @file
+/// GL adapter of ofxHeadlessFbo.
+///
+/// Keeps an ofTexture in sync with the pixels of a buffer and only uploads
+/// them after they changed. ofxHeadlessFbo::draw() uses one internally, it
+/// can also be used directly to get hold of the texture.
+///
+/// ~~~~{.cpp}
+/// ofxHeadlessFboTexture texture;
+///
+/// void ofApp::draw(){
+///     texture.update(hfbo);
+///     texture.getTexture().draw(0, 0, ofGetWidth(), ofGetHeight());
+/// }
+/// ~~~~
+
+class ofxHeadlessFboTexture {
+    public:
+    /// @brief Uploads the pixels of the buffer if they changed since the last upload.
+    void update(const ofxHeadlessFbo &fbo);
+
+    /// @brief Uploads the pixels if needed and draws the texture.
+    void draw(const ofxHeadlessFbo &fbo, float x, float y);
+
+    ofTexture &getTexture();
+    const ofTexture &getTexture() const;
+
+    private:
+    ofTexture texture;
+    size_t textureW = 0;
+    size_t textureH = 0;
+    ofPixelFormat texturePixelFormat = OF_PIXELS_UNKNOWN;
+    const ofxHeadlessFbo *source = nullptr;
+    uint64_t sourceVersion = 0;
+};
@@ -0,0 +1,345 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ofxHeadlessFboTrace.h"
+#include "ofLog.h"
+#include "ofFileUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> ofxHeadlessFboTrace::enabled(false);
+thread_local int ofxHeadlessFboTrace::depth = 0;
+
+namespace {
+// consecutive draw calls further apart than this start a new batch
+const uint64_t batchGapNs = 100000;
+const size_t maxThreadName = 64;
+
+// Fields are atomic since readers copy events while the owner writes them.
+struct TraceEvent {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> duration{0};
+    std::atomic<uint32_t> count{0}; // 0 for plain events, number of calls for batches
+};
+
+struct TraceEventCopy {
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+    uint32_t count;
+};
+
+TraceEventCopy copyEvent(const TraceEvent &event) {
+    return {event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+            event.duration.load(std::memory_order_relaxed), event.count.load(std::memory_order_relaxed)};
+}
+
+// Single producer ring, only the owning thread writes. Readers copy the
+// events and drop the ones that may have been overwritten meanwhile. A batch
+// growing in place is guarded by an odd merges count while it changes.
+struct TraceBuffer {
+    TraceBuffer(size_t size, uint32_t tid) : events(new TraceEvent[size]), size(size), tid(tid) {}
+    std::unique_ptr<TraceEvent[]> events;
+    size_t size;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> merges{0};
+    uint32_t tid;
+    std::string threadName;
+    bool exited = false;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    size_t bufferSize = 65536;
+    uint32_t nextTid = 1;
+};
+
+TraceRegistry &getRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+// First valid event of a buffer, callers hold the registry lock.
+uint64_t getFirstEvent(const TraceBuffer &buffer, uint64_t head) {
+    return std::max(buffer.tail.load(std::memory_order_relaxed), head > buffer.size ? head - buffer.size : 0);
+}
+
+/// Thread state, the ring is only allocated when the thread records its
+/// first event and given up when the thread exits.
+struct LocalTrace {
+    char name[maxThreadName] = {};
+    std::shared_ptr<TraceBuffer> buffer;
+
+    ~LocalTrace() {
+        if (!buffer) {
+            return;
+        }
+        // keep the recorded events until the next clear(), in a buffer just large enough
+        TraceRegistry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        const uint64_t first = getFirstEvent(*buffer, head);
+        auto it = std::find(registry.buffers.begin(), registry.buffers.end(), buffer);
+        if (it == registry.buffers.end()) {
+            return;
+        }
+        if (first == head) {
+            registry.buffers.erase(it);
+            return;
+        }
+        std::unique_ptr<TraceEvent[]> events(new TraceEvent[head - first]);
+        for (uint64_t i = first; i < head; ++i) {
+            const TraceEventCopy event = copyEvent(buffer->events[i % buffer->size]);
+            TraceEvent &target = events[i - first];
+            target.name.store(event.name, std::memory_order_relaxed);
+            target.start.store(event.start, std::memory_order_relaxed);
+            target.duration.store(event.duration, std::memory_order_relaxed);
+            target.count.store(event.count, std::memory_order_relaxed);
+        }
+        buffer->events = std::move(events);
+        buffer->size = head - first;
+        buffer->tail.store(0, std::memory_order_relaxed);
+        buffer->head.store(head - first, std::memory_order_relaxed);
+        buffer->exited = true;
+    }
+};
+
+thread_local LocalTrace localTrace;
+
+TraceBuffer &getLocalBuffer() {
+    if (!localTrace.buffer) {
+        TraceRegistry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        localTrace.buffer = std::make_shared<TraceBuffer>(std::max<size_t>(registry.bufferSize, 1), registry.nextTid++);
+        localTrace.buffer->threadName = localTrace.name;
+        registry.buffers.push_back(localTrace.buffer);
+    }
+    return *localTrace.buffer;
+}
+
+void writeEvent(TraceEvent &event, const char *name, uint64_t startNs, uint64_t endNs, uint32_t count) {
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(startNs, std::memory_order_relaxed);
+    event.duration.store(endNs - startNs, std::memory_order_relaxed);
+    event.count.store(count, std::memory_order_relaxed);
+}
+
+void appendEscaped(std::ostringstream &out, const char *text) {
+    for (const char *c = text; *c != '\0'; ++c) {
+        switch (*c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20) {
+                    out << *c;
+                }
+                break;
+        }
+    }
+}
+} // namespace
+
+void ofxHeadlessFboTrace::setEnabled(bool enabled) {
+    ofxHeadlessFboTrace::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void ofxHeadlessFboTrace::setBufferSize(size_t events) {
+    TraceRegistry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.bufferSize = events;
+}
+
+void ofxHeadlessFboTrace::setThreadName(const std::string &name) {
+    const size_t length = std::min(name.size(), maxThreadName - 1);
+    std::memcpy(localTrace.name, name.data(), length);
+    localTrace.name[length] = '\0';
+    if (localTrace.buffer) {
+        TraceRegistry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        localTrace.buffer->threadName = localTrace.name;
+    }
+}
+
+uint64_t ofxHeadlessFboTrace::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+void ofxHeadlessFboTrace::record(const char *name, uint64_t startNs, uint64_t endNs) {
+    TraceBuffer &buffer = getLocalBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    writeEvent(buffer.events[head % buffer.size], name, startNs, endNs, 0);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void ofxHeadlessFboTrace::recordBatch(const char *name, uint64_t startNs, uint64_t endNs) {
+    TraceBuffer &buffer = getLocalBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head > buffer.tail.load(std::memory_order_relaxed)) {
+        TraceEvent &last = buffer.events[(head - 1) % buffer.size];
+        const TraceEventCopy event = copyEvent(last);
+        if (event.count > 0 && startNs >= event.start && startNs - (event.start + event.duration) < batchGapNs &&
+            (event.name == name || std::strcmp(event.name, name) == 0)) {
+            const uint64_t merges = buffer.merges.load(std::memory_order_relaxed);
+            buffer.merges.store(merges + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            last.duration.store(endNs - event.start, std::memory_order_relaxed);
+            last.count.store(event.count + 1, std::memory_order_relaxed);
+            buffer.merges.store(merges + 2, std::memory_order_release);
+            return;
+        }
+    }
+
+    writeEvent(buffer.events[head % buffer.size], name, startNs, endNs, 1);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void ofxHeadlessFboTrace::instant(const char *name) {
+    if (isEnabled()) {
+        const uint64_t t = now();
+        record(name, t, t);
+    }
+}
+
+std::string ofxHeadlessFboTrace::toJson() {
+    struct Snapshot {
+        uint32_t tid;
+        std::string threadName;
+        std::vector<TraceEventCopy> events;
+    };
+
+    std::vector<Snapshot> snapshots;
+    uint64_t epoch = UINT64_MAX;
+    {
+        TraceRegistry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto &buffer : registry.buffers) {
+            const uint64_t size = buffer->size;
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t first = getFirstEvent(*buffer, head);
+
+            Snapshot snapshot;
+            snapshot.tid = buffer->tid;
+            snapshot.threadName = buffer->threadName;
+            for (uint64_t i = first; i + 1 < head; ++i) {
+                snapshot.events.push_back(copyEvent(buffer->events[i % size]));
+            }
+            if (first < head) {
+                // the last event may be a batch growing meanwhile, copy it between merges
+                const TraceEvent &last = buffer->events[(head - 1) % size];
+                TraceEventCopy event;
+                uint64_t merges;
+                do {
+                    while ((merges = buffer->merges.load(std::memory_order_acquire)) % 2 != 0) {
+                        std::this_thread::yield();
+                    }
+                    event = copyEvent(last);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                } while (buffer->merges.load(std::memory_order_relaxed) != merges);
+                snapshot.events.push_back(event);
+            }
+
+            // drop the oldest events if the thread wrapped around while copying
+            const uint64_t headAfter = buffer->head.load(std::memory_order_acquire);
+            const uint64_t firstValid = headAfter + 1 > size ? headAfter + 1 - size : 0;
+            if (firstValid > first) {
+                const uint64_t overwritten = std::min<uint64_t>(firstValid - first, snapshot.events.size());
+                snapshot.events.erase(snapshot.events.begin(), snapshot.events.begin() + overwritten);
+            }
+
+            for (const auto &event : snapshot.events) {
+                epoch = std::min(epoch, event.start);
+            }
+            snapshots.push_back(std::move(snapshot));
+        }
+    }
+    if (epoch == UINT64_MAX) {
+        epoch = 0;
+    }
+
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool firstEvent = true;
+    for (const auto &snapshot : snapshots) {
+        if (!snapshot.threadName.empty()) {
+            out << (firstEvent ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << snapshot.tid << ",\"args\":{\"name\":\"";
+            appendEscaped(out, snapshot.threadName.c_str());
+            out << "\"}}";
+            firstEvent = false;
+        }
+        for (const auto &event : snapshot.events) {
+            out << (firstEvent ? "" : ",") << "\n{\"name\":\"";
+            appendEscaped(out, event.name);
+            out << "\",\"cat\":\"ofxHeadlessFbo\",\"ph\":\"X\",\"pid\":1,\"tid\":" << snapshot.tid
+                << ",\"ts\":" << (event.start - epoch) / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+            if (event.count > 0) {
+                out << ",\"args\":{\"calls\":" << event.count << "}";
+            }
+            out << "}";
+            firstEvent = false;
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool ofxHeadlessFboTrace::save(const std::string &path) {
+    std::ofstream file(ofToDataPath(path, true), std::ios::binary);
+    if (!file) {
+        ofLogError("ofxHeadlessFboTrace") << "save(): couldn't write " << path;
+        return false;
+    }
+    file << toJson();
+    return static_cast<bool>(file);
+}
+
+void ofxHeadlessFboTrace::clear() {
+    TraceRegistry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    // threads that exited have nothing left to record
+    registry.buffers.erase(std::remove_if(registry.buffers.begin(), registry.buffers.end(),
+                                          [](const std::shared_ptr<TraceBuffer> &buffer) { return buffer->exited; }),
+                           registry.buffers.end());
+    for (const auto &buffer : registry.buffers) {
+        buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
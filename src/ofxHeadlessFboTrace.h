@@ -0,0 +1,157 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/// @file
+/// Frame phase tracing exported as Chrome trace events.
+///
+/// Scoped markers record complete events into a per-thread ring buffer.
+/// Recording is off by default, a disabled marker costs one relaxed atomic
+/// load. Define OFX_HEADLESS_FBO_NO_TRACE to compile the markers and thread
+/// names out, modules using them then link without the tracer.
+///
+/// ~~~~{.cpp}
+/// ofxHeadlessFboTrace::setEnabled(true);
+///
+/// void ofApp::update(){
+///     OFX_HEADLESS_FBO_TRACE_SCOPE("frame");
+///     hfbo.clear(ofColor::black);
+///     drawScene();
+///     {
+///         OFX_HEADLESS_FBO_TRACE_SCOPE("send");
+///         send();
+///     }
+/// }
+///
+/// // open in chrome://tracing or https://ui.perfetto.dev
+/// ofxHeadlessFboTrace::save("trace.json");
+/// ~~~~
+///
+/// Consecutive draw calls of the same primitive on one thread are merged
+/// into a single batch event carrying the number of calls.
+
+class ofxHeadlessFboTrace {
+    public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Number of events kept per thread, applies to threads that
+    /// record their first event after the call.
+    static void setBufferSize(size_t events);
+
+    /// @brief Name shown for the calling thread in the trace viewer.
+    ///
+    /// Cheap enough to call from every worker, a thread only allocates its
+    /// buffer when it records its first event, and gives it up when it exits.
+    /// Events of exited threads are kept until clear().
+    static void setThreadName(const std::string &name);
+
+    /// @brief Records a complete event, names must outlive the trace.
+    static void record(const char *name, uint64_t startNs, uint64_t endNs);
+    /// @brief Records a draw call, merged with the previous event if it has the same name.
+    static void recordBatch(const char *name, uint64_t startNs, uint64_t endNs);
+    /// @brief Records a zero duration marker.
+    static void instant(const char *name);
+
+    /// @brief Monotonic time in nanoseconds used for the events.
+    static uint64_t now();
+
+    /// @brief All recorded events as Chrome trace_event JSON.
+    static std::string toJson();
+    /// @brief Writes the recorded events as Chrome trace_event JSON.
+    static bool save(const std::string &path);
+    /// @brief Discards the recorded events of all threads and the buffers of
+    /// threads that exited.
+    static void clear();
+
+    class Scope {
+        public:
+        explicit Scope(const char *name) : name(name), start(isEnabled() ? now() : 0) {}
+        ~Scope() {
+            if (start != 0) {
+                record(name, start, now());
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        private:
+        const char *name;
+        uint64_t start;
+    };
+
+    /// Scope for draw calls, nested draw calls only record the outermost one.
+    class DrawScope {
+        public:
+        explicit DrawScope(const char *name) : name(name), start(0), counted(isEnabled()) {
+            if (counted && depth++ == 0) {
+                start = now();
+            }
+        }
+        ~DrawScope() {
+            if (!counted) {
+                return;
+            }
+            --depth;
+            if (start != 0) {
+                recordBatch(name, start, now());
+            }
+        }
+        DrawScope(const DrawScope &) = delete;
+        DrawScope &operator=(const DrawScope &) = delete;
+
+        private:
+        const char *name;
+        uint64_t start;
+        bool counted;
+    };
+
+    private:
+    static std::atomic<bool> enabled;
+    static thread_local int depth;
+};
+
+#ifdef OFX_HEADLESS_FBO_NO_TRACE
+#define OFX_HEADLESS_FBO_TRACE_SCOPE(name)
+#define OFX_HEADLESS_FBO_TRACE_DRAW(name)
+#define OFX_HEADLESS_FBO_TRACE_THREAD(name)
+#else
+#define OFX_HEADLESS_FBO_TRACE_CONCAT_(a, b) a##b
+#define OFX_HEADLESS_FBO_TRACE_CONCAT(a, b) OFX_HEADLESS_FBO_TRACE_CONCAT_(a, b)
+#define OFX_HEADLESS_FBO_TRACE_SCOPE(name) \
+    ofxHeadlessFboTrace::Scope OFX_HEADLESS_FBO_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define OFX_HEADLESS_FBO_TRACE_DRAW(name) \
+    ofxHeadlessFboTrace::DrawScope OFX_HEADLESS_FBO_TRACE_CONCAT(traceDrawScope, __LINE__)(name)
+#define OFX_HEADLESS_FBO_TRACE_THREAD(name) ofxHeadlessFboTrace::setThreadName(name)
+#endif
@@ -0,0 +1,185 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Tests of the rasterizer built without GL, ofMain.h or ofMesh.h, see the
+// Makefile next to this file. With --startup it only prints its peak RSS,
+// so the process startup can be timed on its own.
+
+#include "ofxHeadlessFboTest.h"
+#include "ofxHeadlessFboGenerator.h"
+#include <string>
+#include <sys/resource.h>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+void testClear() {
+    for (ofPixelFormat format : {OF_PIXELS_RGB, OF_PIXELS_RGBA, OF_PIXELS_BGRA}) {
+        for (bool lazy : {false, true}) {
+            ofxHeadlessFbo fbo;
+            fbo.allocate(67, 45, format);
+            fbo.setLazyClear(lazy);
+            fbo.clear(ofColor(10, 20, 30, 40));
+            ofPixels pixels;
+            fbo.readPixels(pixels);
+            CHECK(pixels.getWidth() == 67 && pixels.getHeight() == 45);
+            CHECK(pixels.getPixelFormat() == format);
+            const ofColor expected = format == OF_PIXELS_BGRA ? ofColor(30, 20, 10, 40) : ofColor(10, 20, 30, 40);
+            CHECK(countPixels(pixels, expected) == 67 * 45);
+        }
+    }
+}
+
+void testPrimitives() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(100, 80, OF_PIXELS_RGB);
+    ofPixels pixels;
+
+    fbo.clear(ofColor::black);
+    fbo.setColor(ofColor::white);
+    fbo.drawRectangle(10, 20, 30, 15);
+    fbo.readPixels(pixels);
+    CHECK(countPixels(pixels, ofColor::white) == 30 * 15);
+    CHECK(pixelIs(pixels, 10, 20, ofColor::white) && pixelIs(pixels, 39, 34, ofColor::white));
+    CHECK(pixelIs(pixels, 9, 20, ofColor::black) && pixelIs(pixels, 40, 34, ofColor::black));
+
+    fbo.clear(ofColor::black);
+    fbo.drawPoint(5, 6);
+    fbo.drawLine(0, 70, 99, 70);
+    fbo.readPixels(pixels);
+    CHECK(pixelIs(pixels, 5, 6, ofColor::white));
+    CHECK(countPixels(pixels, ofColor::white) == 1 + 100);
+
+    // a diagonal line has one pixel per column and reaches both ends
+    fbo.clear(ofColor::black);
+    fbo.drawLine(0, 0, 79, 40);
+    fbo.readPixels(pixels);
+    CHECK(countPixels(pixels, ofColor::white) == 80);
+    CHECK(pixelIs(pixels, 0, 0, ofColor::white) && pixelIs(pixels, 79, 40, ofColor::white));
+
+    // half of a 60 by 60 square, the diagonal pixel centers are inside
+    fbo.clear(ofColor::black);
+    fbo.drawTriangle(0, 0, 60, 0, 0, 60);
+    fbo.readPixels(pixels);
+    const size_t triangle = countPixels(pixels, ofColor::white);
+    CHECK(triangle >= 1770 && triangle <= 1830);
+
+    // circles and ellipses cover about their area and stay inside their bounds
+    fbo.clear(ofColor::black);
+    fbo.drawCircle(50, 40, 20);
+    fbo.readPixels(pixels);
+    const size_t circle = countPixels(pixels, ofColor::white);
+    CHECK(circle > 1200 && circle < 1320);
+    CHECK(pixelIs(pixels, 50, 40, ofColor::white) && pixelIs(pixels, 50, 18, ofColor::black));
+
+    fbo.clear(ofColor::black);
+    fbo.drawEllipse(50, 40, 60, 20);
+    fbo.readPixels(pixels);
+    const size_t ellipse = countPixels(pixels, ofColor::white);
+    CHECK(ellipse > 880 && ellipse < 1000);
+
+    fbo.clear(ofColor::black);
+    fbo.drawRectRounded(10, 10, 40, 30, 8);
+    fbo.readPixels(pixels);
+    CHECK(pixelIs(pixels, 30, 25, ofColor::white));
+    CHECK(pixelIs(pixels, 10, 10, ofColor::black) && pixelIs(pixels, 49, 39, ofColor::black));
+
+    // outlines only touch the border
+    fbo.clear(ofColor::black);
+    fbo.setNoFill();
+    fbo.drawRectangle(10, 10, 20, 20);
+    fbo.setFill();
+    fbo.readPixels(pixels);
+    CHECK(pixelIs(pixels, 10, 10, ofColor::white) && pixelIs(pixels, 20, 20, ofColor::black));
+
+    // half transparent white over black
+    fbo.clear(ofColor::black);
+    fbo.enableAlphaBlending();
+    fbo.setColor(ofColor(255, 255, 255, 128));
+    fbo.drawRectangle(0, 0, 10, 10);
+    fbo.disableAlphaBlending();
+    fbo.readPixels(pixels);
+    CHECK(pixelIs(pixels, 5, 5, ofColor(128, 128, 128)));
+}
+
+void testReadPixels() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(32, 16, OF_PIXELS_RGBA);
+    fbo.clear(ofColor(0, 0, 0, 255));
+    fbo.setColor(ofColor(200, 100, 50, 255));
+    fbo.drawRectangle(8, 4, 8, 8);
+
+    ofPixels pixels;
+    fbo.readPixelsAs(pixels, OF_PIXELS_BGR);
+    CHECK(pixels.getPixelFormat() == OF_PIXELS_BGR);
+    CHECK(pixelIs(pixels, 8, 4, ofColor(50, 100, 200)));
+    CHECK(pixelIs(pixels, 7, 4, ofColor(0, 0, 0)));
+
+    fbo.readPixelsAs(pixels, OF_PIXELS_RGB, ofRectangle(8, 4, 8, 8));
+    CHECK(pixels.getWidth() == 8 && pixels.getHeight() == 8);
+    CHECK(countPixels(pixels, ofColor(200, 100, 50)) == 64);
+
+    // packed pixels convert to 8 bits per channel
+    ofxHeadlessFbo packed;
+    packed.allocate(16, 8, OFX_HEADLESS_FBO_PACKED_RGB565);
+    packed.clear(ofColor::black);
+    packed.setColor(ofColor(255, 0, 255));
+    packed.drawRectangle(0, 0, 4, 4);
+    packed.readPixelsAs(pixels, OF_PIXELS_RGB);
+    CHECK(pixelIs(pixels, 3, 3, ofColor(255, 0, 255)) && pixelIs(pixels, 4, 4, ofColor::black));
+
+    // generated fills land where the generator puts them
+    ofxHeadlessFbo generated;
+    generated.allocate(16, 16, OF_PIXELS_RGB);
+    generated.clear(ofColor::black);
+    generated.fillWith(ofxHeadlessFboGenerator::checkerboard(4, ofColor::red, ofColor::blue), ofRectangle(0, 0, 16, 16));
+    generated.readPixels(pixels);
+    CHECK(countPixels(pixels, ofColor::red) == 128 && countPixels(pixels, ofColor::blue) == 128);
+    CHECK(!pixelIs(pixels, 4, 0, pixels.getColor(0, 0)) && pixelIs(pixels, 8, 0, pixels.getColor(0, 0)));
+}
+
+void printPeakRss() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::printf("peak RSS %ld kB\n", usage.ru_maxrss);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]) == "--startup") {
+        printPeakRss();
+        return 0;
+    }
+    testClear();
+    testPrimitives();
+    testReadPixels();
+
+    printPeakRss();
+    return finish("core");
+}
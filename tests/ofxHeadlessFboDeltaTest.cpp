@@ -0,0 +1,198 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Delta streams decoded back into the frames they were encoded from, and
+// damaged packets the decoder has to drop.
+
+#include "ofxHeadlessFboDelta.h"
+#include "ofxHeadlessFboTest.h"
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+void putU32(std::vector<unsigned char> &packet, size_t pos, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        packet[pos + i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+std::vector<unsigned char> makeHeader(bool keyframe, uint32_t sequence, uint32_t w, uint32_t h, uint32_t runCount) {
+    std::vector<unsigned char> packet = {'H', 'F', 'B', 'D', 1, static_cast<unsigned char>(keyframe ? 1 : 0),
+                                         static_cast<unsigned char>(OF_PIXELS_RGB), 0};
+    packet.resize(24);
+    putU32(packet, 8, sequence);
+    putU32(packet, 12, w);
+    putU32(packet, 16, h);
+    putU32(packet, 20, runCount);
+    return packet;
+}
+
+void addRun(std::vector<unsigned char> &packet, uint32_t offset, uint32_t length, unsigned char value) {
+    const size_t pos = packet.size();
+    packet.resize(pos + 8 + length, value);
+    putU32(packet, pos, offset);
+    putU32(packet, pos + 4, length);
+}
+
+void testRoundTrip() {
+    for (ofPixelFormat format : {OF_PIXELS_RGBA, OF_PIXELS_RGB, OF_PIXELS_GRAY}) {
+        ofxHeadlessFbo fbo;
+        fbo.allocate(97, 61, format);
+        ofxHeadlessFboDeltaEncoder encoder;
+        encoder.setKeyframeInterval(10);
+        ofxHeadlessFboDeltaDecoder decoder;
+        std::vector<unsigned char> packet;
+        size_t keyframes = 0;
+        size_t decoded = 0;
+        bool same = true;
+
+        fbo.clear(ofColor(20, 30, 40, 255));
+        for (int frame = 0; frame < 25; ++frame) {
+            // small changes become deltas, the full clear a keyframe sized one
+            if (frame == 12) {
+                fbo.clear(ofColor(200, 10, 10, 255));
+            }
+            fbo.setColor(ofColor(frame * 10, 255 - frame * 10, 90, 255));
+            fbo.drawCircle(10 + frame * 3, 30, 5);
+            fbo.drawLine(0, frame * 2, 96, 60 - frame);
+
+            encoder.encode(fbo, packet);
+            keyframes += encoder.isLastKeyframe() ? 1 : 0;
+            decoded += decoder.decode(packet) ? 1 : 0;
+            ofPixels pixels;
+            fbo.readPixels(pixels);
+            same = same && samePixels(pixels, decoder.getPixels());
+        }
+        CHECK(decoded == 25);
+        CHECK(same);
+        CHECK(keyframes >= 3 && keyframes < 25);
+    }
+}
+
+void testLostPacket() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(32, 32, OF_PIXELS_RGB);
+    fbo.clear(ofColor::black);
+    ofxHeadlessFboDeltaEncoder encoder;
+    ofxHeadlessFboDeltaDecoder decoder;
+    std::vector<unsigned char> packet;
+
+    encoder.encode(fbo, packet);
+    CHECK(decoder.decode(packet));
+    fbo.drawRectangle(2, 2, 4, 4);
+    encoder.encode(fbo, packet); // lost
+    fbo.drawRectangle(10, 10, 4, 4);
+    encoder.encode(fbo, packet);
+    CHECK(!encoder.isLastKeyframe());
+    CHECK(!decoder.decode(packet));
+    CHECK(decoder.needsKeyframe());
+
+    encoder.requestKeyframe();
+    encoder.encode(fbo, packet);
+    CHECK(decoder.decode(packet));
+    ofPixels pixels;
+    fbo.readPixels(pixels);
+    CHECK(samePixels(pixels, decoder.getPixels()));
+}
+
+void testCorruptPackets() {
+    const uint32_t w = 8;
+    const uint32_t h = 4;
+    const uint32_t frameSize = w * h * 3;
+    ofxHeadlessFboDeltaDecoder decoder;
+
+    // header only keyframes claiming a huge frame
+    CHECK(!decoder.decode(makeHeader(true, 0, 60000, 60000, 0)));
+    CHECK(!decoder.decode(makeHeader(true, 0, 0xFFFFFFFF, 0xFFFFFFFF, 0)));
+    CHECK(!decoder.getPixels().isAllocated());
+
+    std::vector<unsigned char> packet = makeHeader(true, 0, w, h, 1);
+    addRun(packet, 0, frameSize, 7);
+    CHECK(!decoder.decode(std::vector<unsigned char>(packet.begin(), packet.begin() + 20)));
+    CHECK(!decoder.decode(std::vector<unsigned char>(packet.begin(), packet.end() - 1)));
+    std::vector<unsigned char> badMagic = packet;
+    badMagic[0] = 'X';
+    CHECK(!decoder.decode(badMagic));
+    CHECK(!decoder.getPixels().isAllocated());
+
+    // keyframes that leave part of the frame undefined
+    packet = makeHeader(true, 0, w, h, 1);
+    addRun(packet, 0, frameSize - 1, 7);
+    CHECK(!decoder.decode(packet));
+    packet = makeHeader(true, 0, w, h, 1);
+    addRun(packet, 1, frameSize - 1, 7);
+    CHECK(!decoder.decode(packet));
+    packet = makeHeader(true, 0, w, h, 2);
+    addRun(packet, 0, 10, 7);
+    addRun(packet, 12, frameSize - 12, 7);
+    CHECK(!decoder.decode(packet));
+    packet = makeHeader(true, 0, w, h, 2);
+    addRun(packet, 0, frameSize / 2, 7);
+    addRun(packet, 0, frameSize / 2, 7);
+    CHECK(!decoder.decode(packet));
+    CHECK(!decoder.getPixels().isAllocated());
+
+    // a keyframe split into runs
+    packet = makeHeader(true, 0, w, h, 2);
+    addRun(packet, 0, 10, 7);
+    addRun(packet, 10, frameSize - 10, 7);
+    CHECK(decoder.decode(packet));
+    CHECK(countPixels(decoder.getPixels(), ofColor(7, 7, 7)) == w * h);
+
+    // deltas outside of the frame or out of sequence leave it untouched
+    packet = makeHeader(false, 1, w, h, 1);
+    addRun(packet, frameSize - 2, 3, 9);
+    CHECK(!decoder.decode(packet));
+    packet = makeHeader(false, 1, w, h, 1);
+    addRun(packet, 0xFFFFFFF0, 32, 9);
+    CHECK(!decoder.decode(packet));
+    packet = makeHeader(false, 5, w, h, 1);
+    addRun(packet, 0, 3, 9);
+    CHECK(!decoder.decode(packet));
+    CHECK(countPixels(decoder.getPixels(), ofColor(7, 7, 7)) == w * h);
+
+    // until the next keyframe
+    packet = makeHeader(false, 6, w, h, 1);
+    addRun(packet, 0, 3, 9);
+    CHECK(!decoder.decode(packet));
+    packet = makeHeader(true, 7, w, h, 1);
+    addRun(packet, 0, frameSize, 1);
+    CHECK(decoder.decode(packet));
+    packet = makeHeader(false, 8, w, h, 1);
+    addRun(packet, 0, 3, 9);
+    CHECK(decoder.decode(packet));
+    CHECK(countPixels(decoder.getPixels(), ofColor(1, 1, 1)) == w * h - 1);
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testLostPacket();
+    testCorruptPackets();
+    return finish("delta");
+}
@@ -0,0 +1,117 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Dirty regions tracked by the owner of a buffer and by several outputs
+// reading it independently.
+
+#include "ofxHeadlessFboTest.h"
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+bool sameRect(const ofRectangle &a, float x, float y, float w, float h) {
+    return a.x == x && a.y == y && a.width == w && a.height == h;
+}
+
+void testOwnerRegion() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(100, 80, OF_PIXELS_RGB);
+    CHECK(sameRect(fbo.getDirtyRegion(), 0, 0, 100, 80));
+    fbo.resetDirtyRegion();
+    CHECK(fbo.getDirtyRegion().width == 0);
+
+    fbo.drawRectangle(10, 20, 5, 5);
+    CHECK(sameRect(fbo.getDirtyRegion(), 10, 20, 5, 5));
+    // reading the changes as an output doesn't reset the region of the owner
+    CHECK(sameRect(fbo.getDirtyRegionSince(0), 0, 0, 100, 80));
+    fbo.drawRectangle(50, 60, 10, 2);
+    CHECK(sameRect(fbo.getDirtyRegion(), 10, 20, 50, 42));
+    fbo.resetDirtyRegion();
+    CHECK(fbo.getDirtyRegion().width == 0);
+}
+
+void testIndependentOutputs() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(100, 80, OF_PIXELS_RGB);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    fbo.getDirtyRegionSince(a);
+    a = fbo.getVersion();
+    fbo.getDirtyRegionSince(b);
+    b = fbo.getVersion();
+    CHECK(fbo.getDirtyRegionSince(a).width == 0);
+
+    fbo.drawRectangle(10, 10, 4, 4);
+    CHECK(sameRect(fbo.getDirtyRegionSince(a), 10, 10, 4, 4));
+    a = fbo.getVersion();
+    fbo.drawRectangle(30, 30, 4, 4);
+    CHECK(sameRect(fbo.getDirtyRegionSince(a), 30, 30, 4, 4));
+    a = fbo.getVersion();
+
+    // the second output still sees both rectangles
+    CHECK(sameRect(fbo.getDirtyRegionSince(b), 10, 10, 24, 24));
+    b = fbo.getVersion();
+    CHECK(fbo.getDirtyRegionSince(a).width == 0);
+    CHECK(fbo.getDirtyRegionSince(b).width == 0);
+
+    // the owner resetting its region doesn't hide changes from the outputs
+    fbo.drawRectangle(70, 5, 2, 2);
+    fbo.resetDirtyRegion();
+    CHECK(sameRect(fbo.getDirtyRegionSince(a), 70, 5, 2, 2));
+}
+
+void testForgottenVersions() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(100, 80, OF_PIXELS_GRAY);
+    fbo.getDirtyRegionSince(0);
+    const uint64_t old = fbo.getVersion();
+    uint64_t recent = old;
+    for (int i = 0; i < 20; ++i) {
+        fbo.drawRectangle(i, 0, 1, 1);
+        fbo.getDirtyRegionSince(recent);
+        recent = fbo.getVersion();
+    }
+    // too old to be known, the whole buffer counts as changed
+    CHECK(sameRect(fbo.getDirtyRegionSince(old), 0, 0, 100, 80));
+    fbo.drawRectangle(40, 40, 3, 3);
+    CHECK(sameRect(fbo.getDirtyRegionSince(recent), 40, 40, 3, 3));
+
+    // regions from before a resize are clipped to the new size
+    const uint64_t beforeResize = fbo.getVersion();
+    fbo.drawRectangle(90, 70, 10, 10);
+    fbo.allocate(50, 40, OF_PIXELS_GRAY);
+    CHECK(sameRect(fbo.getDirtyRegionSince(beforeResize), 0, 0, 50, 40));
+}
+
+} // namespace
+
+int main() {
+    testOwnerRegion();
+    testIndependentOutputs();
+    testForgottenVersions();
+    return finish("dirty region");
+}
@@ -0,0 +1,140 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Universe counts and ranges of mapped regions, and the packets they send
+// to a receiver on the loopback interface.
+
+#include "ofxHeadlessFboDmx.h"
+#include "ofxHeadlessFboTest.h"
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+// UDP socket on 127.0.0.1 with a free port, returns the port
+int openReceiver(uint16_t &port) {
+    const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    bind(receiver, reinterpret_cast<sockaddr *>(&address), addressSize);
+    getsockname(receiver, reinterpret_cast<sockaddr *>(&address), &addressSize);
+    timeval timeout = {1, 0};
+    setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    port = ntohs(address.sin_port);
+    return receiver;
+}
+
+void testUniverseCounts() {
+    ofxHeadlessFboDmxSender dmx;
+    CHECK(dmx.setup(OFX_HEADLESS_FBO_DMX_ARTNET, "127.0.0.1"));
+    // 170 RGB or 512 GRAY pixels fill a universe
+    CHECK(dmx.mapRegion(0, 0, 170, 8, 0) == 8);
+    CHECK(dmx.mapRegion(0, 0, 171, 1, 0) == 2);
+    CHECK(dmx.mapRegion(0, 0, 512, 2, 0, 0, 1) == 2);
+    CHECK(dmx.mapRegion(0, 0, 170, 8, 0, 0, 1) == 3);
+    CHECK(dmx.mapRegion(0, 0, 10, 3, 0, 4, 1) == 8);
+    CHECK(dmx.mapRegion(0, 0, 600, 1, 0, 600, 1) == 2);
+    CHECK(dmx.mapRegion(0, 0, 0, 8, 0) == 0);
+    CHECK(dmx.mapRegion(0, 0, 10, 10, 0, 0, 4) == 0);
+}
+
+void testUniverseRanges() {
+    ofxHeadlessFboDmxSender artNet;
+    CHECK(artNet.setup(OFX_HEADLESS_FBO_DMX_ARTNET, "127.0.0.1"));
+    CHECK(artNet.mapRegion(0, 0, 170, 1, 0) == 1);
+    CHECK(artNet.mapRegion(0, 0, 170, 2, 32766) == 2);
+    CHECK(artNet.mapRegion(0, 0, 170, 3, 32766) == 0);
+    CHECK(artNet.mapRegion(0, 0, 170, 1, 40000) == 0);
+
+    ofxHeadlessFboDmxSender sacn;
+    CHECK(sacn.setup(OFX_HEADLESS_FBO_DMX_SACN, "127.0.0.1"));
+    CHECK(sacn.mapRegion(0, 0, 170, 1, 0) == 0);
+    CHECK(sacn.mapRegion(0, 0, 170, 1, 1) == 1);
+    CHECK(sacn.mapRegion(0, 0, 170, 2, 63998) == 2);
+    CHECK(sacn.mapRegion(0, 0, 170, 3, 63998) == 0);
+    CHECK(sacn.mapRegion(0, 0, 170, 1, 64000) == 0);
+}
+
+// a GRAY canvas sends as many universes as mapRegion() counted
+void testGraySend() {
+    uint16_t port = 0;
+    const int receiver = openReceiver(port);
+    ofxHeadlessFboDmxSender dmx;
+    CHECK(dmx.setup(OFX_HEADLESS_FBO_DMX_SACN, "127.0.0.1", port));
+    const size_t count = dmx.mapRegion(0, 0, 300, 4, 10, 0, 1);
+    CHECK(count == 3);
+
+    ofxHeadlessFbo fbo;
+    fbo.allocate(300, 4, OF_PIXELS_GRAY);
+    fbo.clear(ofColor(7));
+    CHECK(dmx.send(fbo) == count);
+    CHECK(dmx.getNumUniverses() == count);
+
+    unsigned char packet[1024];
+    for (size_t i = 0; i < count; ++i) {
+        const ssize_t size = recv(receiver, packet, sizeof(packet), 0);
+        const size_t slots = i + 1 < count ? 512 : 1200 - 2 * 512;
+        CHECK(size == static_cast<ssize_t>(126 + slots));
+        CHECK(((packet[113] << 8) | packet[114]) == static_cast<int>(10 + i));
+        CHECK(size > 126 && packet[126] == 7 && packet[size - 1] == 7);
+    }
+    ::close(receiver);
+}
+
+// a region mapped for GRAY but sent from an RGB canvas is cut at the last universe
+void testCutShort() {
+    uint16_t port = 0;
+    const int receiver = openReceiver(port);
+    ofxHeadlessFboDmxSender dmx;
+    CHECK(dmx.setup(OFX_HEADLESS_FBO_DMX_SACN, "127.0.0.1", port));
+    CHECK(dmx.mapRegion(0, 0, 512, 1, 63999, 0, 1) == 1);
+
+    ofxHeadlessFbo fbo;
+    fbo.allocate(512, 1, OF_PIXELS_RGB);
+    fbo.clear(ofColor(1, 2, 3));
+    CHECK(dmx.send(fbo) == 1);
+    CHECK(dmx.getNumUniverses() == 1);
+
+    unsigned char packet[1024];
+    const ssize_t size = recv(receiver, packet, sizeof(packet), 0);
+    CHECK(size == 126 + 510);
+    CHECK(((packet[113] << 8) | packet[114]) == 63999);
+    ::close(receiver);
+}
+
+} // namespace
+
+int main() {
+    testUniverseCounts();
+    testUniverseRanges();
+    testGraySend();
+    testCutShort();
+    return finish("dmx");
+}
@@ -0,0 +1,155 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Scenes drawn from several threads through draw contexts against the same
+// scene drawn directly into the canvas.
+
+#include "ofxHeadlessFboDrawContext.h"
+#include "ofxHeadlessFboTest.h"
+#include <thread>
+#include <vector>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+template <typename Target>
+void drawScene(Target &target) {
+    target.setColor(ofColor(255, 0, 0, 200));
+    target.drawCircle(50, 40, 30.5f);
+    target.setColor(ofColor(0, 255, 0, 255));
+    target.drawLine(3.5f, 2.2f, 118.7f, 77.9f);
+    target.drawTriangle(10, 70, 60, 5, 110, 60);
+    target.enableAlphaBlending();
+    target.setColor(ofColor(0, 0, 255, 128));
+    target.drawRectangle(20.5f, 15.2f, 70, 40);
+    target.setNoFill();
+    target.drawEllipse(80, 50, 60, 30);
+    target.setFill();
+    target.disableAlphaBlending();
+}
+
+// the canvas drawn in horizontal strips by one thread each
+void drawThreaded(ofxHeadlessFbo &canvas, size_t strips) {
+    std::vector<ofxHeadlessFboDrawContext> contexts(strips);
+    const float height = static_cast<float>(canvas.getHeight()) / strips;
+    for (size_t i = 0; i < strips; ++i) {
+        contexts[i].setup(canvas, ofRectangle(0, i * height, canvas.getWidth(), height));
+    }
+    std::vector<std::thread> threads;
+    for (auto &context : contexts) {
+        threads.emplace_back([&context]() { drawScene(context); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto &context : contexts) {
+        context.merge();
+    }
+}
+
+void testSameAsDirect() {
+    for (ofPixelFormat format : {OF_PIXELS_RGBA, OF_PIXELS_RGB, OF_PIXELS_GRAY}) {
+        ofxHeadlessFbo direct;
+        ofxHeadlessFbo threaded;
+        direct.allocate(120, 80, format);
+        threaded.allocate(120, 80, format);
+        direct.clear(ofColor(10, 20, 30, 255));
+        threaded.clear(ofColor(10, 20, 30, 255));
+        drawScene(direct);
+        drawThreaded(threaded, 4);
+
+        ofPixels a;
+        ofPixels b;
+        direct.readPixels(a);
+        threaded.readPixels(b);
+        CHECK(samePixels(a, b));
+    }
+}
+
+void testLazyMask() {
+    // the mask is only cleared, the tiles the circle doesn't touch are
+    // filled in when it's first read
+    ofxHeadlessFbo mask;
+    mask.allocate(120, 80, OF_PIXELS_GRAY);
+    mask.setLazyClear(true);
+    mask.clear(ofColor(0));
+    mask.setColor(ofColor(255));
+    mask.drawCircle(30, 30, 20);
+
+    ofxHeadlessFbo direct;
+    ofxHeadlessFbo threaded;
+    direct.allocate(120, 80, OF_PIXELS_RGB);
+    threaded.allocate(120, 80, OF_PIXELS_RGB);
+    direct.clear(ofColor::black);
+    threaded.clear(ofColor::black);
+    threaded.setMask(&mask);
+    drawThreaded(threaded, 8);
+    direct.setMask(&mask);
+    drawScene(direct);
+
+    ofPixels a;
+    ofPixels b;
+    direct.readPixels(a);
+    threaded.readPixels(b);
+    CHECK(samePixels(a, b));
+    // nothing outside of the circle
+    CHECK(pixelIs(b, 5, 5, ofColor::black));
+    CHECK(pixelIs(b, 115, 75, ofColor::black));
+    CHECK(!pixelIs(b, 30, 30, ofColor::black));
+}
+
+void testMerge() {
+    ofxHeadlessFbo canvas;
+    canvas.allocate(100, 100, OF_PIXELS_RGBA);
+    canvas.resetDirtyRegion();
+    const uint64_t version = canvas.getVersion();
+
+    ofxHeadlessFboDrawContext context(canvas, ofRectangle(50, 50, 50, 50));
+    context.drawRectangle(40, 40, 20, 20);
+    const ofRectangle dirty = context.getDirtyRegion();
+    CHECK(dirty.x == 50 && dirty.y == 50 && dirty.width == 10 && dirty.height == 10);
+    CHECK(canvas.getDirtyRegion().width == 0);
+
+    context.merge();
+    const ofRectangle merged = canvas.getDirtyRegion();
+    CHECK(merged.x == 50 && merged.y == 50 && merged.width == 10 && merged.height == 10);
+    CHECK(canvas.getVersion() != version);
+    CHECK(context.getDirtyRegion().width == 0);
+
+    // clips outside of the canvas are refused
+    ofxHeadlessFboDrawContext outside;
+    CHECK(!outside.setup(canvas, ofRectangle(200, 200, 10, 10)));
+}
+
+} // namespace
+
+int main() {
+    testSameAsDirect();
+    testLazyMask();
+    testMerge();
+    return finish("draw context");
+}
@@ -0,0 +1,241 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Flood fills compared with a pixel by pixel search of the same area, on
+// every storage the fill reads from.
+
+#include "ofxHeadlessFboTest.h"
+#include <cstdlib>
+#include <deque>
+#include <random>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+const size_t w = 90;
+const size_t h = 70;
+
+// pixels 4-connected to the seed within the tolerance of its channels
+std::vector<bool> referenceArea(const ofPixels &pixels, size_t seedX, size_t seedY, int tolerance) {
+    const size_t channels = pixels.getNumChannels();
+    const unsigned char *data = pixels.getData();
+    const unsigned char *seed = data + (seedY * w + seedX) * channels;
+    auto matches = [&](size_t i) {
+        for (size_t c = 0; c < channels; ++c) {
+            if (std::abs(data[i * channels + c] - seed[c]) > tolerance) {
+                return false;
+            }
+        }
+        return true;
+    };
+    std::vector<bool> area(w * h, false);
+    std::deque<size_t> open = {seedY * w + seedX};
+    area[open.front()] = true;
+    while (!open.empty()) {
+        const size_t i = open.front();
+        open.pop_front();
+        const size_t x = i % w;
+        const size_t y = i / w;
+        const size_t neighbours[4] = {x > 0 ? i - 1 : i, x + 1 < w ? i + 1 : i, y > 0 ? i - w : i,
+                                      y + 1 < h ? i + w : i};
+        for (size_t n : neighbours) {
+            if (!area[n] && matches(n)) {
+                area[n] = true;
+                open.push_back(n);
+            }
+        }
+    }
+    return area;
+}
+
+// blobs of three colors with holes and combs, areas run up and down again
+void drawScene(ofxHeadlessFbo &fbo, unsigned int seed) {
+    const ofColor colors[3] = {ofColor(255, 255, 255), ofColor(40, 90, 160), ofColor(200, 60, 30)};
+    fbo.clear(colors[0]);
+    std::mt19937 random(seed);
+    for (size_t i = 0; i < 120; ++i) {
+        fbo.setColor(colors[1 + random() % 2]);
+        fbo.drawRectangle(random() % w, random() % h, 1 + random() % 12, 1 + random() % 12);
+    }
+    fbo.setColor(colors[1]);
+    for (size_t x = 5; x < w - 5; x += 4) {
+        fbo.drawRectangle(x, 20, 2, 30);
+    }
+    fbo.drawRectangle(5, 48, w - 10, 2);
+}
+
+// the fill changed exactly the area of the reference search
+bool filledArea(ofxHeadlessFbo &fbo, size_t seedX, size_t seedY, int tolerance, const ofColor &color) {
+    ofPixels before;
+    fbo.readPixels(before);
+    const std::vector<bool> area = referenceArea(before, seedX, seedY, tolerance);
+    fbo.setColor(color);
+    fbo.floodFill(seedX + 0.5f, seedY + 0.5f, tolerance);
+    ofPixels after;
+    fbo.readPixels(after);
+    // the color as the buffer stores it
+    const ofColor stored = after.getColor(seedX, seedY);
+    if (stored == before.getColor(seedX, seedY)) {
+        return false;
+    }
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            if (after.getColor(x, y) != (area[y * w + x] ? stored : before.getColor(x, y))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void testAreas() {
+    for (ofPixelFormat format : {OF_PIXELS_RGB, OF_PIXELS_RGBA, OF_PIXELS_GRAY, OF_PIXELS_BGR}) {
+        for (unsigned int seed = 1; seed <= 5; ++seed) {
+            ofxHeadlessFbo fbo;
+            fbo.allocate(w, h, format);
+            drawScene(fbo, seed);
+            // fill colors stay apart from the scene on GRAY canvases too
+            CHECK(filledArea(fbo, 0, 0, 0, ofColor(0, 120, 0)));
+            // the same canvas again, the visited bits of the first fill are gone
+            CHECK(filledArea(fbo, 40, 30, 0, ofColor(90, 0, 90)));
+            CHECK(filledArea(fbo, w - 1, h - 1, 0, ofColor(10, 10, 10)));
+        }
+    }
+}
+
+// noise within the tolerance is filled over, the other colors stop it
+void testTolerance() {
+    ofxHeadlessFbo scene;
+    scene.allocate(w, h, OF_PIXELS_RGB);
+    drawScene(scene, 9);
+    ofPixels pixels = scene.getPixels();
+    std::mt19937 random(3);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        const int value = pixels.getData()[i] + static_cast<int>(random() % 9) - 4;
+        pixels.getData()[i] = static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+    }
+    for (int tolerance : {0, 3, 8, 60}) {
+        ofxHeadlessFbo copy;
+        copy.allocate(w, h, OF_PIXELS_RGB);
+        copy.setFromPixels(pixels.getData(), w, h, OF_PIXELS_RGB);
+        CHECK(filledArea(copy, 45, 60, tolerance, ofColor(0, 255, 0)));
+    }
+}
+
+// 16 bit, RGB565 and lazily cleared canvases are searched on 8 bit copies
+void testStorages() {
+    for (size_t kind = 0; kind < 3; ++kind) {
+        ofxHeadlessFbo fbo;
+        if (kind == 0) {
+            fbo.allocate(w, h, OF_PIXELS_RGB, OFX_HEADLESS_FBO_PRECISION_16);
+            fbo.setDither(OFX_HEADLESS_FBO_DITHER_NONE);
+        } else if (kind == 1) {
+            fbo.allocate(w, h, OFX_HEADLESS_FBO_PACKED_RGB565);
+        } else {
+            fbo.allocate(w, h, OF_PIXELS_RGB);
+            fbo.setLazyClear(true);
+        }
+        drawScene(fbo, 11);
+        CHECK(filledArea(fbo, 0, 0, 0, ofColor(0, 255, 0)));
+        CHECK(filledArea(fbo, 60, 10, 0, ofColor(0, 0, 255)));
+    }
+
+    // a fill inside tiles still solid after a lazy clear
+    ofxHeadlessFbo lazy;
+    lazy.allocate(200, 150, OF_PIXELS_RGB);
+    lazy.setLazyClear(true);
+    lazy.clear(ofColor::black);
+    lazy.setColor(ofColor::white);
+    lazy.drawRectangle(100, 0, 2, 150);
+    lazy.setColor(ofColor::red);
+    lazy.floodFill(10, 10);
+    CHECK(countPixels(lazy.getPixels(), ofColor::red) == 100 * 150);
+    CHECK(countPixels(lazy.getPixels(), ofColor::black) == 98 * 150);
+}
+
+// blending doesn't change what matches, and every pixel is blended once
+void testBlending() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_GRAY);
+    fbo.clear(ofColor(100));
+    fbo.setColor(ofColor(0));
+    fbo.drawRectangle(30, 0, 2, h);
+    fbo.enableAlphaBlending();
+    fbo.setColor(ofColor(255, 255, 255, 128));
+    fbo.floodFill(5, 5, 20);
+    const ofPixels pixels = fbo.getPixels();
+    CHECK(countPixels(pixels, ofColor(0)) == 2 * h);
+    CHECK(countPixels(pixels, ofColor(100)) == (w - 32) * h);
+    const ofColor blended = pixels.getColor(0, 0);
+    CHECK(blended.r > 170 && blended.r < 185);
+    CHECK(countPixels(pixels, blended) == 30 * h);
+}
+
+// the area is found on the whole canvas and drawn through the mask
+void testMask() {
+    ofxHeadlessFbo mask;
+    mask.allocate(w, h, OFX_HEADLESS_FBO_PACKED_MONO1);
+    mask.clear(ofColor::black);
+    mask.setColor(ofColor::white);
+    mask.drawRectangle(0, 0, w, h / 2);
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    fbo.clear(ofColor::black);
+    fbo.setMask(&mask);
+    fbo.setColor(ofColor::red);
+    fbo.floodFill(5, h - 5);
+    CHECK(countPixels(fbo.getPixels(), ofColor::red) == w * (h / 2));
+}
+
+void testOutside() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    fbo.clear(ofColor::black);
+    fbo.setColor(ofColor::red);
+    fbo.floodFill(-1, 5);
+    fbo.floodFill(5, h);
+    CHECK(countPixels(fbo.getPixels(), ofColor::black) == w * h);
+    // the seed is translated like any other coordinate
+    fbo.setColor(ofColor::white);
+    fbo.drawRectangle(50, 0, 1, h);
+    fbo.setColor(ofColor::red);
+    fbo.setTranslation(60, 0);
+    fbo.floodFill(0, 0);
+    CHECK(countPixels(fbo.getPixels(), ofColor::red) == (w - 51) * h);
+}
+
+} // namespace
+
+int main() {
+    testAreas();
+    testTolerance();
+    testStorages();
+    testBlending();
+    testMask();
+    testOutside();
+    return finish("flood fill");
+}
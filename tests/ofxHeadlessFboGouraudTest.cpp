@@ -0,0 +1,262 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Triangles with a color per corner: the pixels they cover, the colors
+// interpolated at the pixel centers and shared edges.
+
+#include "ofxHeadlessFboTest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+const size_t w = 100;
+const size_t h = 80;
+
+struct Triangle {
+    float x[3];
+    float y[3];
+};
+
+const Triangle triangles[] = {
+    {{50, 5, 95}, {3, 75, 60}},
+    {{10.3f, 90.7f, 40.2f}, {10.6f, 20.1f, 77.9f}},
+    {{2, 98, 3}, {2, 3, 78}},
+    {{30.5f, 31.5f, 80.25f}, {5.5f, 70.5f, 40.75f}},
+};
+const ofColor corners[3] = {ofColor(250, 10, 40), ofColor(20, 240, 90), ofColor(30, 60, 230)};
+
+void drawShaded(ofxHeadlessFbo &fbo, const Triangle &t, const ofColor *colors, float dx = 0, float dy = 0) {
+    fbo.drawTriangle(t.x[0] + dx, t.y[0] + dy, t.x[1] + dx, t.y[1] + dy, t.x[2] + dx, t.y[2] + dy, colors[0],
+                     colors[1], colors[2]);
+}
+
+// the pixels a shaded and a flat triangle cover are the same
+void testCoverage() {
+    for (const auto &t : triangles) {
+        ofxHeadlessFbo shaded;
+        shaded.allocate(w, h, OF_PIXELS_RGB);
+        shaded.clear(ofColor::black);
+        drawShaded(shaded, t, corners);
+        ofxHeadlessFbo flat;
+        flat.allocate(w, h, OF_PIXELS_RGB);
+        flat.clear(ofColor::black);
+        flat.setColor(ofColor::white);
+        flat.drawTriangle(t.x[0], t.y[0], t.x[1], t.y[1], t.x[2], t.y[2]);
+        const ofPixels a = shaded.getPixels();
+        const ofPixels b = flat.getPixels();
+        bool same = true;
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                same = same && pixelIs(a, x, y, ofColor::black) == pixelIs(b, x, y, ofColor::black);
+            }
+        }
+        CHECK(same);
+        CHECK(countPixels(b, ofColor::white) > 0);
+    }
+}
+
+// colors are the corners weighted by the barycentric coordinates of the pixel center
+void testInterpolation() {
+    for (const auto &t : triangles) {
+        ofxHeadlessFbo fbo;
+        fbo.allocate(w, h, OF_PIXELS_RGB);
+        fbo.clear(ofColor::black);
+        drawShaded(fbo, t, corners);
+        const ofPixels pixels = fbo.getPixels();
+        const float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+        float worst = 0;
+        size_t drawn = 0;
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                if (pixelIs(pixels, x, y, ofColor::black)) {
+                    continue;
+                }
+                ++drawn;
+                const float px = x + 0.5f;
+                const float py = y + 0.5f;
+                float weights[3];
+                for (size_t i = 0; i < 3; ++i) {
+                    const size_t j = (i + 1) % 3;
+                    const size_t k = (i + 2) % 3;
+                    weights[i] = ((t.x[j] - px) * (t.y[k] - py) - (t.x[k] - px) * (t.y[j] - py)) / area;
+                }
+                const ofColor color = pixels.getColor(x, y);
+                for (size_t c = 0; c < 3; ++c) {
+                    float expected = 0;
+                    for (size_t i = 0; i < 3; ++i) {
+                        expected += weights[i] * (&corners[i].r)[c];
+                    }
+                    // edge pixels whose centers are just outside are clamped to the corners' range
+                    expected = std::min(std::max(expected, 0.0f), 255.0f);
+                    worst = std::max(worst, std::fabs((&color.r)[c] - expected));
+                }
+            }
+        }
+        CHECK(drawn > 100);
+        CHECK(worst <= 2);
+    }
+}
+
+// moving by whole pixels moves the colors along, the corner order doesn't matter
+void testInvariance() {
+    for (const auto &t : triangles) {
+        ofxHeadlessFbo a;
+        a.allocate(w + 7, h + 5, OF_PIXELS_RGB);
+        a.clear(ofColor::black);
+        drawShaded(a, t, corners);
+        ofxHeadlessFbo b;
+        b.allocate(w + 7, h + 5, OF_PIXELS_RGB);
+        b.clear(ofColor::black);
+        drawShaded(b, t, corners, 7, 5);
+        ofxHeadlessFbo c;
+        c.allocate(w + 7, h + 5, OF_PIXELS_RGB);
+        c.clear(ofColor::black);
+        const Triangle reversed = {{t.x[2], t.x[1], t.x[0]}, {t.y[2], t.y[1], t.y[0]}};
+        const ofColor reversedColors[3] = {corners[2], corners[1], corners[0]};
+        drawShaded(c, reversed, reversedColors);
+
+        const ofPixels pa = a.getPixels();
+        const ofPixels pb = b.getPixels();
+        const ofPixels pc = c.getPixels();
+        bool moved = true;
+        int worst = 0;
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                const ofColor ca = pa.getColor(x, y);
+                const ofColor cc = pc.getColor(x, y);
+                moved = moved && ca == pb.getColor(x + 7, y + 5);
+                worst = std::max({worst, std::abs(ca.r - cc.r), std::abs(ca.g - cc.g), std::abs(ca.b - cc.b)});
+            }
+        }
+        CHECK(moved);
+        CHECK(worst <= 1);
+    }
+}
+
+// two triangles of a quad blend every pixel once, without gaps
+void testSharedEdge() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_GRAY);
+    fbo.clear(ofColor(0));
+    fbo.enableAlphaBlending();
+    const ofColor color(200, 200, 200, 128);
+    const ofColor colors[3] = {color, color, color};
+    const Triangle first = {{3.3f, 96.6f, 10.1f}, {4.7f, 8.2f, 75.4f}};
+    const Triangle second = {{96.6f, 90.9f, 10.1f}, {8.2f, 77.7f, 75.4f}};
+    drawShaded(fbo, first, colors);
+    drawShaded(fbo, second, colors);
+    const ofPixels pixels = fbo.getPixels();
+    const ofColor once = pixels.getColor(50, 40);
+    CHECK(once.r > 90 && once.r < 110);
+    size_t wrong = 0;
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            const unsigned char value = pixels.getColor(x, y).r;
+            wrong += value != 0 && value != once.r;
+        }
+    }
+    CHECK(wrong == 0);
+    // a pixel inside both triangles' bounds on the shared edge
+    CHECK(pixels.getColor(53, 42).r == once.r);
+}
+
+// corner alpha is blended like the alpha of the current color
+void testAlpha() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_GRAY);
+    fbo.clear(ofColor(0));
+    fbo.enableAlphaBlending();
+    const ofColor colors[3] = {ofColor(255, 255, 255, 0), ofColor(255, 255, 255, 255), ofColor(255, 255, 255, 255)};
+    const Triangle t = {{0, 100, 100}, {40, 0, 80}};
+    drawShaded(fbo, t, colors);
+    const ofPixels pixels = fbo.getPixels();
+    // alpha goes from 0 at the left corner to 255 at the right edge
+    CHECK(pixels.getColor(2, 40).r < 10);
+    CHECK(pixels.getColor(50, 40).r > 118 && pixels.getColor(50, 40).r < 138);
+    CHECK(pixels.getColor(98, 40).r > 245);
+}
+
+// colors have 8 bits whatever the buffer stores
+void testWide() {
+    for (const auto &t : triangles) {
+        ofxHeadlessFbo narrow;
+        narrow.allocate(w, h, OF_PIXELS_RGB);
+        narrow.clear(ofColor::black);
+        drawShaded(narrow, t, corners);
+        ofxHeadlessFbo wide;
+        wide.allocate(w, h, OF_PIXELS_RGB, OFX_HEADLESS_FBO_PRECISION_16);
+        wide.setDither(OFX_HEADLESS_FBO_DITHER_NONE);
+        wide.clear(ofColor::black);
+        drawShaded(wide, t, corners);
+        CHECK(samePixels(narrow.getPixels(), wide.getPixels()));
+    }
+}
+
+// a triangle without area is its longest edge, like the flat one
+void testDegenerate() {
+    const Triangle line = {{10, 90, 50}, {20, 60, 40}};
+    ofxHeadlessFbo shaded;
+    shaded.allocate(w, h, OF_PIXELS_RGB);
+    shaded.clear(ofColor::black);
+    drawShaded(shaded, line, corners);
+    ofxHeadlessFbo flat;
+    flat.allocate(w, h, OF_PIXELS_RGB);
+    flat.clear(ofColor::black);
+    flat.setColor(ofColor::white);
+    flat.drawTriangle(line.x[0], line.y[0], line.x[1], line.y[1], line.x[2], line.y[2]);
+    const ofPixels a = shaded.getPixels();
+    const ofPixels b = flat.getPixels();
+    bool same = true;
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            same = same && pixelIs(a, x, y, ofColor::black) == pixelIs(b, x, y, ofColor::black);
+        }
+    }
+    CHECK(same);
+    CHECK(countPixels(b, ofColor::white) >= 80);
+    // blended between the colors of the edge's corners, the middle corner is unused
+    const ofColor start = a.getColor(10, 20);
+    const ofColor end = a.getColor(89, 59);
+    CHECK(std::abs(start.r - corners[0].r) <= 4 && std::abs(start.b - corners[0].b) <= 4);
+    CHECK(std::abs(end.r - corners[1].r) <= 4 && std::abs(end.g - corners[1].g) <= 4);
+}
+
+} // namespace
+
+int main() {
+    testCoverage();
+    testInterpolation();
+    testInvariance();
+    testSharedEdge();
+    testAlpha();
+    testWide();
+    testDegenerate();
+    return finish("gouraud");
+}
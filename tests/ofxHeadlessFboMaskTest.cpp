@@ -0,0 +1,216 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Drawing through MONO1 and GRAY masks compared pixel by pixel with the
+// mask, for spans, per-pixel colored rows and changes of the mask.
+
+#include "ofxHeadlessFboTest.h"
+#include <cstdlib>
+#include <random>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+const size_t w = 77;
+const size_t h = 41;
+
+// a circle and random bits, so runs start and end inside and across bytes
+void drawMaskShape(ofxHeadlessFbo &mask, unsigned int seed) {
+    mask.clear(ofColor::black);
+    mask.setColor(ofColor::white);
+    mask.drawCircle(30, 20, 15);
+    mask.drawRectangle(64, 0, 8, h);
+    std::mt19937 random(seed);
+    for (size_t i = 0; i < 300; ++i) {
+        mask.drawPoint(random() % w, random() % h);
+    }
+}
+
+// masked pixels show the color, the others keep the background
+bool matchesMask(const ofPixels &canvas, const ofPixels &mask, const ofColor &inside, const ofColor &outside) {
+    for (size_t y = 0; y < canvas.getHeight(); ++y) {
+        for (size_t x = 0; x < canvas.getWidth(); ++x) {
+            const bool set = x < mask.getWidth() && y < mask.getHeight() && mask.getColor(x, y).r != 0;
+            if (!pixelIs(canvas, x, y, set ? inside : outside)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void testMono() {
+    ofxHeadlessFbo mask;
+    mask.allocate(w, h, OFX_HEADLESS_FBO_PACKED_MONO1);
+    drawMaskShape(mask, 1);
+    for (ofPixelFormat format : {OF_PIXELS_RGB, OF_PIXELS_RGBA, OF_PIXELS_GRAY}) {
+        ofxHeadlessFbo fbo;
+        fbo.allocate(w, h, format);
+        fbo.clear(ofColor(0, 0, 0, 255));
+        fbo.setMask(&mask);
+        CHECK(fbo.getMask() == &mask);
+        const ofColor color = format == OF_PIXELS_GRAY ? ofColor(200) : ofColor(200, 100, 50, 255);
+        fbo.setColor(color);
+        // spans of every length and start
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; x += 1 + y % 9) {
+                fbo.drawRectangle(x, y, 1 + y % 9, 1);
+            }
+        }
+        CHECK(matchesMask(fbo.getPixels(), mask.getPixels(), color, ofColor(0, 0, 0, 255)));
+    }
+}
+
+// runs are rebuilt after the mask changes, clear() ignores the mask
+void testMaskChanges() {
+    ofxHeadlessFbo mask;
+    mask.allocate(w, h, OFX_HEADLESS_FBO_PACKED_MONO1);
+    drawMaskShape(mask, 2);
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    fbo.setMask(&mask);
+    fbo.setColor(ofColor::red);
+    fbo.drawRectangle(0, 0, w, h);
+    fbo.clear(ofColor::black);
+    CHECK(countPixels(fbo.getPixels(), ofColor::black) == w * h);
+
+    drawMaskShape(mask, 3);
+    fbo.clear(ofColor::black);
+    fbo.drawRectangle(0, 0, w, h);
+    CHECK(matchesMask(fbo.getPixels(), mask.getPixels(), ofColor::red, ofColor::black));
+
+    fbo.setMask(nullptr);
+    CHECK(fbo.getMask() == nullptr);
+    fbo.drawRectangle(0, 0, w, h);
+    CHECK(countPixels(fbo.getPixels(), ofColor::red) == w * h);
+}
+
+// a mask smaller than the canvas masks out the rest
+void testSmallMask() {
+    ofxHeadlessFbo mask;
+    mask.allocate(20, 10, OFX_HEADLESS_FBO_PACKED_MONO1);
+    mask.clear(ofColor::white);
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    fbo.clear(ofColor::black);
+    fbo.setMask(&mask);
+    fbo.setColor(ofColor::green);
+    fbo.drawRectangle(0, 0, w, h);
+    CHECK(matchesMask(fbo.getPixels(), mask.getPixels(), ofColor::green, ofColor::black));
+    CHECK(countPixels(fbo.getPixels(), ofColor::green) == 200);
+}
+
+// coverage of a GRAY mask blends, with and without the alpha of the color
+void testCoverage() {
+    ofxHeadlessFbo mask;
+    mask.allocate(w, h, OF_PIXELS_GRAY);
+    for (size_t x = 0; x < w; ++x) {
+        mask.setColor(ofColor(x * 255 / (w - 1)));
+        mask.drawRectangle(x, 0, 1, h / 2);
+    }
+    mask.setColor(ofColor(255));
+    mask.drawRectangle(0, h / 2, w / 2, h - h / 2);
+    const ofPixels coverage = mask.getPixels();
+
+    for (bool blending : {false, true}) {
+        ofxHeadlessFbo fbo;
+        fbo.allocate(w, h, OF_PIXELS_GRAY);
+        fbo.clear(ofColor(0));
+        fbo.setMask(&mask);
+        if (blending) {
+            fbo.enableAlphaBlending();
+        }
+        fbo.setColor(ofColor(255, 255, 255, 128));
+        fbo.drawRectangle(0, 0, w, h);
+        const ofPixels pixels = fbo.getPixels();
+        int worst = 0;
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                const int c = coverage.getColor(x, y).r;
+                const int expected = blending ? c * 128 / 255 : c;
+                worst = std::max(worst, std::abs(pixels.getColor(x, y).r - expected));
+            }
+        }
+        CHECK(worst <= 1);
+    }
+}
+
+// shaded triangles write per-pixel colors through the mask
+void testColoredRows() {
+    ofxHeadlessFbo mask;
+    mask.allocate(w, h, OFX_HEADLESS_FBO_PACKED_MONO1);
+    drawMaskShape(mask, 4);
+    ofxHeadlessFbo masked;
+    masked.allocate(w, h, OF_PIXELS_RGB);
+    masked.clear(ofColor::black);
+    masked.setMask(&mask);
+    ofxHeadlessFbo full;
+    full.allocate(w, h, OF_PIXELS_RGB);
+    full.clear(ofColor::black);
+    for (ofxHeadlessFbo *fbo : {&masked, &full}) {
+        fbo->drawTriangle(0, 0, w, 0, 0, h, ofColor(250, 10, 10), ofColor(10, 250, 10), ofColor(10, 10, 250));
+        fbo->drawTriangle(w, 0, w, h, 0, h, ofColor(10, 10, 250), ofColor(250, 250, 10), ofColor(10, 250, 10));
+    }
+    const ofPixels a = masked.getPixels();
+    const ofPixels b = full.getPixels();
+    const ofPixels bits = mask.getPixels();
+    bool same = true;
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            const ofColor expected = bits.getColor(x, y).r != 0 ? b.getColor(x, y) : ofColor::black;
+            same = same && pixelIs(a, x, y, expected);
+        }
+    }
+    CHECK(same);
+}
+
+void testRejected() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(w, h, OF_PIXELS_RGB);
+    ofxHeadlessFbo rgb;
+    rgb.allocate(w, h, OF_PIXELS_RGB);
+    fbo.setMask(&rgb);
+    CHECK(fbo.getMask() == nullptr);
+    ofxHeadlessFbo wide;
+    wide.allocate(w, h, OF_PIXELS_GRAY, OFX_HEADLESS_FBO_PRECISION_16);
+    fbo.setMask(&wide);
+    CHECK(fbo.getMask() == nullptr);
+    fbo.setMask(&fbo);
+    CHECK(fbo.getMask() == nullptr);
+}
+
+} // namespace
+
+int main() {
+    testMono();
+    testMaskChanges();
+    testSmallMask();
+    testCoverage();
+    testColoredRows();
+    testRejected();
+    return finish("mask");
+}
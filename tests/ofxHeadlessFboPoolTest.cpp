@@ -0,0 +1,133 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Canvases sharing the arena of a pool, cleared and read out together.
+
+#include "ofxHeadlessFboPool.h"
+#include "ofxHeadlessFboTest.h"
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+// every canvas reads back like a canvas of its own cleared with the color,
+// so no clear wrote into its neighbours
+bool allCleared(const ofxHeadlessFboPool &pool, const ofColor &color) {
+    for (const auto &canvas : pool) {
+        ofxHeadlessFbo reference;
+        if (canvas.getPackedFormat() != OFX_HEADLESS_FBO_PACKED_NONE) {
+            reference.allocate(canvas.getWidth(), canvas.getHeight(), canvas.getPackedFormat());
+            reference.setPalette(canvas.getPalette());
+        } else {
+            reference.allocate(canvas.getWidth(), canvas.getHeight(), canvas.getPixelFormat());
+        }
+        reference.clear(color);
+        ofPixels a;
+        ofPixels b;
+        canvas.readPixels(a);
+        reference.readPixels(b);
+        if (!samePixels(a, b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testRowBytes() {
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OF_PIXELS_RGB) == 30);
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OF_PIXELS_GRAY_ALPHA) == 20);
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OF_PIXELS_RGB565) == 20);
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OF_PIXELS_UNKNOWN) == 0);
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OFX_HEADLESS_FBO_PACKED_MONO1) == 2);
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OFX_HEADLESS_FBO_PACKED_INDEXED8) == 10);
+    CHECK(ofxHeadlessFbo::getRowBytes(10, OFX_HEADLESS_FBO_PACKED_NONE) == 0);
+}
+
+void testClearAll() {
+    // odd sizes leave padding between the canvases
+    for (ofPixelFormat format : {OF_PIXELS_RGB, OF_PIXELS_RGBA, OF_PIXELS_GRAY, OF_PIXELS_BGRA}) {
+        for (size_t count : {1, 2, 7, 100}) {
+            ofxHeadlessFboPool pool;
+            CHECK(pool.allocate(count, 7, 5, format));
+            pool[0].setColor(ofColor::white);
+            pool[0].drawRectangle(0, 0, 3, 3);
+            pool[count - 1].resetDirtyRegion();
+            const uint64_t version = pool[count - 1].getVersion();
+
+            const ofColor color(10, 20, 30, 40);
+            pool.clearAll(color);
+            CHECK(allCleared(pool, color));
+            CHECK(pool[count - 1].getVersion() != version);
+            CHECK(pool[count - 1].getDirtyRegion().width == 7);
+        }
+    }
+}
+
+void testClearAllPacked() {
+    ofxHeadlessFboPool pool;
+    CHECK(pool.allocate(9, 13, 3, OFX_HEADLESS_FBO_PACKED_RGB565, 16));
+    pool.clearAll(ofColor(255, 0, 0));
+    std::vector<unsigned char> frame;
+    pool.readAll(frame);
+    bool red = frame.size() == 9 * 13 * 3 * 2;
+    for (size_t i = 0; i + 1 < frame.size(); i += 2) {
+        red = red && frame[i] == 0x00 && frame[i + 1] == 0xF8;
+    }
+    CHECK(red);
+
+    // indexed canvases with their own palettes store the color differently
+    CHECK(pool.allocate(3, 8, 8, OFX_HEADLESS_FBO_PACKED_INDEXED8));
+    pool[1].setPalette({ofColor::black, ofColor::blue, ofColor::green});
+    pool.clearAll(ofColor::blue);
+    CHECK(allCleared(pool, ofColor::blue));
+
+    // and lazily cleared ones only mark their tiles
+    CHECK(pool.allocate(4, 70, 70, OF_PIXELS_RGB));
+    pool[2].setLazyClear(true);
+    pool.clearAll(ofColor::green);
+    CHECK(allCleared(pool, ofColor::green));
+}
+
+void testShapeCacheDisabled() {
+    ofxHeadlessFboPool pool;
+    CHECK(pool.allocate(3, 32, 32, OF_PIXELS_RGB));
+    for (auto &canvas : pool) {
+        CHECK(canvas.getShapeCacheSize() == 0);
+        canvas.drawCircle(16, 16, 10);
+        canvas.drawCircle(16, 16, 10);
+        CHECK(canvas.getShapeCacheStats().entries == 0);
+    }
+}
+
+} // namespace
+
+int main() {
+    testRowBytes();
+    testClearAll();
+    testClearAllPacked();
+    testShapeCacheDisabled();
+    return finish("pool");
+}
@@ -0,0 +1,194 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// 16 bit and float canvases: blending at full precision and the dither
+// modes quantizing them to 8 bits.
+
+#include "ofxHeadlessFboTest.h"
+#include <cmath>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+const size_t size = 16;
+
+// GRAY canvas of the given precision with every pixel at value out of 255
+ofxHeadlessFbo makeLevel(ofxHeadlessFboPrecision precision, float value) {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(size, size, OF_PIXELS_GRAY, precision);
+    if (precision == OFX_HEADLESS_FBO_PRECISION_16) {
+        ofShortPixels pixels;
+        pixels.allocate(size, size, OF_PIXELS_GRAY);
+        for (size_t i = 0; i < size * size; ++i) {
+            pixels.getData()[i] = static_cast<unsigned short>(std::lround(value * 257));
+        }
+        fbo.setFromPixels(pixels);
+    } else {
+        ofFloatPixels pixels;
+        pixels.allocate(size, size, OF_PIXELS_GRAY);
+        for (size_t i = 0; i < size * size; ++i) {
+            pixels.getData()[i] = value / 255.0f;
+        }
+        fbo.setFromPixels(pixels);
+    }
+    return fbo;
+}
+
+double mean(const ofPixels &pixels) {
+    double sum = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        sum += pixels.getData()[i];
+    }
+    return sum / pixels.size();
+}
+
+// values other than the two 8 bit levels around the exact one
+size_t countOutside(const ofPixels &pixels, int low) {
+    size_t count = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        count += pixels.getData()[i] != low && pixels.getData()[i] != low + 1;
+    }
+    return count;
+}
+
+void testNoDither() {
+    for (auto precision : {OFX_HEADLESS_FBO_PRECISION_16, OFX_HEADLESS_FBO_PRECISION_FLOAT}) {
+        ofxHeadlessFbo fbo = makeLevel(precision, 100.3f);
+        fbo.setDither(OFX_HEADLESS_FBO_DITHER_NONE);
+        CHECK(countPixels(fbo.getPixels(), ofColor(100)) == size * size);
+        ofxHeadlessFbo above = makeLevel(precision, 100.7f);
+        above.setDither(OFX_HEADLESS_FBO_DITHER_NONE);
+        CHECK(countPixels(above.getPixels(), ofColor(101)) == size * size);
+    }
+}
+
+void testOrdered() {
+    for (auto precision : {OFX_HEADLESS_FBO_PRECISION_16, OFX_HEADLESS_FBO_PRECISION_FLOAT}) {
+        // exact levels stay flat
+        ofxHeadlessFbo exact = makeLevel(precision, 100);
+        CHECK(exact.getDither() == OFX_HEADLESS_FBO_DITHER_ORDERED);
+        CHECK(countPixels(exact.getPixels(), ofColor(100)) == size * size);
+
+        // levels in between mix the two neighbours in proportion, the same every frame
+        for (float value : {100.25f, 100.5f, 100.75f}) {
+            ofxHeadlessFbo fbo = makeLevel(precision, value);
+            ofPixels first;
+            fbo.readPixels(first);
+            CHECK(countOutside(first, 100) == 0);
+            CHECK(std::fabs(mean(first) - value) < 1.0 / 64);
+            CHECK(samePixels(first, fbo.getPixels()));
+        }
+    }
+}
+
+void testTemporal() {
+    for (auto precision : {OFX_HEADLESS_FBO_PRECISION_16, OFX_HEADLESS_FBO_PRECISION_FLOAT}) {
+        ofxHeadlessFbo fbo = makeLevel(precision, 100.3f);
+        fbo.setDither(OFX_HEADLESS_FBO_DITHER_TEMPORAL);
+        // every pixel averages to the exact value over the 64 frames of the pattern
+        std::vector<double> sums(size * size, 0);
+        ofPixels previous;
+        size_t changed = 0;
+        for (size_t frame = 0; frame < 64; ++frame) {
+            ofPixels pixels;
+            fbo.readPixels(pixels);
+            CHECK(countOutside(pixels, 100) == 0);
+            for (size_t i = 0; i < size * size; ++i) {
+                sums[i] += pixels.getData()[i];
+            }
+            changed += frame > 0 && !samePixels(pixels, previous);
+            previous = pixels;
+        }
+        CHECK(changed > 0);
+        double worst = 0;
+        for (double sum : sums) {
+            worst = std::max(worst, std::fabs(sum / 64 - 100.3));
+        }
+        CHECK(worst < 1.0 / 64 + 0.01);
+    }
+}
+
+// a translucent black rectangle drawn over and over fades to black, 8 bits get stuck
+void testFade() {
+    for (auto precision : {OFX_HEADLESS_FBO_PRECISION_8, OFX_HEADLESS_FBO_PRECISION_16,
+                           OFX_HEADLESS_FBO_PRECISION_FLOAT}) {
+        ofxHeadlessFbo fbo;
+        if (precision == OFX_HEADLESS_FBO_PRECISION_8) {
+            fbo.allocate(size, size, OF_PIXELS_RGB);
+        } else {
+            fbo.allocate(size, size, OF_PIXELS_RGB, precision);
+        }
+        fbo.setDither(OFX_HEADLESS_FBO_DITHER_NONE);
+        fbo.clear(ofColor::white);
+        fbo.enableAlphaBlending();
+        fbo.setColor(ofColor(0, 0, 0, 8));
+        for (size_t i = 0; i < 400; ++i) {
+            fbo.drawRectangle(0, 0, size, size);
+        }
+        const size_t black = countPixels(fbo.getPixels(), ofColor::black);
+        if (precision == OFX_HEADLESS_FBO_PRECISION_8) {
+            CHECK(black == 0);
+        } else {
+            CHECK(black == size * size);
+        }
+    }
+}
+
+// full precision pixels keep what 8 bits lose
+void testWidePixels() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(size, size, OF_PIXELS_RGBA, OFX_HEADLESS_FBO_PRECISION_16);
+    CHECK(fbo.getPrecision() == OFX_HEADLESS_FBO_PRECISION_16);
+    CHECK(fbo.getFloatPixels().size() == 0);
+    fbo.clear(ofColor(0, 0, 0, 255));
+    fbo.enableAlphaBlending();
+    fbo.setColor(ofColor(255, 255, 255, 1));
+    fbo.drawRectangle(0, 0, size, size);
+    const ofShortPixels &wide = fbo.getShortPixels();
+    CHECK(wide.getWidth() == size && wide.getNumChannels() == 4);
+    CHECK(wide.getData()[0] == 257);
+    CHECK(wide.getData()[3] == 65535);
+
+    ofxHeadlessFbo floats;
+    floats.allocate(size, size, OF_PIXELS_GRAY, OFX_HEADLESS_FBO_PRECISION_FLOAT);
+    floats.clear(ofColor(0));
+    floats.enableAlphaBlending();
+    floats.setColor(ofColor(255, 255, 255, 64));
+    floats.drawRectangle(0, 0, size, size);
+    CHECK(std::fabs(floats.getFloatPixels().getData()[0] - 64 / 255.0f) < 1e-5f);
+}
+
+} // namespace
+
+int main() {
+    testNoDither();
+    testOrdered();
+    testTemporal();
+    testFade();
+    testWidePixels();
+    return finish("precision");
+}
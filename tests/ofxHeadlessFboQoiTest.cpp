@@ -0,0 +1,204 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// QOI snapshots decoded again by a decoder written from the format
+// specification, for every pixel layout the encoder takes.
+
+#include "ofxHeadlessFboCapture.h"
+#include "ofxHeadlessFboTest.h"
+#include <random>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+uint32_t getU32(const unsigned char *p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+// RGBA pixels of a QOI file, empty if it is malformed
+std::vector<unsigned char> decodeQoi(const std::vector<unsigned char> &file, size_t &w, size_t &h,
+                                     size_t &channels) {
+    const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    if (file.size() < 22 || std::memcmp(file.data(), "qoif", 4) != 0 ||
+        std::memcmp(file.data() + file.size() - 8, end, 8) != 0) {
+        return {};
+    }
+    w = getU32(file.data() + 4);
+    h = getU32(file.data() + 8);
+    channels = file[12];
+    std::vector<unsigned char> pixels(w * h * 4);
+    unsigned char index[64][4] = {};
+    unsigned char px[4] = {0, 0, 0, 255};
+    size_t p = 14;
+    const size_t last = file.size() - 8;
+    for (size_t i = 0; i < w * h;) {
+        if (p >= last) {
+            return {};
+        }
+        const unsigned char b1 = file[p++];
+        size_t run = 1;
+        if (b1 == 0xfe) {
+            std::memcpy(px, &file[p], 3);
+            p += 3;
+        } else if (b1 == 0xff) {
+            std::memcpy(px, &file[p], 4);
+            p += 4;
+        } else if ((b1 & 0xc0) == 0x00) {
+            std::memcpy(px, index[b1], 4);
+        } else if ((b1 & 0xc0) == 0x40) {
+            px[0] += ((b1 >> 4) & 3) - 2;
+            px[1] += ((b1 >> 2) & 3) - 2;
+            px[2] += (b1 & 3) - 2;
+        } else if ((b1 & 0xc0) == 0x80) {
+            const unsigned char b2 = file[p++];
+            const int dg = (b1 & 0x3f) - 32;
+            px[0] += dg - 8 + ((b2 >> 4) & 0x0f);
+            px[1] += dg;
+            px[2] += dg - 8 + (b2 & 0x0f);
+        } else {
+            run = (b1 & 0x3f) + 1;
+        }
+        std::memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        for (; run > 0 && i < w * h; --run, ++i) {
+            std::memcpy(&pixels[i * 4], px, 4);
+        }
+    }
+    return p == last ? pixels : std::vector<unsigned char>();
+}
+
+// the decoded file holds the pixels, gray spread over RGB and missing alpha opaque
+bool roundTrips(const ofPixels &pixels) {
+    std::vector<unsigned char> file;
+    if (!ofxHeadlessFboCapture::encodeQoi(pixels, file)) {
+        return false;
+    }
+    size_t w = 0;
+    size_t h = 0;
+    size_t channels = 0;
+    const std::vector<unsigned char> decoded = decodeQoi(file, w, h, channels);
+    const size_t numChannels = pixels.getNumChannels();
+    const bool alpha = numChannels == 2 || numChannels == 4;
+    if (decoded.empty() || w != pixels.getWidth() || h != pixels.getHeight() || channels != (alpha ? 4u : 3u) ||
+        file[13] != 0) {
+        return false;
+    }
+    for (size_t y = 0; y < h; ++y) {
+        for (size_t x = 0; x < w; ++x) {
+            const ofColor color = pixels.getColor(x, y);
+            const unsigned char *d = &decoded[(y * w + x) * 4];
+            const unsigned char a = alpha ? color.a : 255;
+            if (d[0] != color.r || d[1] != color.g || d[2] != color.b || d[3] != a) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// gradients, flat areas, translucent shapes and noise, so every op is used
+ofPixels makeScene(ofPixelFormat format) {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(67, 45, format);
+    fbo.clear(ofColor(0, 0, 0, 0));
+    for (size_t x = 0; x < 67; ++x) {
+        fbo.setColor(ofColor(x * 3, 255 - x * 2, x % 7, 100 + x));
+        fbo.drawRectangle(x, 0, 1, 10);
+    }
+    fbo.setColor(ofColor(200, 30, 90, 255));
+    fbo.drawCircle(30, 25, 12);
+    fbo.enableAlphaBlending();
+    fbo.setColor(ofColor(20, 200, 90, 120));
+    fbo.drawRectangle(20, 15, 40, 20);
+    ofPixels pixels;
+    fbo.readPixels(pixels);
+    std::mt19937 random(7);
+    for (size_t i = pixels.size() - pixels.getNumChannels() * 200; i < pixels.size(); ++i) {
+        pixels.getData()[i] = random() & 0xff;
+    }
+    return pixels;
+}
+
+void testFormats() {
+    for (ofPixelFormat format : {OF_PIXELS_RGB, OF_PIXELS_RGBA, OF_PIXELS_BGR, OF_PIXELS_BGRA, OF_PIXELS_GRAY,
+                                 OF_PIXELS_GRAY_ALPHA}) {
+        CHECK(roundTrips(makeScene(format)));
+    }
+}
+
+// runs of up to 62 pixels, the first one continuing the opaque black start
+void testRuns() {
+    ofPixels pixels;
+    pixels.allocate(1000, 1, OF_PIXELS_RGB);
+    pixels.setColor(ofColor::black);
+    std::vector<unsigned char> file;
+    CHECK(ofxHeadlessFboCapture::encodeQoi(pixels, file));
+    CHECK(file.size() == 14 + 17 + 8);
+    CHECK(file[14] == (0xc0 | 61));
+    CHECK(roundTrips(pixels));
+
+    pixels.setColor(ofColor(10, 20, 30));
+    pixels.setColor(999, 0, ofColor(10, 20, 31));
+    CHECK(roundTrips(pixels));
+}
+
+// a small change is one byte, colors seen before come from the index
+void testSmallOps() {
+    ofPixels pixels;
+    pixels.allocate(4, 1, OF_PIXELS_RGB);
+    pixels.setColor(0, 0, ofColor(1, 0, 255));
+    pixels.setColor(1, 0, ofColor(100, 100, 100));
+    pixels.setColor(2, 0, ofColor(1, 0, 255));
+    pixels.setColor(3, 0, ofColor(16, 10, 4));
+    std::vector<unsigned char> file;
+    CHECK(ofxHeadlessFboCapture::encodeQoi(pixels, file));
+    // diff, rgb, index, luma
+    CHECK(file.size() == 14 + 1 + 4 + 1 + 2 + 8);
+    CHECK((file[14] & 0xc0) == 0x40);
+    CHECK(file[15] == 0xfe);
+    CHECK((file[19] & 0xc0) == 0x00);
+    CHECK((file[20] & 0xc0) == 0x80);
+    CHECK(roundTrips(pixels));
+}
+
+void testRejected() {
+    std::vector<unsigned char> file;
+    ofPixels empty;
+    CHECK(!ofxHeadlessFboCapture::encodeQoi(empty, file));
+    ofPixels packed;
+    packed.allocate(4, 4, OF_PIXELS_RGB565);
+    CHECK(!ofxHeadlessFboCapture::encodeQoi(packed, file));
+}
+
+} // namespace
+
+int main() {
+    testFormats();
+    testRuns();
+    testSmallOps();
+    testRejected();
+    return finish("qoi");
+}
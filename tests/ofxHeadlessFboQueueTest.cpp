@@ -0,0 +1,136 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// The bounded lock-free queue of the frame pipeline, alone and with
+// several producers and consumers at once.
+
+#include "ofxHeadlessFboQueue.h"
+#include "ofxHeadlessFboTest.h"
+#include <thread>
+#include <vector>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+void testCapacity() {
+    CHECK(ofxHeadlessFboQueue<int>(0).capacity() == 2);
+    CHECK(ofxHeadlessFboQueue<int>(2).capacity() == 2);
+    CHECK(ofxHeadlessFboQueue<int>(5).capacity() == 8);
+    CHECK(ofxHeadlessFboQueue<int>(16).capacity() == 16);
+    CHECK(ofxHeadlessFboQueue<int>().capacity() == 16);
+}
+
+// first in, first out, across the wrap of the cells
+void testOrder() {
+    ofxHeadlessFboQueue<int> queue(4);
+    int value = -1;
+    CHECK(!queue.pop(value));
+    int next = 0;
+    int expected = 0;
+    bool ordered = true;
+    for (size_t round = 0; round < 10; ++round) {
+        while (queue.push(next)) {
+            ++next;
+        }
+        // full after exactly the capacity
+        CHECK(next - expected == 4);
+        // a freed cell takes one more
+        ordered = ordered && queue.pop(value) && value == expected++;
+        CHECK(queue.push(next++));
+        CHECK(!queue.push(next));
+        while (queue.pop(value)) {
+            ordered = ordered && value == expected++;
+        }
+    }
+    CHECK(ordered);
+    CHECK(expected == next);
+}
+
+// every value pushed by one of the producers is popped exactly once, and
+// values of one producer come out in the order they went in
+void testConcurrent() {
+    const size_t producers = 4;
+    const size_t consumers = 4;
+    const size_t perProducer = 50000;
+    ofxHeadlessFboQueue<size_t> queue(64);
+    std::vector<std::atomic<int>> popped(producers * perProducer);
+    std::atomic<size_t> remaining{producers * perProducer};
+    std::atomic<size_t> outOfOrder{0};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < perProducer; ++i) {
+                while (!queue.push(p * perProducer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&]() {
+            std::vector<size_t> last(producers, 0);
+            std::vector<bool> seen(producers, false);
+            size_t value;
+            while (remaining > 0) {
+                if (!queue.pop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const size_t producer = value / perProducer;
+                if (seen[producer] && value <= last[producer]) {
+                    ++outOfOrder;
+                }
+                seen[producer] = true;
+                last[producer] = value;
+                ++popped[value];
+                --remaining;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    size_t wrong = 0;
+    for (const auto &count : popped) {
+        wrong += count != 1;
+    }
+    CHECK(wrong == 0);
+    CHECK(outOfOrder == 0);
+    size_t value;
+    CHECK(!queue.pop(value));
+}
+
+} // namespace
+
+int main() {
+    testCapacity();
+    testOrder();
+    testConcurrent();
+    return finish("queue");
+}
@@ -0,0 +1,208 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Canvases rendered in parallel by the scheduler's workers, their scratch
+// arenas and errors thrown by render callbacks.
+
+#include "ofxHeadlessFboScheduler.h"
+#include "ofxHeadlessFboTest.h"
+#include <cstdint>
+#include <stdexcept>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+void drawPanel(ofxHeadlessFbo &fbo, size_t index, size_t frame) {
+    fbo.clear(ofColor(index % 256, frame % 256, 0));
+    fbo.setColor(ofColor::white);
+    fbo.drawCircle(8 + index % 16, 8, 1 + frame % 6);
+}
+
+// every canvas ends up as if drawn one after the other on this thread
+void testMatchesSerial() {
+    const size_t count = 64;
+    std::vector<ofxHeadlessFbo> panels(count);
+    std::vector<size_t> runs(count, 0);
+    ofxHeadlessFboScheduler scheduler;
+    scheduler.setup(4);
+    CHECK(scheduler.getNumThreads() == 4);
+    size_t frame = 0;
+    for (size_t i = 0; i < count; ++i) {
+        panels[i].allocate(24 + i % 5, 16, OF_PIXELS_RGB);
+        CHECK(scheduler.add(panels[i], [i, &runs, &frame](ofxHeadlessFbo &fbo, ofxHeadlessFboScheduler::Scratch &) {
+            ++runs[i];
+            drawPanel(fbo, i, frame);
+        }) == i);
+    }
+    CHECK(scheduler.size() == count);
+
+    for (frame = 0; frame < 10; ++frame) {
+        scheduler.render();
+        bool same = true;
+        for (size_t i = 0; i < count; ++i) {
+            ofxHeadlessFbo reference;
+            reference.allocate(panels[i].getWidth(), 16, OF_PIXELS_RGB);
+            drawPanel(reference, i, frame);
+            same = same && samePixels(panels[i].getPixels(), reference.getPixels());
+        }
+        CHECK(same);
+    }
+    size_t wrongRuns = 0;
+    for (size_t run : runs) {
+        wrongRuns += run != 10;
+    }
+    CHECK(wrongRuns == 0);
+}
+
+// costs of the last frame, and a frame lasting at least as long as its longest task
+void testCosts() {
+    std::vector<ofxHeadlessFbo> panels(8);
+    ofxHeadlessFboScheduler scheduler;
+    scheduler.setup(2);
+    for (size_t i = 0; i < panels.size(); ++i) {
+        panels[i].allocate(8, 8, OF_PIXELS_GRAY);
+        scheduler.add(panels[i], [i](ofxHeadlessFbo &fbo, ofxHeadlessFboScheduler::Scratch &) {
+            if (i == 3) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            fbo.clear(ofColor(i));
+        });
+    }
+    CHECK(scheduler.getCost(3) == 0);
+    // without costs the tasks alternate between the workers, the other
+    // worker steals the short tasks queued behind the long one
+    scheduler.render();
+    CHECK(scheduler.getSteals() > 0);
+    CHECK(scheduler.getCost(3) >= 20000000);
+    CHECK(scheduler.getFrameTime() >= scheduler.getCost(3));
+    CHECK(scheduler.getCost(100) == 0);
+    CHECK(countPixels(panels[7].getPixels(), ofColor(7)) == 64);
+}
+
+// aligned scratch memory, grown into one block after a task needed several
+void testScratch() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(8, 8, OF_PIXELS_GRAY);
+    ofxHeadlessFboScheduler scheduler;
+    scheduler.setup(1);
+    bool aligned = true;
+    bool distinct = true;
+    size_t capacity = 0;
+    scheduler.add(fbo, [&](ofxHeadlessFbo &, ofxHeadlessFboScheduler::Scratch &scratch) {
+        unsigned char *bytes = static_cast<unsigned char *>(scratch.allocate(3, 1));
+        double *doubles = scratch.allocate<double>(10);
+        void *page = scratch.allocate(100, 4096);
+        aligned = aligned && reinterpret_cast<uintptr_t>(doubles) % alignof(double) == 0 &&
+                  reinterpret_cast<uintptr_t>(page) % 4096 == 0;
+        distinct = distinct && bytes + 3 <= reinterpret_cast<unsigned char *>(doubles);
+        // more than the first block holds
+        std::vector<unsigned char *> blocks;
+        for (size_t i = 0; i < 4; ++i) {
+            blocks.push_back(static_cast<unsigned char *>(scratch.allocate(40000)));
+            std::memset(blocks.back(), static_cast<int>(i), 40000);
+        }
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            distinct = distinct && blocks[i][0] == i && blocks[i][39999] == i;
+        }
+        capacity = scratch.getCapacity();
+    });
+    scheduler.render();
+    const size_t first = capacity;
+    CHECK(first >= 160000);
+    scheduler.render();
+    CHECK(capacity == first);
+    CHECK(aligned);
+    CHECK(distinct);
+}
+
+// the first exception of a frame comes out of render(), the next frame runs normally
+void testExceptions() {
+    std::vector<ofxHeadlessFbo> panels(16);
+    ofxHeadlessFboScheduler scheduler;
+    bool fail = true;
+    std::atomic<size_t> runs{0};
+    for (size_t i = 0; i < panels.size(); ++i) {
+        panels[i].allocate(4, 4, OF_PIXELS_GRAY);
+        scheduler.add(panels[i], [i, &fail, &runs](ofxHeadlessFbo &fbo, ofxHeadlessFboScheduler::Scratch &) {
+            ++runs;
+            if (fail && i % 5 == 0) {
+                throw std::runtime_error("panel failed");
+            }
+            fbo.clear(ofColor(200));
+        });
+    }
+    // render() starts the workers itself
+    bool thrown = false;
+    try {
+        scheduler.render();
+    } catch (const std::runtime_error &error) {
+        thrown = std::string(error.what()) == "panel failed";
+    }
+    CHECK(thrown);
+    CHECK(scheduler.getNumThreads() > 0);
+    CHECK(runs == panels.size());
+
+    fail = false;
+    std::shared_future<void> frame = scheduler.renderAsync();
+    frame.wait();
+    thrown = false;
+    try {
+        frame.get();
+    } catch (...) {
+        thrown = true;
+    }
+    CHECK(!thrown);
+    CHECK(runs == 2 * panels.size());
+    CHECK(countPixels(panels[0].getPixels(), ofColor(200)) == 16);
+}
+
+void testEmpty() {
+    ofxHeadlessFboScheduler scheduler;
+    scheduler.render();
+    CHECK(scheduler.getNumThreads() == 0);
+    ofxHeadlessFbo fbo;
+    fbo.allocate(4, 4, OF_PIXELS_GRAY);
+    scheduler.add(fbo, [](ofxHeadlessFbo &fbo, ofxHeadlessFboScheduler::Scratch &) { fbo.clear(ofColor(9)); });
+    scheduler.render();
+    scheduler.clear();
+    CHECK(scheduler.size() == 0);
+    scheduler.render();
+    scheduler.close();
+    CHECK(scheduler.getNumThreads() == 0);
+    CHECK(countPixels(fbo.getPixels(), ofColor(9)) == 16);
+}
+
+} // namespace
+
+int main() {
+    testMatchesSerial();
+    testCosts();
+    testScratch();
+    testExceptions();
+    testEmpty();
+    return finish("scheduler");
+}
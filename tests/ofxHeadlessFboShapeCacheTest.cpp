@@ -0,0 +1,151 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Filled shapes replayed from the shape cache against the same shapes drawn
+// without it.
+
+#include "ofxHeadlessFboTest.h"
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+// sizes from a pixel to larger than the canvas, partly outside of it
+void drawShapes(ofxHeadlessFbo &fbo, bool blending, int shift) {
+    fbo.clear(ofColor(10, 20, 30, 255));
+    if (blending) {
+        fbo.enableAlphaBlending();
+    } else {
+        fbo.disableAlphaBlending();
+    }
+    fbo.setColor(ofColor(200, 100, 50, blending ? 100 : 255));
+    int i = 0;
+    for (int r = 0; r < 150; r += r < 12 ? 1 : 9, ++i) {
+        const float x = (i * 37 + shift * 13) % 220 - 20 + 0.3f;
+        const float y = (i * 53 + shift * 7) % 180 - 20 + 0.6f;
+        fbo.drawCircle(x, y, r + 0.4f);
+        fbo.drawEllipse(x + 10.5f, y + 3.2f, r * 1.7f + 0.3f, r * 0.6f + 1.1f);
+        fbo.drawEllipse(x + 3.5f, y + 10.2f, r * 0.3f, r * 1.9f + 0.5f);
+        fbo.drawRectRounded(x - 5.5f, y + 2.1f, r * 2.1f + 3, r * 1.3f + 2, r * 0.4f);
+    }
+}
+
+void testCachedEqualsUncached() {
+    for (ofPixelFormat format : {OF_PIXELS_RGBA, OF_PIXELS_GRAY}) {
+        for (bool blending : {false, true}) {
+            for (int shift = 0; shift < 3; ++shift) {
+                ofxHeadlessFbo cached;
+                ofxHeadlessFbo uncached;
+                cached.allocate(200, 160, format);
+                uncached.allocate(200, 160, format);
+                uncached.setShapeCacheSize(0);
+
+                // the second pass replays every shape the first one recorded
+                drawShapes(cached, blending, shift);
+                drawShapes(cached, blending, shift);
+                drawShapes(uncached, blending, shift);
+                CHECK(cached.getShapeCacheStats().hits > 0);
+                CHECK(uncached.getShapeCacheStats().misses == 0);
+
+                ofPixels a;
+                ofPixels b;
+                cached.readPixels(a);
+                uncached.readPixels(b);
+                CHECK(samePixels(a, b));
+            }
+        }
+    }
+}
+
+void testBlendedPixelsOnce() {
+    // every pixel of a half transparent shape is blended exactly once
+    ofxHeadlessFbo fbo;
+    fbo.allocate(64, 64, OF_PIXELS_GRAY);
+    fbo.setShapeCacheSize(0);
+    fbo.enableAlphaBlending();
+    fbo.clear(ofColor(0));
+    fbo.setColor(ofColor(255, 255, 255, 128));
+    fbo.drawEllipse(32, 32, 50, 17);
+    fbo.drawCircle(10, 10, 7);
+    fbo.drawRectRounded(40, 40, 20, 20, 6);
+    ofPixels pixels;
+    fbo.readPixels(pixels);
+    const unsigned char *p = pixels.getData();
+    size_t other = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        other += p[i] != 0 && p[i] != 128;
+    }
+    CHECK(other == 0);
+}
+
+void testOversizedShapes() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(80, 60, OF_PIXELS_RGB);
+    fbo.setColor(ofColor::white);
+
+    // larger than the canvas, drawn without recording
+    fbo.drawCircle(40, 30, 3000);
+    fbo.drawEllipse(40, 30, 500, 40);
+    CHECK(fbo.getShapeCacheStats().misses == 0 && fbo.getShapeCacheStats().entries == 0);
+    ofPixels pixels;
+    fbo.readPixels(pixels);
+    CHECK(countPixels(pixels, ofColor::white) == 80 * 60);
+
+    // larger than the cap, never recorded either
+    fbo.setShapeCacheSize(256);
+    fbo.drawCircle(40, 30, 25);
+    fbo.drawCircle(40, 30, 25);
+    CHECK(fbo.getShapeCacheStats().misses == 0 && fbo.getShapeCacheStats().entries == 0);
+}
+
+void testEviction() {
+    ofxHeadlessFbo fbo;
+    fbo.allocate(100, 100, OF_PIXELS_RGB);
+    const size_t cap = 4 * ofxHeadlessFboShapeCache::getEntryBytes(21);
+    fbo.setShapeCacheSize(cap);
+    for (int r = 1; r <= 10; ++r) {
+        fbo.drawCircle(50, 50, r);
+    }
+    const auto &stats = fbo.getShapeCacheStats();
+    CHECK(stats.misses == 10);
+    CHECK(stats.evictions > 0);
+    CHECK(stats.bytes <= cap);
+
+    // the most recent shape is still cached
+    fbo.drawCircle(20, 20, 10);
+    CHECK(stats.hits == 1);
+}
+
+} // namespace
+
+int main() {
+    testCachedEqualsUncached();
+    testBlendedPixelsOnce();
+    testOversizedShapes();
+    testEviction();
+    return finish("shape cache");
+}
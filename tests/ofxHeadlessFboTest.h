@@ -0,0 +1,84 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Checks shared by the tests in this folder, every test is its own binary
+// and returns non-zero when a check failed.
+
+#pragma once
+
+#include "ofxHeadlessFbo.h"
+#include <cstdio>
+#include <cstring>
+
+namespace ofxHeadlessFboTest {
+
+inline int checks = 0;
+inline int failures = 0;
+
+inline bool pixelIs(const ofPixels &pixels, size_t x, size_t y, const ofColor &color) {
+    // channels in memory order
+    const unsigned char expected[4] = {color.r, color.g, color.b, color.a};
+    const unsigned char *p = pixels.getData() + (y * pixels.getWidth() + x) * pixels.getNumChannels();
+    for (size_t c = 0; c < pixels.getNumChannels(); ++c) {
+        if (p[c] != expected[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline size_t countPixels(const ofPixels &pixels, const ofColor &color) {
+    size_t count = 0;
+    for (size_t y = 0; y < pixels.getHeight(); ++y) {
+        for (size_t x = 0; x < pixels.getWidth(); ++x) {
+            count += pixelIs(pixels, x, y, color) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+inline bool samePixels(const ofPixels &a, const ofPixels &b) {
+    return a.getWidth() == b.getWidth() && a.getHeight() == b.getHeight() &&
+           a.getPixelFormat() == b.getPixelFormat() && std::memcmp(a.getData(), b.getData(), a.size()) == 0;
+}
+
+/// Prints the summary and returns the exit code of the test.
+inline int finish(const char *name) {
+    std::printf("%s: %d of %d checks passed\n", name, checks - failures, checks);
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace ofxHeadlessFboTest
+
+#define CHECK(condition)                                                     \
+    do {                                                                     \
+        ++ofxHeadlessFboTest::checks;                                        \
+        if (!(condition)) {                                                  \
+            ++ofxHeadlessFboTest::failures;                                  \
+            std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+        }                                                                    \
+    } while (false)
@@ -0,0 +1,213 @@
+/*
+Software License Agreement (BSD License)
+
+Copyright (c) 2022 Tomash GHz.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+// Shapes sharing edges tile the canvas without gaps or double blended
+// pixels, and the integer versions of the primitives match the float ones.
+
+#include "ofxHeadlessFboTest.h"
+#include <random>
+#include <vector>
+
+using namespace ofxHeadlessFboTest;
+
+namespace {
+
+const size_t w = 101;
+const size_t h = 83;
+
+// half transparent white over black, a pixel blended twice comes out brighter
+void prepare(ofxHeadlessFbo &fbo) {
+    fbo.allocate(w, h, OF_PIXELS_GRAY);
+    fbo.clear(ofColor(0));
+    fbo.enableAlphaBlending();
+    fbo.setColor(ofColor(255, 255, 255, 128));
+}
+
+unsigned char blendedOnce() {
+    ofxHeadlessFbo fbo;
+    prepare(fbo);
+    fbo.drawRectangle(0, 0, 1, 1);
+    return fbo.getPixels().getData()[0];
+}
+
+bool coveredOnce(const ofxHeadlessFbo &fbo) {
+    const unsigned char expected = blendedOnce();
+    ofPixels pixels;
+    fbo.readPixels(pixels);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        if (pixels.getData()[i] != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// uneven cuts from 0 to size
+std::vector<int> cuts(std::mt19937 &rng, int size) {
+    std::uniform_int_distribution<int> step(1, 17);
+    std::vector<int> result = {0};
+    while (result.back() < size) {
+        result.push_back(std::min(size, result.back() + step(rng)));
+    }
+    return result;
+}
+
+void testRectangles() {
+    std::mt19937 rng(7);
+    for (int run = 0; run < 5; ++run) {
+        ofxHeadlessFbo fbo;
+        prepare(fbo);
+        const std::vector<int> xs = cuts(rng, w);
+        const std::vector<int> ys = cuts(rng, h);
+        for (size_t j = 0; j + 1 < ys.size(); ++j) {
+            for (size_t i = 0; i + 1 < xs.size(); ++i) {
+                fbo.drawRectangle(xs[i], ys[j], xs[i + 1] - xs[i], ys[j + 1] - ys[j]);
+            }
+        }
+        CHECK(coveredOnce(fbo));
+    }
+}
+
+void testTriangles() {
+    // a grid of about 20 pixel cells with moved inner corners, small enough
+    // to keep the cells convex, every cell split along one of its diagonals
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> jitter(-4, 4);
+    const int nx = 5;
+    const int ny = 4;
+    for (int run = 0; run < 5; ++run) {
+        std::vector<int> px((nx + 1) * (ny + 1));
+        std::vector<int> py((nx + 1) * (ny + 1));
+        for (int y = 0; y <= ny; ++y) {
+            for (int x = 0; x <= nx; ++x) {
+                const bool innerX = x > 0 && x < nx;
+                const bool innerY = y > 0 && y < ny;
+                px[y * (nx + 1) + x] = x * static_cast<int>(w) / nx + (innerX ? jitter(rng) : 0);
+                py[y * (nx + 1) + x] = y * static_cast<int>(h) / ny + (innerY ? jitter(rng) : 0);
+            }
+        }
+
+        ofxHeadlessFbo fbo;
+        prepare(fbo);
+        for (int y = 0; y < ny; ++y) {
+            for (int x = 0; x < nx; ++x) {
+                const int a = y * (nx + 1) + x;
+                const int b = a + 1;
+                const int c = a + nx + 1;
+                const int d = c + 1;
+                // both diagonals and both windings
+                if ((x + y + run) % 2 == 0) {
+                    fbo.drawTriangle(px[a], py[a], px[b], py[b], px[d], py[d]);
+                    fbo.drawTriangle(px[a], py[a], px[c], py[c], px[d], py[d]);
+                } else {
+                    fbo.drawTriangle(px[b], py[b], px[a], py[a], px[c], py[c]);
+                    fbo.drawTriangle(px[c], py[c], px[d], py[d], px[b], py[b]);
+                }
+            }
+        }
+        CHECK(coveredOnce(fbo));
+    }
+}
+
+void testIntegerMatchesFloat() {
+    ofxHeadlessFbo a;
+    ofxHeadlessFbo b;
+    a.allocate(w, h, OF_PIXELS_RGBA);
+    b.allocate(w, h, OF_PIXELS_RGBA);
+    for (ofxHeadlessFbo *fbo : {&a, &b}) {
+        fbo->clear(ofColor(0, 0, 0, 255));
+        fbo->enableAlphaBlending();
+        fbo->setColor(ofColor(200, 100, 50, 150));
+    }
+    for (int i = 0; i < 20; ++i) {
+        const int x = (i * 37) % 90;
+        const int y = (i * 23) % 70;
+        const int s = 3 + i;
+        a.drawPoint(x, y);
+        a.drawLine(x, y, x + s, y + s / 2);
+        a.drawRectangle(x, y, s, s / 2);
+        a.drawTriangle(x, y + s, x + s / 2, y, x + s, y + s);
+        a.drawCircle(x, y, s / 2);
+        a.drawEllipse(x, y, s, s / 2);
+        a.drawRectRounded(x, y, s, s, s / 4);
+
+        const float fx = x;
+        const float fy = y;
+        const float fs = s;
+        b.drawPoint(fx, fy);
+        b.drawLine(fx, fy, fx + fs, fy + s / 2);
+        b.drawRectangle(fx, fy, fs, s / 2);
+        b.drawTriangle(fx, fy + fs, fx + s / 2, fy, fx + fs, fy + fs);
+        b.drawCircle(fx, fy, s / 2);
+        b.drawEllipse(fx, fy, fs, s / 2);
+        b.drawRectRounded(fx, fy, fs, fs, s / 4);
+    }
+    ofPixels pa;
+    ofPixels pb;
+    a.readPixels(pa);
+    b.readPixels(pb);
+    CHECK(samePixels(pa, pb));
+}
+
+void testFloorRounding() {
+    // points and lines start in the pixel containing their coordinates
+    ofxHeadlessFbo fbo;
+    fbo.allocate(10, 10, OF_PIXELS_GRAY);
+    fbo.clear(ofColor(0));
+    fbo.setColor(ofColor(255));
+    fbo.drawPoint(2.7f, 3.9f);
+    fbo.drawPoint(-0.5f, 5.0f);
+    ofPixels pixels;
+    fbo.readPixels(pixels);
+    CHECK(pixels.getData()[3 * 10 + 2] == 255);
+    CHECK(countPixels(pixels, ofColor(255)) == 1);
+
+    ofxHeadlessFbo line;
+    ofxHeadlessFbo reference;
+    line.allocate(10, 10, OF_PIXELS_GRAY);
+    reference.allocate(10, 10, OF_PIXELS_GRAY);
+    line.clear(ofColor(0));
+    reference.clear(ofColor(0));
+    line.setColor(ofColor(255));
+    reference.setColor(ofColor(255));
+    line.drawLine(1.9f, 4.6f, 7.99f, 4.1f);
+    reference.drawLine(1, 4, 7, 4);
+    ofPixels a;
+    ofPixels b;
+    line.readPixels(a);
+    reference.readPixels(b);
+    CHECK(samePixels(a, b));
+}
+
+} // namespace
+
+int main() {
+    testRectangles();
+    testTriangles();
+    testIntegerMatchesFloat();
+    testFloorRounding();
+    return finish("tiling");
+}